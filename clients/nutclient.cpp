@@ -747,6 +747,22 @@ std::map<std::string,std::vector<std::string> > Client::getDeviceVariableValues(
 	return res;
 }
 
+std::map<std::string,VariableInfo> Client::getDeviceVariableInfos(const std::string& dev)
+{
+	std::map<std::string,VariableInfo> res;
+
+	// Only values and descriptions are known at this level
+	std::map<std::string,std::vector<std::string> > values = getDeviceVariableValues(dev);
+	for(std::map<std::string,std::vector<std::string> >::iterator it=values.begin(); it!=values.end(); ++it)
+	{
+		VariableInfo& info = res[it->first];
+		info.values = it->second;
+		info.description = getDeviceVariableDescription(dev, it->first);
+	}
+
+	return res;
+}
+
 std::map<std::string,std::map<std::string,std::vector<std::string> > > Client::getDevicesVariableValues(const std::set<std::string>& devs)
 {
 	std::map<std::string,std::map<std::string,std::vector<std::string> > > res;
@@ -1006,6 +1022,60 @@ std::map<std::string,std::map<std::string,std::vector<std::string> > > TcpClient
 	return map;
 }
 
+std::map<std::string,VariableInfo> TcpClient::getDeviceVariableInfos(const std::string& dev)
+{
+	std::map<std::string,VariableInfo> map;
+	std::vector<std::vector<std::string> > res;
+
+	try
+	{
+		res = list("VARINFO", dev);
+	}
+	catch (NutException& ex)
+	{
+		// upsd older than protocol 1.4: ask about each variable
+		if (ex.str() != "INVALID-ARGUMENT")
+		{
+			throw;
+		}
+
+		map = Client::getDeviceVariableInfos(dev);
+		for (std::map<std::string,VariableInfo>::iterator it=map.begin(); it!=map.end(); ++it)
+		{
+			VariableInfo& info = it->second;
+			std::string var = dev + " " + it->first;
+
+			info.type = get("TYPE", var);
+			for (size_t n=0; n<info.type.size(); ++n)
+			{
+				if (info.type[n] == "ENUM")
+				{
+					std::vector<std::vector<std::string> > enums = list("ENUM", var);
+					for (size_t i=0; i<enums.size(); ++i)
+					{
+						info.enums.push_back(enums[i][0]);
+					}
+				}
+				else if (info.type[n] == "RANGE")
+				{
+					std::vector<std::vector<std::string> > ranges = list("RANGE", var);
+					for (size_t i=0; i<ranges.size(); ++i)
+					{
+						if (ranges[i].size() >= 2)
+						{
+							info.ranges.push_back(std::make_pair(ranges[i][0], ranges[i][1]));
+						}
+					}
+				}
+			}
+		}
+
+		return map;
+	}
+
+	return parseVariableInfos(res);
+}
+
 TrackingID TcpClient::setDeviceVariable(const std::string& dev, const std::string& name, const std::string& value)
 {
 	std::string query = "SET VAR " + dev + " " + name + " " + escape(value);
@@ -1245,6 +1315,48 @@ std::vector<std::vector<std::string> > TcpClient::parseList
 	}
 }
 
+std::map<std::string,VariableInfo> TcpClient::parseVariableInfos(const std::vector<std::vector<std::string> >& lines)
+{
+	std::map<std::string,VariableInfo> map;
+
+	// <varname> <what> <args>...
+	for (size_t n=0; n<lines.size(); ++n)
+	{
+		const std::vector<std::string>& vals = lines[n];
+		if (vals.size() < 3)
+		{
+			continue;
+		}
+
+		VariableInfo& info = map[vals[0]];
+		const std::string& what = vals[1];
+
+		if (what == "VALUE")
+		{
+			info.values.assign(vals.begin() + 2, vals.end());
+		}
+		else if (what == "TYPE")
+		{
+			info.type.assign(vals.begin() + 2, vals.end());
+		}
+		else if (what == "DESC")
+		{
+			info.description = vals[2];
+		}
+		else if (what == "ENUM")
+		{
+			info.enums.push_back(vals[2]);
+		}
+		else if (what == "RANGE" && vals.size() >= 4)
+		{
+			info.ranges.push_back(std::make_pair(vals[2], vals[3]));
+		}
+		// Other keywords may be added by later upsd versions
+	}
+
+	return map;
+}
+
 std::string TcpClient::sendQuery(const std::string& req)
 {
 	_socket->write(req);
@@ -1520,6 +1632,12 @@ std::set<std::string> Device::getRWVariableNames()
 	return getClient()->getDeviceRWVariableNames(getName());
 }
 
+std::map<std::string,VariableInfo> Device::getVariableInfos()
+{
+	if (!isOk()) throw NutException("Invalid device");
+	return getClient()->getDeviceVariableInfos(getName());
+}
+
 void Device::setVariable(const std::string& name, const std::string& value)
 {
 	if (!isOk()) throw NutException("Invalid device");
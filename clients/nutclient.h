@@ -27,6 +27,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <utility>
 #include <exception>
 #include <cstdint>
 #include <ctime>
@@ -149,6 +150,24 @@ typedef enum
 
 typedef std::string Feature;
 
+/**
+ * Value and metadata of a device variable.
+ * \see Client::getDeviceVariableInfos()
+ */
+struct VariableInfo
+{
+	/** Variable values (usually one). */
+	std::vector<std::string> values;
+	/** Variable description, if provided. */
+	std::string description;
+	/** Words of the variable type, as in "GET TYPE" ("RW", "ENUM", "RANGE", "STRING:<len>" or "NUMBER"). */
+	std::vector<std::string> type;
+	/** Enumerated values, if any. */
+	std::vector<std::string> enums;
+	/** Ranges of values (min, max), if any. */
+	std::vector<std::pair<std::string,std::string> > ranges;
+};
+
 /**
  * A nut client is the starting point to dialog to NUTD.
  * It can connect to an NUTD then retrieve its device list.
@@ -264,6 +283,13 @@ public:
 	 * \return Variable values indexed by variable names, indexed by device names.
 	 */
 	virtual std::map<std::string,std::map<std::string,std::vector<std::string> > > getDevicesVariableValues(const std::set<std::string>& devs);
+	/**
+	 * Retrieve values, types, descriptions, enumerated values and ranges
+	 * of all variables of a device.
+	 * \param dev Device name
+	 * \return Variable information indexed by variable names.
+	 */
+	virtual std::map<std::string,VariableInfo> getDeviceVariableInfos(const std::string& dev);
 	/**
 	 * Intend to set the value of a variable.
 	 * \param dev Device name
@@ -376,6 +402,8 @@ class TcpClient : public Client
 	 * generally, but still want covered with integration tests
 	 */
 	friend class NutActiveClientTest;
+	/* ...and some parsing covered by unit tests */
+	friend class NutClientTest;
 
 public:
 	/**
@@ -457,6 +485,7 @@ public:
 	virtual std::vector<std::string> getDeviceVariableValue(const std::string& dev, const std::string& name) override;
 	virtual std::map<std::string,std::vector<std::string> > getDeviceVariableValues(const std::string& dev) override;
 	virtual std::map<std::string,std::map<std::string,std::vector<std::string> > > getDevicesVariableValues(const std::set<std::string>& devs) override;
+	virtual std::map<std::string,VariableInfo> getDeviceVariableInfos(const std::string& dev) override;
 	virtual TrackingID setDeviceVariable(const std::string& dev, const std::string& name, const std::string& value) override;
 	virtual TrackingID setDeviceVariable(const std::string& dev, const std::string& name, const std::vector<std::string>& values) override;
 
@@ -496,6 +525,8 @@ protected:
 	static std::vector<std::string> explode(const std::string& str, size_t begin=0);
 	static std::string escape(const std::string& str);
 
+	static std::map<std::string,VariableInfo> parseVariableInfos(const std::vector<std::vector<std::string> >& lines);
+
 private:
 	std::string _host;
 	uint16_t _port;
@@ -583,6 +614,12 @@ public:
 	 * \return Set of available Read/Write variable names.
 	 */
 	std::set<std::string> getRWVariableNames();
+	/**
+	 * Retrieve values, types, descriptions, enumerated values and ranges
+	 * of all variables of the device.
+	 * \return Map of variable information indexed by variable names.
+	 */
+	std::map<std::string,VariableInfo> getVariableInfos();
 	/**
 	 * Intend to set the value of a variable of the device.
 	 * \param name Variable name.
@@ -26,6 +26,7 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/wait.h>
 #endif
 
 #include "nut_stdint.h"
@@ -34,6 +35,44 @@
 static char		*upsname = NULL, *hostname = NULL;
 static UPSCONN_t	*ups = NULL;
 
+/* bulk mode (-b) */
+#define BULK_STYLE_TSV	0
+#define BULK_STYLE_JSON	1
+
+/* LIST VAR requests in flight on one connection */
+#define BULK_WINDOW	32
+
+/* how long a worker may overrun the deadline before it is killed */
+#define BULK_GRACE	2
+
+typedef struct {
+	char	*label;		/* as given, or "<ups>@<host>" when expanded */
+	char	*upsname;	/* "*" for all UPSes on the host */
+} bulk_target_t;
+
+typedef struct bulk_host_s {
+	char		*hostname;
+	uint16_t	port;
+	bulk_target_t	*targets;
+	size_t		numtargets;
+	pid_t		pid;
+	int		fd;		/* output of the worker */
+	char		*buf;		/* partial line read from fd */
+	size_t		buflen;
+	struct bulk_host_s	*next;
+} bulk_host_t;
+
+typedef struct {
+	char	*data;
+	size_t	len;
+	size_t	size;
+} bulk_out_t;
+
+static bulk_host_t	*bulk_hosts = NULL;
+static int	bulk_style = BULK_STYLE_TSV;
+static time_t	bulk_deadline = 0;
+static volatile sig_atomic_t	bulk_timedout = 0;
+
 static void usage(const char *prog)
 {
 	printf("Network UPS Tools upsc %s\n\n", UPS_VERSION);
@@ -41,6 +80,7 @@ static void usage(const char *prog)
 	printf("usage: %s -l | -L [<hostname>[:port]]\n", prog);
 	printf("       %s <ups> [<variable>]\n", prog);
 	printf("       %s -c <ups>\n", prog);
+	printf("       %s -b [-j <jobs>] [-t <seconds>] [-o tsv|json] [<ups> ...]\n", prog);
 
 	printf("\nDemo program to display UPS variables.\n\n");
 
@@ -58,6 +98,14 @@ static void usage(const char *prog)
 	printf("  -c         - lists each client connected on <ups>, one per line.\n");
 	printf("  <ups>      - upsd server, <upsname>[@<hostname>[:<port>]] form\n");
 
+	printf("\nFourth form (bulk listing of variables):\n");
+	printf("  -b         - list the variables of each <ups>, querying the servers in parallel.\n");
+	printf("               Use * as <upsname> for all UPSes on a server.\n");
+	printf("               Targets are read from stdin if none or - is given.\n");
+	printf("  -j <jobs>  - number of servers queried at the same time (default: 16)\n");
+	printf("  -t <secs>  - give up on targets not listed after so many seconds (default: 30)\n");
+	printf("  -o <style> - output as tsv (target, variable, value) or json (one line per target)\n");
+
 	printf("\nCommon arguments:\n");
 	printf("  -V         - display the version of this software\n");
 	printf("  -h         - display this help text\n");
@@ -205,8 +253,576 @@ static void list_clients(const char *devname)
 	}
 }
 
+static void bulk_append(bulk_out_t *out, const char *s, size_t len)
+{
+	if (out->len + len + 1 > out->size) {
+		out->size = out->len + len + 1 + LARGEBUF;
+		out->data = xrealloc(out->data, out->size);
+	}
+
+	memcpy(out->data + out->len, s, len);
+	out->len += len;
+	out->data[out->len] = '\0';
+}
+
+static void bulk_puts(bulk_out_t *out, const char *s)
+{
+	bulk_append(out, s, strlen(s));
+}
+
+/* append s as a JSON string, or as a TSV field */
+static void bulk_escape(bulk_out_t *out, const char *s)
+{
+	char	esc[8];
+
+	if (bulk_style == BULK_STYLE_JSON)
+		bulk_puts(out, "\"");
+
+	for (; *s; s++) {
+		if (*s == '\\') {
+			bulk_puts(out, "\\\\");
+		} else if (*s == '\t') {
+			bulk_puts(out, "\\t");
+		} else if (*s == '\n') {
+			bulk_puts(out, "\\n");
+		} else if (bulk_style == BULK_STYLE_JSON && *s == '"') {
+			bulk_puts(out, "\\\"");
+		} else if (bulk_style == BULK_STYLE_JSON && (unsigned char)*s < 0x20) {
+			snprintf(esc, sizeof(esc), "\\u%04x", (unsigned int)(unsigned char)*s);
+			bulk_puts(out, esc);
+		} else {
+			bulk_append(out, s, 1);
+		}
+	}
+
+	if (bulk_style == BULK_STYLE_JSON)
+		bulk_puts(out, "\"");
+}
+
+/* start the record of a target */
+static void bulk_begin(bulk_out_t *out, const bulk_host_t *host, const bulk_target_t *target)
+{
+	char	port[16];
+
+	out->len = 0;
+
+	if (bulk_style != BULK_STYLE_JSON)
+		return;
+
+	snprintf(port, sizeof(port), "%" PRIu16, host->port);
+
+	bulk_puts(out, "{\"target\":");
+	bulk_escape(out, target->label);
+	bulk_puts(out, ",\"ups\":");
+	bulk_escape(out, target->upsname);
+	bulk_puts(out, ",\"host\":");
+	bulk_escape(out, host->hostname);
+	bulk_puts(out, ",\"port\":");
+	bulk_puts(out, port);
+}
+
+static void bulk_var(bulk_out_t *out, const bulk_target_t *target, size_t numvars,
+	const char *name, const char *value)
+{
+	if (bulk_style == BULK_STYLE_JSON) {
+		bulk_puts(out, numvars ? "," : ",\"vars\":{");
+		bulk_escape(out, name);
+		bulk_puts(out, ":");
+		bulk_escape(out, value);
+		return;
+	}
+
+	/* <target> TAB <variable> TAB <value> */
+	bulk_escape(out, target->label);
+	bulk_puts(out, "\t");
+	bulk_escape(out, name);
+	bulk_puts(out, "\t");
+	bulk_escape(out, value);
+	bulk_puts(out, "\n");
+}
+
+static void bulk_end(bulk_out_t *out, size_t numvars)
+{
+	if (bulk_style == BULK_STYLE_JSON)
+		bulk_puts(out, numvars ? "}}\n" : ",\"vars\":{}}\n");
+}
+
+/* the record of a target that could not be listed */
+static void bulk_fail(bulk_out_t *out, const bulk_host_t *host, const bulk_target_t *target,
+	const char *error)
+{
+	bulk_begin(out, host, target);
+
+	if (bulk_style == BULK_STYLE_JSON) {
+		bulk_puts(out, ",\"error\":");
+		bulk_escape(out, error);
+		bulk_puts(out, "}\n");
+		return;
+	}
+
+	/* <target> TAB TAB <error> */
+	bulk_escape(out, target->label);
+	bulk_puts(out, "\t\t");
+	bulk_escape(out, error);
+	bulk_puts(out, "\n");
+}
+
+static void bulk_write(int fd, const bulk_out_t *out)
+{
+	size_t	done = 0;
+	ssize_t	ret;
+
+	while (done < out->len) {
+		ret = write(fd, out->data + done, out->len - done);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return;
+		}
+
+		done += (size_t)ret;
+	}
+}
+
+static const char *bulk_strerror(UPSCONN_t *conn)
+{
+	return bulk_timedout ? "Timeout" : upscli_strerror(conn);
+}
+
+/* Replace the "*" targets of a host with the UPSes its upsd serves */
+static void bulk_expand(UPSCONN_t *conn, bulk_host_t *host, bulk_out_t *out, int fd, size_t *failed)
+{
+	int	ret;
+	size_t	i, len, numa, numtargets = 0;
+	const char	*query[1];
+	char	**answer;
+	bulk_target_t	*targets = NULL, *target;
+
+	for (i = 0; i < host->numtargets; i++) {
+		target = &host->targets[i];
+
+		if (strcmp(target->upsname, "*")) {
+			targets = xrealloc(targets, (numtargets + 1) * sizeof(*targets));
+			targets[numtargets++] = *target;
+			continue;
+		}
+
+		query[0] = "UPS";
+
+		if (bulk_timedout || upscli_list_start(conn, 1, query) < 0) {
+			bulk_fail(out, host, target, bulk_strerror(conn));
+			bulk_write(fd, out);
+			(*failed)++;
+		} else {
+			while ((ret = upscli_list_next(conn, 1, query, &numa, &answer)) == 1) {
+				/* UPS <upsname> <description> */
+				if (numa < 3)
+					continue;
+
+				targets = xrealloc(targets, (numtargets + 1) * sizeof(*targets));
+				targets[numtargets].upsname = xstrdup(answer[1]);
+				/* "*@host" becomes "<upsname>@host" */
+				len = strlen(answer[1]) + strlen(target->label);
+				targets[numtargets].label = xcalloc(1, len);
+				snprintf(targets[numtargets].label, len, "%s%s", answer[1], target->label + 1);
+				numtargets++;
+			}
+
+			if (ret < 0) {
+				bulk_fail(out, host, target, bulk_strerror(conn));
+				bulk_write(fd, out);
+				(*failed)++;
+			}
+		}
+
+		free(target->label);
+		free(target->upsname);
+	}
+
+	free(host->targets);
+	host->targets = targets;
+	host->numtargets = numtargets;
+}
+
+/* Query all the targets on one upsd, and write the record of each to fd
+ * as soon as it is complete. The LIST VAR requests are pipelined on a
+ * single connection. Returns the number of targets that failed. */
+static size_t bulk_query(bulk_host_t *host, int fd)
+{
+	int	ret;
+	size_t	i, sent = 0, numa, numvars, failed = 0;
+	time_t	now;
+	const char	*query[2];
+	char	**answer, buf[UPSCLI_NETBUF_LEN], lost[UPSCLI_ERRBUF_LEN];
+	struct timeval	tv;
+	UPSCONN_t	conn;
+	bulk_out_t	out;
+	bulk_target_t	*target;
+
+	memset(&conn, 0, sizeof(conn));
+	memset(&out, 0, sizeof(out));
+
+	time(&now);
+	tv.tv_sec = (bulk_deadline > now) ? bulk_deadline - now : 0;
+	tv.tv_usec = 0;
+
+	if (!bulk_timedout)
+		upscli_tryconnect(&conn, host->hostname, host->port, UPSCLI_CONN_TRYSSL, &tv);
+
+	if (upscli_fd(&conn) >= 0 && !bulk_timedout)
+		bulk_expand(&conn, host, &out, fd, &failed);
+
+	/* what to tell about the targets once the connection is gone */
+	snprintf(lost, sizeof(lost), "%s", bulk_strerror(&conn));
+
+	for (i = 0; i < host->numtargets; i++) {
+		target = &host->targets[i];
+
+		/* keep up to BULK_WINDOW requests ahead of the answers */
+		while (sent < host->numtargets && sent - i < BULK_WINDOW
+			&& upscli_fd(&conn) >= 0 && !bulk_timedout
+		) {
+			snprintf(buf, sizeof(buf), "LIST VAR %s\n", host->targets[sent].upsname);
+
+			if (upscli_sendline(&conn, buf, strlen(buf)) != 0) {
+				snprintf(lost, sizeof(lost), "%s", bulk_strerror(&conn));
+				break;
+			}
+
+			sent++;
+		}
+
+		if (i >= sent || bulk_timedout) {
+			bulk_fail(&out, host, target, bulk_timedout ? "Timeout" : lost);
+			bulk_write(fd, &out);
+			failed++;
+			continue;
+		}
+
+		if (upscli_readline(&conn, buf, sizeof(buf)) != 0) {
+			snprintf(lost, sizeof(lost), "%s", bulk_strerror(&conn));
+			sent = i;
+			bulk_fail(&out, host, target, lost);
+			bulk_write(fd, &out);
+			failed++;
+			continue;
+		}
+
+		if (strncmp(buf, "BEGIN LIST VAR ", 15) != 0) {
+			/* upsd error name, e.g. "UNKNOWN-UPS" */
+			buf[strcspn(buf, "\r\n")] = '\0';
+			bulk_fail(&out, host, target, strncmp(buf, "ERR ", 4) ? buf : buf + 4);
+			bulk_write(fd, &out);
+			failed++;
+			continue;
+		}
+
+		query[0] = "VAR";
+		query[1] = target->upsname;
+		numvars = 0;
+
+		bulk_begin(&out, host, target);
+
+		while ((ret = upscli_list_next(&conn, 2, query, &numa, &answer)) == 1) {
+			/* VAR <upsname> <varname> <val> */
+			if (numa < 4)
+				continue;
+
+			bulk_var(&out, target, numvars++, answer[2], answer[3]);
+		}
+
+		if (ret < 0) {
+			/* out of step with upsd now, give up on the connection */
+			snprintf(lost, sizeof(lost), "%s", bulk_strerror(&conn));
+			upscli_disconnect(&conn);
+			sent = i;
+			bulk_fail(&out, host, target, lost);
+			bulk_write(fd, &out);
+			failed++;
+			continue;
+		}
+
+		bulk_end(&out, numvars);
+		bulk_write(fd, &out);
+	}
+
+	upscli_disconnect(&conn);
+	free(out.data);
+
+	return failed;
+}
+
+/* Add "<ups>[@<host>[:<port>]]" to the targets of its upsd */
+static int bulk_add(const char *spec)
+{
+	char	*name = NULL, *host = NULL;
+	uint16_t	port;
+	bulk_host_t	*tmp, *last = NULL;
+
+	if (upscli_splitname(spec, &name, &host, &port) != 0) {
+		upslogx(LOG_ERR, "Error: invalid UPS definition '%s'", spec);
+		free(name);
+		free(host);
+		return -1;
+	}
+
+	for (tmp = bulk_hosts; tmp; tmp = tmp->next) {
+		if ((tmp->port == port) && (!strcasecmp(tmp->hostname, host)))
+			break;
+
+		last = tmp;
+	}
+
+	if (tmp) {
+		free(host);
+	} else {
+		tmp = xcalloc(1, sizeof(*tmp));
+		tmp->hostname = host;
+		tmp->port = port;
+		tmp->fd = -1;
+
+		if (last)
+			last->next = tmp;
+		else
+			bulk_hosts = tmp;
+	}
+
+	tmp->targets = xrealloc(tmp->targets, (tmp->numtargets + 1) * sizeof(*tmp->targets));
+	tmp->targets[tmp->numtargets].label = xstrdup(spec);
+	tmp->targets[tmp->numtargets].upsname = name;
+	tmp->numtargets++;
+
+	return 0;
+}
+
+/* Add the targets listed in fp, separated by blanks or newlines */
+static int bulk_read(FILE *fp)
+{
+	int	ret = 0;
+	char	buf[LARGEBUF], *s, *last = NULL;
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (buf[0] == '#')
+			continue;
+
+		for (s = strtok_r(buf, " \t\r\n", &last); s; s = strtok_r(NULL, " \t\r\n", &last)) {
+			if (bulk_add(s) < 0)
+				ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+#ifndef WIN32
+static void bulk_alarm(int sig)
+{
+	NUT_UNUSED_VARIABLE(sig);
+
+	bulk_timedout = 1;
+}
+
+/* Fork the worker for a host, its records are read from host->fd */
+static void bulk_start(bulk_host_t *host)
+{
+	int	pipefd[2];
+	struct sigaction	sa;
+
+	if (pipe(pipefd) < 0)
+		fatal_with_errno(EXIT_FAILURE, "pipe");
+
+	fflush(stdout);
+
+	host->pid = fork();
+
+	if (host->pid < 0)
+		fatal_with_errno(EXIT_FAILURE, "fork");
+
+	if (host->pid == 0) {
+		close(pipefd[0]);
+
+		/* no SA_RESTART: the alarm has to break out of blocked I/O */
+		sigemptyset(&sa.sa_mask);
+		sa.sa_flags = 0;
+		sa.sa_handler = bulk_alarm;
+		sigaction(SIGALRM, &sa, NULL);
+
+		sa.sa_handler = SIG_IGN;
+		sigaction(SIGPIPE, &sa, NULL);
+
+		alarm((unsigned int)(bulk_deadline - time(NULL)));
+
+		_exit(bulk_query(host, pipefd[1]) ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	close(pipefd[1]);
+	host->fd = pipefd[0];
+}
+
+/* Copy the complete lines a worker wrote to stdout, so that records
+ * from different workers are not mixed. Returns 0 at end of file. */
+static int bulk_collect(bulk_host_t *host)
+{
+	char	buf[LARGEBUF];
+	ssize_t	ret;
+	size_t	len;
+
+	ret = read(host->fd, buf, sizeof(buf));
+
+	if (ret < 0 && errno == EINTR)
+		return 1;
+
+	if (ret <= 0)
+		return 0;
+
+	host->buf = xrealloc(host->buf, host->buflen + (size_t)ret);
+	memcpy(host->buf + host->buflen, buf, (size_t)ret);
+	host->buflen += (size_t)ret;
+
+	for (len = host->buflen; len > 0 && host->buf[len - 1] != '\n'; len--)
+		;
+
+	if (len > 0) {
+		fwrite(host->buf, 1, len, stdout);
+		fflush(stdout);
+
+		memmove(host->buf, host->buf + len, host->buflen - len);
+		host->buflen -= len;
+	}
+
+	return 1;
+}
+
+/* Query up to jobs hosts at a time, returns nonzero if a target failed */
+static int bulk_run(int jobs)
+{
+	int	ret, status, maxfd, running = 0, failed = 0;
+	time_t	now;
+	fd_set	rfds;
+	struct timeval	tv;
+	bulk_host_t	*tmp, *next = bulk_hosts;
+
+	while (next || running) {
+		while (next && running < jobs) {
+			if (time(NULL) >= bulk_deadline) {
+				/* too late to ask, report its targets right away */
+				bulk_timedout = 1;
+				fflush(stdout);
+
+				if (bulk_query(next, STDOUT_FILENO))
+					failed = 1;
+			} else {
+				bulk_start(next);
+				running++;
+			}
+
+			next = next->next;
+		}
+
+		if (!running)
+			continue;
+
+		FD_ZERO(&rfds);
+		maxfd = -1;
+
+		for (tmp = bulk_hosts; tmp != next; tmp = tmp->next) {
+			if (tmp->fd < 0)
+				continue;
+
+			FD_SET(tmp->fd, &rfds);
+
+			if (tmp->fd > maxfd)
+				maxfd = tmp->fd;
+		}
+
+		time(&now);
+		tv.tv_sec = (bulk_deadline + BULK_GRACE > now) ? bulk_deadline + BULK_GRACE - now : 0;
+		tv.tv_usec = 0;
+
+		ret = select(maxfd + 1, &rfds, NULL, NULL, &tv);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			fatal_with_errno(EXIT_FAILURE, "select");
+		}
+
+		for (tmp = bulk_hosts; tmp != next; tmp = tmp->next) {
+			if (tmp->fd < 0)
+				continue;
+
+			if (ret > 0) {
+				if (!FD_ISSET(tmp->fd, &rfds) || bulk_collect(tmp))
+					continue;
+			} else {
+				/* stuck past the deadline (e.g. in name resolution) */
+				upslogx(LOG_ERR, "Error: no answer from %s:%" PRIu16 " in time",
+					tmp->hostname, tmp->port);
+				kill(tmp->pid, SIGKILL);
+				failed = 1;
+			}
+
+			close(tmp->fd);
+			tmp->fd = -1;
+			running--;
+
+			if (waitpid(tmp->pid, &status, 0) < 0
+				|| !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS
+			) {
+				failed = 1;
+			}
+		}
+	}
+
+	return failed;
+}
+#else	/* WIN32 */
+/* no fork() here, so the hosts are queried one after the other */
+static int bulk_run(int jobs)
+{
+	int	failed = 0;
+	bulk_host_t	*tmp;
+
+	NUT_UNUSED_VARIABLE(jobs);
+
+	for (tmp = bulk_hosts; tmp; tmp = tmp->next) {
+		if (time(NULL) >= bulk_deadline)
+			bulk_timedout = 1;
+
+		fflush(stdout);
+
+		if (bulk_query(tmp, fileno(stdout)))
+			failed = 1;
+	}
+
+	return failed;
+}
+#endif	/* WIN32 */
+
 static void clean_exit(void)
 {
+	size_t	i;
+	bulk_host_t	*tmp;
+
+	while (bulk_hosts) {
+		tmp = bulk_hosts->next;
+
+		for (i = 0; i < bulk_hosts->numtargets; i++) {
+			free(bulk_hosts->targets[i].label);
+			free(bulk_hosts->targets[i].upsname);
+		}
+
+		free(bulk_hosts->targets);
+		free(bulk_hosts->hostname);
+		free(bulk_hosts->buf);
+		free(bulk_hosts);
+
+		bulk_hosts = tmp;
+	}
+
 	if (ups) {
 		upscli_disconnect(ups);
 	}
@@ -221,6 +837,7 @@ int main(int argc, char **argv)
 	int	i = 0;
 	uint16_t	port;
 	int	varlist = 0, clientlist = 0, verbose = 0;
+	int	bulk = 0, bulk_jobs = 16, bulk_timeout = 30, bulk_error = 0;
 	const char	*prog = xbasename(argv[0]);
 	char	*s = NULL;
 
@@ -235,7 +852,7 @@ int main(int argc, char **argv)
 	}
 	upsdebugx(1, "Starting NUT client: %s", prog);
 
-	while ((i = getopt(argc, argv, "+hlLcV")) != -1) {
+	while ((i = getopt(argc, argv, "+hlLcVbj:t:o:")) != -1) {
 
 		switch (i)
 		{
@@ -249,6 +866,28 @@ int main(int argc, char **argv)
 		case 'c':
 			clientlist = 1;
 			break;
+		case 'b':
+			bulk = 1;
+			break;
+		case 'j':
+			if (!str_to_int(optarg, &bulk_jobs, 10) || bulk_jobs < 1) {
+				fatalx(EXIT_FAILURE, "Error: invalid number of jobs '%s'", optarg);
+			}
+			break;
+		case 't':
+			if (!str_to_int(optarg, &bulk_timeout, 10) || bulk_timeout < 1) {
+				fatalx(EXIT_FAILURE, "Error: invalid timeout '%s'", optarg);
+			}
+			break;
+		case 'o':
+			if (!strcasecmp(optarg, "tsv")) {
+				bulk_style = BULK_STYLE_TSV;
+			} else if (!strcasecmp(optarg, "json")) {
+				bulk_style = BULK_STYLE_JSON;
+			} else {
+				fatalx(EXIT_FAILURE, "Error: invalid output style '%s' (tsv or json)", optarg);
+			}
+			break;
 
 		case 'V':
 			nut_report_config_flags();
@@ -271,6 +910,29 @@ int main(int argc, char **argv)
 	/* be a good little client that cleans up after itself */
 	atexit(clean_exit);
 
+	if (bulk) {
+		if (argc < 1) {
+			bulk_error = bulk_read(stdin);
+		}
+
+		for (i = 0; i < argc; i++) {
+			if (!strcmp(argv[i], "-")) {
+				if (bulk_read(stdin) < 0)
+					bulk_error = -1;
+			} else if (bulk_add(argv[i]) < 0) {
+				bulk_error = -1;
+			}
+		}
+
+		bulk_deadline = time(NULL) + bulk_timeout;
+
+		if (bulk_run(bulk_jobs) || bulk_error) {
+			exit(EXIT_FAILURE);
+		}
+
+		exit(EXIT_SUCCESS);
+	}
+
 	if (varlist) {
 		if (upscli_splitaddr(argv[0] ? argv[0] : "localhost", &hostname, &port) != 0) {
 			fatalx(EXIT_FAILURE, "Error: invalid hostname.\nRequired format: [hostname[:port]]");
@@ -40,6 +40,7 @@
 #include "nut_stdint.h"
 #include "upsclient.h"
 #include "cgilib.h"
+#include "parseconf.h"
 #include <stdlib.h>
 #include <gd.h>
 #include <gdfontmb.h>
@@ -54,6 +55,10 @@ static	uint16_t	port;
 static	char	*upsname, *hostname;
 static	UPSCONN_t	ups;
 
+	/* IMAGECACHE from hosts.conf, and the image at hand */
+static	char	*imagecache = NULL;
+static	char	imagekey[LARGEBUF], imagetag[32];
+
 #define RED(x)		((x >> 16) & 0xff)
 #define GREEN(x)	((x >> 8)  & 0xff)
 #define BLUE(x)		(x & 0xff)
@@ -114,17 +119,167 @@ static int get_imgarg(const char *name)
 	return -1;
 }
 
+/* IMAGECACHE <directory> */
+static void load_imagecache(void)
+{
+	char	fn[SMALLBUF];
+	PCONF_CTX_t	ctx;
+
+	snprintf(fn, sizeof(fn), "%s/hosts.conf", confpath());
+
+	pconf_init(&ctx, NULL);
+
+	if (!pconf_file_begin(&ctx, fn)) {
+		pconf_finish(&ctx);
+		return;
+	}
+
+	while (pconf_file_next(&ctx)) {
+		if (pconf_parse_error(&ctx) || ctx.numargs < 2)
+			continue;
+
+		if (!strcmp(ctx.arglist[0], "IMAGECACHE")) {
+			free(imagecache);
+			imagecache = xstrdup(ctx.arglist[1]);
+		}
+	}
+
+	pconf_finish(&ctx);
+}
+
+/* 64-bit FNV-1a */
+static uint64_t hash_key(const char *key)
+{
+	uint64_t	h = 0xcbf29ce484222325ULL;
+
+	while (*key) {
+		h ^= (unsigned char)*key++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+static void imagecache_fn(char *fn, size_t fnlen)
+{
+	/* the tag without its quotes */
+	snprintf(fn, fnlen, "%s/%.16s.png", imagecache, imagetag + 1);
+}
+
+/* What gets drawn is fully described by what (the scale, the bar and
+ * its text, or an error message) and the imgarg settings: if the
+ * browser already has that image, or IMAGECACHE has a copy of it,
+ * answer from there without drawing anything */
+static void image_lookup(const char *what)
+{
+	char	fn[SMALLBUF], buf[LARGEBUF];
+	const	char	*inm;
+	size_t	len, keylen;
+	FILE	*f;
+	int	i;
+
+	snprintf(imagekey, sizeof(imagekey), "%s", what);
+
+	for (i = 0; imgarg[i].name != NULL; i++)
+		snprintfcat(imagekey, sizeof(imagekey), " %s=%d", imgarg[i].name, imgarg[i].val);
+
+	snprintf(imagetag, sizeof(imagetag), "\"%016" PRIx64 "\"", hash_key(imagekey));
+
+	inm = getenv("HTTP_IF_NONE_MATCH");
+
+	if (inm && strstr(inm, imagetag)) {
+		printf("Status: 304 Not Modified\n");
+		printf("ETag: %s\n\n", imagetag);
+
+		upscli_disconnect(&ups);
+		exit(EXIT_SUCCESS);
+	}
+
+	if (!imagecache)
+		return;
+
+	imagecache_fn(fn, sizeof(fn));
+
+	if ((f = fopen(fn, "rb")) == NULL)
+		return;
+
+	/* the file starts with the key, in case two of them hash the same */
+	keylen = strlen(imagekey);
+
+	if (fread(buf, 1, keylen + 1, f) != keylen + 1
+	 || memcmp(buf, imagekey, keylen) != 0 || buf[keylen] != '\n'
+	) {
+		fclose(f);
+		return;
+	}
+
+	printf("Pragma: no-cache\n");
+	printf("ETag: %s\n", imagetag);
+	printf("Content-type: image/png\n\n");
+
+	while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+		if (fwrite(buf, 1, len, stdout) != len)
+			break;
+	}
+
+	fclose(f);
+
+	upscli_disconnect(&ups);
+	exit(EXIT_SUCCESS);
+}
+
+/* keep a copy of the encoded image in IMAGECACHE, if set */
+static void image_store(const void *png, size_t size)
+{
+	char	fn[SMALLBUF], tmpfn[SMALLBUF + 32];
+	FILE	*f;
+	int	ok;
+
+	if (!imagecache || !imagetag[0])
+		return;
+
+	imagecache_fn(fn, sizeof(fn));
+	snprintf(tmpfn, sizeof(tmpfn), "%s.%" PRIiMAX, fn, (intmax_t)getpid());
+
+	if ((f = fopen(tmpfn, "wb")) == NULL) {
+		fprintf(stderr, "upsimage: Can't create %s: %s\n", tmpfn, strerror(errno));
+		return;
+	}
+
+	ok = (fprintf(f, "%s\n", imagekey) > 0);
+	ok = (ok && fwrite(png, 1, size, f) == size);
+	ok = (fclose(f) == 0 && ok);
+
+	/* others only ever see complete files */
+	if (!ok || rename(tmpfn, fn) != 0) {
+		fprintf(stderr, "upsimage: Can't write %s: %s\n", fn, strerror(errno));
+		unlink(tmpfn);
+	}
+}
+
 /* write the HTML header then have gd dump the image */
 static void drawimage(gdImagePtr im)
 	__attribute__((noreturn));
 
 static void drawimage(gdImagePtr im)
 {
+	void	*png;
+	int	size = 0;
+
+	png = gdImagePngPtr(im, &size);
+	gdImageDestroy(im);
+
 	printf("Pragma: no-cache\n");
+	if (imagetag[0])
+		printf("ETag: %s\n", imagetag);
 	printf("Content-type: image/png\n\n");
 
-	gdImagePng(im, stdout);
-	gdImageDestroy(im);
+	if (png && size > 0) {
+		fwrite(png, 1, (size_t)size, stdout);
+		image_store(png, (size_t)size);
+	}
+
+	gdFree(png);
 
 	upscli_disconnect(&ups);
 
@@ -238,7 +393,7 @@ static void drawbar(
 {
 	gdImagePtr	im;
 	int		bar_color, summary_color;
-	char		text[SMALLBUF];
+	char		text[SMALLBUF], what[LARGEBUF];
 	int		bar_y;
 	int		width, height, scale_height;
 
@@ -247,17 +402,6 @@ static void drawbar(
 	height = get_imgarg("height");
 	scale_height = get_imgarg("scale_height");
 
-	/* create the image */
-	im = gdImageCreate(width, height);
-
-	/* draw the scale */
-	drawscale(im, lvllo, lvlhi, step, step5, step10, redlo1, redhi1,
-		redlo2, redhi2, grnlo, grnhi);
-
-	/* allocate colors for the bar and summary text */
-	bar_color	= color_alloc(im, get_imgarg("bar_col"));
-	summary_color	= color_alloc(im, get_imgarg("summary_col"));
-
 	/* rescale UPS value to fit in the scale */
 	bar_y = (int)((1.0 - (value - lvllo) / (lvlhi - lvllo)) * scale_height);
 
@@ -271,11 +415,7 @@ static void drawbar(
 	if (bar_y > scale_height)
 		bar_y = scale_height;
 
-	/* draw it */
-	gdImageFilledRectangle(im, 25, bar_y, width - 25, scale_height,
-		bar_color);
-
-	/* stick the text version of the value at the bottom center */
+	/* the text version of the value */
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
 #pragma GCC diagnostic push
 #endif
@@ -289,6 +429,29 @@ static void drawbar(
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
 #pragma GCC diagnostic pop
 #endif
+
+	/* the value only matters as far as it shows: bar height and text */
+	snprintf(what, sizeof(what), "bar %d %d %d %d %d %d %d %d %d %d %d %d %s",
+		lvllo, lvlhi, step, step5, step10, redlo1, redhi1,
+		redlo2, redhi2, grnlo, grnhi, bar_y, text);
+	image_lookup(what);
+
+	/* create the image */
+	im = gdImageCreate(width, height);
+
+	/* draw the scale */
+	drawscale(im, lvllo, lvlhi, step, step5, step10, redlo1, redhi1,
+		redlo2, redhi2, grnlo, grnhi);
+
+	/* allocate colors for the bar and summary text */
+	bar_color	= color_alloc(im, get_imgarg("bar_col"));
+	summary_color	= color_alloc(im, get_imgarg("summary_col"));
+
+	/* draw it */
+	gdImageFilledRectangle(im, 25, bar_y, width - 25, scale_height,
+		bar_color);
+
+	/* stick the text version of the value at the bottom center */
 	gdImageString(im, gdFontMediumBold,
 		(width - (int)(strlen(text))*gdFontMediumBold->w)/2,
 		height - gdFontMediumBold->h,
@@ -308,7 +471,7 @@ static void noimage(const char *fmt, ...)
 	gdImagePtr	im;
 	int		back_color, summary_color;
 	int		width, height;
-	char		msg[SMALLBUF];
+	char		msg[SMALLBUF], what[LARGEBUF];
 	va_list		ap;
 
 	va_start(ap, fmt);
@@ -327,6 +490,9 @@ static void noimage(const char *fmt, ...)
 #endif
 	va_end(ap);
 
+	snprintf(what, sizeof(what), "noimage %s", msg);
+	image_lookup(what);
+
 	width = get_imgarg("width");
 	height = get_imgarg("height");
 
@@ -622,6 +788,7 @@ int main(int argc, char **argv)
 	NUT_UNUSED_VARIABLE(argv);
 
 	extractcgiargs();
+	load_imagecache();
 
 	/* no 'host=' or 'display=' given */
 	if ((!monhost) || (!cmd))
@@ -35,6 +35,8 @@
 #include "nut_platform.h"
 #include "upsclient.h"
 
+#include <ctype.h>
+
 #include "config.h"
 #include "timehead.h"
 #include "nut_stdint.h"
@@ -55,6 +57,13 @@
 	static	char	logbuffer[LARGEBUF], *logformat;
 
 	static	flist_t	*fhead = NULL;
+
+	/* a variable of the UPS, as listed by upsd */
+	typedef struct {
+		char	*name;
+		char	*value;
+	} upsvar_t;
+
 	struct 	monhost_ups {
 		char	*monhost;
 		char	*logfn;
@@ -63,17 +72,72 @@
 		uint16_t	port;
 		UPSCONN_t	*ups;
 		FILE	*logfile;
+		int	listing;	/* LIST VAR sent, answer not read yet */
+		int	listed;		/* vars hold the answer of this interval */
+		upsvar_t	*vars;
+		size_t	numvars, maxvars;
 		struct	monhost_ups	*next;
 	};
 	static	struct	monhost_ups *monhost_ups_anchor = NULL;
 	static	struct	monhost_ups *monhost_ups_current = NULL;
 	static	struct	monhost_ups *monhost_ups_prev = NULL;
 
+	/* the format has VAR escapes, so fetch the variables */
+	static	int	format_vars = 0;
+
+	/* output style: the format as is, or its escapes as CSV or JSON fields */
+	typedef enum {
+		LOG_STYLE_TEXT = 0,
+		LOG_STYLE_CSV,
+		LOG_STYLE_JSON
+	} log_style_t;
+
+	static	log_style_t	log_style = LOG_STYLE_TEXT;
+
+	/* when > 0, log files are written at most every flush_interval
+	 * seconds (or when their buffer is full), not after each line */
+	static	int	flush_interval = 0;
+	static	time_t	lastflush = 0;
+
 
 #define DEFAULT_LOGFORMAT "%TIME @Y@m@d @H@M@S% %VAR battery.charge% " \
 		"%VAR input.voltage% %VAR ups.load% [%VAR ups.status%] " \
 		"%VAR ups.temperature% %VAR input.frequency%"
 
+/* prepare a newly (re)opened log file: its buffering, and for CSV,
+ * the header line with the field names if the file is empty */
+static void setup_logfile(struct monhost_ups *monhost_ups_print)
+{
+	flist_t	*tmp;
+	FILE	*logfile = monhost_ups_print->logfile;
+	const char	*sep = "";
+
+	/* stdout was already written to (banner), so its buffering can not
+	 * be changed anymore: it is left as is (full if not a terminal) */
+	if (flush_interval > 0 && logfile != stdout) {
+		setvbuf(logfile, NULL, _IOFBF, LARGEBUF * 16);
+	}
+
+	if (log_style != LOG_STYLE_CSV) {
+		return;
+	}
+
+	if (logfile != stdout) {
+		fseek(logfile, 0, SEEK_END);
+		if (ftell(logfile) > 0)
+			return;
+	}
+
+	for (tmp = fhead; tmp != NULL; tmp = tmp->next) {
+		if (tmp->name) {
+			fprintf(logfile, "%s%s", sep, tmp->name);
+			sep = ",";
+		}
+	}
+
+	fprintf(logfile, "\n");
+}
+
 static void reopen_log(void)
 {
 	for (monhost_ups_current = monhost_ups_anchor;
@@ -89,6 +153,8 @@ static void reopen_log(void)
 		    monhost_ups_current->logfile)) == NULL)
 			fatal_with_errno(EXIT_FAILURE,
 				"could not reopen logfile %s", logfn);
+
+		setup_logfile(monhost_ups_current);
 	}
 }
 
@@ -160,6 +226,10 @@ static void help(const char *prog)
 	printf("        	- Example: -s myups@server\n");
 	printf("  -m <tuple>	- Monitor UPS <ups,logfile>\n");
 	printf("		- Example: -m myups@server,/var/log/myups.log\n");
+	printf("  -o <style>	- Output style: text (the format as is, default),\n");
+	printf("		  csv or json (one field per format escape)\n");
+	printf("  -w <seconds>	- Write log files at most every <seconds>\n");
+	printf("		  (default 0: after each line)\n");
 	printf("  -u <user>	- Switch to <user> if started as root\n");
 	printf("  -V		- Display the version of this software\n");
 	printf("  -h		- Display this help text\n");
@@ -236,13 +306,102 @@ static void do_time(const char *arg)
 	free(format);
 }
 
+/* Send "LIST VAR" for the UPS. The answers are only read once this is
+ * sent for all the UPSes, so that they are worked on concurrently */
+static void list_vars_request(struct monhost_ups *monhost_ups_list)
+{
+	char	cmd[UPSCLI_NETBUF_LEN];
+
+	monhost_ups_list->listed = 0;
+	monhost_ups_list->listing = 0;
+
+	if (upscli_fd(monhost_ups_list->ups) < 0)
+		return;
+
+	snprintf(cmd, sizeof(cmd), "LIST VAR %s\n", monhost_ups_list->upsname);
+
+	if (upscli_sendline(monhost_ups_list->ups, cmd, strlen(cmd)) == 0)
+		monhost_ups_list->listing = 1;
+}
+
+/* Read the answer to list_vars_request() */
+static void list_vars_read(struct monhost_ups *monhost_ups_list)
+{
+	int	ret;
+	size_t	i, numa;
+	const	char	*query[2];
+	char	**answer, buf[UPSCLI_NETBUF_LEN];
+	upsvar_t	*var;
+
+	if (!monhost_ups_list->listing)
+		return;
+
+	monhost_ups_list->listing = 0;
+
+	for (i = 0; i < monhost_ups_list->numvars; i++) {
+		free(monhost_ups_list->vars[i].name);
+		free(monhost_ups_list->vars[i].value);
+	}
+
+	monhost_ups_list->numvars = 0;
+
+	if (upscli_readline(monhost_ups_list->ups, buf, sizeof(buf)) != 0)
+		return;
+
+	if (strncmp(buf, "BEGIN LIST VAR ", 15) != 0) {
+		/* e.g. "ERR UNKNOWN-UPS": no values then */
+		upsdebugx(1, "%s: %s: %s", __func__, monhost_ups_list->monhost, buf);
+		return;
+	}
+
+	query[0] = "VAR";
+	query[1] = monhost_ups_list->upsname;
+
+	while ((ret = upscli_list_next(monhost_ups_list->ups, 2, query, &numa, &answer)) == 1) {
+		if (numa < 4)
+			continue;
+
+		if (monhost_ups_list->numvars == monhost_ups_list->maxvars) {
+			monhost_ups_list->maxvars += 64;
+			monhost_ups_list->vars = xrealloc(monhost_ups_list->vars,
+				monhost_ups_list->maxvars * sizeof(upsvar_t));
+		}
+
+		var = &monhost_ups_list->vars[monhost_ups_list->numvars++];
+		var->name = xstrdup(answer[2]);
+		var->value = xstrdup(answer[3]);
+	}
+
+	if (ret < 0) {
+		/* out of step with upsd now, start over with a new connection */
+		upscli_disconnect(monhost_ups_list->ups);
+		return;
+	}
+
+	monhost_ups_list->listed = 1;
+}
+
 static void getvar(const char *var)
 {
 	int	ret;
-	size_t	numq, numa;
+	size_t	i, numq, numa;
 	const	char	*query[4];
 	char	**answer;
 
+	/* all the variables were listed for this round */
+	if (monhost_ups_current && monhost_ups_current->listed) {
+		for (i = 0; i < monhost_ups_current->numvars; i++) {
+			if (!strcasecmp(monhost_ups_current->vars[i].name, var)) {
+				snprintfcat(logbuffer, sizeof(logbuffer), "%s",
+					monhost_ups_current->vars[i].value);
+				return;
+			}
+		}
+
+		snprintfcat(logbuffer, sizeof(logbuffer), "NA");
+		return;
+	}
+
 	query[0] = "VAR";
 	query[1] = upsname;
 	query[2] = var;
@@ -295,7 +454,8 @@ static void print_literal(const char *arg)
 }
 
 /* register another parsing function to be called later */
-static void add_call(void (*fptr)(const char *arg), const char *arg)
+static void add_call(void (*fptr)(const char *arg), const char *arg,
+	const char *name)
 {
 	flist_t	*tmp, *last;
 
@@ -315,6 +475,11 @@ static void add_call(void (*fptr)(const char *arg), const char *arg)
 	else
 		tmp->arg = NULL;
 
+	if (name)
+		tmp->name = xstrdup(name);
+	else
+		tmp->name = NULL;
+
 	tmp->next = NULL;
 
 	if (last)
@@ -339,14 +504,14 @@ static void compile_format(void)
 
 			/* we have to stuff it into a string first */
 			snprintf(buf, sizeof(buf), "%c", logformat[i]);
-			add_call(print_literal, buf);
+			add_call(print_literal, buf, NULL);
 
 			continue;
 		}
 
 		/* if a %%, append % and start over */
 		if (logformat[i+1] == '%') {
-			add_call(print_literal, "%");
+			add_call(print_literal, "%", NULL);
 
 			/* make sure we don't parse the second % next time */
 			i++;
@@ -360,7 +525,7 @@ static void compile_format(void)
 
 		/* no trailing % = broken */
 		if (!ptr) {
-			add_call(print_literal, "INVALID");
+			add_call(print_literal, "INVALID", NULL);
 			free(cmd);
 			continue;
 		}
@@ -383,7 +548,19 @@ static void compile_format(void)
 			if (strncasecmp(cmd, logcmds[j].name,
 				strlen(logcmds[j].name)) == 0) {
 
-				add_call(logcmds[j].func, arg);
+				if (logcmds[j].func == do_var) {
+					format_vars = 1;
+					add_call(logcmds[j].func, arg, arg ? arg : "var");
+				} else {
+					char	name[SMALLBUF], *p;
+
+					snprintf(name, sizeof(name), "%s", logcmds[j].name);
+					for (p = name; *p; p++)
+						*p = (char)tolower((unsigned char)*p);
+
+					add_call(logcmds[j].func, arg, name);
+				}
+
 				found = 1;
 				break;
 			}
@@ -392,7 +569,7 @@ static void compile_format(void)
 		free(cmd);
 
 		if (!found)
-			add_call(print_literal, "INVALID");
+			add_call(print_literal, "INVALID", NULL);
 
 		/* now do the skip ahead saved from before */
 		i += ofs;
@@ -400,23 +577,125 @@ static void compile_format(void)
 	} /* for (i = 0; i < strlen(logformat); i++) */
 }
 
+/* append value to logbuffer as a CSV field, quoted if needed */
+static void print_csv(const char *value)
+{
+	const char	*s;
+
+	if (!strpbrk(value, ",\"\r\n")) {
+		snprintfcat(logbuffer, sizeof(logbuffer), "%s", value);
+		return;
+	}
+
+	snprintfcat(logbuffer, sizeof(logbuffer), "\"");
+
+	for (s = value; *s; s++) {
+		if (*s == '"')
+			snprintfcat(logbuffer, sizeof(logbuffer), "\"\"");
+		else
+			snprintfcat(logbuffer, sizeof(logbuffer), "%c", *s);
+	}
+
+	snprintfcat(logbuffer, sizeof(logbuffer), "\"");
+}
+
+/* append value to logbuffer as a JSON string */
+static void print_json(const char *value)
+{
+	const char	*s;
+
+	snprintfcat(logbuffer, sizeof(logbuffer), "\"");
+
+	for (s = value; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			snprintfcat(logbuffer, sizeof(logbuffer), "\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			snprintfcat(logbuffer, sizeof(logbuffer), "\\u%04x", (unsigned int)(unsigned char)*s);
+		else
+			snprintfcat(logbuffer, sizeof(logbuffer), "%c", *s);
+	}
+
+	snprintfcat(logbuffer, sizeof(logbuffer), "\"");
+}
+
 /* go through the list of functions and call them in order */
 static void run_flist(struct monhost_ups *monhost_ups_print)
 {
 	flist_t	*tmp;
+	size_t	len;
+	char	field[LARGEBUF];
+	const char	*sep = (log_style == LOG_STYLE_JSON) ? "{" : "";
 
 	tmp = fhead;
 
 	memset(logbuffer, 0, sizeof(logbuffer));
 
 	while (tmp) {
+		if (log_style == LOG_STYLE_TEXT) {
+			tmp->fptr(tmp->arg);
+			tmp = tmp->next;
+			continue;
+		}
+
+		/* CSV and JSON: one field per escape, literals are left out */
+		if (!tmp->name) {
+			tmp = tmp->next;
+			continue;
+		}
+
+		len = strlen(logbuffer);
 		tmp->fptr(tmp->arg);
+		snprintf(field, sizeof(field), "%s", logbuffer + len);
+		logbuffer[len] = '\0';
+
+		snprintfcat(logbuffer, sizeof(logbuffer), "%s", sep);
+		sep = ",";
+
+		if (log_style == LOG_STYLE_CSV) {
+			print_csv(field);
+		} else {
+			print_json(tmp->name);
+			snprintfcat(logbuffer, sizeof(logbuffer), ":");
+
+			if (tmp->fptr == do_var && !strcmp(field, "NA"))
+				snprintfcat(logbuffer, sizeof(logbuffer), "null");
+			else
+				print_json(field);
+		}
 
 		tmp = tmp->next;
 	}
 
+	if (log_style == LOG_STYLE_JSON)
+		snprintfcat(logbuffer, sizeof(logbuffer), "%s}", (*sep == '{') ? "{" : "");
+
 	fprintf(monhost_ups_print->logfile, "%s\n", logbuffer);
-	fflush(monhost_ups_print->logfile);
+
+	/* otherwise see flush_logs() */
+	if (flush_interval <= 0)
+		fflush(monhost_ups_print->logfile);
+}
+
+/* write out what is buffered for the log files, if it is time to */
+static void flush_logs(int force)
+{
+	time_t	now;
+
+	if (flush_interval <= 0)
+		return;
+
+	time(&now);
+
+	if (!force && difftime(now, lastflush) < flush_interval)
+		return;
+
+	for (monhost_ups_current = monhost_ups_anchor;
+	     monhost_ups_current != NULL;
+	     monhost_ups_current = monhost_ups_current->next) {
+		fflush(monhost_ups_current->logfile);
+	}
+
+	lastflush = now;
 }
 
 	/* -s <monhost>
@@ -441,7 +720,7 @@ int main(int argc, char **argv)
 
 	printf("Network UPS Tools %s %s\n", prog, UPS_VERSION);
 
-	while ((i = getopt(argc, argv, "+hs:l:i:f:u:Vp:FBm:")) != -1) {
+	while ((i = getopt(argc, argv, "+hs:l:i:f:u:Vp:FBm:o:w:")) != -1) {
 		switch(i) {
 			case 'h':
 				help(prog);
@@ -453,7 +732,7 @@ int main(int argc, char **argv)
 					char *m_arg, *s;
 
 					monhost_ups_prev = monhost_ups_current;
-					monhost_ups_current = xmalloc(sizeof(struct monhost_ups));
+					monhost_ups_current = xcalloc(1, sizeof(struct monhost_ups));
 					if (monhost_ups_anchor == NULL)
 						monhost_ups_anchor = monhost_ups_current;
 					else
@@ -519,6 +798,21 @@ int main(int argc, char **argv)
 			case 'B':
 				foreground = 0;
 				break;
+
+			case 'o':
+				if (!strcasecmp(optarg, "text"))
+					log_style = LOG_STYLE_TEXT;
+				else if (!strcasecmp(optarg, "csv"))
+					log_style = LOG_STYLE_CSV;
+				else if (!strcasecmp(optarg, "json"))
+					log_style = LOG_STYLE_JSON;
+				else
+					fatalx(EXIT_FAILURE, "Invalid output style '%s' (text, csv or json)", optarg);
+				break;
+
+			case 'w':
+				flush_interval = atoi(optarg);
+				break;
 		}
 	}
 
@@ -555,7 +849,7 @@ int main(int argc, char **argv)
 
 	if (monhost_ups_anchor == NULL) {
 		if (monhost) {
-			monhost_ups_current = xmalloc(sizeof(struct monhost_ups));
+			monhost_ups_current = xcalloc(1, sizeof(struct monhost_ups));
 			monhost_ups_anchor = monhost_ups_current;
 			monhost_ups_current->next = NULL;
 			monhost_ups_current->monhost = monhost;
@@ -578,6 +872,9 @@ int main(int argc, char **argv)
 	if (!monhost_len)
 		fatalx(EXIT_FAILURE, "No UPS defined for monitoring - use -s <system> or -m <ups,logfile>");
 
+	/* the field names are needed for the CSV headers */
+	compile_format();
+
 	for (monhost_ups_current = monhost_ups_anchor;
 	     monhost_ups_current != NULL;
 	     monhost_ups_current = monhost_ups_current->next) {
@@ -600,6 +897,8 @@ int main(int argc, char **argv)
 		if (monhost_ups_current->logfile == NULL)
 			fatal_with_errno(EXIT_FAILURE, "could not open logfile %s", logfn);
 
+		setup_logfile(monhost_ups_current);
+
 	}
 
 	/* now drop root if we have it */
@@ -625,8 +924,6 @@ int main(int argc, char **argv)
 
 	become_user(new_uid);
 
-	compile_format();
-
 	upsnotify(NOTIFY_STATE_READY_WITH_PID, NULL);
 
 	while (exit_flag == 0) {
@@ -647,20 +944,34 @@ int main(int argc, char **argv)
 			upsnotify(NOTIFY_STATE_RELOADING, NULL);
 			upslogx(LOG_INFO, "Signal %d: reopening log file",
 				reopen_flag);
+			/* what was buffered goes to the file being rotated */
+			flush_logs(1);
 			reopen_log();
 			reopen_flag = 0;
 			upsnotify(NOTIFY_STATE_READY, NULL);
 		}
 
+		/* reconnect if necessary, and ask for the variables
+		 * of all the UPSes before reading any answer */
+		for (monhost_ups_current = monhost_ups_anchor;
+		     monhost_ups_current != NULL;
+		     monhost_ups_current = monhost_ups_current->next) {
+			if (upscli_fd(monhost_ups_current->ups) < 0) {
+				upscli_connect(monhost_ups_current->ups, monhost_ups_current->hostname, monhost_ups_current->port, 0);
+			}
+
+			if (format_vars) {
+				list_vars_request(monhost_ups_current);
+			}
+		}
+
 		for (monhost_ups_current = monhost_ups_anchor;
 		     monhost_ups_current != NULL;
 		     monhost_ups_current = monhost_ups_current->next) {
 			ups = monhost_ups_current->ups;	/* XXX Not ideal */
 			upsname = monhost_ups_current->upsname;	/* XXX Not ideal */
-			/* reconnect if necessary */
-			if (upscli_fd(ups) < 0) {
-				upscli_connect(ups, monhost_ups_current->hostname, monhost_ups_current->port, 0);
-			}
+
+			list_vars_read(monhost_ups_current);
 
 			run_flist(monhost_ups_current);
 
@@ -669,11 +980,16 @@ int main(int argc, char **argv)
 				upscli_disconnect(ups);
 			}
 		}
+
+		flush_logs(0);
 	}
 
 	upslogx(LOG_INFO, "Signal %d: exiting", exit_flag);
 	upsnotify(NOTIFY_STATE_STOPPING, "Signal %d: exiting", exit_flag);
 
+	/* nothing buffered may be lost, not even for stdout */
+	flush_logs(1);
+
 	for (monhost_ups_current = monhost_ups_anchor;
 	     monhost_ups_current != NULL;
 	     monhost_ups_current = monhost_ups_current->next) {
@@ -13,6 +13,7 @@ extern "C" {
 typedef struct flist_s {
 	void	(*fptr)(const char *arg);
 	const	char	*arg;
+	const	char	*name;	/* field name for CSV and JSON output (NULL for literals) */
 	struct flist_s	*next;
 } flist_t;
 
@@ -47,6 +47,11 @@ static	char	*powerdownflag = NULL, *configfile = NULL;
 
 static	unsigned int	minsupplies = 1, sleepval = 5;
 
+	/* most helpers (wall or NOTIFYCMD) run at once by the notifier
+	 * (0 = fork upsmon for each notification instead), and most
+	 * notifications passed to one NOTIFYCMD call (see notifier_run()) */
+static	int	notifycmd_maxprocs = 4, notifycmd_batch = 1;
+
 	/* sum of all power values from config file */
 static	unsigned int	totalpv = 0;
 
@@ -226,6 +231,391 @@ static void wall(const char *text)
 #endif
 }
 
+#ifndef WIN32
+/* Notifications to WALL or EXEC are handed over through a pipe to a
+ * long-lived worker process (the "notifier"), rather than forking upsmon
+ * for each of them. The notifier queues them, drops those identical to
+ * one still waiting in its queue, and runs at most NOTIFYCMD_MAXPROCS
+ * helpers (wall or NOTIFYCMD) at a time. With NOTIFYCMD_BATCH, several
+ * queued notifications can be passed to one NOTIFYCMD invocation. */
+typedef struct {
+	int	flags;
+	char	ntype[32];
+	char	upsname[SMALLBUF];
+	char	notice[LARGEBUF];
+} notify_msg_t;	/* larger than PIPE_BUF may be (512 bytes), so not
+		 * written to the pipe atomically: only upsmon writes
+		 * there, and the notifier reassembles what it reads */
+
+typedef struct notify_job_s {
+	notify_msg_t	msg;
+	struct notify_job_s	*next;
+} notify_job_t;
+
+static	int	notifier_fd = -1;
+static	pid_t	notifier_pid = -1;
+
+/* Run NOTIFYCMD for the count jobs listed from first */
+static pid_t notifier_exec(notify_job_t *first, int count)
+{
+	char	exec[LARGEBUF * 2], *args[2], *input = NULL;
+	size_t	inputlen;
+	pid_t	pid;
+	notify_job_t	*job;
+
+	upsdebugx(6, "%s: NOTIFY_EXEC: calling NOTIFYCMD as '%s \"%s\"'%s",
+		__func__, notifycmd, first->msg.notice,
+		(count > 1) ? " with more notifications on stdin" : "");
+
+	setenv("UPSNAME", first->msg.upsname, 1);
+	setenv("NOTIFYTYPE", first->msg.ntype, 1);
+
+	if (count > 1) {
+		snprintf(exec, sizeof(exec), "%d", count);
+		setenv("NOTIFYBATCH", exec, 1);
+
+		/* one "NOTIFYTYPE<TAB>UPSNAME<TAB>message" line per notification */
+		inputlen = (size_t)count * (sizeof(notify_msg_t) + 3);
+		input = xcalloc(1, inputlen);
+
+		for (job = first; job != NULL; job = job->next) {
+			snprintfcat(input, inputlen, "%s\t%s\t%s\n",
+				job->msg.ntype, job->msg.upsname, job->msg.notice);
+		}
+	} else {
+		unsetenv("NOTIFYBATCH");
+	}
+
+	snprintf(exec, sizeof(exec), "%s \"%s\"", notifycmd, first->msg.notice);
+	args[0] = first->msg.notice;
+	args[1] = NULL;
+
+	pid = nut_spawn_command(notifycmd, args, exec, input);
+
+	if (pid < 0) {
+		upslog_with_errno(LOG_ERR, "%s: can't run %s", __func__, notifycmd);
+	}
+
+	free(input);
+
+	return pid;
+}
+
+/* Take job out of the queue (and its list) */
+static void notifier_unlink(notify_job_t **queue, notify_job_t ***tail, notify_job_t *job)
+{
+	notify_job_t	**pjob;
+
+	for (pjob = queue; *pjob != job; pjob = &(*pjob)->next);
+
+	*pjob = job->next;
+	job->next = NULL;
+
+	if (*tail == &job->next) {
+		*tail = pjob;
+	}
+}
+
+/* Queue msg (as one job for WALL and one for EXEC), unless the same
+ * notification is still waiting in the queue */
+static void notifier_queue(notify_job_t *queue, notify_job_t ***tail, const notify_msg_t *msg)
+{
+	int	flags = msg->flags, flag;
+	notify_job_t	*job;
+
+	while (flags) {
+		flag = flag_isset(flags, NOTIFY_WALL) ? NOTIFY_WALL : NOTIFY_EXEC;
+		flags &= ~flag;
+
+		for (job = queue; job != NULL; job = job->next) {
+			if (job->msg.flags == flag
+			 && !strcmp(job->msg.ntype, msg->ntype)
+			 && !strcmp(job->msg.upsname, msg->upsname)
+			 && !strcmp(job->msg.notice, msg->notice)
+			) {
+				break;
+			}
+		}
+
+		if (job) {
+			upsdebugx(2, "%s: %s notification for [%s] already queued, dropped",
+				__func__, msg->ntype, msg->upsname);
+			continue;
+		}
+
+		job = xcalloc(1, sizeof(*job));
+		job->msg = *msg;
+		job->msg.flags = flag;
+
+		**tail = job;
+		*tail = &job->next;
+	}
+}
+
+/* The notifier process: read notifications from fd until it is closed
+ * by upsmon, then start the helpers for those still queued and exit */
+static void notifier_run(int fd)
+	__attribute__((noreturn));
+
+static void notifier_run(int fd)
+{
+	char	buf[sizeof(notify_msg_t) * 4];
+	size_t	buflen = 0;
+	ssize_t	ret;
+	int	running = 0, eof = 0, count, waiting;
+	pid_t	pid;
+	fd_set	rfds;
+	struct timeval	tv;
+	notify_job_t	*queue = NULL, **tail = &queue, *job, *next, *batch, **btail;
+	struct sigaction	sa;
+
+	/* default signal handling here, but for the helpers which do
+	 * not read the notifications passed on their standard input */
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sa.sa_handler = SIG_DFL;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGQUIT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGALRM, &sa, NULL);
+	sigaction(SIGCMD_FSD, &sa, NULL);
+	sigaction(SIGCMD_RELOAD, &sa, NULL);
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, NULL);
+
+	upsdebugx(1, "%s: notifier started (at most %d helpers at once, up to %d notifications per NOTIFYCMD call)",
+		__func__, notifycmd_maxprocs, notifycmd_batch);
+
+	while (!eof || queue) {
+
+		while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+			running--;
+		}
+
+		/* start helpers for the oldest notifications queued */
+		while (queue && running < notifycmd_maxprocs) {
+			job = queue;
+			notifier_unlink(&queue, &tail, job);
+
+			if (job->msg.flags == NOTIFY_WALL) {
+				upsdebugx(6, "%s: NOTIFY_WALL", __func__);
+				pid = nut_spawn_command("wall", NULL, NULL, job->msg.notice);
+				if (pid < 0) {
+					upslog_with_errno(LOG_ERR, "%s: can't run wall", __func__);
+				}
+				free(job);
+			} else {
+				/* take the next EXEC jobs along, if allowed */
+				batch = job;
+				btail = &job->next;
+
+				for (count = 1, job = queue; job && count < notifycmd_batch; job = next) {
+					next = job->next;
+
+					if (job->msg.flags != NOTIFY_EXEC)
+						continue;
+
+					notifier_unlink(&queue, &tail, job);
+					*btail = job;
+					btail = &job->next;
+					count++;
+				}
+
+				pid = notifier_exec(batch, count);
+
+				for (job = batch; job != NULL; job = next) {
+					next = job->next;
+					free(job);
+				}
+			}
+
+			if (pid > 0) {
+				running++;
+			}
+		}
+
+		if (eof) {
+			/* only waiting for helpers to finish: poll shortly */
+			if (queue) {
+				usleep(100000);
+			}
+			continue;
+		}
+
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+
+		/* exited helpers are reaped, and waiting jobs started, by polling */
+		waiting = (queue && running >= notifycmd_maxprocs);
+		tv.tv_sec = waiting ? 0 : 1;
+		tv.tv_usec = waiting ? 100000 : 0;
+
+		ret = select(fd + 1, &rfds, NULL, NULL, running ? &tv : NULL);
+
+		if (ret <= 0) {
+			continue;
+		}
+
+		ret = read(fd, buf + buflen, sizeof(buf) - buflen);
+
+		if (ret <= 0) {
+			if (ret < 0 && errno == EINTR)
+				continue;
+
+			upsdebugx(1, "%s: upsmon closed the notifier pipe", __func__);
+			eof = 1;
+			continue;
+		}
+
+		buflen += (size_t)ret;
+
+		/* queue the notifications received in full */
+		while (buflen >= sizeof(notify_msg_t)) {
+			notify_msg_t	msg;
+
+			memcpy(&msg, buf, sizeof(msg));
+			notifier_queue(queue, &tail, &msg);
+
+			buflen -= sizeof(msg);
+			memmove(buf, buf + sizeof(msg), buflen);
+		}
+	}
+
+	upsdebugx(1, "%s: notifier exiting", __func__);
+	exit(EXIT_SUCCESS);
+}
+
+/* Close the pipe to the notifier, which exits when its queue is done */
+static void notifier_stop(void)
+{
+	if (notifier_fd < 0)
+		return;
+
+	upsdebugx(2, "%s: closing pipe to notifier [%" PRIiMAX "]",
+		__func__, (intmax_t)notifier_pid);
+
+	close(notifier_fd);
+	notifier_fd = -1;
+	notifier_pid = -1;
+}
+
+static int notifier_start(void)
+{
+	int	pfd[2];
+	pid_t	pid;
+
+	if (pipe(pfd)) {
+		upslog_with_errno(LOG_ERR, "Can't create pipe for the notifier");
+		return -1;
+	}
+
+	pid = fork();
+
+	if (pid < 0) {
+		upslog_with_errno(LOG_ERR, "Can't fork the notifier");
+		close(pfd[0]);
+		close(pfd[1]);
+		return -1;
+	}
+
+	if (pid == 0) {
+		long	i, maxfd = sysconf(_SC_OPEN_MAX);
+
+		/* the notifier (and the helpers it runs) must not hold the
+		 * connections to upsd, nor anything else upsmon had open */
+		if (maxfd < 0)
+			maxfd = FD_SETSIZE;
+
+		for (i = STDERR_FILENO + 1; i < maxfd; i++) {
+			if (i != pfd[0])
+				close((int)i);
+		}
+
+		/* nor do the helpers need the pipe */
+		set_close_on_exec(pfd[0]);
+
+		notifier_run(pfd[0]);
+	}
+
+	close(pfd[0]);
+
+	/* prevent pipe leaking to NOTIFYCMD */
+	set_close_on_exec(pfd[1]);
+
+	notifier_fd = pfd[1];
+	notifier_pid = pid;
+
+	return 0;
+}
+
+/* Write msg to the notifier in full, returns 0 if done */
+static int notifier_write(const notify_msg_t *msg)
+{
+	const char	*p = (const char *)msg;
+	size_t	left = sizeof(*msg);
+	ssize_t	ret;
+
+	while (left > 0) {
+		ret = write(notifier_fd, p, left);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+
+		p += ret;
+		left -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+/* Hand a notification over to the notifier, returns 0 if done */
+static int notifier_send(const char *notice, int flags, const char *ntype,
+			const char *upsname)
+{
+	notify_msg_t	msg;
+	int	tries;
+
+	if (notifycmd_maxprocs < 1)
+		return -1;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.flags = flags & (NOTIFY_WALL | NOTIFY_EXEC);
+	snprintf(msg.ntype, sizeof(msg.ntype), "%s", ntype);
+	snprintf(msg.upsname, sizeof(msg.upsname), "%s", upsname ? upsname : "");
+	snprintf(msg.notice, sizeof(msg.notice), "%s", notice);
+
+	if (!flag_isset(msg.flags, NOTIFY_EXEC) || notifycmd == NULL) {
+		if (flag_isset(msg.flags, NOTIFY_EXEC))
+			upsdebugx(6, "%s: NOTIFY_EXEC: no NOTIFYCMD was configured", __func__);
+
+		msg.flags &= ~NOTIFY_EXEC;
+
+		if (!msg.flags)
+			return 0;
+	}
+
+	/* restart the notifier once, if it went away */
+	for (tries = 0; tries < 2; tries++) {
+		if (notifier_fd < 0 && notifier_start() < 0)
+			return -1;
+
+		if (notifier_write(&msg) == 0) {
+			upsdebugx(6, "%s: queued for notifier [%" PRIiMAX "]",
+				__func__, (intmax_t)notifier_pid);
+			return 0;
+		}
+
+		upslog_with_errno(LOG_WARNING, "Can't write to the notifier");
+		notifier_stop();
+	}
+
+	return -1;
+}
+#endif	/* !WIN32 */
+
 #ifdef WIN32
 typedef struct async_notify_s {
 	char *notice;
@@ -297,6 +687,15 @@ static void notify(const char *notice, int flags, const char *ntype,
 	}
 
 #ifndef WIN32
+	if (!(flags & (NOTIFY_WALL | NOTIFY_EXEC))) {
+		return;
+	}
+
+	/* normally the notifier process takes it from here */
+	if (notifier_send(notice, flags, ntype, upsname) == 0) {
+		return;
+	}
+
 	/* fork here so upsmon doesn't get wedged if the notifier is slow */
 	ret = fork();
 
@@ -1792,6 +2191,28 @@ static int parse_conf_arg(size_t numargs, char **arg)
 		return 1;
 	}
 
+	/* NOTIFYCMD_MAXPROCS <num> */
+	if (!strcmp(arg[0], "NOTIFYCMD_MAXPROCS")) {
+		int inotifycmd_maxprocs = atoi(arg[1]);
+		if (inotifycmd_maxprocs < 0) {
+			upsdebugx(0, "Ignoring invalid NOTIFYCMD_MAXPROCS value: %d", inotifycmd_maxprocs);
+		} else {
+			notifycmd_maxprocs = inotifycmd_maxprocs;
+		}
+		return 1;
+	}
+
+	/* NOTIFYCMD_BATCH <num> */
+	if (!strcmp(arg[0], "NOTIFYCMD_BATCH")) {
+		int inotifycmd_batch = atoi(arg[1]);
+		if (inotifycmd_batch < 1 || inotifycmd_batch > 32) {
+			upsdebugx(0, "Ignoring invalid NOTIFYCMD_BATCH value: %d", inotifycmd_batch);
+		} else {
+			notifycmd_batch = inotifycmd_batch;
+		}
+		return 1;
+	}
+
 	/* POLLFREQ <num> */
 	if (!strcmp(arg[0], "POLLFREQ")) {
 		int ipollfreq = atoi(arg[1]);
@@ -2153,6 +2574,10 @@ static void upsmon_cleanup(void)
 		utmp = unext;
 	}
 
+#ifndef WIN32
+	notifier_stop();
+#endif
+
 	free(run_as_user);
 	free(shutdowncmd);
 	free(notifycmd);
@@ -2816,6 +3241,11 @@ static void reload_conf(void)
 	/* reread upsmon.conf */
 	loadconfig();
 
+#ifndef WIN32
+	/* a new notifier will be started with the new settings */
+	notifier_stop();
+#endif
+
 	/* go through the utype_t struct again */
 	tmp = firstups;
 
@@ -40,9 +40,19 @@ static UPSCONN_t	*ups = NULL;
 static int			tracking_enabled = 0;
 static unsigned int	timeout = DEFAULT_TRACKING_TIMEOUT;
 
-struct list_t {
+/* what upsrw -l shows about a variable */
+struct varinfo_t {
 	char	*name;
-	struct	list_t	*next;
+	char	*value;		/* NULL if unavailable */
+	char	*desc;		/* NULL if unavailable */
+	char	**type;		/* words of the GET TYPE answer */
+	size_t	numtype;
+	int	typed;		/* 0 if the type is unknown */
+	char	**enums;
+	size_t	numenums;
+	char	**ranges;	/* min, max pairs */
+	size_t	numranges;
+	struct	varinfo_t	*next;
 };
 
 static void usage(const char *prog)
@@ -326,70 +336,41 @@ static const char *get_data(const char *type, const char *varname)
 	return answer[3];
 }
 
-static void do_string(const char *varname, const long len)
+static void do_string(const struct varinfo_t *var, const long len)
 {
-	const char	*val;
-
-	val = get_data("VAR", varname);
-
-	if (!val) {
-		fatalx(EXIT_FAILURE, "do_string: can't get current value of %s", varname);
+	if (!var->value) {
+		fatalx(EXIT_FAILURE, "do_string: can't get current value of %s", var->name);
 	}
 
 	printf("Type: STRING\n");
 	printf("Maximum length: %ld\n", len);
-	printf("Value: %s\n", val);
+	printf("Value: %s\n", var->value);
 }
 
-static void do_number(const char *varname)
+static void do_number(const struct varinfo_t *var)
 {
-	const char	*val;
-
-	val = get_data("VAR", varname);
-
-	if (!val) {
-		fatalx(EXIT_FAILURE, "do_number: can't get current value of %s", varname);
+	if (!var->value) {
+		fatalx(EXIT_FAILURE, "do_number: can't get current value of %s", var->name);
 	}
 
 	printf("Type: NUMBER\n");
-	printf("Value: %s\n", val);
+	printf("Value: %s\n", var->value);
 }
 
 /**
  * Display ENUM information
- * @param varname the name of the NUT variable
+ * @param var the NUT variable, with its enumerated values
  * @param vartype the type of the NUT variable (ST_FLAG_STRING, ST_FLAG_NUMBER
  * @param len the length of the NUT variable, if type == ST_FLAG_STRING
  */
-static void do_enum(const char *varname, const int vartype, const long len)
+static void do_enum(const struct varinfo_t *var, const int vartype, const long len)
 {
-	int	ret;
-	size_t	numq, numa;
-	char	**answer, buf[SMALLBUF];
-	const char	*query[4], *val;
-
-	/* get current value */
-	val = get_data("VAR", varname);
-
-	if (!val) {
-		fatalx(EXIT_FAILURE, "do_enum: can't get current value of %s", varname);
-	}
-
-	snprintf(buf, sizeof(buf), "%s", val);
-
-	query[0] = "ENUM";
-	query[1] = upsname;
-	query[2] = varname;
-	numq = 3;
+	size_t	i;
 
-	ret = upscli_list_start(ups, numq, query);
-
-	if (ret < 0) {
-		fatalx(EXIT_FAILURE, "Error: %s", upscli_strerror(ups));
+	if (!var->value) {
+		fatalx(EXIT_FAILURE, "do_enum: can't get current value of %s", var->name);
 	}
 
-	ret = upscli_list_next(ups, numq, query, &numa, &answer);
-
 	/* Fallback for older upsd versions */
 	if (vartype != ST_FLAG_NONE)
 		printf("Type: ENUM %s\n", (vartype == ST_FLAG_STRING)?"STRING":"NUMBER");
@@ -399,69 +380,36 @@ static void do_enum(const char *varname, const int vartype, const long len)
 	if (vartype == ST_FLAG_STRING)
 		printf("Maximum length: %ld\n", len);
 
-	while (ret == 1) {
+	for (i = 0; i < var->numenums; i++) {
 
-		/* ENUM <upsname> <varname> <value> */
+		printf("Option: \"%s\"", var->enums[i]);
 
-		if (numa < 4) {
-			fatalx(EXIT_FAILURE, "Error: insufficient data (got %" PRIuSIZE " args, need at least 4)", numa);
-		}
-
-		printf("Option: \"%s\"", answer[3]);
-
-		if (!strcmp(answer[3], buf)) {
+		if (!strcmp(var->enums[i], var->value)) {
 			printf(" SELECTED");
 		}
 
 		printf("\n");
-
-		ret = upscli_list_next(ups, numq, query, &numa, &answer);
 	}
 }
 
-static void do_range(const char *varname)
+static void do_range(const struct varinfo_t *var)
 {
-	int	ret;
-	size_t	numq, numa;
-	char	**answer;
-	const char	*query[4], *val;
+	size_t	i;
 	int ival, min, max;
 
-	/* get current value */
-	val = get_data("VAR", varname);
-
-	if (!val) {
-		fatalx(EXIT_FAILURE, "do_range: can't get current value of %s", varname);
+	if (!var->value) {
+		fatalx(EXIT_FAILURE, "do_range: can't get current value of %s", var->name);
 	}
 
-	ival = atoi(val);
-
-	query[0] = "RANGE";
-	query[1] = upsname;
-	query[2] = varname;
-	numq = 3;
-
-	ret = upscli_list_start(ups, numq, query);
-
-	if (ret < 0) {
-		fatalx(EXIT_FAILURE, "Error: %s", upscli_strerror(ups));
-	}
-
-	ret = upscli_list_next(ups, numq, query, &numa, &answer);
+	ival = atoi(var->value);
 
 	/* Ranges implies a type "NUMBER" */
 	printf("Type: RANGE NUMBER\n");
 
-	while (ret == 1) {
-
-		/* RANGE <upsname> <varname> <min> <max> */
+	for (i = 0; i + 1 < var->numranges; i += 2) {
 
-		if (numa < 5) {
-			fatalx(EXIT_FAILURE, "Error: insufficient data (got %" PRIuSIZE " args, need at least 4)", numa);
-		}
-
-		min = atoi(answer[3]);
-		max = atoi(answer[4]);
+		min = atoi(var->ranges[i]);
+		max = atoi(var->ranges[i + 1]);
 
 		printf("Option: \"%i-%i\"", min, max);
 
@@ -470,106 +418,277 @@ static void do_range(const char *varname)
 		}
 
 		printf("\n");
-
-		ret = upscli_list_next(ups, numq, query, &numa, &answer);
 	}
 }
 
-static void do_type(const char *varname)
+static void do_type(const struct varinfo_t *var)
 {
-	int	ret;
 	int is_enum = 0; /* 1 if ENUM; FIXME: add a boolean type in common.h */
-	size_t	i, numq, numa;
-	char	**answer;
-	const char	*query[4];
-
-	query[0] = "TYPE";
-	query[1] = upsname;
-	query[2] = varname;
-	numq = 3;
+	size_t	i;
 
-	ret = upscli_get(ups, numq, query, &numa, &answer);
-
-	if ((ret < 0) || (numa < numq)) {
+	if (!var->typed) {
 		printf("Unknown type\n");
 		return;
 	}
 
-	/* TYPE <upsname> <varname> <type>... */
-	for (i = 3; i < numa; i++) {
+	for (i = 0; i < var->numtype; i++) {
 
 		/* ENUM can be NUMBER or STRING
 		 * just flag it for latter processing */
-		if (!strcasecmp(answer[i], "ENUM")) {
+		if (!strcasecmp(var->type[i], "ENUM")) {
 			is_enum = 1;
 			continue;
 		}
 
-		if (!strcasecmp(answer[i], "RANGE")) {
-			do_range(varname);
+		if (!strcasecmp(var->type[i], "RANGE")) {
+			do_range(var);
 			return;
 		}
 
-		if (!strncasecmp(answer[i], "STRING:", 7)) {
+		if (!strncasecmp(var->type[i], "STRING:", 7)) {
 
-			char	*len = answer[i] + 7;
+			char	*len = var->type[i] + 7;
 			long	length = strtol(len, NULL, 10);
 
 			if (is_enum == 1)
-				do_enum(varname, ST_FLAG_STRING, length);
+				do_enum(var, ST_FLAG_STRING, length);
 			else
-				do_string(varname, length);
+				do_string(var, length);
 			return;
 
 		}
 
-		if (!strcasecmp(answer[i], "NUMBER")) {
+		if (!strcasecmp(var->type[i], "NUMBER")) {
 			if (is_enum == 1)
-				do_enum(varname, ST_FLAG_NUMBER, 0);
+				do_enum(var, ST_FLAG_NUMBER, 0);
 			else
-				do_number(varname);
+				do_number(var);
 			return;
 		}
 
 		/* ignore this one */
-		if (!strcasecmp(answer[i], "RW")) {
+		if (!strcasecmp(var->type[i], "RW")) {
 			continue;
 		}
 
-		printf("Type: %s (unrecognized)\n", answer[i]);
+		printf("Type: %s (unrecognized)\n", var->type[i]);
 	}
 	/* Fallback for older upsd versions, where STRING|NUMBER is not
 	 * appended to ENUM */
 	if (is_enum == 1)
-		do_enum(varname, ST_FLAG_NONE, 0);
+		do_enum(var, ST_FLAG_NONE, 0);
 }
 
-static void print_rw(const char *varname)
+static void print_rw(const struct varinfo_t *var)
 {
-	const char	*tmp;
-
-	printf("[%s]\n", varname);
-
-	tmp = get_data("DESC", varname);
+	printf("[%s]\n", var->name);
 
-	if (tmp) {
-		printf("%s\n", tmp);
+	if (var->desc) {
+		printf("%s\n", var->desc);
 	} else {
 		printf("Description unavailable\n");
 	}
 
-	do_type(varname);
+	do_type(var);
 
 	printf("\n");
 }
 
+static int has_word(char **list, size_t num, const char *word)
+{
+	size_t	i;
+
+	for (i = 0; i < num; i++) {
+		if (!strcasecmp(list[i], word))
+			return 1;
+	}
+
+	return 0;
+}
+
+static void add_word(char ***list, size_t *num, const char *word)
+{
+	*list = xrealloc(*list, (*num + 1) * sizeof(**list));
+	(*list)[(*num)++] = xstrdup(word);
+}
+
+static struct varinfo_t *add_varinfo(struct varinfo_t **last, struct varinfo_t **head,
+	const char *varname)
+{
+	struct varinfo_t	*var;
+
+	var = xcalloc(1, sizeof(*var));
+	var->name = xstrdup(varname);
+
+	if (*last) {
+		(*last)->next = var;
+	} else {
+		*head = var;
+	}
+
+	*last = var;
+
+	return var;
+}
+
+static void free_varinfo(struct varinfo_t *var)
+{
+	size_t	i;
+
+	for (i = 0; i < var->numtype; i++)
+		free(var->type[i]);
+
+	for (i = 0; i < var->numenums; i++)
+		free(var->enums[i]);
+
+	for (i = 0; i < var->numranges; i++)
+		free(var->ranges[i]);
+
+	free(var->type);
+	free(var->enums);
+	free(var->ranges);
+	free(var->name);
+	free(var->value);
+	free(var->desc);
+	free(var);
+}
+
+/* ask an older upsd about a variable, one request at a time */
+static void get_varinfo(struct varinfo_t *var)
+{
+	int	ret;
+	size_t	i, numq, numa;
+	char	**answer;
+	const char	*query[4], *tmp;
+
+	if ((tmp = get_data("DESC", var->name)) != NULL)
+		var->desc = xstrdup(tmp);
+
+	query[0] = "TYPE";
+	query[1] = upsname;
+	query[2] = var->name;
+	numq = 3;
+
+	ret = upscli_get(ups, numq, query, &numa, &answer);
+
+	if ((ret < 0) || (numa < numq)) {
+		return;
+	}
+
+	/* TYPE <upsname> <varname> <type>... */
+	var->typed = 1;
+
+	for (i = 3; i < numa; i++)
+		add_word(&var->type, &var->numtype, answer[i]);
+
+	if ((tmp = get_data("VAR", var->name)) != NULL)
+		var->value = xstrdup(tmp);
+
+	if (has_word(var->type, var->numtype, "ENUM")) {
+		query[0] = "ENUM";
+		numq = 3;
+
+		if (upscli_list_start(ups, numq, query) < 0) {
+			fatalx(EXIT_FAILURE, "Error: %s", upscli_strerror(ups));
+		}
+
+		while (upscli_list_next(ups, numq, query, &numa, &answer) == 1) {
+
+			/* ENUM <upsname> <varname> <value> */
+			if (numa < 4) {
+				fatalx(EXIT_FAILURE, "Error: insufficient data (got %" PRIuSIZE " args, need at least 4)", numa);
+			}
+
+			add_word(&var->enums, &var->numenums, answer[3]);
+		}
+	}
+
+	if (has_word(var->type, var->numtype, "RANGE")) {
+		query[0] = "RANGE";
+		numq = 3;
+
+		if (upscli_list_start(ups, numq, query) < 0) {
+			fatalx(EXIT_FAILURE, "Error: %s", upscli_strerror(ups));
+		}
+
+		while (upscli_list_next(ups, numq, query, &numa, &answer) == 1) {
+
+			/* RANGE <upsname> <varname> <min> <max> */
+			if (numa < 5) {
+				fatalx(EXIT_FAILURE, "Error: insufficient data (got %" PRIuSIZE " args, need at least 4)", numa);
+			}
+
+			add_word(&var->ranges, &var->numranges, answer[3]);
+			add_word(&var->ranges, &var->numranges, answer[4]);
+		}
+	}
+}
+
+/* Get everything about all the variables with one LIST VARINFO.
+ * Returns -1 if upsd does not know that list yet. */
+static int list_varinfo(struct varinfo_t **head)
+{
+	int	ret;
+	size_t	i, numq, numa;
+	const char	*query[2];
+	char	**answer;
+	struct	varinfo_t	*last = NULL;
+
+	query[0] = "VARINFO";
+	query[1] = upsname;
+	numq = 2;
+
+	if (upscli_list_start(ups, numq, query) < 0) {
+		/* older upsd answered with an error, the connection is fine */
+		if (upscli_fd(ups) >= 0)
+			return -1;
+
+		fatalx(EXIT_FAILURE, "Error: %s", upscli_strerror(ups));
+	}
+
+	while ((ret = upscli_list_next(ups, numq, query, &numa, &answer)) == 1) {
+
+		/* VARINFO <upsname> <varname> <what> [<value>...] */
+		if (numa < 5) {
+			fatalx(EXIT_FAILURE, "Error: insufficient data (got %" PRIuSIZE " args, need at least 5)", numa);
+		}
+
+		/* the lines of a variable come one after the other */
+		if (!last || strcmp(last->name, answer[2]))
+			add_varinfo(&last, head, answer[2]);
+
+		if (!strcasecmp(answer[3], "VALUE")) {
+			free(last->value);
+			last->value = xstrdup(answer[4]);
+		} else if (!strcasecmp(answer[3], "DESC")) {
+			free(last->desc);
+			last->desc = xstrdup(answer[4]);
+		} else if (!strcasecmp(answer[3], "TYPE")) {
+			last->typed = 1;
+			for (i = 4; i < numa; i++)
+				add_word(&last->type, &last->numtype, answer[i]);
+		} else if (!strcasecmp(answer[3], "ENUM")) {
+			add_word(&last->enums, &last->numenums, answer[4]);
+		} else if (!strcasecmp(answer[3], "RANGE") && numa >= 6) {
+			add_word(&last->ranges, &last->numranges, answer[4]);
+			add_word(&last->ranges, &last->numranges, answer[5]);
+		}
+	}
+
+	if (ret < 0) {
+		fatalx(EXIT_FAILURE, "Error: %s", upscli_strerror(ups));
+	}
+
+	return 0;
+}
+
 static void print_rwlist(void)
 {
 	int	ret;
 	size_t	numq, numa;
 	const char	*query[2];
 	char	**answer;
-	struct	list_t	*lhead, *llast, *ltmp, *lnext;
+	struct	varinfo_t	*lhead, *llast, *ltmp, *lnext;
 
 	/* the upsname is now required */
 	if (!upsname) {
@@ -578,6 +697,20 @@ static void print_rwlist(void)
 
 	llast = lhead = NULL;
 
+	/* everything in one go, then show the RW variables */
+	if (list_varinfo(&lhead) == 0) {
+		for (ltmp = lhead; ltmp; ltmp = lnext) {
+			lnext = ltmp->next;
+
+			if (has_word(ltmp->type, ltmp->numtype, "RW"))
+				print_rw(ltmp);
+
+			free_varinfo(ltmp);
+		}
+
+		return;
+	}
+
 	query[0] = "RW";
 	query[1] = upsname;
 	numq = 2;
@@ -604,18 +737,7 @@ static void print_rwlist(void)
 		}
 
 		/* sock this entry away for later */
-
-		ltmp = xmalloc(sizeof(struct list_t));
-		ltmp->name = xstrdup(answer[2]);
-		ltmp->next = NULL;
-
-		if (llast) {
-			llast->next = ltmp;
-		} else {
-			lhead = ltmp;
-		}
-
-		llast = ltmp;
+		add_varinfo(&llast, &lhead, answer[2]);
 
 		ret = upscli_list_next(ups, numq, query, &numa, &answer);
 	}
@@ -627,10 +749,10 @@ static void print_rwlist(void)
 	while (ltmp) {
 		lnext = ltmp->next;
 
-		print_rw(ltmp->name);
+		get_varinfo(ltmp);
+		print_rw(ltmp);
 
-		free(ltmp->name);
-		free(ltmp);
+		free_varinfo(ltmp);
 		ltmp = lnext;
 	}
 }
@@ -0,0 +1,164 @@
+/* upssched-timers.c - pending timers of the upssched daemon
+
+   Copyright (C)
+	2026	NUT Community
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "common.h"
+#include "upssched.h"
+
+#define TNAME_BUCKETS		256
+
+/* pending timers: a binary min-heap ordered by expiry time, so that the
+ * daemon only looks at (and sleeps until) the first one due, and a hash
+ * of their names so that CANCEL-TIMER does not have to scan all of them */
+static ttype_t	**theap = NULL;
+static size_t	theap_num = 0, theap_max = 0;
+static ttype_t	*tnames[TNAME_BUCKETS];
+static unsigned long	tseq = 0;
+
+static size_t tname_hash(const char *name)
+{
+	size_t	h = 5381;
+
+	while (*name)
+		h = h * 33 + (unsigned char)*name++;
+
+	return h % TNAME_BUCKETS;
+}
+
+static int timer_before(const ttype_t *a, const ttype_t *b)
+{
+	if (a->etime != b->etime)
+		return a->etime < b->etime;
+
+	return a->seq < b->seq;
+}
+
+static void theap_set(size_t pos, ttype_t *tmp)
+{
+	theap[pos] = tmp;
+	tmp->pos = pos;
+}
+
+static void theap_up(size_t pos)
+{
+	ttype_t	*tmp = theap[pos];
+
+	while (pos > 0 && timer_before(tmp, theap[(pos - 1) / 2])) {
+		theap_set(pos, theap[(pos - 1) / 2]);
+		pos = (pos - 1) / 2;
+	}
+
+	theap_set(pos, tmp);
+}
+
+static void theap_down(size_t pos)
+{
+	ttype_t	*tmp = theap[pos];
+	size_t	child;
+
+	while ((child = 2 * pos + 1) < theap_num) {
+		if (child + 1 < theap_num && timer_before(theap[child + 1], theap[child]))
+			child++;
+
+		if (!timer_before(theap[child], tmp))
+			break;
+
+		theap_set(pos, theap[child]);
+		pos = child;
+	}
+
+	theap_set(pos, tmp);
+}
+
+ttype_t *timer_add(const char *name, time_t etime)
+{
+	ttype_t	*tmp, **last;
+
+	tmp = xcalloc(1, sizeof(ttype_t));
+	tmp->name = xstrdup(name);
+	tmp->etime = etime;
+	tmp->seq = tseq++;
+
+	/* by name: append, so that CANCEL-TIMER finds the oldest one first */
+	for (last = &tnames[tname_hash(name)]; *last != NULL; last = &(*last)->next);
+	*last = tmp;
+
+	/* now add to the queue */
+	if (theap_num == theap_max) {
+		theap_max = theap_max ? theap_max * 2 : 16;
+		theap = xrealloc(theap, theap_max * sizeof(*theap));
+	}
+
+	theap_set(theap_num, tmp);
+	theap_up(theap_num++);
+
+	return tmp;
+}
+
+ttype_t *timer_first(void)
+{
+	return (theap_num > 0) ? theap[0] : NULL;
+}
+
+ttype_t *timer_find(const char *name)
+{
+	ttype_t	*tmp;
+
+	for (tmp = tnames[tname_hash(name)]; tmp != NULL; tmp = tmp->next) {
+		if (!strcmp(tmp->name, name))
+			return tmp;
+	}
+
+	return NULL;
+}
+
+void timer_remove(ttype_t *tfind)
+{
+	ttype_t	**tmp, *last;
+
+	for (tmp = &tnames[tname_hash(tfind->name)]; *tmp != NULL; tmp = &(*tmp)->next) {
+		if (*tmp == tfind)	/* found it */
+			break;
+	}
+
+	if (*tmp == NULL || tfind->pos >= theap_num || theap[tfind->pos] != tfind) {
+		/* this one should never happen */
+		upslogx(LOG_ERR, "%s: failed to locate target at %p", __func__, (void *)tfind);
+		return;
+	}
+
+	*tmp = tfind->next;
+
+	/* fill its place in the heap with the last one */
+	last = theap[--theap_num];
+
+	if (last != tfind) {
+		theap_set(tfind->pos, last);
+		theap_up(last->pos);
+		theap_down(last->pos);
+	}
+
+	free(tfind->name);
+	free(tfind);
+}
+
+size_t timer_count(void)
+{
+	return theap_num;
+}
@@ -60,13 +60,27 @@
 #include "timehead.h"
 #include "nut_stdint.h"
 
-typedef struct ttype_s {
+static time_t	tempty = 0;	/* since when there were no timers */
+
+#define CMDSCRIPT_MAXBATCH	32
+
+#ifndef WIN32
+/* CMDSCRIPT calls of the daemon: timers which fired and wait for one of
+ * the CMDSCRIPT_MAXPROCS slots, and the calls which hold one (the name
+ * being their command line then) */
+typedef struct exec_job_s {
 	char	*name;
-	time_t	etime;
-	struct ttype_s	*next;
-} ttype_t;
+	pid_t	pid;
+	struct exec_job_s	*next;
+} exec_job_t;
+
+static exec_job_t	*exec_queue = NULL, **exec_tail = &exec_queue;
+static exec_job_t	*exec_running = NULL;
+static int	exec_numrunning = 0;
+#endif
+
+static int	cmdscript_maxprocs = 1, cmdscript_batch = 1;
 
-static ttype_t	*thead = NULL;
 static conn_t	*connhead = NULL;
 static char	*cmdscript = NULL, *pipefn = NULL, *lockfn = NULL;
 
@@ -81,22 +95,16 @@ static OVERLAPPED connect_overlapped;
 #define PARENT_STARTED		-2
 #define PARENT_UNNECESSARY	-3
 #define MAX_TRIES 		30
-#define EMPTY_WAIT		15	/* min passes with no timers to exit */
+#define EMPTY_WAIT		15	/* min seconds with no timers to exit */
 #define US_LISTEN_BACKLOG	16
 #define US_SOCK_BUF_LEN		256
 #define US_MAX_READ		128
 
 /* --- server functions --- */
 
-static void exec_cmd(const char *cmd)
-{
-	int	err;
-	char	buf[LARGEBUF];
-
-	snprintf(buf, sizeof(buf), "%s %s", cmdscript, cmd);
-
-	err = system(buf);
 #ifndef WIN32
+static void exec_status(const char *buf, int err)
+{
 	if (WIFEXITED(err)) {
 		if (WEXITSTATUS(err)) {
 			upslogx(LOG_INFO, "exec_cmd(%s) returned %d", buf, WEXITSTATUS(err));
@@ -108,7 +116,60 @@ static void exec_cmd(const char *cmd)
 			upslogx(LOG_ERR, "Execute command failure: %s", buf);
 		}
 	}
+}
+
+/* Start CMDSCRIPT for count timer names, and describe the call in buf.
+ * Unless it needs the shell, CMDSCRIPT (possibly with arguments of its
+ * own) is run directly, and gets the names as separate arguments. */
+static pid_t exec_spawn(char **names, size_t count, char *buf, size_t buflen)
+{
+	char	*args[CMDSCRIPT_MAXBATCH + 1];
+	size_t	i;
+	pid_t	pid;
+
+	snprintf(buf, buflen, "%s", cmdscript);
+	for (i = 0; i < count && i < CMDSCRIPT_MAXBATCH; i++) {
+		snprintfcat(buf, buflen, " %s", names[i]);
+		args[i] = names[i];
+	}
+	args[i] = NULL;
+
+	pid = nut_spawn_command(cmdscript, args, buf, NULL);
+
+	if (pid < 0) {
+		upslog_with_errno(LOG_ERR, "Execute command failure: %s", buf);
+	}
+
+	return pid;
+}
+#endif	/* !WIN32 */
+
+static void exec_cmd(const char *cmd)
+{
+	int	err;
+	char	buf[LARGEBUF];
+#ifndef WIN32
+	char	*name = xstrdup(cmd);
+	pid_t	pid;
+
+	pid = exec_spawn(&name, 1, buf, sizeof(buf));
+	free(name);
+
+	if (pid < 0)
+		return;
+
+	while (waitpid(pid, &err, 0) < 0) {
+		if (errno != EINTR) {
+			upslog_with_errno(LOG_ERR, "Execute command failure: %s", buf);
+			return;
+		}
+	}
+
+	exec_status(buf, err);
 #else
+	snprintf(buf, sizeof(buf), "%s %s", cmdscript, cmd);
+
+	err = system(buf);
 	if(err != -1) {
 		upslogx(LOG_INFO, "Execute command \"%s\" OK", buf);
 	}
@@ -120,47 +181,121 @@ static void exec_cmd(const char *cmd)
 	return;
 }
 
-static void removetimer(ttype_t *tfind)
+/* Have the daemon run CMDSCRIPT for cmd, without waiting for it */
+static void exec_later(const char *cmd)
 {
-	ttype_t	*tmp, *last;
+#ifndef WIN32
+	exec_job_t	*job;
 
-	last = NULL;
-	tmp = thead;
+	if (cmdscript_maxprocs > 0) {
+		job = xcalloc(1, sizeof(*job));
+		job->name = xstrdup(cmd);
 
-	while (tmp) {
-		if (tmp == tfind) {	/* found it */
-			if (last == NULL)	/* deleting first */
-				thead = tmp->next;
-			else
-				last->next = tmp->next;
+		*exec_tail = job;
+		exec_tail = &job->next;
+		return;
+	}
+#endif
 
-			free(tmp->name);
-			free(tmp);
-			return;
+	exec_cmd(cmd);
+}
+
+#ifndef WIN32
+/* Reap finished CMDSCRIPT calls, and start queued ones: at most
+ * CMDSCRIPT_MAXPROCS at a time, for up to CMDSCRIPT_BATCH timers each */
+static void exec_dispatch(void)
+{
+	exec_job_t	*job, **pjob;
+	char	*names[CMDSCRIPT_MAXBATCH];
+	char	buf[LARGEBUF];
+	size_t	count;
+	int	err;
+	pid_t	pid;
+
+	while (exec_numrunning > 0 && (pid = waitpid(-1, &err, WNOHANG)) > 0) {
+		for (pjob = &exec_running; *pjob != NULL; pjob = &(*pjob)->next) {
+			if ((*pjob)->pid == pid)
+				break;
 		}
 
-		last = tmp;
-		tmp = tmp->next;
+		if (*pjob == NULL)
+			continue;
+
+		job = *pjob;
+		*pjob = job->next;
+		exec_numrunning--;
+
+		exec_status(job->name, err);
+		free(job->name);
+		free(job);
 	}
 
-	/* this one should never happen */
+	while (exec_queue != NULL && exec_numrunning < cmdscript_maxprocs) {
+		count = 0;
+		for (job = exec_queue; job != NULL && count < (size_t)cmdscript_batch; job = job->next) {
+			names[count++] = job->name;
+		}
+
+		pid = exec_spawn(names, count, buf, sizeof(buf));
+
+		while (count-- > 0) {
+			job = exec_queue;
+			exec_queue = job->next;
+			free(job->name);
+			free(job);
+		}
+
+		if (exec_queue == NULL)
+			exec_tail = &exec_queue;
 
-	upslogx(LOG_ERR, "removetimer: failed to locate target at %p", (void *)tfind);
+		if (pid < 0)
+			continue;
+
+		job = xcalloc(1, sizeof(*job));
+		job->name = xstrdup(buf);
+		job->pid = pid;
+		job->next = exec_running;
+		exec_running = job;
+		exec_numrunning++;
+	}
 }
+#endif	/* !WIN32 */
 
 static void checktimers(void)
 {
-	ttype_t	*tmp, *tmpnext;
 	time_t	now;
-	static	int	emptyctr = 0;
+	ttype_t	*tmp;
+
+	time(&now);
+
+	/* fire the timers which are due, earliest first */
+	while ((tmp = timer_first()) != NULL && now >= tmp->etime) {
+		if (nut_debug_level)
+			upslogx(LOG_INFO, "Event: %s ", tmp->name);
+
+		exec_later(tmp->name);
+
+		/* delete from queue */
+		timer_remove(tmp);
+	}
+
+#ifndef WIN32
+	exec_dispatch();
+
+	if (exec_queue || exec_running) {
+		tempty = 0;
+		return;
+	}
+#endif
 
 	/* if the queue is empty we might be ready to exit */
-	if (!thead) {
+	if (timer_count() == 0) {
 
-		emptyctr++;
+		if (!tempty)
+			tempty = now;
 
 		/* wait a little while in case someone wants us again */
-		if (emptyctr < EMPTY_WAIT)
+		if (now - tempty < EMPTY_WAIT)
 			return;
 
 		if (nut_debug_level)
@@ -176,26 +311,52 @@ static void checktimers(void)
 		exit(EXIT_SUCCESS);
 	}
 
-	emptyctr = 0;
+	tempty = 0;
+}
 
-	/* flip through LL, look for activity */
-	tmp = thead;
+/* How long the daemon may wait for clients: until the first timer is
+ * due, or until it is time to exit if there are none left */
+static void timer_wait(struct timeval *tv)
+{
+	struct timeval	now;
+	time_t	until;
+	long	limit = -1;
+	ttype_t	*first = timer_first();
 
-	time(&now);
-	while (tmp) {
-		tmpnext = tmp->next;
+	gettimeofday(&now, NULL);
 
-		if (now >= tmp->etime) {
-			if (nut_debug_level)
-				upslogx(LOG_INFO, "Event: %s ", tmp->name);
+	if (first != NULL)
+		until = first->etime;
+	else if (tempty)
+		until = tempty + EMPTY_WAIT;
+	else
+		until = now.tv_sec + 1;
 
-			exec_cmd(tmp->name);
+	if (until <= now.tv_sec) {
+		tv->tv_sec = 0;
+		tv->tv_usec = 0;
+	} else {
+		tv->tv_sec = until - now.tv_sec - 1;
+		tv->tv_usec = 1000000 - now.tv_usec;
 
-			/* delete from queue */
-			removetimer(tmp);
+		if (tv->tv_usec >= 1000000) {
+			tv->tv_sec++;
+			tv->tv_usec -= 1000000;
 		}
+	}
+
+#ifndef WIN32
+	/* finished CMDSCRIPT calls are reaped, and waiting ones started,
+	 * by polling */
+	if (exec_queue && exec_numrunning >= cmdscript_maxprocs)
+		limit = 100000;
+	else if (exec_running)
+		limit = 1000000;
+#endif
 
-		tmp = tmpnext;
+	if (limit >= 0 && (double)tv->tv_sec * 1000000.0 + (double)tv->tv_usec > (double)limit) {
+		tv->tv_sec = limit / 1000000;
+		tv->tv_usec = limit % 1000000;
 	}
 }
 
@@ -203,7 +364,6 @@ static void start_timer(const char *name, const char *ofsstr)
 {
 	time_t	now;
 	long	ofs;
-	ttype_t	*tmp, *last;
 
 	/* get the time */
 	time(&now);
@@ -219,36 +379,18 @@ static void start_timer(const char *name, const char *ofsstr)
 	if (nut_debug_level)
 		upslogx(LOG_INFO, "New timer: %s (%ld seconds)", name, ofs);
 
-	/* now add to the queue */
-	tmp = last = thead;
-
-	while (tmp) {
-		last = tmp;
-		tmp = tmp->next;
-	}
-
-	tmp = xmalloc(sizeof(ttype_t));
-	tmp->name = xstrdup(name);
-	tmp->etime = now + ofs;
-	tmp->next = NULL;
-
-	if (last)
-		last->next = tmp;
-	else
-		thead = tmp;
+	timer_add(name, now + ofs);
 }
 
 static void cancel_timer(const char *name, const char *cname)
 {
-	ttype_t	*tmp;
+	ttype_t	*tmp = timer_find(name);
 
-	for (tmp = thead; tmp != NULL; tmp = tmp->next) {
-		if (!strcmp(tmp->name, name)) {		/* match */
-			if (nut_debug_level)
-				upslogx(LOG_INFO, "Cancelling timer: %s", name);
-			removetimer(tmp);
-			return;
-		}
+	if (tmp != NULL) {		/* match */
+		if (nut_debug_level)
+			upslogx(LOG_INFO, "Cancelling timer: %s", name);
+		timer_remove(tmp);
+		return;
 	}
 
 	/* this is not necessarily an error */
@@ -256,7 +398,7 @@ static void cancel_timer(const char *name, const char *cname)
 		if (nut_debug_level)
 			upslogx(LOG_INFO, "Cancel %s, event: %s", name, cname);
 
-		exec_cmd(cname);
+		exec_later(cname);
 	}
 }
 
@@ -892,12 +1034,13 @@ static void start_daemon(TYPE_FD lockfd)
 	for (;;) {
 		int	zero_reads = 0, total_reads = 0;
 		struct timeval	start, now;
+		double	wait;
 
 		gettimeofday(&start, NULL);
 
-		/* wait at most 1s so we can check our timers regularly */
-		tv.tv_sec = 1;
-		tv.tv_usec = 0;
+		/* wait until the next timer is due */
+		timer_wait(&tv);
+		wait = (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
 
 		FD_ZERO(&rfds);
 		FD_SET(pipefd, &rfds);
@@ -944,7 +1087,7 @@ static void start_daemon(TYPE_FD lockfd)
 		if (zero_reads && zero_reads == total_reads) {
 			/* Catch run-away loops - that is, consider
 			 * throttling the cycle as to not hog CPU:
-			 * did select() spend its second to reply,
+			 * did select() spend its time to reply,
 			 * or had something to say immediately?
 			 * Note that while select() may have changed
 			 * "tv" to deduct the time waited, our further
@@ -952,13 +1095,16 @@ static void start_daemon(TYPE_FD lockfd)
 			 * So we just check the difference of "start"
 			 * and "now". If we did spend a substantial
 			 * part of the second, do not delay further.
+			 * Never sleep past the next timer due, either.
 			 */
 			double d;
 			gettimeofday(&now, NULL);
 			d = difftimeval(now, start);
 			upsdebugx(6, "difftimeval() => %f sec", d);
-			if (d > 0 && d < 0.2) {
-				d = (1.0 - d) * 1000000.0;
+			if (wait > 1.0)
+				wait = 1.0;
+			if (d > 0 && d < 0.2 && d < wait) {
+				d = (wait - d) * 1000000.0;
 				upsdebugx(5, "Enforcing a throttling sleep: %f usec", d);
 				usleep((useconds_t)d);
 			}
@@ -992,9 +1138,8 @@ static void start_daemon(TYPE_FD lockfd)
 	/* now watch for activity */
 
 	for (;;) {
-		/* wait at most 1s so we can check our timers regularly */
-		tv.tv_sec = 1;
-		tv.tv_usec = 0;
+		/* wait until the next timer is due */
+		timer_wait(&tv);
 
 		timeout_ms = (tv.tv_sec * 1000) + (tv.tv_usec / 1000);
 
@@ -1413,6 +1558,28 @@ static int conf_arg(size_t numargs, char **arg)
 		return 1;
 	}
 
+	/* CMDSCRIPT_MAXPROCS <num> */
+	if (!strcmp(arg[0], "CMDSCRIPT_MAXPROCS")) {
+		int icmdscript_maxprocs = atoi(arg[1]);
+		if (icmdscript_maxprocs < 0) {
+			upsdebugx(0, "Ignoring invalid CMDSCRIPT_MAXPROCS value: %d", icmdscript_maxprocs);
+		} else {
+			cmdscript_maxprocs = icmdscript_maxprocs;
+		}
+		return 1;
+	}
+
+	/* CMDSCRIPT_BATCH <num> */
+	if (!strcmp(arg[0], "CMDSCRIPT_BATCH")) {
+		int icmdscript_batch = atoi(arg[1]);
+		if (icmdscript_batch < 1 || icmdscript_batch > CMDSCRIPT_MAXBATCH) {
+			upsdebugx(0, "Ignoring invalid CMDSCRIPT_BATCH value: %d", icmdscript_batch);
+		} else {
+			cmdscript_batch = icmdscript_batch;
+		}
+		return 1;
+	}
+
 	if (numargs < 5)
 		return 0;
 
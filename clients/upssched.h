@@ -27,6 +27,31 @@ typedef struct conn_s {
 	struct conn_s	*next;
 } conn_t;
 
+/* pending timers (see upssched-timers.c) */
+typedef struct ttype_s {
+	char	*name;
+	time_t	etime;
+	unsigned long	seq;	/* order of START, for equal etime and CANCEL */
+	size_t	pos;		/* index in the heap */
+	struct ttype_s	*next;	/* next one with the same name hash */
+} ttype_t;
+
+/* add a timer for name, due at etime */
+ttype_t *timer_add(const char *name, time_t etime);
+
+/* the first timer due (started first, if several are due at once),
+ * or NULL if there are none */
+ttype_t *timer_first(void);
+
+/* the oldest timer started for name, or NULL if there are none */
+ttype_t *timer_find(const char *name);
+
+/* remove (and free) a timer */
+void timer_remove(ttype_t *tfind);
+
+/* how many timers are pending */
+size_t timer_count(void);
+
 #ifdef __cplusplus
 /* *INDENT-OFF* */
 }
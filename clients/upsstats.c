@@ -28,6 +28,17 @@
 #include "upsstats.h"
 #include "upsimagearg.h"
 
+#include <ctype.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <sys/socket.h>
+#include <netdb.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
 #define MAX_CGI_STRLEN 128
 #define MAX_PARSE_ARGS 16
 
@@ -42,13 +53,20 @@ static char	*upsname, *hostname;
 static char	*upsimgpath="upsimage.cgi", *upsstatpath="upsstats.cgi";
 static UPSCONN_t	ups;
 
-static FILE	*tf;
-static long	forofs = 0;
+static template_t	*thead = NULL;
+static size_t	forofs = 0, curnext = 0;
+static int	infor = 0, forjump = 0;
+
+	/* -l: stay running, and serve pages from periodic snapshots */
+static int	daemon_mode = 0, snapshot_interval = 5;
 
 static ulist_t	*ulhead = NULL, *currups = NULL;
 
 static int	skip_clause = 0, skip_block = 0;
 
+static void help(const char *prog)
+	__attribute__((noreturn));
+
 void parsearg(char *var, char *value)
 {
 	/* avoid bogus junk from evil people */
@@ -72,6 +90,12 @@ void parsearg(char *var, char *value)
 
 static void report_error(void)
 {
+	if (daemon_mode) {
+		printf("[error: %s]\n", (currups && currups->error)
+			? currups->error : "Not connected");
+		return;
+	}
+
 	if (upscli_upserror(&ups) == UPSCLI_ERR_VARNOTSUPP)
 		printf("Not supported\n");
 	else
@@ -81,7 +105,9 @@ static void report_error(void)
 /* make sure we're actually connected to upsd */
 static int check_ups_fd(int do_report)
 {
-	if (upscli_fd(&ups) == -1) {
+	if (daemon_mode ? (!currups || !currups->host || upscli_fd(&currups->host->ups) == -1)
+		: (upscli_fd(&ups) == -1)
+	) {
 		if (do_report)
 			report_error();
 
@@ -101,6 +127,41 @@ static int check_ups_fd(int do_report)
 	return 1;
 }
 
+static int snapvar_cmp(const void *a, const void *b)
+{
+	return strcasecmp(((const snapvar_t *)a)->name, ((const snapvar_t *)b)->name);
+}
+
+static int snapvar_find(const void *key, const void *elem)
+{
+	return strcasecmp((const char *)key, ((const snapvar_t *)elem)->name);
+}
+
+/* daemon mode: look the variable up in the last snapshot of currups */
+static int get_snapvar(const char *var, char *buf, size_t buflen, int verbose)
+{
+	snapvar_t	*sv;
+
+	if (currups->error) {
+		if (verbose)
+			report_error();
+
+		return 0;
+	}
+
+	sv = bsearch(var, currups->vars, currups->numvars, sizeof(*sv), snapvar_find);
+
+	if (!sv) {
+		if (verbose)
+			printf("Not supported\n");
+
+		return 0;
+	}
+
+	snprintf(buf, buflen, "%s", sv->value);
+	return 1;
+}
+
 static int get_var(const char *var, char *buf, size_t buflen, int verbose)
 {
 	int	ret;
@@ -111,6 +172,9 @@ static int get_var(const char *var, char *buf, size_t buflen, int verbose)
 	if (!check_ups_fd(1))
 		return 0;
 
+	if (daemon_mode)
+		return get_snapvar(var, buf, buflen, verbose);
+
 	if (!upsname) {
 		if (verbose)
 			printf("[No UPS name specified]\n");
@@ -353,6 +417,10 @@ static void ups_connect(void)
 	char	*newups, *newhost;
 	uint16_t	newport;
 
+	/* the daemon mode is already connected to all of them */
+	if (daemon_mode)
+		return;
+
 	/* try to minimize reconnects */
 	if (lastups) {
 
@@ -551,14 +619,14 @@ static void do_ifbetween(const char *s)
 
 static void do_upsstatpath(const char *s) {
 
-	if(strlen(s)) {
+	if(strlen(s) && strcmp(s, upsstatpath)) {
 		upsstatpath = strdup(s);
 	}
 }
 
 static void do_upsimgpath(const char *s) {
 
-	if(strlen(s)) {
+	if(strlen(s) && strcmp(s, upsimgpath)) {
 		upsimgpath = strdup(s);
 	}
 }
@@ -724,7 +792,8 @@ static int do_command(char *cmd)
 	}
 
 	if (!strcmp(cmd, "FOREACHUPS")) {
-		forofs = ftell(tf);
+		forofs = curnext;
+		infor = 1;
 
 		currups = ulhead;
 		ups_connect();
@@ -734,14 +803,15 @@ static int do_command(char *cmd)
 	if (!strcmp(cmd, "ENDFOR")) {
 
 		/* if not in a for, ignore this */
-		if (forofs == 0) {
+		if (!infor) {
 			return 1;
 		}
 
 		currups = currups->next;
 
 		if (currups) {
-			fseek(tf, forofs, SEEK_SET);
+			/* start over from the line after FOREACHUPS */
+			forjump = 1;
 			ups_connect();
 		}
 
@@ -806,10 +876,24 @@ static int do_command(char *cmd)
 	return 0;
 }
 
-static void parse_line(const char *buf)
+static void add_piece(template_t *t, const char *text, size_t len, int command)
+{
+	tpiece_t	*p;
+
+	t->pieces = xrealloc(t->pieces, (t->numpieces + 1) * sizeof(*t->pieces));
+	p = &t->pieces[t->numpieces++];
+
+	p->text = xcalloc(1, len + 1);
+	memcpy(p->text, text, len);
+	p->command = command;
+	p->nextline = 0;
+}
+
+/* split one line of the template into text and commands */
+static void parse_line(template_t *t, const char *buf)
 {
 	char	cmd[SMALLBUF];
-	size_t	i, len;
+	size_t	i, len, first = t->numpieces;
 	char	do_cmd = 0;
 
 	for (i = 0; buf[i]; i += len) {
@@ -818,7 +902,8 @@ static void parse_line(const char *buf)
 
 		if (len == 0) {
 			if (do_cmd) {
-				do_command(cmd);
+				if (cmd[0])
+					add_piece(t, cmd, strlen(cmd), 1);
 				do_cmd = 0;
 			} else {
 				cmd[0] = '\0';
@@ -834,22 +919,40 @@ static void parse_line(const char *buf)
 			continue;
 		}
 
-		if (skip_clause || skip_block) {
-			/* ignore this */
-			continue;
-		}
-
-		/* pass it trough */
-		printf("%.*s", (int)len, &buf[i]);
+		add_piece(t, &buf[i], len, 0);
 	}
+
+	for (i = first; i < t->numpieces; i++)
+		t->pieces[i].nextline = t->numpieces;
 }
 
-static void display_template(const char *tfn)
+static void free_template(template_t *t)
+{
+	size_t	i;
+
+	for (i = 0; i < t->numpieces; i++)
+		free(t->pieces[i].text);
+
+	free(t->pieces);
+	t->pieces = NULL;
+	t->numpieces = 0;
+}
+
+/* compile the template file, unless it is already and did not change since */
+static template_t *load_template(const char *tfn)
 {
 	char	fn[SMALLBUF], buf[LARGEBUF];
+	template_t	*t;
+	struct	stat	fs;
+	FILE	*tf;
 
 	snprintf(fn, sizeof(fn), "%s/%s", confpath(), tfn);
 
+	for (t = thead; t != NULL; t = t->next) {
+		if (!strcmp(t->fn, fn))
+			break;
+	}
+
 	tf = fopen(fn, "r");
 
 	if (!tf) {
@@ -857,36 +960,114 @@ static void display_template(const char *tfn)
 
 		printf("Error: can't open template file (%s)\n", tfn);
 
-		exit(EXIT_FAILURE);
+		return NULL;
 	}
 
+	if (fstat(fileno(tf), &fs) != 0)
+		fs.st_mtime = 0;
+
+	if (t && fs.st_mtime && t->mtime == fs.st_mtime) {
+		fclose(tf);
+		return t;
+	}
+
+	if (!t) {
+		t = xcalloc(1, sizeof(*t));
+		t->fn = xstrdup(fn);
+		t->next = thead;
+		thead = t;
+	}
+
+	free_template(t);
+	t->mtime = fs.st_mtime;
+
 	while (fgets(buf, sizeof(buf), tf)) {
-		parse_line(buf);
+		parse_line(t, buf);
 	}
 
 	fclose(tf);
+	return t;
+}
+
+static int display_template(const char *tfn)
+{
+	char	cmd[SMALLBUF];
+	template_t	*t;
+	tpiece_t	*p;
+	size_t	i, next;
+
+	if ((t = load_template(tfn)) == NULL)
+		return 0;
+
+	infor = forjump = 0;
+	skip_clause = skip_block = 0;
+
+	for (i = 0; i < t->numpieces; i = next) {
+		p = &t->pieces[i];
+		next = i + 1;
+
+		if (p->command) {
+			/* commands may chop up their argument */
+			snprintf(cmd, sizeof(cmd), "%s", p->text);
+			curnext = p->nextline;
+			do_command(cmd);
+		} else if (!skip_clause && !skip_block) {
+			/* pass it trough */
+			fputs(p->text, stdout);
+		}
+
+		/* ENDFOR takes effect at the end of its line */
+		if (forjump && next == p->nextline) {
+			next = forofs;
+			forjump = 0;
+		}
+	}
+
+	return 1;
+}
+
+static void display_tree_row(const char *name, const char *value)
+{
+	printf("<TR BGCOLOR=\"#60B0B0\" ALIGN=\"LEFT\">\n");
+
+	printf("<TD>%s</TD>\n", name);
+	printf("<TD>:</TD>\n");
+	printf("<TD>%s<br></TD>\n", value);
+
+	printf("</TR>\n");
 }
 
 static void display_tree(int verbose)
 {
-	size_t	numq, numa;
+	size_t	numq = 0, numa, i;
 	const	char	*query[4];
 	char	**answer;
 
-	if (!upsname) {
-		if (verbose)
-			printf("[No UPS name specified]\n");
-		return;
-	}
+	if (daemon_mode) {
+		if (!check_ups_fd(verbose))
+			return;
 
-	query[0] = "VAR";
-	query[1] = upsname;
-	numq = 2;
+		if (currups->error) {
+			if (verbose)
+				report_error();
+			return;
+		}
+	} else {
+		if (!upsname) {
+			if (verbose)
+				printf("[No UPS name specified]\n");
+			return;
+		}
 
-	if (upscli_list_start(&ups, numq, query) < 0) {
-		if (verbose)
-			report_error();
-		return;
+		query[0] = "VAR";
+		query[1] = upsname;
+		numq = 2;
+
+		if (upscli_list_start(&ups, numq, query) < 0) {
+			if (verbose)
+				report_error();
+			return;
+		}
 	}
 
 	printf("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0 Transitional//EN\"\n");
@@ -908,7 +1089,12 @@ static void display_tree(int verbose)
 
 	printf("<TR><TH COLSPAN=3 BGCOLOR=\"#60B0B0\"></TH></TR>\n");
 
-	while (upscli_list_next(&ups, numq, query, &numa, &answer) == 1) {
+	if (daemon_mode) {
+		for (i = 0; i < currups->numvars; i++)
+			display_tree_row(currups->vars[i].name, currups->vars[i].value);
+	}
+
+	while (!daemon_mode && upscli_list_next(&ups, numq, query, &numa, &answer) == 1) {
 
 		/* VAR <upsname> <varname> <val> */
 		if (numa < 4) {
@@ -918,13 +1104,7 @@ static void display_tree(int verbose)
 			return;
 		}
 
-		printf("<TR BGCOLOR=\"#60B0B0\" ALIGN=\"LEFT\">\n");
-
-		printf("<TD>%s</TD>\n", answer[2]);
-		printf("<TD>:</TD>\n");
-		printf("<TD>%s<br></TD>\n", answer[3]);
-
-		printf("</TR>\n");
+		display_tree_row(answer[2], answer[3]);
 	}
 
 	printf("</TABLE>\n");
@@ -945,7 +1125,7 @@ static void add_ups(char *sys, char *desc)
 		tmp = tmp->next;
 	}
 
-	tmp = xmalloc(sizeof(ulist_t));
+	tmp = xcalloc(1, sizeof(ulist_t));
 
 	tmp->sys = xstrdup(sys);
 	tmp->desc = xstrdup(desc);
@@ -968,7 +1148,7 @@ static void load_hosts_conf(void)
 	char	fn[SMALLBUF];
 	PCONF_CTX_t	ctx;
 
-	snprintf(fn, sizeof(fn), "%s/hosts.conf", CONFPATH);
+	snprintf(fn, sizeof(fn), "%s/hosts.conf", confpath());
 
 	pconf_init(&ctx, upsstats_hosts_err);
 
@@ -1021,15 +1201,33 @@ static void load_hosts_conf(void)
 	}
 }
 
-static void display_single(void)
+static int display_single(void)
 {
-	if (!checkhost(monhost, &monhostdesc)) {
+	ulist_t	*u = NULL, *all = ulhead, single;
+	int	ret = 1;
+
+	if (daemon_mode) {
+		/* like checkhost(), with the hosts.conf loaded at startup */
+		for (u = ulhead; u != NULL; u = u->next) {
+			if (!strcmp(u->sys, monhost))
+				break;
+		}
+	}
+
+	if (daemon_mode ? (u == NULL) : !checkhost(monhost, &monhostdesc)) {
 		printf("Access to that host [%s] is not authorized.\n",
 			monhost);
-		exit(EXIT_FAILURE);
+		return 0;
 	}
 
-	add_ups(monhost, monhostdesc);
+	if (daemon_mode) {
+		/* FOREACHUPS only goes over this one */
+		single = *u;
+		single.next = NULL;
+		ulhead = &single;
+	} else {
+		add_ups(monhost, monhostdesc);
+	}
 
 	currups = ulhead;
 	ups_connect();
@@ -1038,37 +1236,655 @@ static void display_single(void)
 	if (treemode)
 		display_tree(1);
 	else
-		display_template("upsstats-single.html");
+		ret = display_template("upsstats-single.html");
 
-	upscli_disconnect(&ups);
+	if (daemon_mode)
+		ulhead = all;
+
+	return ret;
 }
 
-int main(int argc, char **argv)
+/* the page (after the headers) for the arguments of this request */
+static int display_page(void)
+{
+	/* if a host is specified, use upsstats-single.html instead */
+	if (monhost)
+		return display_single();
+
+	/* default: multimon replacement mode */
+
+	if (!daemon_mode)
+		load_hosts_conf();
+
+	currups = ulhead;
+
+	return display_template("upsstats.html");
+}
+
+#ifndef WIN32
+/* --- daemon mode --- */
+
+#define SNAPSHOT_CONNECT_TIMEOUT	5
+#define HTTP_REQUEST_TIMEOUT	5
+#define HTTP_MAX_LISTEN		8
+#define HTTP_MAX_CLIENTS	64
+
+/* one connection from a web client: the request is read, then the
+ * reply written, as the socket allows - a slow client only waits
+ * for itself */
+typedef struct {
+	int	fd;
+	time_t	deadline;
+	char	req[LARGEBUF];
+	size_t	reqlen;
+	char	*reply;
+	size_t	replylen, replyofs;
+} http_client_t;
+
+static upshost_t	*hosthead = NULL;
+static int	stdout_fd = -1;
+
+	/* pages are rendered into this file, then sent from memory */
+static int	page_fd = -1;
+
+static http_client_t	clients[HTTP_MAX_CLIENTS];
+static int	numclients = 0;
+
+/* group the UPS from hosts.conf by the upsd they are on */
+static void snapshot_init(void)
+{
+	ulist_t	*u;
+	upshost_t	*h;
+	char	*newhost;
+	uint16_t	newport;
+
+	for (u = ulhead; u != NULL; u = u->next) {
+		if (upscli_splitname(u->sys, &u->upsname, &newhost, &newport) != 0) {
+			upslogx(LOG_ERR, "Unusable UPS definition [%s]", u->sys);
+			u->error = xstrdup("Unusable UPS definition");
+			continue;
+		}
+
+		for (h = hosthead; h != NULL; h = h->next) {
+			if (!strcmp(h->hostname, newhost) && h->port == newport)
+				break;
+		}
+
+		if (h) {
+			free(newhost);
+		} else {
+			h = xcalloc(1, sizeof(*h));
+			h->hostname = newhost;
+			h->port = newport;
+			h->next = hosthead;
+			hosthead = h;
+		}
+
+		u->host = h;
+	}
+}
+
+static void snapshot_clear(ulist_t *u)
+{
+	size_t	i;
+
+	for (i = 0; i < u->numvars; i++) {
+		free(u->vars[i].name);
+		free(u->vars[i].value);
+	}
+
+	free(u->vars);
+	u->vars = NULL;
+	u->numvars = 0;
+
+	free(u->error);
+	u->error = NULL;
+}
+
+static void snapshot_failed(ulist_t *u)
+{
+	UPSCONN_t	*conn = &u->host->ups;
+
+	snapshot_clear(u);
+	u->error = xstrdup(upscli_strerror(conn));
+
+	/* start over with a new connection, unless upsd just said no */
+	switch (upscli_upserror(conn))
+	{
+		case UPSCLI_ERR_INVRESP:
+		case UPSCLI_ERR_SENDFAILURE:
+		case UPSCLI_ERR_RECVFAILURE:
+		case UPSCLI_ERR_WRITE:
+		case UPSCLI_ERR_READ:
+		case UPSCLI_ERR_SSLERR:
+		case UPSCLI_ERR_SRVDISC:
+		case UPSCLI_ERR_PARSE:
+		case UPSCLI_ERR_PROTOCOL:
+			upscli_disconnect(conn);
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* get all variables of one UPS with a single LIST VAR */
+static void snapshot_ups(ulist_t *u)
+{
+	int	ret;
+	size_t	numq, numa, maxvars = 0;
+	const	char	*query[4];
+	char	**answer;
+	UPSCONN_t	*conn = &u->host->ups;
+
+	snapshot_clear(u);
+
+	if (upscli_fd(conn) == -1) {
+		u->error = xstrdup(upscli_strerror(conn));
+		return;
+	}
+
+	query[0] = "VAR";
+	query[1] = u->upsname;
+	numq = 2;
+
+	if (upscli_list_start(conn, numq, query) < 0) {
+		snapshot_failed(u);
+		return;
+	}
+
+	while ((ret = upscli_list_next(conn, numq, query, &numa, &answer)) == 1) {
+
+		/* VAR <upsname> <varname> <val> */
+		if (numa < 4)
+			continue;
+
+		if (u->numvars == maxvars) {
+			maxvars = maxvars ? maxvars * 2 : 64;
+			u->vars = xrealloc(u->vars, maxvars * sizeof(*u->vars));
+		}
+
+		u->vars[u->numvars].name = xstrdup(answer[2]);
+		u->vars[u->numvars].value = xstrdup(answer[3]);
+		u->numvars++;
+	}
+
+	if (ret < 0) {
+		snapshot_failed(u);
+		return;
+	}
+
+	qsort(u->vars, u->numvars, sizeof(*u->vars), snapvar_cmp);
+}
+
+/* (re)connect to each upsd as needed, and take a new snapshot of each UPS */
+static void snapshot_refresh(void)
+{
+	upshost_t	*h;
+	ulist_t	*u;
+	struct	timeval	tv;
+
+	for (h = hosthead; h != NULL; h = h->next) {
+		if (upscli_fd(&h->ups) != -1)
+			continue;
+
+		tv.tv_sec = SNAPSHOT_CONNECT_TIMEOUT;
+		tv.tv_usec = 0;
+
+		if (upscli_tryconnect(&h->ups, h->hostname, h->port, 0, &tv) < 0) {
+			upsdebugx(1, "Can't connect to %s port %" PRIu16 ": %s",
+				h->hostname, h->port, upscli_strerror(&h->ups));
+		}
+	}
+
+	for (u = ulhead; u != NULL; u = u->next) {
+		if (u->host)
+			snapshot_ups(u);
+	}
+}
+
+/* [address]:port, address:port or just port */
+static int http_listen(const char *addr, int *fds, int maxfds)
+{
+	char	*buf, *host = NULL, *service, *ptr;
+	struct	addrinfo	hints, *res, *ai;
+	int	numfds = 0, fd, one = 1, ret;
+
+	buf = xstrdup(addr);
+	service = buf;
+
+	if ((ptr = strrchr(buf, ':')) != NULL) {
+		*ptr = '\0';
+		service = ptr + 1;
+		host = buf;
+
+		if (*host == '[' && ptr > host + 1 && ptr[-1] == ']') {
+			ptr[-1] = '\0';
+			host++;
+		}
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+
+	ret = getaddrinfo((host && *host) ? host : NULL, service, &hints, &res);
+
+	if (ret != 0)
+		fatalx(EXIT_FAILURE, "Can't resolve %s: %s", addr, gai_strerror(ret));
+
+	for (ai = res; ai != NULL && numfds < maxfds; ai = ai->ai_next) {
+		if ((fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0)
+			continue;
+
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (void *)&one, sizeof(one));
+#ifdef IPV6_V6ONLY
+		if (ai->ai_family == AF_INET6)
+			setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (void *)&one, sizeof(one));
+#endif
+
+		if (bind(fd, ai->ai_addr, ai->ai_addrlen) < 0 || listen(fd, 16) < 0) {
+			upslog_with_errno(LOG_WARNING, "Can't listen on %s", addr);
+			close(fd);
+			continue;
+		}
+
+		fds[numfds++] = fd;
+	}
+
+	freeaddrinfo(res);
+	free(buf);
+
+	if (numfds == 0)
+		fatalx(EXIT_FAILURE, "Can't listen on %s", addr);
+
+	return numfds;
+}
+
+static void http_reply(http_client_t *c, char *reply, size_t len)
+{
+	free(c->reply);
+	c->reply = reply;
+	c->replylen = len;
+	c->replyofs = 0;
+}
+
+static void http_error(http_client_t *c, const char *status)
+{
+	char	buf[SMALLBUF];
+
+	snprintf(buf, sizeof(buf), "HTTP/1.0 %s\r\n"
+		"Content-type: text/plain\r\n"
+		"Connection: close\r\n"
+		"\r\n"
+		"%s\n", status, status);
+
+	http_reply(c, xstrdup(buf), strlen(buf));
+}
+
+/* cgilib gives up on the whole process on a bad escape: don't let
+ * a request do that to the daemon */
+static int http_query_valid(const char *query)
+{
+	const	char	*ptr;
+
+	for (ptr = query; (ptr = strchr(ptr, '%')) != NULL; ptr += 3) {
+		if (!isxdigit((unsigned char)ptr[1]) || !isxdigit((unsigned char)ptr[2]))
+			return 0;
+	}
+
+	return 1;
+}
+
+/* the page code printf()s: point stdout at page_fd for a while, and
+ * take back what was written */
+static void http_render(http_client_t *c, int head_only)
 {
-	NUT_UNUSED_VARIABLE(argc);
-	NUT_UNUSED_VARIABLE(argv);
+	struct	stat	st;
+	char	*page;
+	ssize_t	ret;
 
+	fflush(stdout);
+
+	if (ftruncate(page_fd, 0) < 0 || lseek(page_fd, 0, SEEK_SET) < 0
+	 || dup2(page_fd, STDOUT_FILENO) < 0
+	) {
+		upslog_with_errno(LOG_ERR, "%s: can't prepare the page", __func__);
+		http_error(c, "500 Internal Server Error");
+		return;
+	}
+
+	printf("HTTP/1.0 200 OK\r\n");
+	printf("Content-type: text/html\r\n");
+	printf("Pragma: no-cache\r\n");
+	printf("Connection: close\r\n");
+	printf("\r\n");
+
+	if (!head_only)
+		display_page();
+
+	fflush(stdout);
+	dup2(stdout_fd, STDOUT_FILENO);
+
+	if (fstat(page_fd, &st) < 0 || st.st_size <= 0) {
+		upslog_with_errno(LOG_ERR, "%s: can't size the page", __func__);
+		http_error(c, "500 Internal Server Error");
+		return;
+	}
+
+	page = xcalloc(1, (size_t)st.st_size);
+	ret = pread(page_fd, page, (size_t)st.st_size, 0);
+
+	if (ret != (ssize_t)st.st_size) {
+		upslog_with_errno(LOG_ERR, "%s: can't read the page back", __func__);
+		free(page);
+		http_error(c, "500 Internal Server Error");
+		return;
+	}
+
+	http_reply(c, page, (size_t)st.st_size);
+}
+
+/* answer a complete request - from the snapshots, so the only network
+ * I/O here is with the clients */
+static void http_handle(http_client_t *c)
+{
+	char	*method, *target, *query, *last = NULL;
+
+	method = strtok_r(c->req, " ", &last);
+	target = strtok_r(NULL, " \r\n", &last);
+
+	if (!method || !target) {
+		http_error(c, "400 Bad Request");
+		return;
+	}
+
+	if (strcmp(method, "GET") && strcmp(method, "HEAD")) {
+		http_error(c, "405 Method Not Allowed");
+		return;
+	}
+
+	query = strchr(target, '?');
+
+	if (query)
+		*query++ = '\0';
+	else
+		query = target + strlen(target);
+
+	if (!http_query_valid(query)) {
+		http_error(c, "400 Bad Request");
+		return;
+	}
+
+	upsdebugx(2, "%s: %s %s?%s", __func__, method, target, query);
+
+	/* forget the arguments of the previous request */
+	free(monhost);
+	monhost = NULL;
+	refreshdelay = -1;
+	treemode = 0;
+	use_celsius = 1;
+
+	setenv("QUERY_STRING", query, 1);
 	extractcgiargs();
 
-	printf("Content-type: text/html\n");
-	printf("Pragma: no-cache\n");
-	printf("\n");
+	http_render(c, !strcmp(method, "HEAD"));
+}
 
-	/* if a host is specified, use upsstats-single.html instead */
-	if (monhost) {
-		display_single();
-		exit(EXIT_SUCCESS);
+static void http_accept(int listenfd)
+{
+	http_client_t	*c;
+	int	fd;
+
+	if ((fd = accept(listenfd, NULL, NULL)) < 0) {
+		upsdebug_with_errno(2, "accept");
+		return;
 	}
 
-	/* default: multimon replacement mode */
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+		upsdebug_with_errno(2, "%s: fcntl", __func__);
+		close(fd);
+		return;
+	}
+
+	c = &clients[numclients++];
+	memset(c, 0, sizeof(*c));
+	c->fd = fd;
+	c->deadline = time(NULL) + HTTP_REQUEST_TIMEOUT;
+}
+
+/* keep the client list packed, the order does not matter */
+static void http_drop(int i)
+{
+	close(clients[i].fd);
+	free(clients[i].reply);
+
+	if (i != --numclients)
+		clients[i] = clients[numclients];
+}
+
+/* returns 0 when done with the client */
+static int http_read(http_client_t *c)
+{
+	ssize_t	ret;
+
+	/* only the request line matters, but take the whole header */
+	ret = read(c->fd, c->req + c->reqlen, sizeof(c->req) - 1 - c->reqlen);
+
+	if (ret < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+
+	c->reqlen += (size_t)ret;
+	c->req[c->reqlen] = '\0';
+
+	if (ret > 0 && c->reqlen < sizeof(c->req) - 1
+	 && !strstr(c->req, "\r\n\r\n") && !strstr(c->req, "\n\n")
+	)
+		return 1;
+
+	/* the header is complete, cut or the client is done sending */
+	http_handle(c);
+
+	return 1;
+}
+
+/* returns 0 when done with the client */
+static int http_write(http_client_t *c)
+{
+	ssize_t	ret;
+
+	ret = write(c->fd, c->reply + c->replyofs, c->replylen - c->replyofs);
+
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 1;
+
+		upsdebug_with_errno(2, "%s: writing to client", __func__);
+		return 0;
+	}
+
+	/* a long page to a slow client: give it time while it reads */
+	c->replyofs += (size_t)ret;
+	c->deadline = time(NULL) + HTTP_REQUEST_TIMEOUT;
+
+	return (c->replyofs < c->replylen);
+}
+
+static void daemon_loop(const char *addr, struct passwd *new_uid)
+{
+	int	fds[HTTP_MAX_LISTEN], numfds, i, ret, timeout, keep, listening;
+	struct	pollfd	pfds[HTTP_MAX_LISTEN + HTTP_MAX_CLIENTS], *pfd;
+	nfds_t	numpfds, first;
+	time_t	now, next = 0, wake;
+	FILE	*pagefile;
+
+	numfds = http_listen(addr, fds, HTTP_MAX_LISTEN);
 
 	load_hosts_conf();
+	snapshot_init();
 
-	currups = ulhead;
+	if ((pagefile = tmpfile()) == NULL)
+		fatal_with_errno(EXIT_FAILURE, "tmpfile");
+
+	page_fd = fileno(pagefile);
+
+	signal(SIGPIPE, SIG_IGN);
+
+	if ((stdout_fd = dup(STDOUT_FILENO)) < 0)
+		fatal_with_errno(EXIT_FAILURE, "dup");
+
+	setvbuf(stdout, NULL, _IOFBF, LARGEBUF);
+
+	/* the ports are bound and the configuration read: drop root */
+	become_user(new_uid);
+
+	upslogx(LOG_INFO, "Serving pages on %s, refreshing data every %d seconds",
+		addr, snapshot_interval);
+
+	for (;;) {
+		time(&now);
+
+		if (now >= next) {
+			snapshot_refresh();
+			time(&now);
+			next = now + snapshot_interval;
+		}
+
+		numpfds = 0;
+
+		/* when full, new connections wait in the listen backlog */
+		listening = (numclients < HTTP_MAX_CLIENTS);
 
-	display_template("upsstats.html");
+		if (listening) {
+			for (i = 0; i < numfds; i++) {
+				pfds[numpfds].fd = fds[i];
+				pfds[numpfds].events = POLLIN;
+				numpfds++;
+			}
+		}
+
+		wake = next;
+		first = numpfds;
+
+		for (i = 0; i < numclients; i++) {
+			pfds[numpfds].fd = clients[i].fd;
+			pfds[numpfds].events = clients[i].reply ? POLLOUT : POLLIN;
+			numpfds++;
+
+			if (clients[i].deadline < wake)
+				wake = clients[i].deadline;
+		}
+
+		timeout = (wake > now) ? (int)(wake - now) * 1000 : 0;
+
+		ret = poll(pfds, numpfds, timeout);
+
+		if (ret < 0 && errno != EINTR)
+			upslog_with_errno(LOG_ERR, "poll");
+
+		time(&now);
+
+		/* a dropped client is replaced by the last one: walk backwards,
+		 * so pfds[] still matches the clients not seen yet */
+		for (i = numclients - 1; i >= 0; i--) {
+			pfd = &pfds[first + (nfds_t)i];
+			keep = 1;
+
+			if (ret > 0 && pfd->revents) {
+				if (clients[i].reply)
+					keep = http_write(&clients[i]);
+				else
+					keep = http_read(&clients[i]);
+			}
+
+			if (keep && now >= clients[i].deadline) {
+				upsdebugx(2, "Client timed out");
+				keep = 0;
+			}
+
+			if (!keep)
+				http_drop(i);
+		}
+
+		if (ret <= 0 || !listening)
+			continue;
+
+		for (i = 0; i < numfds && numclients < HTTP_MAX_CLIENTS; i++) {
+			if (pfds[i].revents & POLLIN)
+				http_accept(fds[i]);
+		}
+	}
+}
+#endif	/* !WIN32 */
+
+static void help(const char *prog)
+{
+	printf("Web-based UPS status viewer.\n");
+	printf("\nusage: %s [-h] [-l [<address>:]<port> [-i <interval>] [-u <user>]]\n", prog);
+	printf("\n");
+	printf("  -h		- display this help text\n");
+	printf("  -l <address>	- stay running, and serve the pages over HTTP on this\n");
+	printf("		  [address:]port (use [address]:port for IPv6)\n");
+	printf("  -i <interval>	- with -l: seconds between data refreshes (default 5)\n");
+	printf("  -u <user>	- with -l: run as this user once the port is bound\n");
+	printf("		  (default: %s)\n", RUN_AS_USER);
+	printf("\nWithout -l, this is run as a CGI program by your web server.\n");
+
+	nut_report_config_flags();
+
+	exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char **argv)
+{
+	int	i, ret;
+	const char	*prog = xbasename(argv[0]);
+	const char	*listen_addr = NULL, *user = RUN_AS_USER;
+
+	/* web servers may turn a query string into command line arguments,
+	 * so only look at them when not run as a CGI */
+	while (!getenv("GATEWAY_INTERFACE") && (i = getopt(argc, argv, "+hl:i:u:")) != -1) {
+		switch (i) {
+			case 'l':
+				listen_addr = optarg;
+				break;
+
+			case 'i':
+				snapshot_interval = atoi(optarg);
+				if (snapshot_interval < 1)
+					fatalx(EXIT_FAILURE, "Invalid interval: %s", optarg);
+				break;
+
+			case 'u':
+				user = optarg;
+				break;
+
+			case 'h':
+			default:
+				help(prog);
+		}
+	}
+
+	if (listen_addr) {
+#ifndef WIN32
+		daemon_mode = 1;
+		daemon_loop(listen_addr, get_user_pwent(user));
+#else
+		NUT_UNUSED_VARIABLE(user);
+		fatalx(EXIT_FAILURE, "The -l option is not supported on this platform");
+#endif
+	}
+
+	extractcgiargs();
+
+	printf("Content-type: text/html\n");
+	printf("Pragma: no-cache\n");
+	printf("\n");
+
+	ret = display_page();
 
 	upscli_disconnect(&ups);
 
-	return 0;
+	return ret ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -26,12 +26,48 @@ extern "C" {
 /* *INDENT-ON* */
 #endif
 
+/* one variable in the snapshot of a UPS (daemon mode) */
+typedef struct {
+	char	*name;
+	char	*value;
+}	snapvar_t;
+
+/* one upsd that the daemon mode stays connected to */
+typedef struct {
+	char	*hostname;
+	uint16_t	port;
+	UPSCONN_t	ups;
+	void	*next;
+}	upshost_t;
+
 typedef struct {
 	char	*sys;
 	char	*desc;
 	void	*next;
+
+	/* daemon mode: where the data comes from, and its last snapshot */
+	char	*upsname;
+	upshost_t	*host;
+	snapvar_t	*vars;		/* sorted by name */
+	size_t	numvars;
+	char	*error;		/* why the last refresh failed, or NULL */
 }	ulist_t;
 
+/* template file compiled into pieces of text, and @COMMAND@s between them */
+typedef struct {
+	char	*text;
+	int	command;
+	size_t	nextline;	/* index of the first piece of the next line */
+}	tpiece_t;
+
+typedef struct {
+	char	*fn;
+	time_t	mtime;
+	tpiece_t	*pieces;
+	size_t	numpieces;
+	void	*next;
+}	template_t;
+
 #ifdef __cplusplus
 /* *INDENT-OFF* */
 }
@@ -38,6 +38,15 @@
 # include <unistd.h>	/* readlink */
 #endif
 
+#ifndef WIN32
+# ifdef HAVE_SPAWN_H
+#  include <spawn.h>	/* nut_spawn_command() */
+# endif
+# ifdef HAVE_POSIX_SPAWNP
+extern char **environ;
+# endif
+#endif
+
 #include <dirent.h>
 #if !HAVE_DECL_REALPATH
 # include <sys/stat.h>
@@ -3499,6 +3508,107 @@ void set_close_on_exec(int fd) {
 #endif
 }
 
+#ifndef WIN32
+pid_t nut_spawn_command(const char *cmd, char *const args[], const char *shellcmd, const char *input)
+{
+	char	*cmdcopy = NULL, **argv, *s, *last = NULL;
+	size_t	argc = 0, nargs = 0, i;
+	int	pfd[2] = { -1, -1 }, saved_errno;
+	pid_t	pid;
+#ifdef HAVE_POSIX_SPAWNP
+	int	ret;
+	posix_spawn_file_actions_t	actions;
+#endif
+
+	while (args && args[nargs] != NULL)
+		nargs++;
+
+	/* enough for each word of cmd, the args or the shell, and NULL */
+	argv = xcalloc(strlen(cmd) / 2 + 1 + nargs + 3 + 1, sizeof(*argv));
+
+	/* only go through the shell if the command needs it */
+	if (strpbrk(cmd, "\"'\\$`|&;<>(){}[]*?~#=%!\t\n") == NULL) {
+		cmdcopy = xstrdup(cmd);
+
+		for (s = strtok_r(cmdcopy, " ", &last); s != NULL;
+			s = strtok_r(NULL, " ", &last)
+		) {
+			argv[argc++] = s;
+		}
+	}
+
+	if (argc == 0) {
+		argv[argc++] = "/bin/sh";
+		argv[argc++] = "-c";
+		argv[argc++] = (char *)(shellcmd ? shellcmd : cmd);
+	} else {
+		for (i = 0; i < nargs; i++) {
+			argv[argc++] = args[i];
+		}
+	}
+
+	argv[argc] = NULL;
+
+	if (input && pipe(pfd)) {
+		saved_errno = errno;
+		free(argv);
+		free(cmdcopy);
+		errno = saved_errno;
+		return -1;
+	}
+
+#ifdef HAVE_POSIX_SPAWNP
+	posix_spawn_file_actions_init(&actions);
+
+	if (input) {
+		posix_spawn_file_actions_adddup2(&actions, pfd[0], STDIN_FILENO);
+		posix_spawn_file_actions_addclose(&actions, pfd[0]);
+		posix_spawn_file_actions_addclose(&actions, pfd[1]);
+	}
+
+	ret = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (ret) {
+		errno = ret;
+		pid = -1;
+	}
+#else
+	pid = fork();
+
+	if (pid == 0) {
+		if (input) {
+			dup2(pfd[0], STDIN_FILENO);
+			close(pfd[0]);
+			close(pfd[1]);
+		}
+
+		execvp(argv[0], argv);
+		_exit(EXIT_FAILURE);
+	}
+#endif
+
+	saved_errno = errno;
+
+	if (input) {
+		close(pfd[0]);
+
+		/* a helper which does not read it is not an error */
+		if (pid > 0 && write(pfd[1], input, strlen(input)) < 0) {
+			upsdebug_with_errno(2, "%s: writing to %s", __func__, argv[0]);
+		}
+
+		close(pfd[1]);
+	}
+
+	free(argv);
+	free(cmdcopy);
+
+	errno = saved_errno;
+	return pid;
+}
+#endif	/* !WIN32 */
+
 /**** REGEX helper methods ****/
 
 int strcmp_null(const char *s1, const char *s2)
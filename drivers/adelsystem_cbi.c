@@ -627,9 +627,12 @@ void reginit(void)
 int read_all_regs(modbus_t *mb, uint16_t *data)
 {
 	int rval;
+	struct timeval start;
 
 	/* read all HOLDING registers */
+	gettimeofday(&start, NULL);
 	rval = modbus_read_registers(mb, regs[H_REG_STARTIDX].xaddr, MAX_H_REGS, data);
+	drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, rval != -1);
 	if (rval == -1) {
 		upslogx(LOG_ERR,
 				"ERROR:(%s) modbus_read: addr:0x%x, length:%8d, path:%s\n",
@@ -655,11 +658,13 @@ int read_all_regs(modbus_t *mb, uint16_t *data)
 int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
 {
 	int rval = -1;
+	struct timeval start;
 
 	/* register bit masks */
 	uint16_t mask8 = 0x00FF;
 	uint16_t mask16 = 0xFFFF;
 
+	gettimeofday(&start, NULL);
 	switch (type) {
 		case COIL:
 			rval = modbus_read_bits(mb, addr, 1, (uint8_t *)data);
@@ -706,6 +711,7 @@ int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
 # pragma GCC diagnostic pop
 #endif
 	}
+	drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, rval != -1);
 	if (rval == -1) {
 		upslogx(LOG_ERR,
 				"ERROR:(%s) modbus_read: addr:0x%x, type:%8s, path:%s\n",
@@ -731,11 +737,13 @@ int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
 int register_write(modbus_t *mb, int addr, regtype_t type, void *data)
 {
 	int rval = -1;
+	struct timeval start;
 
 	/* register bit masks */
 	uint16_t mask8 = 0x00FF;
 	uint16_t mask16 = 0xFFFF;
 
+	gettimeofday(&start, NULL);
 	switch (type) {
 		case COIL:
 			*(uint16_t *)data = *(uint16_t *)data & mask8;
@@ -763,6 +771,7 @@ int register_write(modbus_t *mb, int addr, regtype_t type, void *data)
 			upsdebugx(2,"ERROR: register_write: invalid register type %d\n", type);
 			break;
 	}
+	drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, rval != -1);
 	if (rval == -1) {
 		upslogx(LOG_ERR,
 				"ERROR:(%s) modbus_write: addr:0x%x, type:%8s, path:%s\n",
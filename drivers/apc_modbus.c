@@ -30,9 +30,10 @@
 #include <stdio.h>
 
 #include <modbus.h>
+#include "modbus-regmap.h"
 
 #define DRIVER_NAME "NUT APC Modbus driver"
-#define DRIVER_VERSION "0.10"
+#define DRIVER_VERSION "0.11"
 
 #if defined NUT_MODBUS_HAS_USB
 
@@ -74,6 +75,10 @@ static USBDeviceMatcher_t *best_matcher = NULL;
 static int is_usb = 0;
 #endif /* defined NUT_MODBUS_HAS_USB */
 static int is_open = 0;
+static int is_tcp = 0;
+static int modbus_slave_id = 1;
+static int tcp_pipeline = 1;
+static struct timeval tcp_timeout = { 0, 500000 }; /* libmodbus default */
 static double power_nominal;
 static double realpower_nominal;
 
@@ -953,6 +958,11 @@ static void _apc_modbus_interframe_delay(void)
 	static const useconds_t inter_frame_delay = 35000;
 	useconds_t current_time, delta_time;
 
+	if (is_tcp) {
+		/* Only for serial links, TCP has its own framing */
+		return;
+	}
+
 	current_time = _apc_modbus_get_time_us();
 	delta_time = current_time - last_send_time;
 
@@ -1009,9 +1019,16 @@ static void _apc_modbus_handle_error(modbus_t *ctx)
 
 static int _apc_modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest)
 {
+	int r;
+	struct timeval start;
+
 	_apc_modbus_interframe_delay();
 
-	if (modbus_read_registers(ctx, addr, nb, dest) > 0) {
+	gettimeofday(&start, NULL);
+	r = modbus_read_registers(ctx, addr, nb, dest);
+	drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, r > 0);
+
+	if (r > 0) {
 		return 1;
 	} else {
 		upslogx(LOG_ERR, "%s: Read of %d:%d failed: %s (%s)", __func__, addr, addr + nb, modbus_strerror(errno), device_path);
@@ -1020,6 +1037,39 @@ static int _apc_modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t
 	}
 }
 
+/* Reads several register blocks, all requests sent at once on TCP if tcp_pipeline is set.
+ * Stops at the first failure, unread blocks are left with rval -1. */
+static int _apc_modbus_read_blocks(modbus_t *ctx, mbregmap_read_t *reads, size_t nreads)
+{
+	size_t i;
+
+	if (!is_tcp || tcp_pipeline <= 1) {
+		for (i = 0; i < nreads; i++) {
+			reads[i].rval = -1;
+		}
+		for (i = 0; i < nreads; i++) {
+			if (!_apc_modbus_read_registers(ctx, reads[i].addr, reads[i].count, reads[i].dest)) {
+				return 0;
+			}
+			reads[i].rval = reads[i].count;
+		}
+		return 1;
+	}
+
+	if (mbregmap_tcp_read_batch(ctx, modbus_slave_id, tcp_pipeline, &tcp_timeout, reads, nreads) == 0) {
+		return 1;
+	}
+
+	for (i = 0; i < nreads; i++) {
+		if (reads[i].rval == -1) {
+			upslogx(LOG_ERR, "%s: Read of %d:%d failed: %s (%s)", __func__, reads[i].addr, reads[i].addr + reads[i].count, modbus_strerror(reads[i].err), device_path);
+			errno = reads[i].err;
+		}
+	}
+	_apc_modbus_handle_error(ctx);
+	return 0;
+}
+
 static int _apc_modbus_update_value(apc_modbus_register_t *regs_info, const uint16_t *regs, const size_t regs_len)
 {
 	apc_modbus_value_t value;
@@ -1362,8 +1412,13 @@ void upsdrv_initinfo(void)
 
 void upsdrv_updateinfo(void)
 {
-	uint16_t regbuf[32];
+	uint16_t regbuf[27], dynbuf[32], staticbuf[22];
 	uint64_t value;
+	mbregmap_read_t reads[] = {
+		{ MBREGMAP_HOLDING, 0, SIZEOF_ARRAY(regbuf), regbuf, 0, 0 },		/* Status Data */
+		{ MBREGMAP_HOLDING, 128, SIZEOF_ARRAY(dynbuf), dynbuf, 0, 0 },		/* Dynamic Data */
+		{ MBREGMAP_HOLDING, 1026, SIZEOF_ARRAY(staticbuf), staticbuf, 0, 0 }	/* Static Data */
+	};
 
 	if (!is_open) {
 		if (!_apc_modbus_reopen()) {
@@ -1373,11 +1428,14 @@ void upsdrv_updateinfo(void)
 		}
 	}
 
+	/* All requests at once, so that over TCP they can share the round-trip time */
+	_apc_modbus_read_blocks(modbus_ctx, reads, SIZEOF_ARRAY(reads));
+
 	alarm_init();
 	status_init();
 
 	/* Status Data */
-	if (_apc_modbus_read_registers(modbus_ctx, 0, 27, regbuf)) {
+	if (reads[0].rval != -1) {
 		/* UPSStatus_BF, 2 registers */
 		_apc_modbus_to_uint64(&regbuf[0], 2, &value);
 		if (value & (1 << 1)) {
@@ -1433,9 +1491,9 @@ void upsdrv_updateinfo(void)
 	}
 
 	/* Dynamic Data */
-	if (_apc_modbus_read_registers(modbus_ctx, 128, 32, regbuf)) {
+	if (reads[1].rval != -1) {
 		/* InputStatus_BF, 1 register */
-		_apc_modbus_to_uint64(&regbuf[22], 1, &value);
+		_apc_modbus_to_uint64(&dynbuf[22], 1, &value);
 		if (value & (1 << 5)) {
 			status_set("BOOST");
 		}
@@ -1443,15 +1501,15 @@ void upsdrv_updateinfo(void)
 			status_set("TRIM");
 		}
 
-		_apc_modbus_process_registers(apc_modbus_register_map_dynamic, regbuf, 32, 128);
+		_apc_modbus_process_registers(apc_modbus_register_map_dynamic, dynbuf, 32, 128);
 	} else {
 		dstate_datastale();
 		return;
 	}
 
 	/* Static Data */
-	if (_apc_modbus_read_registers(modbus_ctx, 1026, 22, regbuf)) {
-		_apc_modbus_process_registers(apc_modbus_register_map_static, regbuf, 22, 1026);
+	if (reads[2].rval != -1) {
+		_apc_modbus_process_registers(apc_modbus_register_map_static, staticbuf, 22, 1026);
 	} else {
 		dstate_datastale();
 		return;
@@ -1484,6 +1542,7 @@ void upsdrv_makevartable(void)
 #endif /* defined NUT_MODBUS_HAS_USB */
 	addvar(VAR_VALUE, "slaveid", "Modbus slave id (default=1)");
 	addvar(VAR_VALUE, "response_timeout_ms", "Modbus response timeout in milliseconds");
+	addvar(VAR_VALUE, "tcp_pipeline", "Modbus TCP requests sent before awaiting responses (default=1)");
 
 	/* Serial RTU parameters */
 	addvar(VAR_VALUE, "baudrate", "Modbus serial RTU communication speed in baud (default=9600)");
@@ -1779,6 +1838,15 @@ void upsdrv_initups(void)
 		}
 
 		modbus_ctx = modbus_new_tcp_pi(tcp_host, tcp_port);
+		is_tcp = 1;
+
+		val = getval("tcp_pipeline");
+		if (val != NULL) {
+			tcp_pipeline = atoi(val);
+			if (tcp_pipeline < 1 || tcp_pipeline > 64) {
+				fatalx(EXIT_FAILURE, "invalid tcp_pipeline %s", val);
+			}
+		}
 	} else if (!strcasecmp(val, "serial")) {
 		val = getval("baudrate");
 		rtu_baudrate = val ? atoi(val) : modbus_rtu_default_baudrate;
@@ -1810,10 +1878,13 @@ void upsdrv_initups(void)
 		modbus_free(modbus_ctx);
 		fatalx(EXIT_FAILURE, "modbus_set_slave: invalid slave id %d", slaveid);
 	}
+	modbus_slave_id = slaveid;
 
 	val = getval("response_timeout_ms");
 	if (val != NULL) {
 		response_timeout_ms = (uint32_t)strtoul(val, NULL, 0);
+		tcp_timeout.tv_sec = (time_t)(response_timeout_ms / 1000);
+		tcp_timeout.tv_usec = (suseconds_t)((response_timeout_ms % 1000) * 1000);
 
 #if (defined NUT_MODBUS_TIMEOUT_ARG_sec_usec_uint32) || (defined NUT_MODBUS_TIMEOUT_ARG_sec_usec_uint32_cast_timeval_fields)
 		r = modbus_set_response_timeout(modbus_ctx, response_timeout_ms / 1000, (response_timeout_ms % 1000) * 1000);
@@ -0,0 +1,299 @@
+/* drvstats.c - Network UPS Tools driver core self-instrumentation
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h" /* must be the first header */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "dstate.h"
+#include "drvstats.h"
+#include "nut_stdint.h"
+
+/* How many recent upsdrv_updateinfo() durations we keep for the p99 */
+#define DRVSTATS_WINDOW	256
+
+typedef struct drvstats_timing_s {
+	uintmax_t	count;
+	double	last, min, max, total;	/* seconds */
+} drvstats_timing_t;
+
+typedef struct drvstats_xfer_s {
+	drvstats_timing_t	timing;
+	uintmax_t	errors;
+	uintmax_t	retries;
+	void	(*dumper)(void);
+} drvstats_xfer_t;
+
+static const char *xport_names[DRVSTATS_XPORT_MAX] = {
+	"serial",
+	"usb",
+	"snmp",
+	"modbus"
+};
+
+static int	publish = 0, published = 0;
+/* Do not count our own driver.stats.* updates towards the stats */
+static int	publishing = 0;
+
+static drvstats_timing_t	update_timing;
+static double	update_window[DRVSTATS_WINDOW];
+static size_t	update_window_pos = 0;
+
+static uintmax_t	setinfo_changes = 0, upsd_writes = 0, upsd_bytes = 0;
+
+static drvstats_xfer_t	xfer_stats[DRVSTATS_XPORT_MAX];
+
+static void timing_add(drvstats_timing_t *t, double sec)
+{
+	if (sec < 0)
+		sec = 0;
+
+	if (!t->count || sec < t->min)
+		t->min = sec;
+	if (!t->count || sec > t->max)
+		t->max = sec;
+
+	t->last = sec;
+	t->total += sec;
+	t->count++;
+}
+
+static double timing_avg(const drvstats_timing_t *t)
+{
+	return t->count ? t->total / (double)t->count : 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double	x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* nearest-rank percentile over the recent update cycles */
+static double update_p99(void)
+{
+	double	sorted[DRVSTATS_WINDOW];
+	size_t	n, rank;
+
+	n = (update_timing.count < DRVSTATS_WINDOW)
+		? (size_t)update_timing.count : DRVSTATS_WINDOW;
+	if (!n)
+		return 0;
+
+	memcpy(sorted, update_window, n * sizeof(double));
+	qsort(sorted, n, sizeof(double), cmp_double);
+
+	rank = (n * 99 + 99) / 100;
+	return sorted[rank - 1];
+}
+
+void drvstats_set_publish(int enable)
+{
+	publish = (enable != 0);
+	upsdebugx(1, "%s: publishing of driver.stats.* is now %s",
+		__func__, publish ? "enabled" : "disabled");
+}
+
+int drvstats_get_publish(void)
+{
+	return publish;
+}
+
+void drvstats_update_done(const struct timeval *start)
+{
+	struct timeval	now;
+	double	sec;
+
+	gettimeofday(&now, NULL);
+	sec = difftimeval(now, *start);
+
+	timing_add(&update_timing, sec);
+	update_window[update_window_pos] = sec;
+	update_window_pos = (update_window_pos + 1) % DRVSTATS_WINDOW;
+
+	upsdebugx(5, "%s: upsdrv_updateinfo() took %.3f ms", __func__, sec * 1000);
+}
+
+void drvstats_setinfo_changed(const char *var)
+{
+	/* Only count device data, not the driver's own state
+	 * such as driver.state or driver.stats.* themselves */
+	if (!strncmp(var, "driver.", 7))
+		return;
+
+	setinfo_changes++;
+}
+
+void drvstats_sent(size_t len)
+{
+	if (publishing)
+		return;
+
+	upsd_writes++;
+	upsd_bytes += len;
+}
+
+void drvstats_xfer(drvstats_xport_t xport, const struct timeval *start, int ok)
+{
+	struct timeval	now;
+	drvstats_xfer_t	*x;
+
+	if ((int)xport < 0 || xport >= DRVSTATS_XPORT_MAX || !start)
+		return;
+
+	x = &xfer_stats[xport];
+	gettimeofday(&now, NULL);
+	timing_add(&x->timing, difftimeval(now, *start));
+	if (!ok)
+		x->errors++;
+}
+
+void drvstats_xfer_retry(drvstats_xport_t xport)
+{
+	if ((int)xport < 0 || xport >= DRVSTATS_XPORT_MAX)
+		return;
+
+	xfer_stats[xport].retries++;
+}
+
+void drvstats_xfer_dumper(drvstats_xport_t xport, void (*dumper)(void))
+{
+	if ((int)xport < 0 || xport >= DRVSTATS_XPORT_MAX)
+		return;
+
+	xfer_stats[xport].dumper = dumper;
+}
+
+/* Remove all published values, e.g. when publishing gets disabled */
+static void drvstats_unpublish(void)
+{
+	static const char *common_names[] = {
+		"updateinfo.count", "updateinfo.last", "updateinfo.min",
+		"updateinfo.avg", "updateinfo.max", "updateinfo.p99",
+		"setinfo.changes", "upsd.writes", "upsd.bytes",
+		NULL
+	};
+	static const char *xport_fields[] = {
+		"transactions", "errors", "retries", "latency.avg", "latency.max",
+		NULL
+	};
+	char	name[SMALLBUF];
+	int	i, j;
+
+	publishing = 1;
+
+	for (i = 0; common_names[i]; i++) {
+		snprintf(name, sizeof(name), "driver.stats.%s", common_names[i]);
+		dstate_delinfo(name);
+	}
+
+	for (i = 0; i < DRVSTATS_XPORT_MAX; i++) {
+		for (j = 0; xport_fields[j]; j++) {
+			snprintf(name, sizeof(name), "driver.stats.%s.%s",
+				xport_names[i], xport_fields[j]);
+			dstate_delinfo(name);
+		}
+	}
+
+	publishing = 0;
+	published = 0;
+}
+
+void drvstats_publish(void)
+{
+	int	i;
+	char	name[SMALLBUF];
+
+	if (!publish) {
+		if (published)
+			drvstats_unpublish();
+		return;
+	}
+
+	publishing = 1;
+
+	dstate_setinfo("driver.stats.updateinfo.count", "%" PRIuMAX, update_timing.count);
+	dstate_setinfo("driver.stats.updateinfo.last", "%.3f", update_timing.last * 1000);
+	dstate_setinfo("driver.stats.updateinfo.min", "%.3f", update_timing.min * 1000);
+	dstate_setinfo("driver.stats.updateinfo.avg", "%.3f", timing_avg(&update_timing) * 1000);
+	dstate_setinfo("driver.stats.updateinfo.max", "%.3f", update_timing.max * 1000);
+	dstate_setinfo("driver.stats.updateinfo.p99", "%.3f", update_p99() * 1000);
+
+	dstate_setinfo("driver.stats.setinfo.changes", "%" PRIuMAX, setinfo_changes);
+	dstate_setinfo("driver.stats.upsd.writes", "%" PRIuMAX, upsd_writes);
+	dstate_setinfo("driver.stats.upsd.bytes", "%" PRIuMAX, upsd_bytes);
+
+	for (i = 0; i < DRVSTATS_XPORT_MAX; i++) {
+		drvstats_xfer_t	*x = &xfer_stats[i];
+
+		if (!x->timing.count && !x->retries)
+			continue;
+
+		snprintf(name, sizeof(name), "driver.stats.%s.transactions", xport_names[i]);
+		dstate_setinfo(name, "%" PRIuMAX, x->timing.count);
+		snprintf(name, sizeof(name), "driver.stats.%s.errors", xport_names[i]);
+		dstate_setinfo(name, "%" PRIuMAX, x->errors);
+		snprintf(name, sizeof(name), "driver.stats.%s.retries", xport_names[i]);
+		dstate_setinfo(name, "%" PRIuMAX, x->retries);
+		snprintf(name, sizeof(name), "driver.stats.%s.latency.avg", xport_names[i]);
+		dstate_setinfo(name, "%.3f", timing_avg(&x->timing) * 1000);
+		snprintf(name, sizeof(name), "driver.stats.%s.latency.max", xport_names[i]);
+		dstate_setinfo(name, "%.3f", x->timing.max * 1000);
+	}
+
+	publishing = 0;
+	published = 1;
+}
+
+void drvstats_dump(void)
+{
+	int	i;
+
+	upslogx(LOG_INFO, "Driver stats: updateinfo: count=%" PRIuMAX
+		" last=%.3fms min=%.3fms avg=%.3fms max=%.3fms p99=%.3fms",
+		update_timing.count,
+		update_timing.last * 1000, update_timing.min * 1000,
+		timing_avg(&update_timing) * 1000, update_timing.max * 1000,
+		update_p99() * 1000);
+
+	upslogx(LOG_INFO, "Driver stats: setinfo changes=%" PRIuMAX
+		", upsd writes=%" PRIuMAX " bytes=%" PRIuMAX,
+		setinfo_changes, upsd_writes, upsd_bytes);
+
+	for (i = 0; i < DRVSTATS_XPORT_MAX; i++) {
+		drvstats_xfer_t	*x = &xfer_stats[i];
+
+		if (!x->timing.count && !x->retries)
+			continue;
+
+		upslogx(LOG_INFO, "Driver stats: %s: transactions=%" PRIuMAX
+			" errors=%" PRIuMAX " retries=%" PRIuMAX
+			" latency avg=%.3fms max=%.3fms",
+			xport_names[i], x->timing.count, x->errors, x->retries,
+			timing_avg(&x->timing) * 1000, x->timing.max * 1000);
+
+		if (x->dumper)
+			x->dumper();
+	}
+}
@@ -0,0 +1,75 @@
+/* drvstats.h - Network UPS Tools driver core self-instrumentation
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef NUT_DRVSTATS_H_SEEN
+#define NUT_DRVSTATS_H_SEEN 1
+
+#include "common.h"
+#include "timehead.h"
+
+/* Media which can report their transaction timings to the driver core.
+ * Counters are kept for each of these separately, and only those which
+ * were actually used are published as driver.stats.<name>.* values. */
+typedef enum drvstats_xport_e {
+	DRVSTATS_XPORT_SERIAL = 0,
+	DRVSTATS_XPORT_USB,
+	DRVSTATS_XPORT_SNMP,
+	DRVSTATS_XPORT_MODBUS,
+	DRVSTATS_XPORT_MAX	/* not a transport, keep last */
+} drvstats_xport_t;
+
+/* Counters are collected always (cheap), but only published as
+ * driver.stats.* when enabled by the "publish_stats" flag in ups.conf
+ * or by protocol SET of driver.flag.publish_stats during run-time */
+void drvstats_set_publish(int enable);
+int drvstats_get_publish(void);
+
+/* Called by driver core around each upsdrv_updateinfo() */
+void drvstats_update_done(const struct timeval *start);
+
+/* Called by dstate.c when a value changed, and when data was sent to upsd */
+void drvstats_setinfo_changed(const char *var);
+void drvstats_sent(size_t len);
+
+/* Called by media layers (serial.c, libusb*.c, snmp-ups.c, modbus drivers)
+ * when a request/response transaction which started at <start> completed
+ * (ok != 0) or failed (ok == 0), and when the caller retries a transaction.
+ * Media layers may also register a function to log their own details (e.g.
+ * per-command latencies) when the driver is asked to dump its data.
+ * Media code built without a driver core (e.g. libserial-nutscan.la for
+ * nut-scanner) defines DRIVERS_WITHOUT_DRVSTATS to skip all that. */
+#ifndef DRIVERS_WITHOUT_DRVSTATS
+void drvstats_xfer(drvstats_xport_t xport, const struct timeval *start, int ok);
+void drvstats_xfer_retry(drvstats_xport_t xport);
+void drvstats_xfer_dumper(drvstats_xport_t xport, void (*dumper)(void));
+#else	/* DRIVERS_WITHOUT_DRVSTATS */
+# define drvstats_xfer(xport, start, ok)	\
+	do { NUT_UNUSED_VARIABLE(xport); NUT_UNUSED_VARIABLE(start); NUT_UNUSED_VARIABLE(ok); } while (0)
+# define drvstats_xfer_retry(xport)	\
+	do { NUT_UNUSED_VARIABLE(xport); } while (0)
+# define drvstats_xfer_dumper(xport, dumper)	\
+	do { NUT_UNUSED_VARIABLE(xport); NUT_UNUSED_VARIABLE(dumper); } while (0)
+#endif	/* DRIVERS_WITHOUT_DRVSTATS */
+
+/* Publish counters as driver.stats.* (if enabled), or log them all */
+void drvstats_publish(void);
+void drvstats_dump(void);
+
+#endif	/* NUT_DRVSTATS_H_SEEN */
@@ -38,6 +38,7 @@
 
 #include "common.h"
 #include "dstate.h"
+#include "drvstats.h"
 #include "state.h"
 #include "parseconf.h"
 #include "attribute.h"
@@ -319,6 +320,7 @@ static void send_to_all(const char *fmt, ...)
 			upsdebugx(6, "%s: write %" PRIiSIZE " bytes to socket %d succeeded "
 				"(ret=%" PRIiSIZE "): %s",
 				__func__, buflen, conn->fd, ret, buf);
+			drvstats_sent(buflen);
 		}
 	}
 }
@@ -452,6 +454,7 @@ static int send_to_one(conn_t *conn, const char *fmt, ...)
 			"(ret=%" PRIiSIZE "): %s",
 			__func__, buflen, conn->fd, ret, buf);
 #endif
+		drvstats_sent(buflen);
 	}
 
 	return 1;	/* OK */
@@ -1251,6 +1254,7 @@ int dstate_setinfo(const char *var, const char *fmt, ...)
 	ret = state_setinfo(&dtree_root, var, value);
 
 	if (ret == 1) {
+		drvstats_setinfo_changed(var);
 		send_to_all("SETINFO %s \"%s\"\n", var, value);
 	}
 
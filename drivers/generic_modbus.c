@@ -23,14 +23,16 @@
 #include "main.h"
 #include "generic_modbus.h"
 #include <modbus.h>
+#include "modbus-regmap.h"
 #include "timehead.h"
 #include "nut_stdint.h"
 
 #define DRIVER_NAME "NUT Generic Modbus driver"
-#define DRIVER_VERSION  "0.05"
+#define DRIVER_VERSION  "0.06"
 
 /* variables */
 static modbus_t *mbctx = NULL;                             /* modbus memory context */
+static mbregmap_t *regmap = NULL;                          /* image of the registers read per cycle */
 static sigattr_t sigar[NUMOF_SIG_STATES];                  /* array of ups signal attributes */
 static int errcnt = 0;                                     /* modbus access error counter */
 
@@ -46,6 +48,8 @@ static uint32_t mod_resp_to_s = MODRESP_TIMEOUT_s;         /* set the modbus res
 static uint32_t mod_resp_to_us = MODRESP_TIMEOUT_us;       /* set the modbus response time out (us) */
 static uint32_t mod_byte_to_s = MODBYTE_TIMEOUT_s;         /* set the modbus byte time out (us) */
 static uint32_t mod_byte_to_us = MODBYTE_TIMEOUT_us;       /* set the modbus byte time out (us) */
+static int mod_max_gap = MBREGMAP_DEFAULT_MAX_GAP;         /* max. unused registers read to merge requests */
+static int mod_tcp_pipeline = 1;                           /* max. modbus TCP requests sent ahead of responses */
 
 
 /* get config vars set by -x or defined in ups.conf driver section */
@@ -57,9 +61,6 @@ modbus_t *modbus_new(const char *port);
 /* reconnect upon communication error */
 void modbus_reconnect(void);
 
-/* modbus register read function */
-int register_read(modbus_t *mb, int addr, regtype_t type, void *data);
-
 /* instant command triggered by upsd */
 int upscmd(const char *cmd, const char *arg);
 
@@ -105,6 +106,7 @@ void upsdrv_initinfo(void) {
 void upsdrv_initups(void)
 {
 	int rval;
+	int i;
 	upsdebugx(2, "upsdrv_initups");
 
 	get_config_vars();
@@ -172,6 +174,24 @@ void upsdrv_initups(void)
 	}
 /* #elif (defined NUT_MODBUS_TIMEOUT_ARG_timeval) // some un-castable type in fields */
 #endif /* NUT_MODBUS_TIMEOUT_ARG_* */
+
+	/* declare the signal registers read on each update, so they are
+	 * fetched with as few modbus requests as possible */
+	regmap = mbregmap_new(mod_max_gap);
+	for (i = OL_T; i <= DISCHRG_T; i++) {
+		if (sigar[i].addr != NOTUSED) {
+			/* regtype_t has the same order as mbregmap_type_t */
+			mbregmap_add(regmap, (mbregmap_type_t)sigar[i].type, sigar[i].addr, 1);
+		}
+	}
+
+	/* over TCP, send those requests without waiting for each response */
+	if (strstr(device_path, "/dev/tty") == NULL && mod_tcp_pipeline > 1) {
+		struct timeval to;
+		to.tv_sec = (time_t)mod_resp_to_s;
+		to.tv_usec = (suseconds_t)mod_resp_to_us;
+		mbregmap_set_tcp_pipeline(regmap, rio_slave_id, mod_tcp_pipeline, &to);
+	}
 }
 
 /* update UPS signal state */
@@ -185,6 +205,13 @@ void upsdrv_updateinfo(void)
 	status_init();      /* initialize ups.status update */
 	alarm_init();       /* initialize ups.alarm update */
 
+	/* read all mapped signals at once, get_signal_state() uses this image */
+	if (mbregmap_refresh(regmap, mbctx) > 0 && errno == EPIPE) {
+		/* on BROKEN PIPE error try to reconnect */
+		upsdebugx(2, "upsdrv_updateinfo: error(%s)", modbus_strerror(errno));
+		modbus_reconnect();
+	}
+
 	/*
 	 * update UPS status regarding MAINS state either via OL | OB.
 	 * if both statuses are mapped to contacts then only OL is evaluated.
@@ -368,6 +395,8 @@ void upsdrv_makevartable(void)
 	addvar(VAR_VALUE, "mod_resp_to_us", "modbus response timeout (us)");
 	addvar(VAR_VALUE, "mod_byte_to_s", "modbus byte timeout (s)");
 	addvar(VAR_VALUE, "mod_byte_to_us", "modbus byte timeout (us)");
+	addvar(VAR_VALUE, "mod_max_gap", "max. unused registers read to merge modbus requests");
+	addvar(VAR_VALUE, "mod_tcp_pipeline", "max. modbus TCP requests sent before their responses");
 	addvar(VAR_VALUE, "OL_addr", "modbus address for OL state");
 	addvar(VAR_VALUE, "OB_addr", "modbus address for OB state");
 	addvar(VAR_VALUE, "LB_addr", "modbus address for LB state");
@@ -402,97 +431,25 @@ void upsdrv_cleanup(void)
 		modbus_close(mbctx);
 		modbus_free(mbctx);
 	}
+	mbregmap_free(regmap);
+	regmap = NULL;
 }
 
 /*
  * driver support functions
  */
 
-/* Read a modbus register */
-int register_read(modbus_t *mb, int addr, regtype_t type, void *data)
-{
-	int rval = -1;
-
-	/* register bit masks */
-	uint16_t mask8 = 0x000F;
-	uint16_t mask16 = 0x00FF;
-
-	switch (type) {
-		case COIL:
-			rval = modbus_read_bits(mb, addr, 1, (uint8_t *)data);
-			*(uint16_t *)data = *(uint16_t *)data & mask8;
-			break;
-		case INPUT_B:
-			rval = modbus_read_input_bits(mb, addr, 1, (uint8_t *)data);
-			*(uint16_t *)data = *(uint16_t *)data & mask8;
-			break;
-		case INPUT_R:
-			rval = modbus_read_input_registers(mb, addr, 1, (uint16_t *)data);
-			*(uint16_t *)data = *(uint16_t *)data & mask16;
-			break;
-		case HOLDING:
-			rval = modbus_read_registers(mb, addr, 1, (uint16_t *)data);
-			*(uint16_t *)data = *(uint16_t *)data & mask16;
-			break;
-
-#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE) )
-# pragma GCC diagnostic push
-#endif
-#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT
-# pragma GCC diagnostic ignored "-Wcovered-switch-default"
-#endif
-#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE
-# pragma GCC diagnostic ignored "-Wunreachable-code"
-#endif
-/* Older CLANG (e.g. clang-3.4) seems to not support the GCC pragmas above */
-#ifdef __clang__
-# pragma clang diagnostic push
-# pragma clang diagnostic ignored "-Wunreachable-code"
-# pragma clang diagnostic ignored "-Wcovered-switch-default"
-#endif
-		/* All enum cases defined as of the time of coding
-		 * have been covered above. Handle later definitions,
-		 * memory corruptions and buggy inputs below...
-		 */
-		default:
-			upsdebugx(2,"ERROR: register_read: invalid register type %d\n", type);
-			break;
-#ifdef __clang__
-# pragma clang diagnostic pop
-#endif
-#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_COVERED_SWITCH_DEFAULT) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE) )
-# pragma GCC diagnostic pop
-#endif
-	}
-	if (rval == -1) {
-		upslogx(LOG_ERR,"ERROR:(%s) modbus_read: addr:0x%x, type:%8s, path:%s\n",
-			modbus_strerror(errno),
-			addr,
-			(type == COIL) ? "COIL" :
-			(type == INPUT_B) ? "INPUT_B" :
-			(type == INPUT_R) ? "INPUT_R" : "HOLDING",
-			device_path
-		);
-
-		/* on BROKEN PIPE error try to reconnect */
-		if (errno == EPIPE) {
-			upsdebugx(2, "register_read: error(%s)", modbus_strerror(errno));
-			modbus_reconnect();
-		}
-	}
-	upsdebugx(3, "register addr: 0x%x, register type: %d read: %u",addr, type, *(unsigned int *)data);
-	return rval;
-}
-
 /* write a modbus register */
 int register_write(modbus_t *mb, int addr, regtype_t type, void *data)
 {
 	int rval = -1;
+	struct timeval start;
 
 	/* register bit masks */
 	uint16_t mask8 = 0x000F;
 	uint16_t mask16 = 0x00FF;
 
+	gettimeofday(&start, NULL);
 	switch (type) {
 		case COIL:
 			*(uint16_t *)data = *(uint16_t *)data & mask8;
@@ -520,6 +477,7 @@ int register_write(modbus_t *mb, int addr, regtype_t type, void *data)
 			upsdebugx(2,"ERROR: register_write: invalid register type %d\n", type);
 			break;
 	}
+	drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, rval != -1);
 	if (rval == -1) {
 		upslogx(LOG_ERR,"ERROR:(%s) modbus_read: addr:0x%x, type:%8s, path:%s\n",
 			modbus_strerror(errno),
@@ -641,7 +599,7 @@ int upscmd(const char *cmd, const char *arg)
 int get_signal_state(devstate_t state)
 {
 	int rval = -1;
-	int reg_val;
+	uint16_t reg_val;
 	regtype_t rtype = 0;    /* register type */
 	int addr = -1;          /* register address */
 
@@ -698,11 +656,12 @@ int get_signal_state(devstate_t state)
 			break;
 	}
 
-	rval = register_read(mbctx, addr, rtype, &reg_val);
-	if (rval > -1) {
-		rval = reg_val;
+	/* value of the register read by the last mbregmap_refresh() */
+	if (addr != NOTUSED && mbregmap_get(regmap, (mbregmap_type_t)rtype, addr, &reg_val) == 0) {
+		/* register bit masks as in register_write() */
+		rval = reg_val & ((rtype == COIL || rtype == INPUT_B) ? 0x000F : 0x00FF);
 	}
-	upsdebugx(3, "get_signal_state: state: %d", reg_val);
+	upsdebugx(3, "get_signal_state: addr: 0x%x, type: %d, state: %d", addr, rtype, rval);
 	return rval;
 }
 
@@ -796,6 +755,24 @@ void get_config_vars(void)
 	}
 	upsdebugx(2, "mod_byte_to_us %d", mod_byte_to_us);
 
+	/* check if max. gap between registers read at once is set and get the value */
+	if (testvar("mod_max_gap")) {
+		mod_max_gap = (int)strtol(getval("mod_max_gap"), NULL, 10);
+		if (mod_max_gap < 0) {
+			fatalx(EXIT_FAILURE, "get_config_vars: Invalid mod_max_gap %d", mod_max_gap);
+		}
+	}
+	upsdebugx(2, "mod_max_gap %d", mod_max_gap);
+
+	/* check if modbus TCP pipelining is set and get the value */
+	if (testvar("mod_tcp_pipeline")) {
+		mod_tcp_pipeline = (int)strtol(getval("mod_tcp_pipeline"), NULL, 10);
+		if (mod_tcp_pipeline < 1 || mod_tcp_pipeline > 64) {
+			fatalx(EXIT_FAILURE, "get_config_vars: Invalid mod_tcp_pipeline %d", mod_tcp_pipeline);
+		}
+	}
+	upsdebugx(2, "mod_tcp_pipeline %d", mod_tcp_pipeline);
+
 	/* check if OL address is set and get the value */
 	if (testvar("OL_addr")) {
 		sigar[OL_T].addr = (int)strtol(getval("OL_addr"), NULL, 0);
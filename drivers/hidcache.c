@@ -0,0 +1,401 @@
+/* hidcache.c - remembered report descriptor and HID mapping for usbhid-ups
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h" /* must be the first header */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "nut_stdint.h"
+#include "hidcache.h"
+#include "hidparser.h"
+
+/* Communication layers (for the stall return code) */
+#if (defined SHUT_MODE) && SHUT_MODE
+	#include "libshut.h"
+#else	/* !SHUT_MODE => USB */
+	#include "nut_libusb.h"
+#endif	/* SHUT_MODE / USB */
+
+#define HIDCACHE_UNMAPPED	-2	/* mapping not known (yet) */
+#define HIDCACHE_ABSENT		-1	/* not in the report descriptor */
+
+typedef struct {
+	int	index;	/* into pDesc->item[], or HIDCACHE_* */
+	char	probe;	/* '?' not read yet, 'r' readable, 'f' refused by the device */
+} hidcache_entry_t;
+
+static hidcache_entry_t	*hidcache = NULL;	/* one per hid2nut[] entry */
+static size_t	hidcache_count = 0;
+static int	hidcache_dirty = 0;
+static int	hidcache_interrupt_only = -1;	/* mapping made with interruptonly? */
+static int	hidcache_fixed = 0;	/* report descriptor fix-ups disabled? */
+static uint32_t	hidcache_thash = 0;	/* hid2nut[] table the mapping is for */
+static size_t	hidcache_rdlen = 0;	/* report descriptor of the device */
+static uint32_t	hidcache_rdhash = 0;
+
+/* FNV-1a hash of a buffer, chained from a previous hash */
+static uint32_t hidcache_hash(uint32_t hash, const void *buf, size_t len)
+{
+	const unsigned char	*p = buf;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static void hidcache_forget(void)
+{
+	size_t	i;
+
+	for (i = 0; i < hidcache_count; i++) {
+		hidcache[i].index = HIDCACHE_UNMAPPED;
+		hidcache[i].probe = '?';
+	}
+
+	hidcache_dirty = 1;
+}
+
+void hidcache_init(hid_info_t *hid2nut, const char *subdriver_name, int fixed)
+{
+	hid_info_t	*item;
+
+	/* Hash of what the mapping depends on, besides the report descriptor */
+	hidcache_thash = 2166136261U;
+	hidcache_thash = hidcache_hash(hidcache_thash, UPS_VERSION, strlen(UPS_VERSION) + 1);
+	hidcache_thash = hidcache_hash(hidcache_thash, subdriver_name, strlen(subdriver_name) + 1);
+
+	for (hidcache_count = 0, item = hid2nut; item->info_type != NULL; item++) {
+		hidcache_thash = hidcache_hash(hidcache_thash, item->info_type, strlen(item->info_type) + 1);
+		if (item->hidpath) {
+			hidcache_thash = hidcache_hash(hidcache_thash, item->hidpath, strlen(item->hidpath) + 1);
+		}
+		hidcache_count++;
+	}
+
+	free(hidcache);
+	hidcache = xcalloc(hidcache_count ? hidcache_count : 1, sizeof(*hidcache));
+	hidcache_forget();
+
+	hidcache_interrupt_only = -1;
+	hidcache_fixed = fixed;
+	hidcache_rdlen = 0;
+	hidcache_rdhash = 0;
+}
+
+void hidcache_free(void)
+{
+	free(hidcache);
+	hidcache = NULL;
+	hidcache_count = 0;
+}
+
+static hidcache_entry_t *hidcache_entry(size_t i)
+{
+	if (!hidcache || i >= hidcache_count) {
+		return NULL;
+	}
+
+	return &hidcache[i];
+}
+
+/* Parse an "item" line of the cache file */
+static int hidcache_parse_item(const char *line, HIDData_t *pData)
+{
+	unsigned int	id, offset, size, type, attr, pathsize, i;
+	long	unit, logmin, logmax, phymin, phymax;
+	int	unitexp, havemin, havemax, pos = 0;
+	char	*end;
+
+	if (sscanf(line, "item %u %u %u %u %u %ld %d %ld %ld %ld %ld %d %d %u%n",
+		&id, &offset, &size, &type, &attr, &unit, &unitexp,
+		&logmin, &logmax, &phymin, &phymax, &havemin, &havemax,
+		&pathsize, &pos) != 14
+	 || id > 255 || offset > 255 || size > 255 || type > 255 || attr > 255
+	 || pathsize > PATH_SIZE
+	) {
+		return 0;
+	}
+
+	pData->ReportID = (uint8_t)id;
+	pData->Offset = (uint8_t)offset;
+	pData->Size = (uint8_t)size;
+	pData->Type = (uint8_t)type;
+	pData->Attribute = (uint8_t)attr;
+	pData->Unit = unit;
+	pData->UnitExp = (int8_t)unitexp;
+	pData->LogMin = logmin;
+	pData->LogMax = logmax;
+	pData->PhyMin = phymin;
+	pData->PhyMax = phymax;
+	pData->have_PhyMin = (int8_t)havemin;
+	pData->have_PhyMax = (int8_t)havemax;
+	pData->Path.Size = (uint8_t)pathsize;
+
+	line += pos;
+	for (i = 0; i < pathsize; i++) {
+		pData->Path.Node[i] = (HIDNode_t)strtoul(line, &end, 16);
+		if (end == line) {
+			return 0;
+		}
+		line = end;
+	}
+
+	return 1;
+}
+
+HIDDesc_t *hidcache_load(const char *fn, HIDDevice_t *hd,
+	const usb_ctrl_charbuf rdbuf, usb_ctrl_charbufsize rdlen)
+{
+	char	line[LARGEBUF];
+	FILE	*fp;
+	HIDDesc_t	*desc = NULL;
+	size_t	nitems = 0, n = 0;
+	unsigned int	vid, pid, id, fixed, intonly;
+	unsigned long	clen, chash, thash, num, len;
+	int	idx, ok = 1;
+	char	probe;
+
+	hidcache_forget();
+	hidcache_interrupt_only = -1;
+	hidcache_rdlen = (rdlen > 0) ? (size_t)rdlen : 0;
+	hidcache_rdhash = hidcache_hash(2166136261U, rdbuf, hidcache_rdlen);
+
+	if (!fn || rdlen < 1) {
+		return NULL;
+	}
+
+	if ((fp = fopen(fn, "r")) == NULL) {
+		upsdebugx(2, "%s: no report descriptor remembered in %s", __func__, fn);
+		return NULL;
+	}
+
+	while (ok && fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+
+		if (!desc) {
+			/* The first line tells which device and descriptor this is about */
+			ok = (sscanf(line, "descriptor %x %x %lu %lx %lx %u %lu",
+				&vid, &pid, &clen, &chash, &thash, &fixed, &num) == 7
+				&& vid == hd->VendorID && pid == hd->ProductID
+				&& clen == (unsigned long)hidcache_rdlen
+				&& chash == (unsigned long)hidcache_rdhash
+				&& thash == (unsigned long)hidcache_thash
+				&& fixed == (unsigned int)hidcache_fixed
+				&& num > 0 && num <= MAX_REPORT);
+			if (!ok) {
+				upsdebugx(1, "%s: %s is not about this device or report descriptor", __func__, fn);
+				break;
+			}
+
+			nitems = (size_t)num;
+			desc = xcalloc(1, sizeof(*desc));
+			desc->item = xcalloc(nitems, sizeof(*desc->item));
+			desc->nitems = nitems;
+			continue;
+		}
+
+		if (!strncmp(line, "report ", 7)) {
+			ok = (sscanf(line, "report %u %lu", &id, &len) == 2 && id < 256);
+			if (ok) {
+				desc->replen[id] = (size_t)len;
+			}
+		} else if (!strncmp(line, "item ", 5)) {
+			ok = (n < nitems && hidcache_parse_item(line, &desc->item[n]));
+			n++;
+		} else if (!strncmp(line, "mapping ", 8)) {
+			ok = (sscanf(line, "mapping %u", &intonly) == 1);
+			hidcache_interrupt_only = (int)intonly;
+		} else if (!strncmp(line, "map ", 4)) {
+			ok = (sscanf(line, "map %lu %d %c", &num, &idx, &probe) == 3
+				&& num < hidcache_count && idx >= HIDCACHE_ABSENT
+				&& (idx < 0 || (size_t)idx < nitems)
+				&& strchr("?rf", probe) != NULL);
+			if (ok) {
+				hidcache[num].index = idx;
+				hidcache[num].probe = probe;
+			}
+		} else {
+			ok = 0;
+		}
+	}
+	fclose(fp);
+
+	if (!ok || !desc || n != nitems) {
+		if (desc) {
+			upsdebugx(1, "%s: %s is not usable, ignoring it", __func__, fn);
+		}
+		Free_ReportDesc(desc);
+		hidcache_forget();
+		hidcache_interrupt_only = -1;
+		return NULL;
+	}
+
+	upsdebugx(1, "%s: using report descriptor and mapping remembered in %s", __func__, fn);
+	hidcache_dirty = 0;
+	return desc;
+}
+
+void hidcache_save(const char *fn, HIDDevice_t *hd, HIDDesc_t *desc)
+{
+	char	tmpfn[LARGEBUF + 32];
+	FILE	*fp;
+	size_t	i;
+	uint8_t	j;
+	int	ok;
+
+	if (!fn || !hidcache_dirty || !hidcache || !desc || !hd) {
+		return;
+	}
+
+	snprintf(tmpfn, sizeof(tmpfn), "%s.%" PRIiMAX, fn, (intmax_t)getpid());
+	if ((fp = fopen(tmpfn, "w")) == NULL) {
+		upsdebug_with_errno(2, "%s: can't write %s", __func__, tmpfn);
+		return;
+	}
+
+	fprintf(fp, "# Report descriptor and mapping remembered by usbhid-ups, remove this file to parse and probe again\n");
+	fprintf(fp, "descriptor %04x %04x %lu %08lx %08lx %d %lu\n",
+		(unsigned int)hd->VendorID, (unsigned int)hd->ProductID,
+		(unsigned long)hidcache_rdlen, (unsigned long)hidcache_rdhash,
+		(unsigned long)hidcache_thash,
+		hidcache_fixed, (unsigned long)desc->nitems);
+
+	for (i = 0; i < 256; i++) {
+		if (desc->replen[i]) {
+			fprintf(fp, "report %lu %lu\n", (unsigned long)i, (unsigned long)desc->replen[i]);
+		}
+	}
+
+	for (i = 0; i < desc->nitems; i++) {
+		HIDData_t	*pData = &desc->item[i];
+
+		fprintf(fp, "item %u %u %u %u %u %ld %d %ld %ld %ld %ld %d %d %u",
+			(unsigned int)pData->ReportID, (unsigned int)pData->Offset,
+			(unsigned int)pData->Size, (unsigned int)pData->Type,
+			(unsigned int)pData->Attribute, pData->Unit, (int)pData->UnitExp,
+			pData->LogMin, pData->LogMax, pData->PhyMin, pData->PhyMax,
+			(int)pData->have_PhyMin, (int)pData->have_PhyMax,
+			(unsigned int)pData->Path.Size);
+		for (j = 0; j < pData->Path.Size; j++) {
+			fprintf(fp, " %08lx", (unsigned long)pData->Path.Node[j]);
+		}
+		fprintf(fp, "\n");
+	}
+
+	fprintf(fp, "mapping %d\n", interrupt_only);
+	for (i = 0; i < hidcache_count; i++) {
+		if (hidcache[i].index != HIDCACHE_UNMAPPED) {
+			fprintf(fp, "map %lu %d %c\n", (unsigned long)i, hidcache[i].index, hidcache[i].probe);
+		}
+	}
+
+	ok = !ferror(fp);
+	ok = (fclose(fp) == 0 && ok);
+
+	/* a driver starting meanwhile only ever sees a complete file */
+#ifdef WIN32
+	if (ok)
+		unlink(fn);
+#endif
+	if (!ok || rename(tmpfn, fn) != 0) {
+		upsdebug_with_errno(2, "%s: can't write %s", __func__, fn);
+		unlink(tmpfn);
+		return;
+	}
+
+	upsdebugx(2, "%s: remembered report descriptor and mapping in %s", __func__, fn);
+	hidcache_dirty = 0;
+}
+
+HIDData_t *hidcache_item_data(size_t i, const char *hidpath, usage_tables_t *utab)
+{
+	hidcache_entry_t	*entry = hidcache_entry(i);
+	HIDData_t	*pData;
+
+	if (!entry) {
+		return HIDGetItemData(hidpath, utab);
+	}
+
+	if (hidcache_interrupt_only != interrupt_only) {
+		/* The mapping was made for the other kind of items, forget it */
+		hidcache_forget();
+		hidcache_interrupt_only = interrupt_only;
+	}
+
+	if (entry->index != HIDCACHE_UNMAPPED) {
+		return (entry->index < 0) ? NULL : &pDesc->item[entry->index];
+	}
+
+	pData = HIDGetItemData(hidpath, utab);
+	entry->index = pData ? (int)(pData - pDesc->item) : HIDCACHE_ABSENT;
+	entry->probe = '?';
+	hidcache_dirty = 1;
+
+	return pData;
+}
+
+static void hidcache_probed(hidcache_entry_t *entry, char probe)
+{
+	if (entry->index >= 0 && entry->probe != probe) {
+		entry->probe = probe;
+		hidcache_dirty = 1;
+	}
+}
+
+int hidcache_get_value(hid_dev_handle_t udev, size_t i, HIDData_t *hiddata,
+	double *value, time_t age, int init)
+{
+	hidcache_entry_t	*entry = hidcache_entry(i);
+	int	ret;
+
+	/* Don't try again what failed at a previous start */
+	if (init && entry && entry->probe == 'f') {
+		upsdebugx(3, "%s: item %" PRIuSIZE " was refused by the device before, skipping it",
+			__func__, i);
+		return 0;
+	}
+
+	ret = HIDGetDataValue(udev, hiddata, value, age);
+	if (!entry) {
+		return ret;
+	}
+
+	if (ret == 1) {
+		/* Also clears a remembered refusal, if the item was
+		 * polled anyway and the device now answers for it */
+		if (init || entry->probe == 'f') {
+			hidcache_probed(entry, 'r');
+		}
+	} else if (ret == LIBUSB_ERROR_PIPE && init) {
+		/* Only a stall is a definite answer, other errors
+		 * (timeouts, protocol errors...) may well be transient */
+		hidcache_probed(entry, 'f');
+	}
+
+	return ret;
+}
@@ -0,0 +1,56 @@
+/* hidcache.h - remembered report descriptor and HID mapping for usbhid-ups
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef NUT_HIDCACHE_H_SEEN
+#define NUT_HIDCACHE_H_SEEN 1
+
+#include "usbhid-ups.h"
+
+/* The mapping of the hid2nut[] items of a subdriver to the report
+ * descriptor is kept here, one entry per item (addressed by its index
+ * in hid2nut[]), along with whether the device answered for each item.
+ * With a file name, it is remembered across restarts: when the device
+ * presents the same report descriptor on the next start, its parsing,
+ * the look-ups of the HID paths and the reading of the items which the
+ * device refused before are skipped. A NULL file name keeps it in memory. */
+
+/* Forget any mapping, for the hid2nut[] table of a subdriver */
+void hidcache_init(hid_info_t *hid2nut, const char *subdriver_name, int fixed);
+void hidcache_free(void);
+
+/* Return the report descriptor remembered in fn for this device, if it
+ * still presents the same one, and load the remembered mapping.
+ * Otherwise, return NULL with a blank mapping. */
+HIDDesc_t *hidcache_load(const char *fn, HIDDevice_t *hd,
+	const usb_ctrl_charbuf rdbuf, usb_ctrl_charbufsize rdlen);
+
+/* Remember the report descriptor and mapping in fn, if they changed */
+void hidcache_save(const char *fn, HIDDevice_t *hd, HIDDesc_t *desc);
+
+/* Map hid2nut[i] to pDesc, reusing the remembered mapping if possible */
+HIDData_t *hidcache_item_data(size_t i, const char *hidpath, usage_tables_t *utab);
+
+/* Read hid2nut[i] with HIDGetDataValue(), and remember whether the device
+ * answered. At initialization, the items the device refused before (with
+ * a stall) are not read again: 0 is returned for them. */
+int hidcache_get_value(hid_dev_handle_t udev, size_t i, HIDData_t *hiddata,
+	double *value, time_t age, int init);
+
+#endif	/* NUT_HIDCACHE_H_SEEN */
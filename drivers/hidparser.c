@@ -472,12 +472,12 @@ HIDData_t *FindObject_with_ID_Node(HIDDesc_t *pDesc_arg, uint8_t ReportID, HIDNo
 }
 
 /*
- * GetValue
- * Extract data from a report stored in Buf.
- * Use Offset, Size, LogMin, and LogMax of pData.
- * Return response in *pValue.
+ * Prepare_Decoder
+ * Precompute how GetValue() extracts the data of pData from a report:
+ * where its bits are, and which ones are kept and sign-extended. This
+ * is done on first use; call it again if the item is changed later.
  * -------------------------------------------------------------------------- */
-void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue)
+void Prepare_Decoder(HIDData_t *pData)
 {
 	/* Note:  https://github.com/networkupstools/nut/issues/1023
 	   This conversion code can easily be sensitive to 32- vs 64- bit
@@ -487,19 +487,17 @@ void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue)
 	   Test carefully in both environments if changing any declarations.
 	*/
 
-	int	Weight, Bit;
-	unsigned long mask, signbit, magMax, magMin;
-	long	value = 0;
-
-	Bit = pData->Offset + 8;	/* First byte of report is report ID */
+	HIDDecoder_t	*dec = &pData->Decoder;
+	int	Bit = pData->Offset + 8;	/* First byte of report is report ID */
+	int	Bytes;
+	unsigned long	mask, signbit, magMax, magMin;
 
-	for (Weight = 0; Weight < pData->Size; Weight++, Bit++) {
-		int	State = Buf[Bit >> 3] & (1 << (Bit & 7));
+	dec->Byte = (uint8_t)(Bit >> 3);
+	dec->Shift = (uint8_t)(Bit & 7);
 
-		if(State) {
-			value += (1L << Weight);
-		}
-	}
+	/* read the data as one word, when it fits (almost always) */
+	Bytes = (dec->Shift + pData->Size + 7) >> 3;
+	dec->Bytes = (Bytes <= 8 && pData->Size < sizeof(unsigned long) * 8) ? (uint8_t)Bytes : 0;
 
 	/* translate Value into a signed/unsigned value in the range
 	LogMin..LogMax, as appropriate. See HID spec, p.38: "If both the
@@ -533,12 +531,60 @@ void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue)
 	/* but only include sign bit in mask if negative numbers are involved */
 	mask = (signbit - 1) | ((pData->LogMin < 0) ? signbit : 0);
 
-	/* throw away excess high order bits (which may contain garbage) */
-	value = (long)((unsigned long)(value) & mask);
+	dec->Mask = mask;
+	dec->SignBit = (pData->LogMin < 0) ? signbit : 0;
+
+	/* throw away excess high order bits (which may contain garbage),
+	 * and those beyond the size of the data */
+	dec->ValueMask = dec->Bytes ? (mask & ((1UL << pData->Size) - 1)) : mask;
+
+	dec->Ready |= HID_DECODER_VALUE;
+}
+
+/*
+ * GetValue
+ * Extract data from a report stored in Buf.
+ * Use Offset, Size, LogMin, and LogMax of pData (see Prepare_Decoder()).
+ * Return response in *pValue.
+ * -------------------------------------------------------------------------- */
+void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue)
+{
+	HIDDecoder_t	*dec = &pData->Decoder;
+	long	value = 0;
+
+	if (!(dec->Ready & HID_DECODER_VALUE)) {
+		Prepare_Decoder(pData);
+	}
+
+	if (dec->Bytes) {
+		const unsigned char	*p = Buf + dec->Byte;
+		uint64_t	word = 0;
+		int	i;
+
+		for (i = dec->Bytes - 1; i >= 0; i--) {
+			word = (word << 8) | p[i];
+		}
+
+		value = (long)((unsigned long)(word >> dec->Shift) & dec->ValueMask);
+	} else {
+		int	Weight, Bit;
+
+		Bit = pData->Offset + 8;	/* First byte of report is report ID */
+
+		for (Weight = 0; Weight < pData->Size; Weight++, Bit++) {
+			int	State = Buf[Bit >> 3] & (1 << (Bit & 7));
+
+			if(State) {
+				value += (1L << Weight);
+			}
+		}
+
+		value = (long)((unsigned long)(value) & dec->ValueMask);
+	}
 
 	/* sign-extend it, if appropriate */
-	if (pData->LogMin < 0 && ((unsigned long)(value) & signbit) != 0) {
-		value |= ~mask;
+	if (((unsigned long)(value) & dec->SignBit) != 0) {
+		value |= ~dec->Mask;
 	}
 
 	/* clamp returned value to range [LogMin..LogMax] */
@@ -552,6 +598,121 @@ void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue)
 	return;
 }
 
+/* Units and exponents table (HID PDC, 3.2.3) */
+#define NB_HID_UNITS 10
+static const struct {
+	const long	Type;
+	const int8_t	Expo;
+} HIDUnits[NB_HID_UNITS] = {
+	{ 0x00000000, 0 },	/* None */
+	{ 0x00F0D121, 7 },	/* Voltage */
+	{ 0x00100001, 0 },	/* Ampere */
+	{ 0x0000D121, 7 },	/* VA */
+	{ 0x0000D121, 7 },	/* Watts */
+	{ 0x00001001, 0 },	/* second */
+	{ 0x00010001, 0 },	/* K */
+	{ 0x00000000, 0 },	/* percent */
+	{ 0x0000F001, 0 },	/* Hertz */
+	{ 0x00101001, 0 },	/* As */
+};
+
+static int8_t get_unit_expo(const HIDData_t *pData)
+{
+	int	i;
+	int8_t	unit_expo = pData->UnitExp;
+
+	upsdebugx(5, "Unit = %08x, UnitExp = %d", (uint32_t)(pData->Unit), pData->UnitExp);
+
+	for (i = 0; i < NB_HID_UNITS; i++) {
+
+		if (HIDUnits[i].Type == pData->Unit) {
+			unit_expo -= HIDUnits[i].Expo;
+			break;
+		}
+	}
+
+	upsdebugx(5, "Exponent = %d", unit_expo);
+	return unit_expo;
+}
+
+/* exponent function: return a^b */
+static double exponent(double a, int8_t b)
+{
+	if (b>0)
+		return (a * exponent(a, --b));		/* a * a ... */
+
+	if (b<0)
+		return ((1/a) * exponent(a, ++b));	/* (1/a) * (1/a) ... */
+
+	return 1;
+}
+
+/*
+ * Prepare_Physical
+ * Precompute the conversion from logical to physical value of pData,
+ * including its unit exponent, so it is not redone for every read.
+ * This is done on first use; call it again if the item is changed later.
+ * -------------------------------------------------------------------------- */
+void Prepare_Physical(HIDData_t *pData)
+{
+	HIDDecoder_t	*dec = &pData->Decoder;
+
+	upsdebugx(5, "PhyMax = %ld, PhyMin = %ld, LogMax = %ld, LogMin = %ld",
+		pData->PhyMax, pData->PhyMin, pData->LogMax, pData->LogMin);
+
+	dec->Linear = 0;
+	dec->Factor = 1;
+
+	/* HID spec says that if one or both are undefined, or if they are
+	 * both 0, then PhyMin = LogMin, PhyMax = LogMax. */
+	if (!pData->have_PhyMax || !pData->have_PhyMin ||
+		(pData->PhyMax == 0 && pData->PhyMin == 0))
+	{
+		/* logical value as is */
+	} else if ((pData->PhyMax <= pData->PhyMin) || (pData->LogMax <= pData->LogMin)) {
+		/* Paranoia: this should not really happen */
+		upsdebugx(5, "Max was not greater than Min, returning logical value as is");
+	} else {
+		dec->Linear = 1;
+		dec->Factor = (double)(pData->PhyMax - pData->PhyMin) / (pData->LogMax - pData->LogMin);
+	}
+
+	/* Process exponents and units */
+	dec->Scale = exponent(10, get_unit_expo(pData));
+
+	dec->Ready |= HID_DECODER_PHYSICAL;
+}
+
+/*
+ * GetPhysicalValue
+ * Convert a logical value of pData (as returned by GetValue()) into its
+ * physical value, with the unit exponent applied (see Prepare_Physical()).
+ * -------------------------------------------------------------------------- */
+double GetPhysicalValue(HIDData_t *pData, long logical)
+{
+	HIDDecoder_t	*dec = &pData->Decoder;
+	double	physical;
+
+	if (!(dec->Ready & HID_DECODER_PHYSICAL)) {
+		Prepare_Physical(pData);
+	}
+
+	if (!dec->Linear) {
+		return (double)logical * dec->Scale;
+	}
+
+	/* Convert Value */
+	physical = (double)((logical - pData->LogMin) * dec->Factor) + pData->PhyMin;
+
+	if (physical > pData->PhyMax) {
+		physical = pData->PhyMax;
+	} else if (physical < pData->PhyMin) {
+		physical = pData->PhyMin;
+	}
+
+	return physical * dec->Scale;
+}
+
 /*
  * SetValue
  * Set a data in a report stored in Buf. Use Value, Offset and Size of pData.
@@ -71,11 +71,26 @@ HIDData_t *FindObject_with_Path(HIDDesc_t *pDesc_arg, HIDPath_t *Path, uint8_t T
 HIDData_t *FindObject_with_ID(HIDDesc_t *pDesc_arg, uint8_t ReportID, uint8_t Offset, uint8_t Type);
 
 HIDData_t *FindObject_with_ID_Node(HIDDesc_t *pDesc_arg, uint8_t ReportID, HIDNode_t Node);
+/*
+ * Prepare_Decoder
+ * -------------------------------------------------------------------------- */
+void Prepare_Decoder(HIDData_t *pData);
+
 /*
  * GetValue
  * -------------------------------------------------------------------------- */
 void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue);
 
+/*
+ * Prepare_Physical
+ * -------------------------------------------------------------------------- */
+void Prepare_Physical(HIDData_t *pData);
+
+/*
+ * GetPhysicalValue
+ * -------------------------------------------------------------------------- */
+double GetPhysicalValue(HIDData_t *pData, long logical);
+
 /*
  * SetValue
  * -------------------------------------------------------------------------- */
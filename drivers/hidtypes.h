@@ -288,6 +288,30 @@ typedef struct {
 	HIDNode_t	Node[PATH_SIZE];		/* HID Path				*/
 } HIDPath_t;
 
+/*
+ * HIDDecoder struct
+ *
+ * How to decode a HID Data from a report, precomputed from its other
+ * fields on first use, so that polls need not work it out again
+ * -------------------------------------------------------------------------- */
+#define HID_DECODER_VALUE	0x01	/* Byte..SignBit are computed	*/
+#define HID_DECODER_PHYSICAL	0x02	/* Linear..Scale are computed	*/
+
+typedef struct {
+	uint8_t		Ready;				/* HID_DECODER_* flags		*/
+
+	uint8_t		Byte;				/* First byte of data in report	*/
+	uint8_t		Shift;				/* Bit offset in that byte	*/
+	uint8_t		Bytes;				/* Bytes spanned, 0 if over 8	*/
+	unsigned long	ValueMask;			/* Bits to keep from the data	*/
+	unsigned long	Mask;				/* Value bits with sign bit	*/
+	unsigned long	SignBit;			/* Sign bit, 0 if unsigned	*/
+
+	uint8_t		Linear;				/* Physical differs from logical*/
+	double		Factor;				/* Logical to physical factor	*/
+	double		Scale;				/* Unit exponent (power of 10)	*/
+} HIDDecoder_t;
+
 /*
  * HIDData struct
  *
@@ -312,6 +336,8 @@ typedef struct {
 	long		PhyMax;				/* Physical Max			*/
 	int8_t		have_PhyMin;			/* Physical Min defined?		*/
 	int8_t		have_PhyMax;			/* Physical Max defined?		*/
+
+	HIDDecoder_t	Decoder;			/* Precomputed decoding		*/
 } HIDData_t;
 
 /*
@@ -1944,6 +1944,7 @@ static int ups2000_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *des
 {
 	int i;
 	int r = -1;
+	struct timeval start;
 
 	if (addr < 10000)
 		upslogx(LOG_ERR, "Invalid register read from %04d detected. "
@@ -1960,13 +1961,16 @@ static int ups2000_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *des
 		 */
 		modbus_flush(ctx);
 
+		gettimeofday(&start, NULL);
 		r = modbus_read_registers(ctx, addr, nb, dest);
+		drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, r == nb);
 
 		/* generic retry for modbus read failures. */
 		if (retry_status == RETRY_ENABLE && r != nb) {
 			upslogx(LOG_WARNING, "modbus_read_registers() failed (%d, errno %d): %s",
 				r, errno, modbus_strerror(errno));
 			upslogx(LOG_WARNING, "Register %04d has a read failure. Retrying...", addr);
+			drvstats_xfer_retry(DRVSTATS_XPORT_MODBUS);
 			sleep(1);
 			continue;
 		}
@@ -1981,6 +1985,7 @@ static int ups2000_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *des
 		if (retry_status == RETRY_ENABLE &&
 		    addr == 12002 && (dest[0] < 2 || dest[0] > 5)) {
 			upslogx(LOG_INFO, "Battery status has a non-fatal read failure, it's usually harmless. Retrying... ");
+			drvstats_xfer_retry(DRVSTATS_XPORT_MODBUS);
 			sleep(1);
 			continue;
 		}
@@ -2003,19 +2008,23 @@ static int ups2000_write_registers(modbus_t *ctx, int addr, int nb, uint16_t *sr
 {
 	int i;
 	int r = -1;
+	struct timeval start;
 
 	if (addr < 10000)
 		upslogx(LOG_ERR, "Invalid register write to %04d detected. "
 				 "Please file a bug report!", addr);
 
 	for (i = 0; i < 3; i++) {
+		gettimeofday(&start, NULL);
 		r = modbus_write_registers(ctx, addr, nb, src);
+		drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, r == nb);
 
 		/* generic retry for modbus write failures. */
 		if (retry_status == RETRY_ENABLE && r != nb) {
 			upslogx(LOG_WARNING, "modbus_write_registers() failed (%d, errno %d): %s",
 				r, errno, modbus_strerror(errno));
 			upslogx(LOG_WARNING, "Register %04d has a write failure. Retrying...", addr);
+			drvstats_xfer_retry(DRVSTATS_XPORT_MODBUS);
 			sleep(1);
 			continue;
 		}
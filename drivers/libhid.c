@@ -55,14 +55,11 @@
 #endif	/* SHUT_MODE / USB */
 
 /* support functions */
-static double logical_to_physical(HIDData_t *Data, long logical);
 static long physical_to_logical(HIDData_t *Data, double physical);
 static const char *hid_lookup_path(const HIDNode_t usage, usage_tables_t *utab);
 static long hid_lookup_usage(const char *name, usage_tables_t *utab);
 static int string_to_path(const char *string, HIDPath_t *path, usage_tables_t *utab);
 static int path_to_string(char *string, size_t size, const HIDPath_t *path, usage_tables_t *utab);
-static int8_t get_unit_expo(const HIDData_t *hiddata);
-static double exponent(double a, int8_t b);
 
 /* Tweak flag for APC Back-UPS */
 size_t max_report_size = 0;
@@ -379,26 +376,6 @@ static int file_report_buffer(reportbuf_t *rbuf, unsigned char *buf, size_t bufl
 
 /* ---------------------------------------------------------------------- */
 
-/* Units and exponents table (HID PDC, 3.2.3) */
-#define NB_HID_UNITS 10
-static struct {
-	const long	Type;
-	const int8_t	Expo;
-} HIDUnits[NB_HID_UNITS] = {
-	{ 0x00000000, 0 },	/* None */
-	{ 0x00F0D121, 7 },	/* Voltage */
-	{ 0x00100001, 0 },	/* Ampere */
-	{ 0x0000D121, 7 },	/* VA */
-	{ 0x0000D121, 7 },	/* Watts */
-	{ 0x00001001, 0 },	/* second */
-	{ 0x00010001, 0 },	/* K */
-	{ 0x00000000, 0 },	/* percent */
-	{ 0x0000F001, 0 },	/* Hertz */
-	{ 0x00101001, 0 },	/* As */
-};
-
-/* ---------------------------------------------------------------------- */
-
 /* CAUTION: be careful when modifying the output format of this function,
  * since it's used to produce sub-drivers "stub" using
  * scripts/subdriver/gen-usbhid-subdriver.sh
@@ -526,15 +503,41 @@ int HIDGetDataValue(hid_dev_handle_t udev, HIDData_t *hiddata, double *Value, ti
 		return -errno;
 	}
 
-	*Value = hValue;
+	/* Convert Logical Min, Max and Value into Physical,
+	 * and process exponents and units */
+	*Value = GetPhysicalValue(hiddata, hValue);
 
-	/* Convert Logical Min, Max and Value into Physical */
-	*Value = logical_to_physical(hiddata, hValue);
+	return 1;
+}
 
-	/* Process exponents and units */
-	*Value *= exponent(10, get_unit_expo(hiddata));
+/* Return the physical values associated with the events just returned
+ * by HIDGetEvents(), decoded in one pass over the buffered report.
+ * return the number of values if OK, -errno otherwise.
+ */
+int HIDGetEventValues(hid_dev_handle_t udev, HIDData_t **event, int eventcount, double *Value)
+{
+	const unsigned char	*report;
+	long	hValue;
+	int	i;
+	NUT_UNUSED_VARIABLE(udev);
 
-	return 1;
+	if (eventcount <= 0) {
+		return 0;
+	}
+
+	/* all events come from the same interrupt report */
+	report = reportbuf ? reportbuf->data[event[0]->ReportID] : NULL;
+	if (!report) {
+		errno = ENOENT;
+		return -errno;
+	}
+
+	for (i = 0; i < eventcount; i++) {
+		GetValue(report, event[i], &hValue);
+		Value[i] = GetPhysicalValue(event[i], hValue);
+	}
+
+	return eventcount;
 }
 
 /* Return the physical value associated with the given path.
@@ -657,7 +660,10 @@ int HIDSetDataValue(hid_dev_handle_t udev, HIDData_t *hiddata, double Value)
 	}
 
 	/* Process exponents and units */
-	Value /= exponent(10, get_unit_expo(hiddata));
+	if (!(hiddata->Decoder.Ready & HID_DECODER_PHYSICAL)) {
+		Prepare_Physical(hiddata);
+	}
+	Value /= hiddata->Decoder.Scale;
 
 	/* Convert Physical Min, Max and Value into Logical */
 	hValue = physical_to_logical(hiddata, Value);
@@ -802,45 +808,6 @@ int HIDGetEvents(hid_dev_handle_t udev, HIDData_t **event, int eventsize)
  * Support functions
  *******************************************************/
 
-static double logical_to_physical(HIDData_t *Data, long logical)
-{
-	double physical;
-	double Factor;
-
-	upsdebugx(5, "PhyMax = %ld, PhyMin = %ld, LogMax = %ld, LogMin = %ld",
-		Data->PhyMax, Data->PhyMin, Data->LogMax, Data->LogMin);
-
-	/* HID spec says that if one or both are undefined, or if they are
-	 * both 0, then PhyMin = LogMin, PhyMax = LogMax. */
-	if (!Data->have_PhyMax || !Data->have_PhyMin ||
-		(Data->PhyMax == 0 && Data->PhyMin == 0))
-	{
-		return (double)logical;
-	}
-
-	/* Paranoia */
-	if ((Data->PhyMax <= Data->PhyMin) || (Data->LogMax <= Data->LogMin))
-	{
-		/* this should not really happen */
-		upsdebugx(5, "Max was not greater than Min, returning logical value as is");
-		return (double)logical;
-	}
-
-	Factor = (double)(Data->PhyMax - Data->PhyMin) / (Data->LogMax - Data->LogMin);
-	/* Convert Value */
-	physical = (double)((logical - Data->LogMin) * Factor) + Data->PhyMin;
-
-	if (physical > Data->PhyMax) {
-		return Data->PhyMax;
-	}
-
-	if (physical < Data->PhyMin) {
-		return Data->PhyMin;
-	}
-
-	return physical;
-}
-
 static long physical_to_logical(HIDData_t *Data, double physical)
 {
 	long logical;
@@ -878,37 +845,6 @@ static long physical_to_logical(HIDData_t *Data, double physical)
 	return logical;
 }
 
-static int8_t get_unit_expo(const HIDData_t *hiddata)
-{
-	int	i;
-	int8_t	unit_expo = hiddata->UnitExp;
-
-	upsdebugx(5, "Unit = %08x, UnitExp = %d", (uint32_t)(hiddata->Unit), hiddata->UnitExp);
-
-	for (i = 0; i < NB_HID_UNITS; i++) {
-
-		if (HIDUnits[i].Type == hiddata->Unit) {
-			unit_expo -= HIDUnits[i].Expo;
-			break;
-		}
-	}
-
-	upsdebugx(5, "Exponent = %d", unit_expo);
-	return unit_expo;
-}
-
-/* exponent function: return a^b */
-static double exponent(double a, int8_t b)
-{
-	if (b>0)
-		return (a * exponent(a, --b));		/* a * a ... */
-
-	if (b<0)
-		return ((1/a) * exponent(a, ++b));	/* (1/a) * (1/a) ... */
-
-	return 1;
-}
-
 /* translate HID string path to numeric path and return path depth */
 static int string_to_path(const char *string, HIDPath_t *path, usage_tables_t *utab)
 {
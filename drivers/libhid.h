@@ -150,6 +150,11 @@ char *HIDGetIndexString(hid_dev_handle_t udev, int Index, char *buf, size_t bufl
  * -------------------------------------------------------------------------- */
 int HIDGetEvents(hid_dev_handle_t udev, HIDData_t **event, int eventlen);
 
+/*
+ * HIDGetEventValues
+ * -------------------------------------------------------------------------- */
+int HIDGetEventValues(hid_dev_handle_t udev, HIDData_t **event, int eventcount, double *Value);
+
 /*
  * Support functions
  * -------------------------------------------------------------------------- */
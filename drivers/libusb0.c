@@ -822,9 +822,10 @@ static int libusb_get_report(
 	errno = -ret;
 #endif
 
-	/* Ignore "protocol stall" (for unsupported request) on control endpoint */
+	/* A "protocol stall" (for unsupported request) on control endpoint
+	 * is quietly passed up: the device refused to provide this report */
 	if (ret == -EPIPE) {
-		return 0;
+		return ret;
 	}
 
 	return libusb_strerror(ret, __func__);
@@ -1008,6 +1009,7 @@ usb_communication_subdriver_t usb_subdriver = {
 	libusb_set_report,
 	libusb_get_string,
 	libusb_get_interrupt,
+	NULL,	/* no asynchronous interrupt transfers with libusb-0.1 */
 	LIBUSB_DEFAULT_CONF_INDEX,
 	LIBUSB_DEFAULT_INTERFACE,
 	LIBUSB_DEFAULT_DESC_INDEX,
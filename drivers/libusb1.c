@@ -32,8 +32,15 @@
 #include "nut_libusb.h"
 #include "nut_stdint.h"
 
+#if (defined HAVE_PTHREAD) && !(defined WIN32)
+/* Interrupt transfers can be kept submitted in the background */
+# define NUT_LIBUSB_ASYNC_INTERRUPT 1
+# include <pthread.h>
+# include <fcntl.h>
+#endif
+
 #define USB_DRIVER_NAME		"USB communication driver (libusb 1.0)"
-#define USB_DRIVER_VERSION	"0.48"
+#define USB_DRIVER_VERSION	"0.50"
 
 /* driver description structure */
 upsdrv_info_t comm_upsdrv_info = {
@@ -153,6 +160,160 @@ static int nut_usb_set_altinterface(libusb_device_handle *udev)
 	return ret;
 }
 
+/* Descriptor strings of the devices looked at by nut_libusb_open(), so
+ * that reconnection attempts do not need to open all candidate devices
+ * and read them again (which is slow, and retried on failures) while a
+ * device stays at the same bus address with the same descriptor */
+#define STRCACHE_SIZE	8
+
+typedef struct {
+	int	used;
+	uint8_t	bus_num, device_addr;
+	uint16_t	idVendor, idProduct, bcdDevice;
+	uint8_t	iManufacturer, iProduct, iSerialNumber;
+	char	*Vendor, *Product, *Serial;
+} strcache_entry_t;
+
+static strcache_entry_t	strcache[STRCACHE_SIZE];
+static size_t	strcache_next = 0;
+
+static strcache_entry_t *nut_libusb_strcache_find(libusb_device *device,
+	const struct libusb_device_descriptor *dev_desc)
+{
+	uint8_t	bus_num = libusb_get_bus_number(device);
+	uint8_t	device_addr = libusb_get_device_address(device);
+	size_t	i;
+
+	for (i = 0; device_addr > 0 && i < STRCACHE_SIZE; i++) {
+		strcache_entry_t	*c = &strcache[i];
+
+		if (c->used
+		 && c->bus_num == bus_num && c->device_addr == device_addr
+		 && c->idVendor == dev_desc->idVendor
+		 && c->idProduct == dev_desc->idProduct
+		 && c->bcdDevice == dev_desc->bcdDevice
+		 && c->iManufacturer == dev_desc->iManufacturer
+		 && c->iProduct == dev_desc->iProduct
+		 && c->iSerialNumber == dev_desc->iSerialNumber
+		) {
+			return c;
+		}
+	}
+
+	return NULL;
+}
+
+/* Fill in the strings of curDevice if we remember them; return 1 if so */
+static int nut_libusb_strcache_get(libusb_device *device,
+	const struct libusb_device_descriptor *dev_desc, USBDevice_t *curDevice)
+{
+	strcache_entry_t	*c = nut_libusb_strcache_find(device, dev_desc);
+
+	if (!c) {
+		return 0;
+	}
+
+	upsdebugx(3, "%s: using remembered strings of device %03d on bus %03d",
+		__func__, c->device_addr, c->bus_num);
+	curDevice->Vendor = c->Vendor ? xstrdup(c->Vendor) : NULL;
+	curDevice->Product = c->Product ? xstrdup(c->Product) : NULL;
+	curDevice->Serial = c->Serial ? xstrdup(c->Serial) : NULL;
+
+	return 1;
+}
+
+/* Read one descriptor string, with retries; return it allocated, or NULL */
+static char *nut_libusb_read_string(libusb_device_handle *udev, uint8_t index, const char *what)
+{
+	char	string[256];
+	int	retries, ret;
+
+	if (!index) {
+		return NULL;
+	}
+
+	for (retries = MAX_RETRY; retries > 0; retries--) {
+		ret = libusb_get_string_descriptor_ascii(udev, index,
+			(unsigned char*)string, sizeof(string));
+		if (ret > 0) {
+			return xstrdup(string);
+		}
+		upsdebugx(1, "%s get %s failed, retrying...", __func__, what);
+	}
+
+	return NULL;
+}
+
+/* Read the strings of curDevice from the (opened) device, and remember
+ * them if they could all be read */
+static void nut_libusb_strcache_read(libusb_device_handle *udev, libusb_device *device,
+	const struct libusb_device_descriptor *dev_desc, USBDevice_t *curDevice)
+{
+	strcache_entry_t	*c;
+
+	curDevice->Vendor = nut_libusb_read_string(udev, dev_desc->iManufacturer, "iManufacturer");
+	curDevice->Product = nut_libusb_read_string(udev, dev_desc->iProduct, "iProduct");
+	curDevice->Serial = nut_libusb_read_string(udev, dev_desc->iSerialNumber, "iSerialNumber");
+
+	if ((dev_desc->iManufacturer && !curDevice->Vendor)
+	 || (dev_desc->iProduct && !curDevice->Product)
+	 || (dev_desc->iSerialNumber && !curDevice->Serial)
+	 || libusb_get_device_address(device) == 0
+	) {
+		return;
+	}
+
+	if ((c = nut_libusb_strcache_find(device, dev_desc)) == NULL) {
+		c = &strcache[strcache_next];
+		strcache_next = (strcache_next + 1) % STRCACHE_SIZE;
+	}
+
+	free(c->Vendor);
+	free(c->Product);
+	free(c->Serial);
+
+	c->used = 1;
+	c->bus_num = libusb_get_bus_number(device);
+	c->device_addr = libusb_get_device_address(device);
+	c->idVendor = dev_desc->idVendor;
+	c->idProduct = dev_desc->idProduct;
+	c->bcdDevice = dev_desc->bcdDevice;
+	c->iManufacturer = dev_desc->iManufacturer;
+	c->iProduct = dev_desc->iProduct;
+	c->iSerialNumber = dev_desc->iSerialNumber;
+	c->Vendor = curDevice->Vendor ? xstrdup(curDevice->Vendor) : NULL;
+	c->Product = curDevice->Product ? xstrdup(curDevice->Product) : NULL;
+	c->Serial = curDevice->Serial ? xstrdup(curDevice->Serial) : NULL;
+}
+
+static int nut_libusb_open_device(libusb_device *device,
+	const struct libusb_device_descriptor *dev_desc,
+	libusb_device_handle **udevp)
+{
+	int	ret = libusb_open(device, udevp);
+
+	if (ret != 0) {
+		upsdebugx(1, "Failed to open device (%04X/%04X), skipping: %s",
+			dev_desc->idVendor,
+			dev_desc->idProduct,
+			libusb_strerror((enum libusb_error)ret));
+		*udevp = NULL;
+	}
+
+	return ret;
+}
+
+/* Tell how long looking for the device took, and how many of the devices
+ * had to be opened for that */
+static void nut_libusb_open_stats(struct timeval *start, ssize_t devcount, int count_opened)
+{
+	struct timeval	now;
+
+	gettimeofday(&now, NULL);
+	upsdebugx(2, "%s: looked at %" PRIiSIZE " device(s), opened %d, in %.3f sec",
+		__func__, devcount, count_opened, difftimeval(now, *start));
+}
+
 /* On success, fill in the curDevice structure and return the report
  * descriptor length. On failure, return -1.
  * Note: When callback is not NULL, the report descriptor will be
@@ -167,7 +328,9 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		USBDevice_t *hd, usb_ctrl_charbuf rdbuf, usb_ctrl_charbufsize rdlen)
 	)
 {
+#if (defined HAVE_LIBUSB_DETACH_KERNEL_DRIVER) || (defined HAVE_LIBUSB_DETACH_KERNEL_DRIVER_NP)
 	int retries;
+#endif
 	/* libusb-1.0 usb_ctrl_charbufsize is uint16_t and we
 	 * want the rdlen vars signed - so taking a wider type */
 	int32_t rdlen1, rdlen2; /* report descriptor length, method 1+2 */
@@ -186,10 +349,11 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 	int ret, res;
 	unsigned char buf[20];
 	const unsigned char *p;
-	char string[256];
 	int i;
 	int count_open_EACCESS = 0;
 	int count_open_errors = 0;
+	int count_opened = 0;
+	struct timeval	start;
 
 	/* report descriptor */
 	unsigned char	rdbuf[MAX_REPORT_SIZE];
@@ -286,6 +450,7 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		libusb_close(*udevp);
 #endif
 
+	gettimeofday(&start, NULL);
 	devcount = libusb_get_device_list(NULL, &devlist);
 
 	/* devcount may be < 0, loop will get skipped;
@@ -299,28 +464,8 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 			devnum + 1, devcount,
 			dev_desc.idVendor, dev_desc.idProduct);
 
-		/* supported vendors are now checked by the supplied matcher */
-
-		/* open the device */
-		ret = libusb_open(device, udevp);
-		if (ret != 0) {
-			upsdebugx(1, "Failed to open device (%04X/%04X), skipping: %s",
-				dev_desc.idVendor,
-				dev_desc.idProduct,
-				libusb_strerror((enum libusb_error)ret));
-			count_open_errors++;
-			if (ret == LIBUSB_ERROR_ACCESS) {
-				count_open_EACCESS++;
-			}
-			continue;
-		}
-		udev = *udevp;
-
 		/* collect the identifying information of this
-		   device. Note that this is safe, because
-		   there's no need to claim an interface for
-		   this (and therefore we do not yet need to
-		   detach any kernel drivers). */
+		   device which is known without opening it */
 
 		free(curDevice->Vendor);
 		free(curDevice->Product);
@@ -389,58 +534,38 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		curDevice->ProductID = dev_desc.idProduct;
 		curDevice->bcdDevice = dev_desc.bcdDevice;
 
-		if (dev_desc.iManufacturer) {
-			retries = MAX_RETRY;
-			while (retries > 0) {
-				ret = libusb_get_string_descriptor_ascii(udev, dev_desc.iManufacturer,
-					(unsigned char*)string, sizeof(string));
-				if (ret > 0) {
-					curDevice->Vendor = strdup(string);
-					if (curDevice->Vendor == NULL) {
-						libusb_free_device_list(devlist, 1);
-						fatal_with_errno(EXIT_FAILURE, "Out of memory");
-					}
-					break;
-				}
-				retries--;
-				upsdebugx(1, "%s get iManufacturer failed, retrying...", __func__);
-			}
+		/* supported vendors are now checked by the supplied matcher;
+		 * rule out what is possible without opening (and disturbing)
+		 * the device and reading its descriptor strings */
+		ret = USBMatchBeforeOpen(matcher, curDevice);
+		if (ret == -1) {
+			libusb_free_device_list(devlist, 1);
+			fatal_with_errno(EXIT_FAILURE, "matcher");
 		}
-
-		if (dev_desc.iProduct) {
-			retries = MAX_RETRY;
-			while (retries > 0) {
-				ret = libusb_get_string_descriptor_ascii(udev, dev_desc.iProduct,
-					(unsigned char*)string, sizeof(string));
-				if (ret > 0) {
-					curDevice->Product = strdup(string);
-					if (curDevice->Product == NULL) {
-						libusb_free_device_list(devlist, 1);
-						fatal_with_errno(EXIT_FAILURE, "Out of memory");
-					}
-					break;
-				}
-				retries--;
-				upsdebugx(1, "%s get iProduct failed, retrying...", __func__);
-			}
+		if (ret != 1) {
+			upsdebugx(2, "Device does not match - skipping");
+			continue;
 		}
 
-		if (dev_desc.iSerialNumber) {
-			retries = MAX_RETRY;
-			while (retries > 0) {
-				ret = libusb_get_string_descriptor_ascii(udev, dev_desc.iSerialNumber,
-					(unsigned char*)string, sizeof(string));
-				if (ret > 0) {
-					curDevice->Serial = strdup(string);
-					if (curDevice->Serial == NULL) {
-						libusb_free_device_list(devlist, 1);
-						fatal_with_errno(EXIT_FAILURE, "Out of memory");
-					}
-					break;
+		/* collect the descriptor strings of this device, from
+		   what we remember of it or by opening it. Note that this
+		   is safe, because there's no need to claim an interface
+		   for this (and therefore we do not yet need to detach
+		   any kernel drivers). */
+		udev = *udevp = NULL;
+		if (!nut_libusb_strcache_get(device, &dev_desc, curDevice)) {
+			ret = nut_libusb_open_device(device, &dev_desc, udevp);
+			if (ret != 0) {
+				count_open_errors++;
+				if (ret == LIBUSB_ERROR_ACCESS) {
+					count_open_EACCESS++;
 				}
-				retries--;
-				upsdebugx(1, "%s get iSerialNumber failed, retrying...", __func__);
+				continue;
 			}
+			udev = *udevp;
+			count_opened++;
+
+			nut_libusb_strcache_read(udev, device, &dev_desc, curDevice);
 		}
 
 		upsdebugx(2, "- VendorID: %04x", curDevice->VendorID);
@@ -490,6 +615,20 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		 * that the device is not what we want. */
 		upsdebugx(2, "Device matches");
 
+		if (!udev) {
+			/* we knew its strings, so did not open it yet */
+			ret = nut_libusb_open_device(device, &dev_desc, udevp);
+			if (ret != 0) {
+				count_open_errors++;
+				if (ret == LIBUSB_ERROR_ACCESS) {
+					count_open_EACCESS++;
+				}
+				continue;
+			}
+			udev = *udevp;
+			count_opened++;
+		}
+
 		upsdebugx(2, "Reading configuration descriptor %d of %d",
 			usb_subdriver.usb_config_index+1, dev_desc.bNumConfigurations);
 		ret = libusb_get_config_descriptor(device,
@@ -604,6 +743,7 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 		if (!callback) {
 			libusb_free_config_descriptor(conf_desc);
 			libusb_free_device_list(devlist, 1);
+			nut_libusb_open_stats(&start, devcount, count_opened);
 			return 1;
 		}
 
@@ -793,6 +933,7 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 
 		fflush(stdout);
 		libusb_free_device_list(devlist, 1);
+		nut_libusb_open_stats(&start, devcount, count_opened);
 
 		return rdlen;
 
@@ -801,11 +942,14 @@ static int nut_libusb_open(libusb_device_handle **udevp,
 			into uninterruptible sleep.  So don't do it. */
 			/* if (if_claimed)
 				libusb_release_interface(udev, usb_subdriver.hid_rep_index); */
-			libusb_close(udev);
+			if (udev) {
+				libusb_close(udev);
+			}
 	}
 
 	*udevp = NULL;
 	libusb_free_device_list(devlist, 1);
+	nut_libusb_open_stats(&start, devcount, count_opened);
 	upsdebugx(2, "libusb1: No appropriate HID device found");
 	fflush(stdout);
 
@@ -895,6 +1039,7 @@ static int nut_libusb_get_report(
 	usb_ctrl_charbufsize ReportSize)
 {
 	int	ret;
+	struct timeval	start;
 
 	upsdebugx(4, "Entering libusb_get_report");
 
@@ -921,16 +1066,20 @@ static int nut_libusb_get_report(
 	}
 
 	/* libusb0: USB_ENDPOINT_IN + USB_TYPE_CLASS + USB_RECIP_INTERFACE */
+	gettimeofday(&start, NULL);
 	ret = libusb_control_transfer(udev,
 		LIBUSB_ENDPOINT_IN|LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE,
 		0x01, /* HID_REPORT_GET */
 		(uint16_t)ReportId + (0x03<<8), /* HID_REPORT_TYPE_FEATURE */
 		usb_subdriver.hid_rep_index,
 		raw_buf, (uint16_t)ReportSize, USB_TIMEOUT);
+	drvstats_xfer(DRVSTATS_XPORT_USB, &start,
+		(ret >= 0 || ret == LIBUSB_ERROR_PIPE));
 
-	/* Ignore "protocol stall" (for unsupported request) on control endpoint */
+	/* A "protocol stall" (for unsupported request) on control endpoint
+	 * is quietly passed up: the device refused to provide this report */
 	if (ret == LIBUSB_ERROR_PIPE) {
-		return 0;
+		return ret;
 	}
 
 	return nut_libusb_strerror(ret, __func__);
@@ -947,6 +1096,7 @@ static int nut_libusb_set_report(
 	usb_ctrl_charbufsize ReportSize)
 {
 	int	ret;
+	struct timeval	start;
 
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && ( (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TYPE_LIMITS) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TAUTOLOGICAL_CONSTANT_OUT_OF_RANGE_COMPARE) || (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_TAUTOLOGICAL_UNSIGNED_ZERO_COMPARE) )
 # pragma GCC diagnostic push
@@ -971,12 +1121,15 @@ static int nut_libusb_set_report(
 	}
 
 	/* libusb0: USB_ENDPOINT_OUT + USB_TYPE_CLASS + USB_RECIP_INTERFACE */
+	gettimeofday(&start, NULL);
 	ret = libusb_control_transfer(udev,
 		LIBUSB_ENDPOINT_OUT|LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE,
 		0x09, /* HID_REPORT_SET = 0x09*/
 		(uint16_t)ReportId + (0x03<<8), /* HID_REPORT_TYPE_FEATURE */
 		usb_subdriver.hid_rep_index,
 		raw_buf, (uint16_t)ReportSize, USB_TIMEOUT);
+	drvstats_xfer(DRVSTATS_XPORT_USB, &start,
+		(ret >= 0 || ret == LIBUSB_ERROR_PIPE));
 
 	/* Ignore "protocol stall" (for unsupported request) on control endpoint */
 	if (ret == LIBUSB_ERROR_PIPE) {
@@ -1038,6 +1191,330 @@ static int nut_libusb_get_string(
 	return nut_libusb_strerror(ret, __func__);
 }
 
+#ifdef NUT_LIBUSB_ASYNC_INTERRUPT
+/* Asynchronous interrupt pipe: one transfer is kept submitted on the
+ * interrupt endpoint, and a thread runs the libusb event handling. The
+ * reports it gets are queued for nut_libusb_get_interrupt(), and a byte
+ * is written to a pipe whose other end the driver polls (as extrafd),
+ * so the report is processed as soon as it arrives rather than on the
+ * next poll cycle. */
+#define ASYNC_QUEUE_LEN	32
+
+static libusb_device_handle	*async_udev = NULL;	/* NULL when not running */
+static struct libusb_transfer	*async_xfer = NULL;
+static pthread_t	async_thread;
+static pthread_mutex_t	async_lock = PTHREAD_MUTEX_INITIALIZER;
+static int	async_wakeup[2] = { -1, -1 };
+static volatile int	async_running = 0;	/* event thread keeps going */
+static int	async_pending = 0;	/* transfer is submitted */
+static int	async_error = 0;	/* libusb error which stopped the transfers */
+
+/* ring of received reports, ASYNC_QUEUE_LEN of async_bufsize bytes each */
+static unsigned char	*async_queue = NULL;
+static int	async_queue_len[ASYNC_QUEUE_LEN];
+static size_t	async_head = 0, async_count = 0;
+static int	async_bufsize = 0;
+
+static void async_notify(void)
+{
+	ssize_t	ret;
+
+	/* non-blocking: a full pipe wakes the driver up anyway */
+	ret = write(async_wakeup[1], "", 1);
+	NUT_UNUSED_VARIABLE(ret);
+}
+
+/* Called by the event thread, with the transfer done */
+static void LIBUSB_CALL nut_libusb_async_cb(struct libusb_transfer *xfer)
+{
+	int	notify = 0, resubmit = 0;
+
+	pthread_mutex_lock(&async_lock);
+
+	switch (xfer->status)
+	{
+	case LIBUSB_TRANSFER_COMPLETED:
+		if (xfer->actual_length > 0) {
+			size_t	tail;
+
+			if (async_count == ASYNC_QUEUE_LEN) {
+				/* driver is not keeping up: drop the oldest */
+				async_head = (async_head + 1) % ASYNC_QUEUE_LEN;
+				async_count--;
+			}
+			tail = (async_head + async_count) % ASYNC_QUEUE_LEN;
+			memcpy(async_queue + tail * (size_t)async_bufsize,
+				xfer->buffer, (size_t)xfer->actual_length);
+			async_queue_len[tail] = xfer->actual_length;
+			async_count++;
+			notify = 1;
+		}
+		resubmit = 1;
+		break;
+
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		resubmit = 1;
+		break;
+
+	case LIBUSB_TRANSFER_CANCELLED:
+		break;
+
+	case LIBUSB_TRANSFER_STALL:
+		/* cleared by the driver thread, no sync calls in here */
+		async_error = LIBUSB_ERROR_PIPE;
+		notify = 1;
+		break;
+
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		async_error = LIBUSB_ERROR_NO_DEVICE;
+		notify = 1;
+		break;
+
+	case LIBUSB_TRANSFER_ERROR:
+	case LIBUSB_TRANSFER_OVERFLOW:
+	default:
+		async_error = LIBUSB_ERROR_IO;
+		notify = 1;
+		break;
+	}
+
+	async_pending = 0;
+	if (resubmit && async_running) {
+		int	ret = libusb_submit_transfer(xfer);
+
+		if (ret == LIBUSB_SUCCESS) {
+			async_pending = 1;
+		} else {
+			async_error = ret;
+			notify = 1;
+		}
+	}
+
+	pthread_mutex_unlock(&async_lock);
+
+	if (notify) {
+		async_notify();
+	}
+}
+
+static void *nut_libusb_async_loop(void *arg)
+{
+	NUT_UNUSED_VARIABLE(arg);
+
+	while (async_running) {
+		/* bounded, so that a stop request is seen soon */
+		struct timeval	tv = { 0, 250000 };
+
+		libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+	}
+
+	return NULL;
+}
+
+static void nut_libusb_async_stop(void)
+{
+	int	i;
+
+	if (async_udev == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&async_lock);
+	async_running = 0;
+	if (async_pending) {
+		libusb_cancel_transfer(async_xfer);
+	}
+	pthread_mutex_unlock(&async_lock);
+
+	pthread_join(async_thread, NULL);
+
+	/* the event thread may have quit before the cancellation came
+	 * through: handle it here, the transfer must not be freed before */
+	for (i = 0; i < 20; i++) {
+		struct timeval	tv = { 0, 100000 };
+		int	pending;
+
+		pthread_mutex_lock(&async_lock);
+		pending = async_pending;
+		pthread_mutex_unlock(&async_lock);
+
+		if (!pending) {
+			break;
+		}
+		libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+	}
+
+	if (i < 20) {
+		libusb_free_transfer(async_xfer);
+	} else {
+		/* leak it rather than have libusb write into freed memory */
+		upslogx(LOG_WARNING, "%s: interrupt transfer could not be cancelled", __func__);
+	}
+	async_xfer = NULL;
+
+	free(async_queue);
+	async_queue = NULL;
+	async_head = async_count = 0;
+	async_error = 0;
+
+	close(async_wakeup[0]);
+	close(async_wakeup[1]);
+	async_wakeup[0] = async_wakeup[1] = -1;
+
+	async_udev = NULL;
+	upsdebugx(2, "%s: asynchronous interrupt transfers stopped", __func__);
+}
+
+/* Returns the descriptor to poll for reports, or -1 if not available */
+static int nut_libusb_start_interrupt_async(
+	libusb_device_handle *udev,
+	usb_ctrl_charbufsize bufsize)
+{
+	int	i, ret;
+
+	if (!udev || bufsize < 1) {
+		return -1;
+	}
+
+	nut_libusb_async_stop();
+
+	if (pipe(async_wakeup) != 0) {
+		upslog_with_errno(LOG_WARNING, "%s: pipe", __func__);
+		async_wakeup[0] = async_wakeup[1] = -1;
+		return -1;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl(async_wakeup[i], F_SETFL, fcntl(async_wakeup[i], F_GETFL) | O_NONBLOCK);
+		fcntl(async_wakeup[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	/* the buffer of the transfer is right after the queue slots */
+	async_bufsize = (int)bufsize;
+	async_queue = xcalloc(ASYNC_QUEUE_LEN + 1, (size_t)async_bufsize);
+	async_xfer = libusb_alloc_transfer(0);
+	if (async_xfer == NULL) {
+		goto fail;
+	}
+
+	/* no timeout: reports come whenever the device has something */
+	libusb_fill_interrupt_transfer(async_xfer, udev,
+		LIBUSB_ENDPOINT_IN + usb_subdriver.hid_ep_in,
+		async_queue + ASYNC_QUEUE_LEN * (size_t)async_bufsize, async_bufsize,
+		nut_libusb_async_cb, NULL, 0);
+
+	ret = libusb_submit_transfer(async_xfer);
+	if (ret != LIBUSB_SUCCESS) {
+		upsdebugx(1, "%s: libusb_submit_transfer: %s",
+			__func__, libusb_strerror((enum libusb_error)ret));
+		libusb_free_transfer(async_xfer);
+		goto fail;
+	}
+
+	async_pending = 1;
+	async_running = 1;
+	async_udev = udev;
+
+	if (pthread_create(&async_thread, NULL, nut_libusb_async_loop, NULL) != 0) {
+		upslog_with_errno(LOG_WARNING, "%s: pthread_create", __func__);
+		async_running = 0;
+		libusb_cancel_transfer(async_xfer);
+		/* nut_libusb_async_stop() would join a thread we do not have */
+		while (async_pending) {
+			struct timeval	tv = { 0, 100000 };
+			libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+		}
+		libusb_free_transfer(async_xfer);
+		async_udev = NULL;
+		goto fail;
+	}
+
+	upsdebugx(2, "%s: interrupt transfers of up to %d bytes now run in the background",
+		__func__, async_bufsize);
+
+	return async_wakeup[0];
+
+fail:
+	async_xfer = NULL;
+	free(async_queue);
+	async_queue = NULL;
+	close(async_wakeup[0]);
+	close(async_wakeup[1]);
+	async_wakeup[0] = async_wakeup[1] = -1;
+	return -1;
+}
+
+/* Hand over the oldest queued report (as nut_libusb_get_interrupt() does) */
+static int nut_libusb_async_get(
+	libusb_device_handle *udev,
+	usb_ctrl_charbuf buf,
+	usb_ctrl_charbufsize bufsize)
+{
+	char	c;
+	int	len = 0, err;
+
+	/* the driver is here now, forget the wakeups */
+	while (read(async_wakeup[0], &c, 1) > 0);
+
+	pthread_mutex_lock(&async_lock);
+	if (async_count > 0) {
+		len = async_queue_len[async_head];
+		if ((uintmax_t)len > (uintmax_t)bufsize) {
+			len = (int)bufsize;
+		}
+		memcpy(buf, async_queue + async_head * (size_t)async_bufsize, (size_t)len);
+		async_head = (async_head + 1) % ASYNC_QUEUE_LEN;
+		async_count--;
+
+		if (async_count > 0) {
+			/* come back for the rest */
+			async_notify();
+		}
+	}
+	err = async_error;
+	async_error = 0;
+	pthread_mutex_unlock(&async_lock);
+
+	if (len > 0) {
+		if (err) {
+			/* report it with the next call */
+			pthread_mutex_lock(&async_lock);
+			async_error = err;
+			pthread_mutex_unlock(&async_lock);
+			async_notify();
+		}
+		return len;
+	}
+
+	if (err == LIBUSB_ERROR_PIPE) {
+		/* Clear stall condition, and carry on */
+		err = libusb_clear_halt(udev, LIBUSB_ENDPOINT_IN + usb_subdriver.hid_ep_in);
+		if (err == LIBUSB_SUCCESS) {
+			pthread_mutex_lock(&async_lock);
+			err = libusb_submit_transfer(async_xfer);
+			async_pending = (err == LIBUSB_SUCCESS);
+			pthread_mutex_unlock(&async_lock);
+		}
+	}
+
+	if (err) {
+		return nut_libusb_strerror(err, __func__);
+	}
+
+	/* no report: as a timed out synchronous read */
+	return 0;
+}
+#else	/* !NUT_LIBUSB_ASYNC_INTERRUPT */
+static int nut_libusb_start_interrupt_async(
+	libusb_device_handle *udev,
+	usb_ctrl_charbufsize bufsize)
+{
+	NUT_UNUSED_VARIABLE(udev);
+	NUT_UNUSED_VARIABLE(bufsize);
+
+	return -1;
+}
+#endif	/* NUT_LIBUSB_ASYNC_INTERRUPT */
+
 /* Expected evaluated types for the API:
  * static int nut_libusb_get_interrupt(libusb_device_handle *udev,
  *	unsigned char *buf, int bufsize, int timeout)
@@ -1071,6 +1548,13 @@ static int nut_libusb_get_interrupt(
 		return -1;
 	}
 
+#ifdef NUT_LIBUSB_ASYNC_INTERRUPT
+	if (async_udev != NULL && async_udev == udev) {
+		/* only take what the background transfers got, if any */
+		return nut_libusb_async_get(udev, buf, bufsize);
+	}
+#endif /* NUT_LIBUSB_ASYNC_INTERRUPT */
+
 	/* NOTE: With all the fuss about word sized arguments,
 	 * the libusb_interrupt_transfer() lengths are about ints:
 	 * int LIBUSB_CALL libusb_interrupt_transfer(libusb_device_handle *dev_handle,
@@ -1111,6 +1595,12 @@ static void nut_libusb_close(libusb_device_handle *udev)
 		return;
 	}
 
+#ifdef NUT_LIBUSB_ASYNC_INTERRUPT
+	if (async_udev == udev) {
+		nut_libusb_async_stop();
+	}
+#endif /* NUT_LIBUSB_ASYNC_INTERRUPT */
+
 	/* usb_release_interface() sometimes blocks and goes
 	 * into uninterruptible sleep.  So don't do it.
 	 */
@@ -1128,6 +1618,7 @@ usb_communication_subdriver_t usb_subdriver = {
 	nut_libusb_set_report,
 	nut_libusb_get_string,
 	nut_libusb_get_interrupt,
+	nut_libusb_start_interrupt_async,
 	LIBUSB_DEFAULT_CONF_INDEX,
 	LIBUSB_DEFAULT_INTERFACE,
 	LIBUSB_DEFAULT_DESC_INDEX,
@@ -50,6 +50,9 @@ static HANDLE	mutex = INVALID_HANDLE_VALUE;
 /* for ser_open */
 int	do_lock_port = 1;
 
+/* for ser_get_*: keep read-ahead data and learn timeouts */
+int	do_serial_adaptive = 0;
+
 /* for dstate->sock_connect, default to effectively
  * asynchronous (0) with fallback to synchronous (1) */
 int	do_synchronous = -1;
@@ -69,6 +72,23 @@ time_t	poll_interval = 2;
 static char	*chroot_path = NULL, *user = NULL, *group = NULL;
 static int	user_from_cmdline = 0, group_from_cmdline = 0;
 
+/* Adaptive polling, configured per UPS section in ups.conf: while the
+ * device reports a troublesome status (see poll_alert_status[] below) or
+ * one of the "pollinterval_watch" variables has changed since the last
+ * update, poll every poll_interval_alert seconds instead of poll_interval;
+ * relax back after poll_interval_stable seconds without such events.
+ * A zero poll_interval_alert (default) disables this.
+ */
+static time_t	poll_interval_alert = 0, poll_interval_stable = 30;
+
+typedef struct pollwatch_s {
+	char	*var;
+	char	*val;	/* as seen after previous update, or NULL */
+	struct pollwatch_s	*next;
+} pollwatch_t;
+
+static pollwatch_t	*pollwatch_h = NULL;
+
 /* signal handling */
 int	exit_flag = 0;
 /* reload_flag is 0 most of the time (including initial config reading),
@@ -850,6 +870,26 @@ int main_setvar(const char *varname, const char *val, conn_t *conn) {
 		return STAT_SET_HANDLED;
 	}
 
+	if (!strcmp(varname, "driver.flag.publish_stats")) {
+		int num = 0;
+		if (str_to_int(val, &num, 10)) {
+			num = (num > 0);
+		} else {
+			/* support certain strings */
+			if (!strncmp(val, "enable", 6)	/* "enabled" matches too */
+			 || !strcmp(val, "true")
+			 || !strcmp(val, "yes")
+			 || !strcmp(val, "on")
+			) num = 1;
+		}
+
+		upsdebugx(1, "%s: Setting %s=%d", __func__, varname, num);
+		drvstats_set_publish(num);
+		dstate_setinfo("driver.flag.publish_stats", "%d", num);
+		drvstats_publish();
+		return STAT_SET_HANDLED;
+	}
+
 	/* By default, the driver-specific values are
 	 * unknown to shared standard handler */
 	upsdebugx(2, "shared %s() does not handle variable %s, "
@@ -863,6 +903,40 @@ invalid:
 	return STAT_SET_INVALID;
 }
 
+static void pollwatch_free(void)
+{
+	pollwatch_t	*tmp, *next;
+
+	for (tmp = pollwatch_h; tmp; tmp = next) {
+		next = tmp->next;
+		free(tmp->var);
+		free(tmp->val);
+		free(tmp);
+	}
+
+	pollwatch_h = NULL;
+}
+
+/* (re)populate the list of watched variables from a comma-separated string */
+static void pollwatch_parse(const char *list)
+{
+	char	*buf, *ptr, *last = NULL;
+	pollwatch_t	*tmp, **tail;
+
+	pollwatch_free();
+	tail = &pollwatch_h;
+
+	buf = xstrdup(list);
+	for (ptr = strtok_r(buf, ", ", &last); ptr; ptr = strtok_r(NULL, ", ", &last)) {
+		tmp = (pollwatch_t *)xcalloc(1, sizeof(*tmp));
+		tmp->var = xstrdup(ptr);
+		*tail = tmp;
+		tail = &tmp->next;
+		upsdebugx(2, "%s: watching '%s' for adaptive polling", __func__, ptr);
+	}
+	free(buf);
+}
+
 /* handle -x / ups.conf config details that are for this part of the code */
 static int main_arg(char *var, char *val)
 {
@@ -888,6 +962,18 @@ static int main_arg(char *var, char *val)
 		return 1;	/* handled */
 	}
 
+	/* Likewise, not changed on the fly: the serial layer would lose
+	 * track of the data it read ahead, and of the learned timings */
+	if (!strcmp(var, "serial_adaptive")) {
+		if (reload_flag) {
+			upsdebugx(6, "%s: SKIP: flag var='%s' can not be reloaded", __func__, var);
+		} else {
+			do_serial_adaptive = 1;
+			dstate_setinfo("driver.flag.serial_adaptive", "enabled");
+		}
+		return 1;	/* handled */
+	}
+
 	/* FIXME: this one we could potentially reload, but need to figure
 	 * out that the flag line was commented away or deleted -- there is
 	 * no setting value to flip in configs here
@@ -901,6 +987,13 @@ static int main_arg(char *var, char *val)
 		return 1;	/* handled */
 	}
 
+	/* Can be toggled on the fly, also via protocol SET */
+	if (!strcmp(var, "publish_stats")) {
+		drvstats_set_publish(1);
+		dstate_setinfo("driver.flag.publish_stats", "1");
+		return 1;	/* handled */
+	}
+
 	if (!strcmp(var, "allow_killpower")) {
 		if (reload_flag) {
 			upsdebugx(6, "%s: SKIP: flag var='%s' currently can not be reloaded "
@@ -1029,6 +1122,40 @@ static int main_arg(char *var, char *val)
 		return 1;	/* handled */
 	}
 
+	/* Adaptive polling settings, can be changed on the fly */
+	if (!strcmp(var, "pollinterval_alert")
+	 || !strcmp(var, "pollinterval_stable")
+	) {
+		char	infoname[SMALLBUF];
+		int	ipv = -1;
+
+		snprintf(infoname, sizeof(infoname), "driver.parameter.%s", var);
+		if (testinfo_reloadable(var, infoname, val, 1) > 0) {
+			if (!str_to_int(val, &ipv, 10) || ipv < 0
+			 || (ipv == 0 && !strcmp(var, "pollinterval_stable"))
+			) {
+				fatalx(EXIT_FAILURE, "Error: UPS [%s]: invalid %s: %s",
+					NUT_STRARG(upsname), var, val);
+			}
+
+			if (!strcmp(var, "pollinterval_alert"))
+				poll_interval_alert = (time_t)ipv;
+			else
+				poll_interval_stable = (time_t)ipv;
+
+			dstate_setinfo(infoname, "%d", ipv);
+		}
+		return 1;	/* handled */
+	}
+
+	if (!strcmp(var, "pollinterval_watch")) {
+		if (testinfo_reloadable(var, "driver.parameter.pollinterval_watch", val, 1) > 0) {
+			pollwatch_parse(val);
+			dstate_setinfo("driver.parameter.pollinterval_watch", "%s", val);
+		}
+		return 1;	/* handled */
+	}
+
 	/* only for upsdrvctl - ignored here */
 	if (!strcmp(var, "sdorder"))
 		return 1;	/* handled */
@@ -1484,6 +1611,103 @@ void vartab_free(void)
 }
 
 #ifndef DRIVERS_MAIN_WITHOUT_MAIN
+/* ups.status tokens which warrant a faster poll */
+static const char	*poll_alert_status[] = {
+	"OB", "LB", "BYPASS", "ALARM", NULL
+};
+
+static int poll_status_alert(void)
+{
+	const char	*status = dstate_getinfo("ups.status");
+	char	*buf, *ptr, *last = NULL;
+	int	i, ret = 0;
+
+	if (!status || !*status)
+		return 0;
+
+	buf = xstrdup(status);
+	for (ptr = strtok_r(buf, " ", &last); ptr && !ret; ptr = strtok_r(NULL, " ", &last)) {
+		for (i = 0; poll_alert_status[i]; i++) {
+			if (!strcmp(ptr, poll_alert_status[i])) {
+				upsdebugx(3, "%s: ups.status has %s", __func__, ptr);
+				ret = 1;
+				break;
+			}
+		}
+	}
+	free(buf);
+
+	return ret;
+}
+
+/* Remember current values of watched variables; return 1 if any changed */
+static int pollwatch_changed(void)
+{
+	pollwatch_t	*tmp;
+	const char	*val;
+	int	ret = 0;
+
+	for (tmp = pollwatch_h; tmp; tmp = tmp->next) {
+		val = dstate_getinfo(tmp->var);
+
+		if (!val && !tmp->val)
+			continue;
+
+		if (val && tmp->val && !strcmp(val, tmp->val))
+			continue;
+
+		/* The very first sample is not a change */
+		if (tmp->val) {
+			upsdebugx(3, "%s: %s changed: '%s' => '%s'",
+				__func__, tmp->var, tmp->val, NUT_STRARG(val));
+			ret = 1;
+		}
+
+		free(tmp->val);
+		tmp->val = val ? xstrdup(val) : NULL;
+	}
+
+	return ret;
+}
+
+/* Decide how long to sleep until the next upsdrv_updateinfo() call */
+static time_t poll_interval_adapt(const struct timeval *now)
+{
+	static struct timeval	alert_last;
+	static int	alert_active = 0;
+	static time_t	current = 0;
+	time_t	next = poll_interval;
+
+	if (poll_interval_alert > 0 && poll_interval_alert < poll_interval) {
+		/* Note: evaluate both, to keep watched values up to date */
+		int	changed = pollwatch_changed();
+
+		if (poll_status_alert() || changed) {
+			alert_last = *now;
+			alert_active = 1;
+		} else if (alert_active
+		 && difftimeval(*now, alert_last) >= (double)poll_interval_stable
+		) {
+			alert_active = 0;
+		}
+
+		if (alert_active)
+			next = poll_interval_alert;
+	} else {
+		alert_active = 0;
+	}
+
+	if (next != current) {
+		if (current)
+			upslogx(LOG_INFO, "Polling interval is now %" PRIdMAX " sec%s",
+				(intmax_t)next, alert_active ? " (device needs attention)" : "");
+		current = next;
+		dstate_setinfo("driver.parameter.pollinterval.current", "%" PRIdMAX, (intmax_t)current);
+	}
+
+	return current;
+}
+
 static void exit_upsdrv_cleanup(void)
 {
 	dstate_setinfo("driver.state", "cleanup.upsdrv");
@@ -1502,6 +1726,7 @@ static void exit_cleanup(void)
 	free(device_path);
 	free(user);
 	free(group);
+	pollwatch_free();
 
 	if (pidfn) {
 		unlink(pidfn);
@@ -1602,6 +1827,7 @@ static void handle_dstate_dump(int sig) {
 		__func__, upsname, sig);
 	/* FIXME: upslogx() instead of printf() when backgrounded, if STDOUT got closed? */
 	dstate_dump();
+	drvstats_dump();
 	upsdebugx(1, "%s: finished driver state dump for [%s]",
 		__func__, upsname);
 }
@@ -2648,6 +2874,9 @@ sockname_ownership_finished:
 	dstate_setflags("driver.flag.allow_killpower", ST_FLAG_RW | ST_FLAG_NUMBER);
 	dstate_addcmd("driver.killpower");
 
+	dstate_setinfo("driver.flag.publish_stats", "%d", drvstats_get_publish());
+	dstate_setflags("driver.flag.publish_stats", ST_FLAG_RW | ST_FLAG_NUMBER);
+
 #ifndef WIN32
 /* TODO: Equivalent for WIN32 - see SIGCMD_RELOAD in upd and upsmon */
 	dstate_addcmd("driver.reload");
@@ -2669,19 +2898,25 @@ sockname_ownership_finished:
 	}
 
 	while (!exit_flag) {
-		struct timeval	timeout;
+		struct timeval	timeout, start;
 
 		if (!dump_data) {
 			upsnotify(NOTIFY_STATE_WATCHDOG, NULL);
 		}
 
-		gettimeofday(&timeout, NULL);
-		timeout.tv_sec += poll_interval;
+		gettimeofday(&start, NULL);
 
 		dstate_setinfo("driver.state", "updateinfo");
 		upsdrv_updateinfo();
 		dstate_setinfo("driver.state", "quiet");
 
+		drvstats_update_done(&start);
+		drvstats_publish();
+
+		/* The next update is due relative to start of this one */
+		timeout = start;
+		timeout.tv_sec += poll_interval_adapt(&start);
+
 		/* Dump the data tree (in upsc-like format) to stdout and exit */
 		if (dump_data) {
 			/* Wait for 'dump_data' update loops to ensure data completion */
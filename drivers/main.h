@@ -5,6 +5,7 @@
 #include "upsconf.h"
 #include "upshandler.h"
 #include "dstate.h"
+#include "drvstats.h"
 #include "extstate.h"
 #ifdef WIN32
 #include "wincompat.h"
@@ -13,7 +14,7 @@
 /* public functions & variables from main.c */
 extern const char	*progname, *upsname, *device_name;
 extern char		*device_path;
-extern int		broken_driver, experimental_driver, do_lock_port, exit_flag;
+extern int		broken_driver, experimental_driver, do_lock_port, do_serial_adaptive, exit_flag;
 extern TYPE_FD		upsfd, extrafd;
 extern time_t	poll_interval;
 
@@ -39,7 +39,7 @@
 #include "wincompat.h"
 #endif
 
-#define MGE_XML_VERSION		"MGEXML/0.36"
+#define MGE_XML_VERSION		"MGEXML/0.37"
 
 #define MGE_XML_INITUPS		"/"
 #define MGE_XML_INITINFO	"/mgeups/product.xml /product.xml /ws/product.xml"
@@ -1139,6 +1139,30 @@ static xml_info_t mge_xml2nut[] = {
 	{ NULL, 0, 0, NULL, 0, 0, NULL }
 };
 
+/* Raw XML text last applied to each mapped variable, so that objects
+ * which did not change since the previous fetch are neither converted
+ * nor stored again. This is only done for the mappings which have no
+ * conversion side effects (on the status, or on other variables). */
+static char	*mge_xml2nut_text[SIZEOF_ARRAY(mge_xml2nut)];
+
+static int mge_xml_unchanged(const xml_info_t *info, const char *text)
+{
+	char	**last = &mge_xml2nut_text[info - mge_xml2nut];
+
+	if (info->convert != NULL && info->convert != convert_deci) {
+		return 0;
+	}
+
+	if (*last != NULL && !strcmp(*last, text)) {
+		return 1;
+	}
+
+	free(*last);
+	*last = xstrdup(text);
+
+	return 0;
+}
+
 /* A start-element callback for element with given namespace/name. */
 static int mge_xml_startelm_cb(void *userdata, int parent, const char *nspace, const char *name, const char **atts)
 {
@@ -1482,6 +1506,11 @@ static int mge_xml_endelm_cb(void *userdata, int state, const char *nspace, cons
 				return 0;
 			}
 
+			if (mge_xml_unchanged(info, val)) {
+				upsdebugx(4, "-> XML variable %s [%s] did not change", var, val);
+				return 0;
+			}
+
 			if (info->convert) {
 				value = info->convert(val);
 				upsdebugx(4, "-> XML variable %s [%s] which maps to NUT variable %s was converted to value %s for the NUT driver state", var, val, info->nutname, value);
@@ -1603,9 +1632,21 @@ char *vvalue_mge_xml2nut(const char *name, const char *value, size_t len) {
 	return NULL;
 }
 
+void vvalue_mge_xml_forget(void) {
+	size_t i = 0;
+
+	for (; i < SIZEOF_ARRAY(mge_xml2nut_text); ++i) {
+		free(mge_xml2nut_text[i]);
+		mge_xml2nut_text[i] = NULL;
+	}
+}
+
 void vname_register_rw(void) {
 	size_t i = 0;
 
+	/* values set so far are overwritten here, apply them again */
+	vvalue_mge_xml_forget();
+
 	for (; i < sizeof(mge_xml2nut) / sizeof(xml_info_t); ++i) {
 		xml_info_t *info = mge_xml2nut + i;
 
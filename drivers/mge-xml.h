@@ -57,6 +57,14 @@ const char * vname_mge_xml2nut(const char *name);
  */
 char *vvalue_mge_xml2nut(const char *name, const char *value, size_t len);
 
+/**
+ *  \brief  Forget the MGE XML variable values last received
+ *
+ *  Values which did not change since they were last received are
+ *  not applied again; after this call, they all will be.
+ */
+void vvalue_mge_xml_forget(void);
+
 /**
  *  \brief  Register set of R/W variables
  */
@@ -0,0 +1,706 @@
+/* modbus-regmap.c - coalesced register reads for Modbus drivers
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "main.h"	/* includes "config.h" which must be the first header */
+#include "modbus-regmap.h"
+#include "timehead.h"
+
+#include <errno.h>
+#ifndef WIN32
+# include <sys/types.h>
+# include <sys/socket.h>
+# include <sys/select.h>
+#else
+# include "wincompat.h"
+#endif
+
+typedef struct mbregmap_block_s {
+	int	addr, count;
+	size_t	first, nwanted;	/* declared addresses in this block */
+	int	split;	/* device refused the merged request */
+	uint16_t	*data;
+	unsigned char	*valid;
+} mbregmap_block_t;
+
+typedef struct mbregmap_regs_s {
+	int	*wanted;	/* sorted, unique */
+	size_t	nwanted, alloc;
+	mbregmap_block_t	*blocks;
+	size_t	nblocks;
+} mbregmap_regs_t;
+
+struct mbregmap_s {
+	int	max_gap;
+	int	planned;
+	int	pipeline, unit_id;	/* see mbregmap_set_tcp_pipeline() */
+	struct timeval	timeout;
+	mbregmap_regs_t	regs[MBREGMAP_TYPES];
+};
+
+static const char *type_names[MBREGMAP_TYPES] = {
+	"COIL", "INPUT_B", "INPUT_R", "HOLDING"
+};
+
+static int is_bits(mbregmap_type_t type)
+{
+	return (type == MBREGMAP_COIL || type == MBREGMAP_INPUT_B);
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	int	x = *(const int *)a, y = *(const int *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void blocks_free(mbregmap_regs_t *r)
+{
+	size_t	i;
+
+	for (i = 0; i < r->nblocks; i++) {
+		free(r->blocks[i].data);
+		free(r->blocks[i].valid);
+	}
+
+	free(r->blocks);
+	r->blocks = NULL;
+	r->nblocks = 0;
+}
+
+mbregmap_t *mbregmap_new(int max_gap)
+{
+	mbregmap_t	*map = xcalloc(1, sizeof(mbregmap_t));
+
+	map->max_gap = (max_gap < 0) ? 0 : max_gap;
+	return map;
+}
+
+void mbregmap_free(mbregmap_t *map)
+{
+	int	t;
+
+	if (map == NULL)
+		return;
+
+	for (t = 0; t < MBREGMAP_TYPES; t++) {
+		blocks_free(&map->regs[t]);
+		free(map->regs[t].wanted);
+	}
+
+	free(map);
+}
+
+void mbregmap_add(mbregmap_t *map, mbregmap_type_t type, int addr, int count)
+{
+	mbregmap_regs_t	*r;
+	int	i;
+
+	if (map == NULL || (int)type < 0 || type >= MBREGMAP_TYPES
+	 || addr < 0 || count < 1 || addr + count > 0x10000
+	) {
+		upsdebugx(1, "%s: ignoring invalid range: type %d, addr 0x%x, count %d",
+			__func__, (int)type, (unsigned int)addr, count);
+		return;
+	}
+
+	r = &map->regs[type];
+	for (i = 0; i < count; i++) {
+		if (r->nwanted == r->alloc) {
+			r->alloc = r->alloc ? r->alloc * 2 : 16;
+			r->wanted = xrealloc(r->wanted, r->alloc * sizeof(int));
+		}
+		r->wanted[r->nwanted++] = addr + i;
+	}
+
+	map->planned = 0;
+}
+
+/* Sort the declared addresses and merge them into blocks */
+static void mbregmap_plan(mbregmap_t *map)
+{
+	int	t;
+
+	for (t = 0; t < MBREGMAP_TYPES; t++) {
+		mbregmap_regs_t	*r = &map->regs[t];
+		int	max_count = is_bits((mbregmap_type_t)t)
+			? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGISTERS;
+		int	max_gap = is_bits((mbregmap_type_t)t)
+			? map->max_gap * 16 : map->max_gap;
+		size_t	i, n;
+
+		blocks_free(r);
+		if (!r->nwanted)
+			continue;
+
+		/* sort and drop duplicates */
+		qsort(r->wanted, r->nwanted, sizeof(int), cmp_int);
+		for (i = 1, n = 1; i < r->nwanted; i++) {
+			if (r->wanted[i] != r->wanted[n - 1])
+				r->wanted[n++] = r->wanted[i];
+		}
+		r->nwanted = n;
+
+		r->blocks = xcalloc(n, sizeof(mbregmap_block_t));
+		for (i = 0; i < n; i++) {
+			mbregmap_block_t	*b = (r->nblocks > 0) ? &r->blocks[r->nblocks - 1] : NULL;
+			int	a = r->wanted[i];
+
+			if (b != NULL
+			 && a - (b->addr + b->count) <= max_gap
+			 && a - b->addr + 1 <= max_count
+			) {
+				b->count = a - b->addr + 1;
+				b->nwanted++;
+				continue;
+			}
+
+			b = &r->blocks[r->nblocks++];
+			b->addr = a;
+			b->count = 1;
+			b->first = i;
+			b->nwanted = 1;
+		}
+
+		for (i = 0; i < r->nblocks; i++) {
+			r->blocks[i].data = xcalloc((size_t)r->blocks[i].count, sizeof(uint16_t));
+			r->blocks[i].valid = xcalloc((size_t)r->blocks[i].count, 1);
+		}
+
+		upsdebugx(2, "%s: %" PRIuSIZE " %s addresses in %" PRIuSIZE " requests",
+			__func__, n, type_names[t], r->nblocks);
+	}
+
+	map->planned = 1;
+}
+
+/* One request; bits are converted to registers with 0 or 1 */
+static int mbregmap_read(modbus_t *ctx, mbregmap_type_t type, int addr, int count, uint16_t *dest)
+{
+	uint8_t	bits[MODBUS_MAX_READ_BITS];
+	struct timeval	start;
+	int	rval = -1, i;
+
+	gettimeofday(&start, NULL);
+	switch (type) {
+		case MBREGMAP_COIL:
+			rval = modbus_read_bits(ctx, addr, count, bits);
+			break;
+		case MBREGMAP_INPUT_B:
+			rval = modbus_read_input_bits(ctx, addr, count, bits);
+			break;
+		case MBREGMAP_INPUT_R:
+			rval = modbus_read_input_registers(ctx, addr, count, dest);
+			break;
+		case MBREGMAP_HOLDING:
+			rval = modbus_read_registers(ctx, addr, count, dest);
+			break;
+		case MBREGMAP_TYPES:
+		default:
+			errno = EINVAL;
+			return -1;
+	}
+	drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, rval != -1);
+
+	if (rval != -1 && is_bits(type)) {
+		for (i = 0; i < count; i++)
+			dest[i] = bits[i] ? 1 : 0;
+	}
+
+	upsdebugx(3, "%s: %s addr 0x%x, count %d: %s", __func__, type_names[type],
+		(unsigned int)addr, count, (rval == -1) ? modbus_strerror(errno) : "ok");
+
+	return rval;
+}
+
+/* Read the declared addresses of a block one contiguous run at a time */
+static int mbregmap_read_split(modbus_t *ctx, mbregmap_type_t type,
+	const mbregmap_regs_t *r, mbregmap_block_t *b)
+{
+	size_t	i = b->first, end = b->first + b->nwanted;
+	int	failed = 0;
+
+	while (i < end) {
+		size_t	j = i + 1;
+		int	offset = r->wanted[i] - b->addr;
+
+		while (j < end && r->wanted[j] == r->wanted[j - 1] + 1)
+			j++;
+
+		if (mbregmap_read(ctx, type, r->wanted[i], (int)(j - i), &b->data[offset]) == -1) {
+			failed++;
+		} else {
+			memset(&b->valid[offset], 1, j - i);
+		}
+
+		i = j;
+	}
+
+	return failed;
+}
+
+/* Modbus TCP (MBAP) header, and length of a read request with it */
+#define MBTCP_HEADER_LENGTH	7
+#define MBTCP_READ_REQ_LENGTH	12
+
+/* Function codes of the reads, by mbregmap_type_t */
+static const uint8_t read_functions[MBREGMAP_TYPES] = {
+	0x01, 0x02, 0x04, 0x03
+};
+
+/* The sockets API does not report its errors in errno on Windows */
+static int mbtcp_errno(void)
+{
+#ifdef WIN32
+	switch (WSAGetLastError()) {
+		case WSAEINTR:
+			return EINTR;
+		case WSAETIMEDOUT:
+			return ETIMEDOUT;
+		case WSAECONNRESET:
+		case WSAECONNABORTED:
+			return ECONNRESET;
+		default:
+			return EPIPE;
+	}
+#else
+	return errno;
+#endif
+}
+
+static int mbtcp_send(int sock, const uint8_t *buf, size_t len)
+{
+	int	ret;
+
+	while (len > 0) {
+#ifdef WIN32
+		ret = send((SOCKET)sock, (const char *)buf, (int)len, 0);
+#else
+		ret = (int)send(sock, (const void *)buf, len, 0);
+#endif
+		if (ret < 0)
+			errno = mbtcp_errno();
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			if (ret == 0 || errno == 0)
+				errno = EPIPE;
+			return -1;
+		}
+		buf += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+static int mbtcp_recv(int sock, uint8_t *buf, size_t len, const struct timeval *timeout)
+{
+	int	ret;
+
+	while (len > 0) {
+		fd_set	fds;
+		struct timeval	tv = *timeout;
+
+		FD_ZERO(&fds);
+#ifdef WIN32
+		FD_SET((SOCKET)sock, &fds);
+#else
+		FD_SET(sock, &fds);
+#endif
+
+		/* the first argument is ignored on Windows */
+		ret = select(sock + 1, &fds, NULL, NULL, &tv);
+		if (ret < 0)
+			errno = mbtcp_errno();
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			if (ret == 0)
+				errno = ETIMEDOUT;
+			return -1;
+		}
+
+#ifdef WIN32
+		ret = recv((SOCKET)sock, (char *)buf, (int)len, 0);
+#else
+		ret = (int)recv(sock, (void *)buf, len, 0);
+#endif
+		if (ret < 0)
+			errno = mbtcp_errno();
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			/* closed by the server */
+			if (ret == 0)
+				errno = ECONNRESET;
+			return -1;
+		}
+		buf += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+/* Check and decode the PDU of a response to a read */
+static int mbtcp_decode(mbregmap_read_t *rd, const uint8_t *pdu, size_t len)
+{
+	uint8_t	function = read_functions[rd->type];
+	size_t	nbytes = is_bits(rd->type)
+		? ((size_t)rd->count + 7) / 8 : (size_t)rd->count * 2;
+	int	i;
+
+	if (len == 2 && pdu[0] == (function | 0x80)) {
+		/* exception response, as libmodbus reports them */
+		rd->err = MODBUS_ENOBASE + pdu[1];
+		return -1;
+	}
+
+	if (pdu[0] != function || len != nbytes + 2 || pdu[1] != nbytes) {
+		rd->err = EMBBADDATA;
+		return -1;
+	}
+
+	for (i = 0; i < rd->count; i++) {
+		if (is_bits(rd->type)) {
+			rd->dest[i] = (pdu[2 + i / 8] >> (i % 8)) & 1;
+		} else {
+			rd->dest[i] = (uint16_t)((pdu[2 + 2 * i] << 8) | pdu[3 + 2 * i]);
+		}
+	}
+
+	rd->rval = rd->count;
+	return 0;
+}
+
+int mbregmap_tcp_read_batch(modbus_t *ctx, int unit_id, int depth,
+	const struct timeval *timeout, mbregmap_read_t *reads, size_t nreads)
+{
+	/* requests waiting for their response */
+	struct {
+		uint16_t	tid;
+		size_t	idx;
+		struct timeval	start;
+	} *inflight;
+	static uint16_t	tid = 0;
+	uint8_t	buf[MBTCP_HEADER_LENGTH + 256];
+	size_t	i, next = 0, done = 0;
+	int	sock, ninflight = 0, failed = 0, err = 0;
+
+	for (i = 0; i < nreads; i++) {
+		reads[i].rval = -1;
+		reads[i].err = 0;
+	}
+
+	if (!nreads)
+		return 0;
+
+	sock = modbus_get_socket(ctx);
+	if (sock < 0) {
+		err = EBADF;
+		goto fail;
+	}
+
+	if (depth < 1)
+		depth = 1;
+	inflight = xcalloc((size_t)depth, sizeof(*inflight));
+
+	while (done < nreads) {
+		struct timeval	now;
+		unsigned int	rtid, len;
+		mbregmap_read_t	*rd;
+		int	j;
+
+		/* fill the window */
+		while (ninflight < depth && next < nreads) {
+			rd = &reads[next];
+			tid++;
+
+			buf[0] = (uint8_t)(tid >> 8);
+			buf[1] = (uint8_t)(tid & 0xFF);
+			buf[2] = 0;	/* protocol: Modbus */
+			buf[3] = 0;
+			buf[4] = 0;	/* length of what follows */
+			buf[5] = 6;
+			buf[6] = (uint8_t)unit_id;
+			buf[7] = read_functions[rd->type];
+			buf[8] = (uint8_t)(rd->addr >> 8);
+			buf[9] = (uint8_t)(rd->addr & 0xFF);
+			buf[10] = (uint8_t)(rd->count >> 8);
+			buf[11] = (uint8_t)(rd->count & 0xFF);
+
+			gettimeofday(&inflight[ninflight].start, NULL);
+			if (mbtcp_send(sock, buf, MBTCP_READ_REQ_LENGTH) == -1) {
+				err = errno;
+				goto fail_inflight;
+			}
+
+			inflight[ninflight].tid = tid;
+			inflight[ninflight].idx = next++;
+			ninflight++;
+		}
+
+		/* then take whichever response comes */
+		if (mbtcp_recv(sock, buf, MBTCP_HEADER_LENGTH, timeout) == -1) {
+			err = errno;
+			goto fail_inflight;
+		}
+
+		rtid = ((unsigned int)buf[0] << 8) | buf[1];
+		len = ((unsigned int)buf[4] << 8) | buf[5];
+		if (buf[2] != 0 || buf[3] != 0 || len < 3 || len > 254) {
+			err = EMBBADDATA;
+			goto fail_inflight;
+		}
+
+		if (mbtcp_recv(sock, buf + MBTCP_HEADER_LENGTH, len - 1, timeout) == -1) {
+			err = errno;
+			goto fail_inflight;
+		}
+
+		for (j = 0; j < ninflight && inflight[j].tid != rtid; j++);
+		if (j == ninflight) {
+			/* late answer to a request given up before */
+			upsdebugx(3, "%s: dropping response with unexpected transaction ID %u",
+				__func__, rtid);
+			continue;
+		}
+
+		rd = &reads[inflight[j].idx];
+		if (mbtcp_decode(rd, buf + MBTCP_HEADER_LENGTH, len - 1) == -1)
+			failed++;
+
+		gettimeofday(&now, NULL);
+		drvstats_xfer(DRVSTATS_XPORT_MODBUS, &inflight[j].start, rd->rval != -1);
+		upsdebugx(3, "%s: transaction %u: %s addr 0x%x, count %d: %s in %.1f ms",
+			__func__, rtid, type_names[rd->type], (unsigned int)rd->addr, rd->count,
+			(rd->rval == -1) ? modbus_strerror(rd->err) : "ok",
+			difftimeval(now, inflight[j].start) * 1000.0);
+
+		inflight[j] = inflight[--ninflight];
+		done++;
+	}
+
+	free(inflight);
+
+	if (failed) {
+		for (i = 0; i < nreads; i++) {
+			if (reads[i].rval == -1)
+				errno = reads[i].err;
+		}
+	}
+
+	return failed;
+
+fail_inflight:
+	for (i = 0; i < (size_t)ninflight; i++)
+		drvstats_xfer(DRVSTATS_XPORT_MODBUS, &inflight[i].start, 0);
+	free(inflight);
+
+	/* Responses may still come for the requests given up here, or the
+	 * stream is out of sync: start over with a new connection, so these
+	 * are not taken for the responses to later requests */
+	upsdebugx(2, "%s: %s, reconnecting", __func__, modbus_strerror(err));
+	modbus_close(ctx);
+	if (modbus_connect(ctx) == -1) {
+		upsdebugx(1, "%s: reconnection failed: %s",
+			__func__, modbus_strerror(errno));
+	}
+
+fail:
+	/* no more responses to expect on this connection */
+	upsdebugx(2, "%s: %s, %" PRIuSIZE " of %" PRIuSIZE " reads done",
+		__func__, modbus_strerror(err), done, nreads);
+	for (i = 0, failed = 0; i < nreads; i++) {
+		if (reads[i].rval == -1) {
+			if (!reads[i].err)
+				reads[i].err = err;
+			failed++;
+		}
+	}
+	errno = err;
+
+	return failed;
+}
+
+void mbregmap_set_tcp_pipeline(mbregmap_t *map, int unit_id, int depth,
+	const struct timeval *timeout)
+{
+	if (map == NULL)
+		return;
+
+	map->pipeline = (depth > 1) ? depth : 0;
+	map->unit_id = unit_id;
+	map->timeout = *timeout;
+}
+
+/* Account for the result of reading a whole block, returns failures */
+static int mbregmap_block_done(modbus_t *ctx, mbregmap_type_t type,
+	const mbregmap_regs_t *r, mbregmap_block_t *b, int ok, int err)
+{
+	if (ok) {
+		memset(b->valid, 1, (size_t)b->count);
+		return 0;
+	}
+
+	if (err == EMBXILADD && b->count > 1
+	 && (size_t)b->count != b->nwanted
+	) {
+		/* Some of the gap is not mapped by the device */
+		upslogx(LOG_INFO, "%s: %s registers 0x%x-0x%x can not be "
+			"read at once, reading them separately",
+			__func__, type_names[type], (unsigned int)b->addr,
+			(unsigned int)(b->addr + b->count - 1));
+		b->split = 1;
+		return mbregmap_read_split(ctx, type, r, b);
+	}
+
+	upslogx(LOG_ERR, "ERROR:(%s) modbus_read: addr:0x%x, count:%d, type:%8s, path:%s",
+		modbus_strerror(err), (unsigned int)b->addr, b->count,
+		type_names[type], device_path);
+	errno = err;
+
+	return 1;
+}
+
+int mbregmap_refresh(mbregmap_t *map, modbus_t *ctx)
+{
+	mbregmap_read_t	*reads = NULL;
+	size_t	i, n = 0, nreads = 0;
+	int	t, rval, failed = 0, last_errno = 0;
+
+	if (map == NULL)
+		return -1;
+
+	if (!map->planned)
+		mbregmap_plan(map);
+
+	if (map->pipeline) {
+		/* send all whole-block reads at once */
+		for (t = 0; t < MBREGMAP_TYPES; t++)
+			nreads += map->regs[t].nblocks;
+		reads = xcalloc(nreads ? nreads : 1, sizeof(mbregmap_read_t));
+
+		for (t = 0; t < MBREGMAP_TYPES; t++) {
+			mbregmap_regs_t	*r = &map->regs[t];
+
+			for (i = 0; i < r->nblocks; i++) {
+				if (r->blocks[i].split)
+					continue;
+				reads[n].type = (mbregmap_type_t)t;
+				reads[n].addr = r->blocks[i].addr;
+				reads[n].count = r->blocks[i].count;
+				reads[n].dest = r->blocks[i].data;
+				n++;
+			}
+		}
+
+		mbregmap_tcp_read_batch(ctx, map->unit_id, map->pipeline,
+			&map->timeout, reads, n);
+		n = 0;
+	}
+
+	for (t = 0; t < MBREGMAP_TYPES; t++) {
+		mbregmap_regs_t	*r = &map->regs[t];
+
+		for (i = 0; i < r->nblocks; i++) {
+			mbregmap_block_t	*b = &r->blocks[i];
+
+			memset(b->valid, 0, (size_t)b->count);
+
+			if (b->split) {
+				rval = mbregmap_read_split(ctx, (mbregmap_type_t)t, r, b);
+			} else if (reads != NULL) {
+				rval = mbregmap_block_done(ctx, (mbregmap_type_t)t, r, b,
+					reads[n].rval != -1, reads[n].err);
+				n++;
+			} else {
+				int	ok = (mbregmap_read(ctx, (mbregmap_type_t)t,
+					b->addr, b->count, b->data) != -1);
+
+				rval = mbregmap_block_done(ctx, (mbregmap_type_t)t, r, b,
+					ok, ok ? 0 : errno);
+			}
+
+			if (rval) {
+				failed += rval;
+				last_errno = errno;
+			}
+		}
+	}
+
+	free(reads);
+
+	if (failed)
+		errno = last_errno;
+
+	return failed;
+}
+
+/* Check (without dest) or copy a range from the blocks holding it: a range
+ * declared with one mbregmap_add() may well be spread over neighbouring
+ * blocks, when it was too wide for one request or crossed the end of one */
+static int mbregmap_copy_range(const mbregmap_regs_t *r, int addr, int count, uint16_t *dest)
+{
+	size_t	i;
+	int	done = 0, j;
+
+	for (i = 0; i < r->nblocks && done < count; i++) {
+		const mbregmap_block_t	*b = &r->blocks[i];
+		int	offset = addr + done - b->addr, n;
+
+		if (offset < 0)
+			return -1;	/* not in any block */
+		if (offset >= b->count)
+			continue;
+
+		n = b->count - offset;
+		if (n > count - done)
+			n = count - done;
+
+		for (j = 0; j < n; j++) {
+			if (!b->valid[offset + j])
+				return -1;
+		}
+
+		if (dest)
+			memcpy(&dest[done], &b->data[offset], (size_t)n * sizeof(uint16_t));
+		done += n;
+	}
+
+	return (done == count) ? 0 : -1;
+}
+
+int mbregmap_get_range(const mbregmap_t *map, mbregmap_type_t type, int addr, int count, uint16_t *dest)
+{
+	if (map == NULL || (int)type < 0 || type >= MBREGMAP_TYPES || count < 1)
+		return -1;
+
+	/* dest is left alone unless all of the range was read */
+	if (mbregmap_copy_range(&map->regs[type], addr, count, NULL) == -1)
+		return -1;
+
+	return mbregmap_copy_range(&map->regs[type], addr, count, dest);
+}
+
+int mbregmap_get(const mbregmap_t *map, mbregmap_type_t type, int addr, uint16_t *dest)
+{
+	return mbregmap_get_range(map, type, addr, 1, dest);
+}
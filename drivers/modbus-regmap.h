@@ -0,0 +1,99 @@
+/* modbus-regmap.h - coalesced register reads for Modbus drivers
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef NUT_MODBUS_REGMAP_H_SEEN
+#define NUT_MODBUS_REGMAP_H_SEEN 1
+
+#include <modbus.h>
+#include "nut_stdint.h"
+#include "timehead.h"
+
+/* Limits of one read request, as per Modbus specification */
+#ifndef MODBUS_MAX_READ_BITS
+# define MODBUS_MAX_READ_BITS		2000
+#endif
+#ifndef MODBUS_MAX_READ_REGISTERS
+# define MODBUS_MAX_READ_REGISTERS	125
+#endif
+
+/* How many unused registers (or 16 times as many bits) may be read
+ * along to merge two ranges into one request, by default */
+#define MBREGMAP_DEFAULT_MAX_GAP	8
+
+/* Register types, in the order of the regtype_t enums of the drivers */
+typedef enum mbregmap_type_e {
+	MBREGMAP_COIL = 0,	/* read with modbus_read_bits() */
+	MBREGMAP_INPUT_B,	/* read with modbus_read_input_bits() */
+	MBREGMAP_INPUT_R,	/* read with modbus_read_input_registers() */
+	MBREGMAP_HOLDING,	/* read with modbus_read_registers() */
+	MBREGMAP_TYPES	/* not a type, keep last */
+} mbregmap_type_t;
+
+typedef struct mbregmap_s mbregmap_t;
+
+/* A driver declares once all the registers it needs in a poll cycle with
+ * mbregmap_add(), then calls mbregmap_refresh() once per cycle, which
+ * reads them with as few requests as possible (ranges of the same type
+ * are merged when they are at most max_gap apart, within the protocol
+ * limits), and gets the values from that image with mbregmap_get*().
+ * If the device refuses a merged request as an illegal address, that
+ * block is read one declared range at a time from then on. */
+mbregmap_t *mbregmap_new(int max_gap);
+void mbregmap_free(mbregmap_t *map);
+void mbregmap_add(mbregmap_t *map, mbregmap_type_t type, int addr, int count);
+
+/* Returns the number of failed requests (0 if all went well), with errno
+ * of the last failure kept for the caller to decide e.g. on reconnecting */
+int mbregmap_refresh(mbregmap_t *map, modbus_t *ctx);
+
+/* Return 0 and the value(s) read by the last refresh (bits as 0 or 1),
+ * or -1 if not declared or not read successfully */
+int mbregmap_get(const mbregmap_t *map, mbregmap_type_t type, int addr, uint16_t *dest);
+int mbregmap_get_range(const mbregmap_t *map, mbregmap_type_t type, int addr, int count, uint16_t *dest);
+
+/* Modbus TCP pipelining: up to <depth> read requests are sent, each with
+ * its own transaction ID, before waiting for the responses, which are
+ * matched by that ID (so a server may answer them in any order).  This
+ * hides the network round-trip time, but some gateways only serve one
+ * request at a time, so drivers only enable it on demand (depth 1). */
+
+/* One read of a batch; rval is the count read, or -1 with errno in err */
+typedef struct mbregmap_read_s {
+	mbregmap_type_t	type;
+	int	addr, count;
+	uint16_t	*dest;	/* count registers; bits as 0 or 1 */
+	int	rval;
+	int	err;
+} mbregmap_read_t;
+
+/* Reads a batch over the (connected) Modbus TCP context, with unit_id and
+ * waiting at most timeout for each response.  Returns the number of failed
+ * reads (0 if all went well), with errno of the last failure.  If requests
+ * were left without a valid response (timeout, garbled data...), the
+ * context is reconnected so that late responses are not read later on. */
+int mbregmap_tcp_read_batch(modbus_t *ctx, int unit_id, int depth,
+	const struct timeval *timeout, mbregmap_read_t *reads, size_t nreads);
+
+/* Let mbregmap_refresh() pipeline its requests this way (depth > 1),
+ * or not (depth <= 1, default) */
+void mbregmap_set_tcp_pipeline(mbregmap_t *map, int unit_id, int depth,
+	const struct timeval *timeout);
+
+#endif	/* NUT_MODBUS_REGMAP_H_SEEN */
@@ -42,7 +42,7 @@
 #include "nut_stdint.h"
 
 #define DRIVER_NAME	"network XML UPS"
-#define DRIVER_VERSION	"0.46"
+#define DRIVER_VERSION	"0.47"
 
 /** *_OBJECT query multi-part body boundary */
 #define FORM_POST_BOUNDARY "NUT-NETXML-UPS-OBJECTS"
@@ -244,12 +244,25 @@ static ne_socket	*sock = NULL;
 static ne_uri		uri;
 static char	*product_page = NULL;
 
+/* Cache validators of the pages fetched (see netxml_get_page()) */
+typedef struct netxml_page_s {
+	char	*page;
+	char	*etag;			/* "ETag" of the last full answer */
+	char	*modified;		/* "Last-Modified" of the last full answer */
+	unsigned long	fetched;	/* full answers received */
+	unsigned long	unmodified;	/* "304 Not Modified" answers received */
+	struct netxml_page_s	*next;
+} netxml_page_t;
+
+static netxml_page_t	*pages = NULL;
+
 /* Support functions */
 static void netxml_alarm_set(void);
 static void netxml_status_set(void);
 static int netxml_authenticate(void *userdata, const char *realm, int attempt, char *username, char *password);
 static int netxml_dispatch_request(ne_request *request, ne_xml_parser *parser);
 static int netxml_get_page(const char *page);
+static void netxml_pages_free(void);
 
 static int instcmd(const char *cmdname, const char *extra);
 static int setvar(const char *varname, const char *val);
@@ -675,6 +688,9 @@ void upsdrv_cleanup(void)
 	free(subdriver->setobject);
 	free(product_page);
 
+	netxml_pages_free();
+	vvalue_mge_xml_forget();
+
 	if (sock) {
 		ne_sock_close(sock);
 	}
@@ -690,17 +706,81 @@ void upsdrv_cleanup(void)
  * Support functions
  *********************************************************************/
 
+/* Find (or add) the cache validators of page */
+static netxml_page_t *netxml_page_find(const char *page)
+{
+	netxml_page_t	*p;
+
+	for (p = pages; p != NULL; p = p->next) {
+		if (!strcmp(p->page, page)) {
+			return p;
+		}
+	}
+
+	p = xcalloc(1, sizeof(*p));
+	p->page = xstrdup(page);
+	p->next = pages;
+	pages = p;
+
+	return p;
+}
+
+#ifdef HAVE_NE_GET_RESPONSE_HEADER
+static void netxml_page_validator(char **validator, const char *value)
+{
+	if (*validator && value && !strcmp(*validator, value)) {
+		return;
+	}
+
+	free(*validator);
+	*validator = value ? xstrdup(value) : NULL;
+}
+#endif
+
+static void netxml_pages_free(void)
+{
+	netxml_page_t	*p;
+
+	while ((p = pages) != NULL) {
+		upsdebugx(2, "%s: %s: %lu full answers, %lu not modified",
+			__func__, p->page, p->fetched, p->unmodified);
+
+		pages = p->next;
+		free(p->page);
+		free(p->etag);
+		free(p->modified);
+		free(p);
+	}
+}
+
+/* Fetch page and feed it to the subdriver XML handlers while it is being
+ * received. The requests go through the same session, so the connection
+ * with the card is kept open between them (unless the card closes it).
+ * If the card sent cache validators for this page, they are sent back,
+ * so that an unchanged page is answered with "304 Not Modified" (and
+ * nothing to parse), since the values it holds are already known. */
 static int netxml_get_page(const char *page)
 {
 	int		ret = NE_ERROR;
 	ne_request	*request;
 	ne_xml_parser	*parser;
+	netxml_page_t	*cached;
 
 	upsdebugx(2, "%s: %s", __func__, (page != NULL)?page:"(null)");
 
 	if (page != NULL) {
 		request = ne_request_create(session, "GET", page);
 
+		cached = netxml_page_find(page);
+
+		if (cached->etag) {
+			ne_add_request_header(request, "If-None-Match", cached->etag);
+		}
+
+		if (cached->modified) {
+			ne_add_request_header(request, "If-Modified-Since", cached->modified);
+		}
+
 		parser = ne_xml_create();
 
 		ne_xml_push_handler(parser, subdriver->startelm_cb, subdriver->cdata_cb, subdriver->endelm_cb, NULL);
@@ -709,6 +789,17 @@ static int netxml_get_page(const char *page)
 
 		if (ret) {
 			upsdebugx(2, "%s: %s", __func__, ne_get_error(session));
+		} else if (ne_get_status(request)->code == 304) {
+			upsdebugx(3, "%s: %s not modified", __func__, page);
+			cached->unmodified++;
+		} else {
+			cached->fetched++;
+#ifdef HAVE_NE_GET_RESPONSE_HEADER
+			netxml_page_validator(&cached->etag,
+				ne_get_response_header(request, "ETag"));
+			netxml_page_validator(&cached->modified,
+				ne_get_response_header(request, "Last-Modified"));
+#endif
 		}
 
 		ne_xml_destroy(parser);
@@ -918,7 +1009,12 @@ static int netxml_dispatch_request(ne_request *request, ne_xml_parser *parser)
 			break;
 		}
 
-		ret = ne_xml_parse_response(request, parser);
+		/* nothing to parse, the page we already have is current */
+		if (ne_get_status(request)->code == 304) {
+			ret = ne_discard_response(request);
+		} else {
+			ret = ne_xml_parse_response(request, parser);
+		}
 
 		if (ret == NE_OK) {
 			ret = ne_end_request(request);
@@ -74,6 +74,14 @@ typedef struct usb_communication_subdriver_s {
 		usb_ctrl_charbuf buf, usb_ctrl_charbufsize bufsize,
 		usb_ctrl_timeout_msec timeout);
 
+	/* Optional (may be NULL): keep reading the interrupt pipe in the
+	 * background, get_interrupt() then returns queued reports of up to
+	 * bufsize bytes without waiting, until close_dev(). Returns a file
+	 * descriptor which gets readable when a report came in, or -1 if
+	 * not supported (get_interrupt() then stays synchronous). */
+	int (*start_interrupt_async)(usb_dev_handle *sdev,
+		usb_ctrl_charbufsize bufsize);
+
 	/* Nearly all devices use a single configuration descriptor, index 0.
 	 * But, it is possible for a device have more than one, check bNumConfigration
 	 * on the device descriptor for the total.
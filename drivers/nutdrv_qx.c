@@ -58,7 +58,7 @@
 	#define DRIVER_NAME	"Generic Q* Serial driver"
 #endif	/* QX_USB */
 
-#define DRIVER_VERSION	"0.36"
+#define DRIVER_VERSION	"0.37"
 
 #ifdef QX_SERIAL
 	#include "serial.h"
@@ -148,13 +148,28 @@ static int	is_usb = 0;	/* Whether the device is connected through USB (1) or ser
 #endif	/* QX_USB && QX_SERIAL */
 
 static struct {
-	char	command[SMALLBUF];	/* Command sent to the UPS to get answer/to execute an instant command */
-	char	answer[SMALLBUF];	/* Answer from the UPS, filled at runtime */
-} previous_item = { "", "" };	/* Hold the values of the item processed just before the actual one */
+	const char	*command;	/* Command sent to the UPS to get answer/to execute an instant command */
+	const char	*answer;	/* Answer from the UPS, filled at runtime */
+} previous_item = { NULL, NULL };	/* Hold the values of the item processed just before the actual one */
+
+/* Items of the active subdriver: a writable copy of its (read-only) qx2nut table (see qx_bind_items()) */
+static item_t	*qx2nut = NULL;
+
+/* Runtime buffers of the items, one per distinct command (see qx_bind_items()) */
+typedef struct {
+	char	*command;		/* Command of the items using these buffers ("" if none) */
+	char	answer[QX_ANSWER_SIZE];	/* Answer from the UPS to command */
+	char	value[QX_ANSWER_SIZE];	/* Value of the item being processed */
+} qx_buffer_t;
+
+static qx_buffer_t	**qx_buffers = NULL;
+static size_t	qx_buffers_count = 0;
 
 
 /* == Support functions == */
 static int	subdriver_matcher(void);
+static void	qx_bind_items(const item_t *table);
+static void	qx_free_items(void);
 static ssize_t	qx_command(const char *cmd, char *buf, size_t buflen);
 static int	qx_process_answer(item_t *item, const size_t len); /* returns just 0 or -1 */
 static bool_t	qx_ups_walk(walkmode_t mode);
@@ -3467,6 +3482,7 @@ void	upsdrv_cleanup(void)
 
 #endif	/* TESTING */
 
+	qx_free_items();
 }
 
 
@@ -3742,6 +3758,9 @@ static int	subdriver_matcher(void)
 
 		}
 
+		/* Let its items store flags and answers */
+		qx_bind_items(subdriver_list[i]->qx2nut);
+
 		/* Give every subdriver some tries */
 		for (j = 0; j < MAXTRIES; j++) {
 
@@ -3758,6 +3777,9 @@ static int	subdriver_matcher(void)
 		if (subdriver != NULL)
 			break;
 
+		/* Only the items of the chosen subdriver are kept */
+		qx_free_items();
+
 	}
 
 	if (!subdriver) {
@@ -3770,6 +3792,80 @@ static int	subdriver_matcher(void)
 	return 1;
 }
 
+/* Make the writable copy of the qx2nut table of a subdriver that the
+ * driver works on, and point the answer and value of its items to
+ * buffers shared by all the items with the same command: the answers
+ * are used only while processing an item, so there is no need for
+ * every item to have its own, and items that send the same command
+ * can reuse its answer. */
+static void	qx_bind_items(const item_t *table)
+{
+	item_t	*item;
+	size_t	count;
+
+	qx_free_items();
+
+	/* Also copy the end of table marker */
+	for (count = 1; table[count - 1].info_type != NULL; count++);
+
+	qx2nut = xcalloc(count, sizeof(*qx2nut));
+	memcpy(qx2nut, table, count * sizeof(*qx2nut));
+
+	for (item = qx2nut; item->info_type != NULL; item++) {
+
+		const char	*command = item->command ? item->command : "";
+		qx_buffer_t	*buffer = NULL;
+		size_t		i;
+
+		for (i = 0; i < qx_buffers_count; i++) {
+			if (!strcasecmp(qx_buffers[i]->command, command)) {
+				buffer = qx_buffers[i];
+				break;
+			}
+		}
+
+		if (buffer == NULL) {
+			qx_buffers = xrealloc(qx_buffers, (qx_buffers_count + 1) * sizeof(*qx_buffers));
+			buffer = xcalloc(1, sizeof(*buffer));
+			buffer->command = xstrdup(command);
+			qx_buffers[qx_buffers_count++] = buffer;
+		}
+
+		item->answer = buffer->answer;
+		item->value = buffer->value;
+	}
+
+	upsdebugx(4, "%s: %" PRIuSIZE " items, %" PRIuSIZE " answer buffers",
+		__func__, count - 1, qx_buffers_count);
+}
+
+/* Free the items and their buffers */
+static void	qx_free_items(void)
+{
+	size_t	i;
+
+	for (i = 0; i < qx_buffers_count; i++) {
+		free(qx_buffers[i]->command);
+		free(qx_buffers[i]);
+	}
+
+	free(qx_buffers);
+	qx_buffers = NULL;
+	qx_buffers_count = 0;
+
+	free(qx2nut);
+	qx2nut = NULL;
+
+	previous_item.command = NULL;
+	previous_item.answer = NULL;
+}
+
+/* See header file for details. */
+item_t	*qx_items(void)
+{
+	return qx2nut;
+}
+
 /* Set vars boundaries */
 static void	qx_set_var(item_t *item)
 {
@@ -3887,14 +3983,14 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 	}
 
 	/* Clear data from previous_item */
-	memset(previous_item.command, 0, sizeof(previous_item.command));
-	memset(previous_item.answer, 0, sizeof(previous_item.answer));
+	previous_item.command = NULL;
+	previous_item.answer = NULL;
 
 	/* 3 modes: QX_WALKMODE_INIT, QX_WALKMODE_QUICK_UPDATE
 	 *      and QX_WALKMODE_FULL_UPDATE */
 
 	/* Device data walk */
-	for (item = subdriver->qx2nut; item->info_type != NULL; item++) {
+	for (item = qx2nut; item->info_type != NULL; item++) {
 
 		/* Skip this item */
 		if (item->qxflags & QX_FLAG_SKIP)
@@ -4008,15 +4104,14 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 		}
 
 		/* Check whether the previous item uses the same command
-		 * and then use its answer, if available.. */
-		if (strlen(previous_item.command) > 0
-		&&  strlen(previous_item.answer) > 0
+		 * and then use its answer, if available (items with
+		 * the same command share the same answer buffer).. */
+		if (previous_item.command != NULL
+		&&  previous_item.answer == item->answer
+		&&  strlen(item->answer) > 0
 		&&  !strcasecmp(previous_item.command, item->command)
 		) {
 
-			snprintf(item->answer, sizeof(item->answer), "%s",
-				previous_item.answer);
-
 			/* Process the answer */
 			retcode = qx_process_answer(item, strlen(item->answer));
 
@@ -4028,16 +4123,14 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 		}
 
 		/* Record item as previous_item */
-		snprintf(previous_item.command, sizeof(previous_item.command), "%s",
-			item->command);
-		snprintf(previous_item.answer, sizeof(previous_item.answer), "%s",
-			item->answer);
+		previous_item.command = item->command;
+		previous_item.answer = item->answer;
 
 		if (retcode) {
 
-			/* Clear data from the item */
-			memset(item->answer, 0, sizeof(item->answer));
-			memset(item->value, 0, sizeof(item->value));
+			/* Clear data from the item (its answer is kept
+			 * for the next items with the same command) */
+			memset(item->value, 0, QX_ANSWER_SIZE);
 
 			if (item->qxflags & QX_FLAG_QUICK_POLL)
 				return FALSE;
@@ -4056,8 +4149,7 @@ static bool_t	qx_ups_walk(walkmode_t mode)
 		retcode = ups_infoval_set(item);
 
 		/* Clear data from the item */
-		memset(item->answer, 0, sizeof(item->answer));
-		memset(item->value, 0, sizeof(item->value));
+		memset(item->value, 0, QX_ANSWER_SIZE);
 
 		/* Uh-oh! Some error! */
 		if (retcode == -1) {
@@ -4228,7 +4320,7 @@ item_t	*find_nut_info(const char *varname, const unsigned long flag, const unsig
 {
 	item_t	*item;
 
-	for (item = subdriver->qx2nut; item->info_type != NULL; item++) {
+	for (item = qx2nut; item->info_type != NULL; item++) {
 
 		if (strcasecmp(item->info_type, varname))
 			continue;
@@ -4283,11 +4375,11 @@ static int	qx_process_answer(item_t *item, const size_t len)
 
 	/* Get value */
 	if (strlen(item->answer)) {
-		snprintf(item->value, sizeof(item->value), "%.*s",
+		snprintf(item->value, QX_ANSWER_SIZE, "%.*s",
 			item->to ? 1 + item->to - item->from : (int)strcspn(item->answer, "\r") - item->from,
 			item->answer + item->from);
 	} else {
-		snprintf(item->value, sizeof(item->value), "%s", "");
+		snprintf(item->value, QX_ANSWER_SIZE, "%s", "");
 	}
 
 	return 0;
@@ -4296,7 +4388,7 @@ static int	qx_process_answer(item_t *item, const size_t len)
 /* See header file for details. */
 int	qx_process(item_t *item, const char *command)
 {
-	char	buf[sizeof(item->answer) - 1] = "", *cmd;
+	char	buf[QX_ANSWER_SIZE - 1] = "", *cmd;
 	ssize_t	len;
 	size_t cmdlen = command ?
 		(strlen(command) >= SMALLBUF ? strlen(command) + 1 : SMALLBUF) :
@@ -4326,7 +4418,14 @@ int	qx_process(item_t *item, const char *command)
 	/* Send the command */
 	len = qx_command(cmd, buf, sizeof(buf));
 
-	memset(item->answer, 0, sizeof(item->answer));
+	/* The answer buffer of the item no longer holds
+	 * the answer to the command of the previous item */
+	if (previous_item.answer == item->answer) {
+		previous_item.command = NULL;
+		previous_item.answer = NULL;
+	}
+
+	memset(item->answer, 0, QX_ANSWER_SIZE);
 
 	if (len < 0 || len > INT_MAX) {
 		upsdebugx(4, "%s: failed to preprocess answer [%s]",
@@ -4345,7 +4444,7 @@ int	qx_process(item_t *item, const char *command)
 				__func__, item->info_type);
 			/* Clear the failed answer, preventing it from
 			 * being reused by next items with same command */
-			memset(item->answer, 0, sizeof(item->answer));
+			memset(item->answer, 0, QX_ANSWER_SIZE);
 			free (cmd);
 			return -1;
 		}
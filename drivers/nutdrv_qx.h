@@ -52,6 +52,9 @@
 #define DEFAULT_OFFDELAY	"30"	/* Delay before power off, in seconds */
 #define DEFAULT_POLLFREQ	30	/* Polling interval between full updates, in seconds; the driver will do quick polls in the meantime */
 
+/* Size of the runtime buffers holding the answer of the UPS to a command, and the value taken from it */
+#define QX_ANSWER_SIZE		SMALLBUF
+
 #ifndef TRUE
 typedef enum { FALSE, TRUE } bool_t;
 #else
@@ -78,12 +81,14 @@ typedef struct item_t {
 						 * If QX_FLAG_SETVAR is set the value given by the user will be checked against these infos. */
 	const char	*command;		/* Command sent to the UPS to get answer/to execute an instant command/to set a variable */
 
-	char		answer[SMALLBUF];	/* Answer from the UPS, filled at runtime.
+	char		*answer;		/* Answer from the UPS, filled at runtime: set it to "" in the tables.
+						 * Points to a buffer of QX_ANSWER_SIZE bytes shared by all the items with the same command.
 						 * If you expect a nonvalid C string (e.g.: inner '\0's) or need to perform actions before the answer is used (and treated as a null-terminated string), you should set a preprocess_answer() function */
 	const size_t	answer_len;		/* Expected min length of the answer. Set it to 0 if there's no minimum length to look after. */
 	const char	leading;		/* Expected leading character of the answer (optional) */
 
-	char		value[SMALLBUF];	/* Value from the answer, filled at runtime (i.e. answer between from and to) */
+	char		*value;			/* Value from the answer, filled at runtime (i.e. answer between from and to): set it to "" in the tables.
+						 * Points to a buffer of QX_ANSWER_SIZE bytes shared by all the items with the same command. */
 	const int	from;			/* Position of the starting character of the info (i.e. 'value') we're after in the answer */
 	const int	to;			/* Position of the ending character of the info (i.e. 'value') we're after in the answer: use 0 if all the remaining of the line is needed */
 
@@ -147,7 +152,8 @@ typedef struct {
 typedef struct {
 	const char	*name;			/* Name of this subdriver, i.e. name (must be equal to the protocol name) + space + version */
 	int		(*claim)(void);		/* Function that allows the subdriver to "claim" a device: return 1 if device is covered by this subdriver, else 0 */
-	item_t		*qx2nut;		/* Main table of vars and instcmds */
+	const item_t	*qx2nut;		/* Main table of vars and instcmds.
+						 * The driver works on a copy of it, holding the runtime data of the items: to change or walk them, use qx_items() */
 	void		(*initups)(void);	/* Subdriver specific upsdrv_initups. Called at the end of nutdrv_qx's own upsdrv_initups */
 	void		(*initinfo)(void);	/* Subdriver specific upsdrv_initinfo. Called at the end of nutdrv_qx's own upsdrv_initinfo */
 	void		(*makevartable)(void);	/* Subdriver specific ups.conf flags/vars */
@@ -176,6 +182,8 @@ int	setvar(const char *varname, const char *val);
 	 *  - 'flag': flags that have to be set in the item, i.e. if one of the flags is absent in the item it won't be returned
 	 *  - 'noflag': flags that have to be absent in the item, i.e. if at least one of the flags is set in the item it won't be returned */
 item_t	*find_nut_info(const char *varname, const unsigned long flag, const unsigned long noflag);
+	/* Return the items the driver works on for the subdriver being used (or tried in its claim()): a copy of its qx2nut table, ended like it by an item with a NULL info_type. */
+item_t	*qx_items(void);
 	/* Send 'command' (a null-terminated byte string) or, if it is NULL, send the command stored in the item to the UPS and process the reply, saving it in item->answer. Return -1 on errors, 0 on success. */
 int	qx_process(item_t *item, const char *command);
 	/* Process the value we got back from the UPS (set status bits and set the value of other parameters), calling the item-specific preprocess function, if any, otherwise executing the standard preprocessing (including trimming if QX_FLAG_TRIM is set).
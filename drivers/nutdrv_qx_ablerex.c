@@ -341,7 +341,7 @@ static int	ablerex_process_status_bits(item_t *item, char *value, const size_t v
 }
 
 /* qx2nut lookup table */
-static item_t	ablerex_qx2nut[] = {
+static const item_t	ablerex_qx2nut[] = {
 
 	/*
 	 * > [Q1\r]
@@ -447,7 +447,7 @@ static testing_t	ablerex_testing[] = {
 /* Subdriver-specific initups */
 static void	ablerex_initups(void)
 {
-	blazer_initups(ablerex_qx2nut);
+	blazer_initups(qx_items());
 }
 
 /* Subdriver interface */
@@ -89,7 +89,7 @@ static info_rw_t	bestups_r_pins_shutdown_mode[] = {
 
 
 /* == qx2nut lookup table == */
-static item_t	bestups_qx2nut[] = {
+static const item_t	bestups_qx2nut[] = {
 
 	/* Query UPS for status
 	 * > [Q1\r]
@@ -282,7 +282,7 @@ static int	bestups_claim(void)
 /* Subdriver-specific initups */
 static void	bestups_initups(void)
 {
-	blazer_initups_light(bestups_qx2nut);
+	blazer_initups_light(qx_items());
 }
 
 /* Subdriver-specific flags/vars */
@@ -348,7 +348,7 @@ static int	bestups_preprocess_id_answer(item_t *item, const int len)
 	upsdebugx(4, "read: '%.*s'", (int)strcspn(refined, "\r"), refined);
 
 	/* e.g.: item->answer = "FOR, 750,120,120,20.0, 27.6\r"; len = 28 */
-	return snprintf(item->answer, sizeof(item->answer), "%s", refined);
+	return snprintf(item->answer, QX_ANSWER_SIZE, "%s", refined);
 }
 
 
@@ -29,7 +29,7 @@
 #define HUNNOX_VERSION "Hunnox 0.02"
 
 /* qx2nut lookup table */
-static item_t	hunnox_qx2nut[] = {
+static const item_t	hunnox_qx2nut[] = {
 
 	/*
 	 * > [Q1\r]
@@ -119,7 +119,7 @@ static testing_t	hunnox_testing[] = {
 /* Subdriver-specific initups */
 static void	hunnox_initups(void)
 {
-	blazer_initups(hunnox_qx2nut);
+	blazer_initups(qx_items());
 }
 
 /* Subdriver interface */
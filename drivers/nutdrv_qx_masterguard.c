@@ -662,7 +662,7 @@ static int masterguard_new_slaveaddr(item_t *item, const int len) {
 
 
 /* qx2nut lookup table */
-static item_t masterguard_qx2nut[] = {
+static const item_t masterguard_qx2nut[] = {
 	/* static values */
 
 	/* type				flags	rw	command	answer	len	leading	value	from	to	dfl		qxflags				precmd	preans	preproc */
@@ -1011,7 +1011,7 @@ static int masterguard_claim(void) {
 	}
 
 	/* set SKIP flag for unimplemented commands */
-	for (item = masterguard_qx2nut; item->info_type != NULL; item++) {
+	for (item = qx_items(); item->info_type != NULL; item++) {
 		int match = 0;
 		if (item->command == NULL || item->command[0] == '\0') continue;
 		for (sp = commands; sp != NULL; sp++) {
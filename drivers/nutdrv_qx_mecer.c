@@ -37,7 +37,7 @@ static int	mecer_process_test_battery(item_t *item, char *value, const size_t va
 
 
 /* == qx2nut lookup table == */
-static item_t	mecer_qx2nut[] = {
+static const item_t	mecer_qx2nut[] = {
 
 	/* Query UPS for protocol (Voltronic Power UPSes)
 	 * > [QPI\r]
@@ -201,7 +201,7 @@ static int	mecer_claim(void)
 /* Subdriver-specific initups */
 static void	mecer_initups(void)
 {
-	blazer_initups(mecer_qx2nut);
+	blazer_initups(qx_items());
 }
 
 
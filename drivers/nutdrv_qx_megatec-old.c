@@ -28,7 +28,7 @@
 #define MEGATEC_OLD_VERSION "Megatec/old 0.08"
 
 /* qx2nut lookup table */
-static item_t	megatec_old_qx2nut[] = {
+static const item_t	megatec_old_qx2nut[] = {
 
 	/*
 	 * > [D\r]
@@ -119,7 +119,7 @@ static testing_t	megatec_old_testing[] = {
 /* Subdriver-specific initups */
 static void	megatec_old_initups(void)
 {
-	blazer_initups(megatec_old_qx2nut);
+	blazer_initups(qx_items());
 }
 
 /* Subdriver interface */
@@ -28,7 +28,7 @@
 #define MEGATEC_VERSION "Megatec 0.07"
 
 /* qx2nut lookup table */
-static item_t	megatec_qx2nut[] = {
+static const item_t	megatec_qx2nut[] = {
 
 	/*
 	 * > [Q1\r]
@@ -119,7 +119,7 @@ static testing_t	megatec_testing[] = {
 /* Subdriver-specific initups */
 static void	megatec_initups(void)
 {
-	blazer_initups(megatec_qx2nut);
+	blazer_initups(qx_items());
 }
 
 /* Subdriver interface */
@@ -28,7 +28,7 @@
 #define MUSTEK_VERSION "Mustek 0.08"
 
 /* qx2nut lookup table */
-static item_t	mustek_qx2nut[] = {
+static const item_t	mustek_qx2nut[] = {
 
 	/*
 	 * > [QS\r]
@@ -119,7 +119,7 @@ static testing_t	mustek_testing[] = {
 /* Subdriver-specific initups */
 static void	mustek_initups(void)
 {
-	blazer_initups(mustek_qx2nut);
+	blazer_initups(qx_items());
 }
 
 /* Subdriver interface */
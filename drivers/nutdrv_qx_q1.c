@@ -38,7 +38,7 @@
 #define Q1_VERSION "Q1 0.08"
 
 /* qx2nut lookup table */
-static item_t	q1_qx2nut[] = {
+static const item_t	q1_qx2nut[] = {
 
 	/*
 	 * > [Q1\r]
@@ -104,7 +104,7 @@ static testing_t	q1_testing[] = {
 /* Subdriver-specific initups */
 static void	q1_initups(void)
 {
-	blazer_initups_light(q1_qx2nut);
+	blazer_initups_light(qx_items());
 }
 
 /* Subdriver interface */
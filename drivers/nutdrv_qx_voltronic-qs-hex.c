@@ -62,7 +62,7 @@ static info_rw_t	voltronic_qs_hex_r_offdelay[] = {
 
 
 /* == qx2nut lookup table == */
-static item_t	voltronic_qs_hex_qx2nut[] = {
+static const item_t	voltronic_qs_hex_qx2nut[] = {
 
 	/* Query UPS for protocol
 	 * > [M\r]
@@ -184,7 +184,7 @@ static int	voltronic_qs_hex_claim(void)
 /* Subdriver-specific initups */
 static void	voltronic_qs_hex_initups(void)
 {
-	blazer_initups_light(voltronic_qs_hex_qx2nut);
+	blazer_initups_light(qx_items());
 }
 
 
@@ -275,7 +275,7 @@ static int	voltronic_qs_hex_preprocess_qs_answer(item_t *item, const int len)
 	upsdebugx(4, "read: %s", refined);
 
 	/* e.g.: item->answer = "#6C01 35 6C01 35 03 519A 1312D0 E6 1E 00001001" */
-	return snprintf(item->answer, sizeof(item->answer), "%s\r", refined);
+	return snprintf(item->answer, QX_ANSWER_SIZE, "%s\r", refined);
 }
 
 /* Transform a char into its binary form (as an int) */
@@ -53,7 +53,7 @@ static info_rw_t	voltronic_qs_r_offdelay[] = {
 
 
 /* == qx2nut lookup table == */
-static item_t	voltronic_qs_qx2nut[] = {
+static const item_t	voltronic_qs_qx2nut[] = {
 
 	/* Query UPS for protocol
 	 * > [M\r]
@@ -182,7 +182,7 @@ static int	voltronic_qs_claim(void)
 /* Subdriver-specific initups */
 static void	voltronic_qs_initups(void)
 {
-	blazer_initups_light(voltronic_qs_qx2nut);
+	blazer_initups_light(qx_items());
 }
 
 
@@ -971,7 +971,7 @@ static info_rw_t	voltronic_e_cap_nonut[] = {
 
 
 /* == qx2nut lookup table == */
-static item_t	voltronic_qx2nut[] = {
+static const item_t	voltronic_qx2nut[] = {
 
 	/* Query UPS for protocol
 	 * > [QPI\r]
@@ -1761,7 +1761,7 @@ static void	voltronic_massive_unskip(const long protocol)
 {
 	item_t	*item;
 
-	for (item = voltronic_qx2nut; item->info_type != NULL; item++) {
+	for (item = qx_items(); item->info_type != NULL; item++) {
 
 		if (!item->command)
 			continue;
@@ -3952,7 +3952,7 @@ static int	voltronic_status(item_t *item, char *value, const size_t valuelen)
 
 			item_t	*faultitem;
 
-			for (faultitem = voltronic_qx2nut; faultitem->info_type != NULL; faultitem++) {
+			for (faultitem = qx_items(); faultitem->info_type != NULL; faultitem++) {
 
 				if (!faultitem->command)
 					continue;
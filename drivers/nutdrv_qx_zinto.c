@@ -28,7 +28,7 @@
 #define ZINTO_VERSION "Zinto 0.07"
 
 /* qx2nut lookup table */
-static item_t	zinto_qx2nut[] = {
+static const item_t	zinto_qx2nut[] = {
 
 	/*
 	 * > [Q1\r]
@@ -119,7 +119,7 @@ static testing_t	zinto_testing[] = {
 /* Subdriver-specific initups */
 static void	zinto_initups(void)
 {
-	blazer_initups(zinto_qx2nut);
+	blazer_initups(qx_items());
 }
 
 /* Subdriver interface */
@@ -22,9 +22,10 @@
 
 #include "main.h"
 #include <modbus.h>
+#include "modbus-regmap.h"
 
 #define DRIVER_NAME	"NUT PhoenixContact Modbus driver"
-#define DRIVER_VERSION	"0.04"
+#define DRIVER_VERSION	"0.05"
 
 #define CHECK_BIT(var,pos) ((var) & (1<<(pos)))
 #define MODBUS_SLAVE_ID 192
@@ -32,8 +33,18 @@
 /* Variables */
 static modbus_t *modbus_ctx = NULL;
 static int errcount = 0;
+static mbregmap_t *regmap = NULL;	/* image of the registers read per update */
+
+/* input registers read on each update: address, count */
+static const int polled_regs[][2] = {
+	{ 29697, 3 },	/* status */
+	{ 29745, 1 },	/* output voltage */
+	{ 29749, 5 },	/* battery charge */
+	{ 29792, 10 },	/* battery data */
+	{ 29840, 1 }	/* alarms */
+};
 
-static int mrir(modbus_t * arg_ctx, int addr, int nb, uint16_t * dest);
+static int mrir(int addr, int nb, uint16_t * dest);
 
 /* driver description structure */
 upsdrv_info_t upsdrv_info = {
@@ -63,7 +74,10 @@ void upsdrv_updateinfo(void)
 
 	upsdebugx(2, "upsdrv_updateinfo");
 
-	mrir(modbus_ctx, 29697, 3, tab_reg);
+	/* failed reads are logged there, and accounted for by mrir() */
+	mbregmap_refresh(regmap, modbus_ctx);
+
+	mrir(29697, 3, tab_reg);
 
 	status_init();
 
@@ -80,14 +94,14 @@ void upsdrv_updateinfo(void)
 		status_set("LB");	/* LB is actually called "shutdown event" on this ups */
 	}
 
-	mrir(modbus_ctx, 29745, 1, tab_reg);
+	mrir(29745, 1, tab_reg);
 	dstate_setinfo("output.voltage", "%d", (int) (tab_reg[0] / 1000));
 
-	mrir(modbus_ctx, 29749, 5, tab_reg);
+	mrir(29749, 5, tab_reg);
 	dstate_setinfo("battery.charge", "%d", tab_reg[0]);
 	/* dstate_setinfo("battery.runtime",tab_reg[1]*60); */ /* also reported on this address, but less accurately */
 
-	mrir(modbus_ctx, 29792, 10, tab_reg);
+	mrir(29792, 10, tab_reg);
 	dstate_setinfo("battery.voltage", "%f", (double) (tab_reg[0]) / 1000.0);
 	dstate_setinfo("battery.temperature", "%d", tab_reg[1] - 273);
 	dstate_setinfo("battery.runtime", "%d", tab_reg[3]);
@@ -95,7 +109,7 @@ void upsdrv_updateinfo(void)
 	dstate_setinfo("output.current", "%f", (double) (tab_reg[6]) / 1000.0);
 
 	/* ALARMS */
-	mrir(modbus_ctx, 29840, 1, tab_reg);
+	mrir(29840, 1, tab_reg);
 	alarm_init();
 	if (CHECK_BIT(tab_reg[0], 4) && CHECK_BIT(tab_reg[0], 5))
 		alarm_set("End of life (Resistance)");
@@ -150,6 +164,7 @@ void upsdrv_makevartable(void)
 void upsdrv_initups(void)
 {
 	int r;
+	size_t i;
 	upsdebugx(2, "upsdrv_initups");
 
 	modbus_ctx = modbus_new_rtu(device_path, 115200, 'E', 8, 1);
@@ -167,6 +182,11 @@ void upsdrv_initups(void)
 		fatalx(EXIT_FAILURE, "modbus_connect: unable to connect: %s", modbus_strerror(errno));
 	}
 
+	/* declare the polled registers, so they are fetched with as
+	 * few modbus requests as possible */
+	regmap = mbregmap_new(MBREGMAP_DEFAULT_MAX_GAP);
+	for (i = 0; i < SIZEOF_ARRAY(polled_regs); i++)
+		mbregmap_add(regmap, MBREGMAP_INPUT_R, polled_regs[i][0], polled_regs[i][1]);
 }
 
 
@@ -176,15 +196,18 @@ void upsdrv_cleanup(void)
 		modbus_close(modbus_ctx);
 		modbus_free(modbus_ctx);
 	}
+	mbregmap_free(regmap);
+	regmap = NULL;
 }
 
-/* Modbus Read Input Registers */
-static int mrir(modbus_t * arg_ctx, int addr, int nb, uint16_t * dest)
+/* Modbus Read Input Registers, as read by the last mbregmap_refresh() */
+static int mrir(int addr, int nb, uint16_t * dest)
 {
 	int r;
-	r = modbus_read_input_registers(arg_ctx, addr, nb, dest);
+
+	r = mbregmap_get_range(regmap, MBREGMAP_INPUT_R, addr, nb, dest);
 	if (r == -1) {
-		upslogx(LOG_ERR, "mrir: modbus_read_input_registers(addr:%d, count:%d): %s (%s)", addr, nb, modbus_strerror(errno), device_path);
+		upsdebugx(2, "mrir: input registers (addr:%d, count:%d) not read", addr, nb);
 		errcount++;
 	}
 	return r;
@@ -38,9 +38,51 @@
 #endif
 
 #include "nut_stdint.h"
+#include "drvstats.h"
 
 	static unsigned int	comm_failures = 0;
 
+/* Adaptive reading (see "serial_adaptive" in ups.conf): bytes received
+ * beyond what the driver asked for are kept for its next read, and the
+ * time the device takes to start answering each command (and between
+ * the chunks of an answer) is learned, to shorten the read timeouts */
+#define SER_ADAPTIVE_PORTS	4	/* ports followed per process */
+#define SER_ADAPTIVE_BUFSIZE	512	/* read-ahead buffer of a port */
+#define SER_ADAPTIVE_CMDS	32	/* commands followed per port */
+#define SER_ADAPTIVE_SAMPLES	8	/* samples needed to shorten a timeout */
+#define SER_ADAPTIVE_MARGIN	0.05	/* seconds added to the learned timeouts */
+
+typedef struct {
+	double	avg, dev;	/* moving average and mean deviation (seconds) */
+	double	max;
+	unsigned long	count;
+} ser_latency_t;
+
+typedef struct {
+	int	used;
+	uint32_t	hash;		/* of the bytes sent (0: nothing sent yet) */
+	ser_latency_t	answer;		/* from the command to the first byte of its answer */
+	ser_latency_t	gap;		/* between the chunks of the answer */
+	unsigned long	timeouts;	/* shortened timeouts which expired (this
+					 * includes the ends of answers, with gaps) */
+} ser_command_t;
+
+typedef struct {
+	TYPE_FD_SER	fd;
+	unsigned char	buf[SER_ADAPTIVE_BUFSIZE];
+	size_t	start, end;		/* bytes not yet read by the driver */
+	uint32_t	hash;		/* of the command being sent */
+	int	sending;		/* nothing was read since the last send */
+	int	answering;		/* waiting for the first byte of the answer */
+	struct timeval	last;		/* end of the last send, or of the last read */
+	ser_command_t	*cmd;		/* timings of the last command sent */
+	ser_command_t	cmds[SER_ADAPTIVE_CMDS];
+} ser_port_t;
+
+static ser_port_t	*ser_ports[SER_ADAPTIVE_PORTS];
+
+static void ser_adaptive_dump(void);
+
 static void ser_open_error(const char *port)
 	__attribute__((noreturn));
 
@@ -144,6 +186,248 @@ static void lock_set(TYPE_FD_SER fd, const char *port)
 #endif
 }
 
+/* Find (or add) the adaptive reading state of port fd,
+ * or NULL if not enabled */
+static ser_port_t *ser_port(TYPE_FD_SER fd, int add)
+{
+	int	i, slot = -1;
+
+	if (!do_serial_adaptive || INVALID_FD_SER(fd))
+		return NULL;
+
+	for (i = 0; i < SER_ADAPTIVE_PORTS; i++) {
+		if (ser_ports[i] && ser_ports[i]->fd == fd)
+			return ser_ports[i];
+
+		if (!ser_ports[i] && slot < 0)
+			slot = i;
+	}
+
+	if (!add)
+		return NULL;
+
+	if (slot < 0) {
+		upsdebugx(1, "%s: too many serial ports, not learning about this one", __func__);
+		return NULL;
+	}
+
+	ser_ports[slot] = xcalloc(1, sizeof(ser_port_t));
+	ser_ports[slot]->fd = fd;
+	drvstats_xfer_dumper(DRVSTATS_XPORT_SERIAL, ser_adaptive_dump);
+
+	return ser_ports[slot];
+}
+
+/* Timings of the command with given hash (least used entry is recycled) */
+static ser_command_t *ser_port_command(ser_port_t *port, uint32_t hash)
+{
+	ser_command_t	*cmd, *lru = NULL;
+	int	i;
+
+	for (i = 0; i < SER_ADAPTIVE_CMDS; i++) {
+		cmd = &port->cmds[i];
+
+		if (cmd->used && cmd->hash == hash)
+			return cmd;
+
+		if (!lru || (lru->used && (!cmd->used
+			|| cmd->answer.count + cmd->gap.count < lru->answer.count + lru->gap.count))
+		) {
+			lru = cmd;
+		}
+	}
+
+	memset(lru, 0, sizeof(*lru));
+	lru->used = 1;
+	lru->hash = hash;
+
+	return lru;
+}
+
+static void ser_latency_add(ser_latency_t *lat, double sec)
+{
+	double	err;
+
+	if (!lat->count) {
+		lat->avg = sec;
+		lat->dev = sec / 2;
+	} else {
+		err = sec - lat->avg;
+		lat->avg += err / 8;
+		lat->dev += ((err < 0 ? -err : err) - lat->dev) / 4;
+	}
+
+	if (sec > lat->max)
+		lat->max = sec;
+
+	lat->count++;
+}
+
+/* Learned timeout, or < 0 if not enough samples yet */
+static double ser_latency_timeout(const ser_latency_t *lat)
+{
+	if (lat->count < SER_ADAPTIVE_SAMPLES)
+		return -1;
+
+	return 2 * lat->avg + 4 * lat->dev + SER_ADAPTIVE_MARGIN;
+}
+
+/* Account buflen bytes from buf sent to the port */
+static void ser_port_sent(TYPE_FD_SER fd, const void *buf, size_t buflen)
+{
+	ser_port_t	*port = ser_port(fd, 1);
+	const unsigned char	*data = buf;
+	size_t	i;
+
+	if (!port)
+		return;
+
+	/* A new command: forget what is left of the previous answer */
+	if (!port->sending) {
+		port->hash = 2166136261U;	/* FNV-1a */
+		port->sending = 1;
+		port->start = port->end = 0;
+	}
+
+	for (i = 0; i < buflen; i++) {
+		port->hash ^= data[i];
+		port->hash *= 16777619U;
+	}
+
+	port->cmd = ser_port_command(port, port->hash);
+	port->answering = 1;
+	gettimeofday(&port->last, NULL);
+}
+
+/* Read the next chunk from the device into the buffer of the port:
+ * the wait for the first byte of an answer, and (if gaps != 0) between
+ * its chunks, is shortened to what was learned for the command */
+static ssize_t ser_port_fill(ser_port_t *port, time_t d_sec, useconds_t d_usec, int gaps)
+{
+	ser_command_t	*cmd;
+	ser_latency_t	*lat;
+	struct timeval	now;
+	double	wait = (double)d_sec + (double)d_usec / 1000000, learned;
+	int	shortened = 0;
+	ssize_t	ret;
+
+	if (!port->cmd)
+		port->cmd = ser_port_command(port, 0);
+
+	cmd = port->cmd;
+	lat = port->answering ? &cmd->answer : &cmd->gap;
+	port->sending = 0;
+
+	learned = ser_latency_timeout(lat);
+
+	/* Answers that always came in one chunk tell nothing about gaps:
+	 * assume the device does not pause longer than it takes to answer */
+	if (learned < 0 && !port->answering)
+		learned = ser_latency_timeout(&cmd->answer);
+
+	if (learned >= 0 && learned < wait && (port->answering || gaps)) {
+		d_sec = (time_t)learned;
+		d_usec = (useconds_t)((learned - (double)d_sec) * 1000000);
+		shortened = 1;
+	}
+
+	ret = select_read(port->fd, port->buf, sizeof(port->buf), d_sec, (suseconds_t)d_usec);
+	gettimeofday(&now, NULL);
+
+	if (ret > 0) {
+		/* Polls (e.g. flushing) tell nothing about the device,
+		 * nor does the first read without a command sent */
+		if (wait > 0 && port->last.tv_sec)
+			ser_latency_add(lat, difftimeval(now, port->last));
+
+		port->answering = 0;
+		port->start = 0;
+		port->end = (size_t)ret;
+		port->last = now;
+	} else if (ret == 0 && shortened) {
+		cmd->timeouts++;
+		upsdebugx(3, "%s: no data within the learned %.3fs (of %.3fs) for command %08x",
+			__func__, learned, wait, (unsigned int)cmd->hash);
+
+		/* Only an answer that did not start is sure to be late (gaps
+		 * also end answers): be more patient with this command */
+		if (lat == &cmd->answer)
+			lat->dev += lat->avg + SER_ADAPTIVE_MARGIN;
+	}
+
+	return ret;
+}
+
+/* Read up to buflen bytes from the port, from what is left of the
+ * previous read first */
+static ssize_t ser_read(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, useconds_t d_usec, int gaps)
+{
+	ser_port_t	*port = ser_port(fd, 1);
+	ssize_t	ret;
+	size_t	len;
+
+	if (!port) {
+		/* Per standard below, we can cast here, because required ranges are
+		 * effectively the same (and signed -1 for suseconds_t), and at most long:
+		 * https://pubs.opengroup.org/onlinepubs/009604599/basedefs/sys/types.h.html
+		 */
+		return select_read(fd, buf, buflen, d_sec, (suseconds_t)d_usec);
+	}
+
+	if (port->start == port->end) {
+		ret = ser_port_fill(port, d_sec, d_usec, gaps);
+
+		if (ret < 1)
+			return ret;
+	}
+
+	len = port->end - port->start;
+	if (len > buflen)
+		len = buflen;
+
+	memcpy(buf, &port->buf[port->start], len);
+	port->start += len;
+
+	return (ssize_t)len;
+}
+
+/* Give back the last len bytes returned by ser_read() to the port */
+static void ser_unread(TYPE_FD_SER fd, size_t len)
+{
+	ser_port_t	*port = ser_port(fd, 0);
+
+	if (port && len <= port->start)
+		port->start -= len;
+}
+
+static void ser_adaptive_dump(void)
+{
+	int	i, j;
+
+	for (i = 0; i < SER_ADAPTIVE_PORTS; i++) {
+		if (!ser_ports[i])
+			continue;
+
+		for (j = 0; j < SER_ADAPTIVE_CMDS; j++) {
+			ser_command_t	*cmd = &ser_ports[i]->cmds[j];
+
+			if (!cmd->answer.count && !cmd->gap.count && !cmd->timeouts)
+				continue;
+
+			upslogx(LOG_INFO, "Driver stats: serial: command %08x: "
+				"answer count=%lu avg=%.3fms dev=%.3fms max=%.3fms, "
+				"gaps count=%lu avg=%.3fms dev=%.3fms max=%.3fms, "
+				"shortened timeouts=%lu",
+				(unsigned int)cmd->hash,
+				cmd->answer.count, cmd->answer.avg * 1000,
+				cmd->answer.dev * 1000, cmd->answer.max * 1000,
+				cmd->gap.count, cmd->gap.avg * 1000,
+				cmd->gap.dev * 1000, cmd->gap.max * 1000,
+				cmd->timeouts);
+		}
+	}
+}
+
 /* Non fatal version of ser_open */
 TYPE_FD_SER ser_open_nf(const char *port)
 {
@@ -317,6 +601,8 @@ int ser_get_dcd(TYPE_FD_SER fd)
 
 int ser_close(TYPE_FD_SER fd, const char *port)
 {
+	int	i;
+
 	if (INVALID_FD_SER(fd)) {
 #ifndef WIN32
 		fatal_with_errno(EXIT_FAILURE, "ser_close: programming error: fd=%d port=%s", fd, port);
@@ -325,6 +611,13 @@ int ser_close(TYPE_FD_SER fd, const char *port)
 #endif
 	}
 
+	for (i = 0; i < SER_ADAPTIVE_PORTS; i++) {
+		if (ser_ports[i] && ser_ports[i]->fd == fd) {
+			free(ser_ports[i]);
+			ser_ports[i] = NULL;
+		}
+	}
+
 	if (close(fd) != 0)
 		return -1;
 
@@ -444,6 +737,8 @@ ssize_t ser_send_buf_pace(TYPE_FD_SER fd, useconds_t d_usec, const void *buf,
 			return ret;
 		}
 
+		ser_port_sent(fd, &data[sent], (size_t)ret);
+
 		usleep(d_usec);
 	}
 
@@ -452,18 +747,21 @@ ssize_t ser_send_buf_pace(TYPE_FD_SER fd, useconds_t d_usec, const void *buf,
 
 ssize_t ser_get_char(TYPE_FD_SER fd, void *ch, time_t d_sec, useconds_t d_usec)
 {
-	/* Per standard below, we can cast here, because required ranges are
-	 * effectively the same (and signed -1 for suseconds_t), and at most long:
-	 * https://pubs.opengroup.org/onlinepubs/009604599/basedefs/sys/types.h.html
-	 */
-	return select_read(fd, ch, 1, d_sec, (suseconds_t)d_usec);
+	return ser_read(fd, ch, 1, d_sec, d_usec, 1);
 }
 
 ssize_t ser_get_buf(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec, useconds_t d_usec)
 {
+	ssize_t	ret;
+	struct timeval	start;
+
 	memset(buf, '\0', buflen);
 
-	return select_read(fd, buf, buflen, d_sec, (suseconds_t)d_usec);
+	gettimeofday(&start, NULL);
+	ret = ser_read(fd, buf, buflen, d_sec, d_usec, 1);
+	drvstats_xfer(DRVSTATS_XPORT_SERIAL, &start, ret > 0);
+
+	return ret;
 }
 
 /* keep reading until buflen bytes are received or a timeout occurs */
@@ -472,21 +770,25 @@ ssize_t ser_get_buf_len(TYPE_FD_SER fd, void *buf, size_t buflen, time_t d_sec,
 	ssize_t	ret;
 	ssize_t	recv;
 	char	*data = buf;
+	struct timeval	start;
 
 	assert(buflen < SSIZE_MAX);
 	memset(buf, '\0', buflen);
 
+	gettimeofday(&start, NULL);
 	for (recv = 0; recv < (ssize_t)buflen; recv += ret) {
 
-		ret = select_read(fd, &data[recv],
+		ret = ser_read(fd, &data[recv],
 			(size_t)((ssize_t)buflen - recv),
-			d_sec, (suseconds_t)d_usec);
+			d_sec, d_usec, 0);
 
 		if (ret < 1) {
+			drvstats_xfer(DRVSTATS_XPORT_SERIAL, &start, 0);
 			return ret;
 		}
 	}
 
+	drvstats_xfer(DRVSTATS_XPORT_SERIAL, &start, 1);
 	return recv;
 }
 
@@ -500,22 +802,28 @@ ssize_t ser_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endcha
 	char	tmp[64];
 	char	*data = buf;
 	ssize_t	count = 0, maxcount;
+	struct timeval	start;
 
 	assert(buflen < SSIZE_MAX && buflen > 0);
 	memset(buf, '\0', buflen);
 
 	maxcount = (ssize_t)buflen - 1;		/* for trailing \0 */
 
+	gettimeofday(&start, NULL);
 	while (count < maxcount) {
-		ret = select_read(fd, tmp, sizeof(tmp), d_sec, (suseconds_t)d_usec);
+		ret = ser_read(fd, tmp, sizeof(tmp), d_sec, d_usec, 0);
 
 		if (ret < 1) {
+			drvstats_xfer(DRVSTATS_XPORT_SERIAL, &start, 0);
 			return ret;
 		}
 
 		for (i = 0; i < ret; i++) {
 
 			if ((count == maxcount) || (tmp[i] == endchar)) {
+				/* keep what follows the line, if adaptive */
+				ser_unread(fd, (size_t)(ret - i - (tmp[i] == endchar)));
+				drvstats_xfer(DRVSTATS_XPORT_SERIAL, &start, 1);
 				return count;
 			}
 
@@ -533,6 +841,7 @@ ssize_t ser_get_line_alert(TYPE_FD_SER fd, void *buf, size_t buflen, char endcha
 		}
 	}
 
+	drvstats_xfer(DRVSTATS_XPORT_SERIAL, &start, 1);
 	return count;
 }
 
@@ -570,6 +879,11 @@ ssize_t ser_flush_in(TYPE_FD_SER fd, const char *ignset, int verbose)
 
 int ser_flush_io(TYPE_FD_SER fd)
 {
+	ser_port_t	*port = ser_port(fd, 0);
+
+	if (port)
+		port->start = port->end = 0;
+
 	return tcflush(fd, TCIOFLUSH);
 }
 
@@ -174,7 +174,7 @@ static const char *mibname;
 static const char *mibvers;
 
 #define DRIVER_NAME	"Generic SNMP UPS driver"
-#define DRIVER_VERSION	"1.31"
+#define DRIVER_VERSION	"1.34"
 
 /* driver description structure */
 upsdrv_info_t	upsdrv_info = {
@@ -213,8 +213,88 @@ static int device_template_offset = -1;
 /* sysOID location */
 #define SYSOID_OID	".1.3.6.1.2.1.1.2.0"
 
+/* GETBULK read-ahead of tables, used while processing templates (outlets,
+ * outlet groups, daisychained devices, ambient sensors): instead of one
+ * GET per instance, the column (parent OID) of the requested instance is
+ * walked with as few GETBULK requests as possible, and further GETs for
+ * its siblings are answered from this cache. It is emptied after each
+ * template is processed, so values are as fresh as without it.
+ * Not used with SNMPv1, and disabled if the agent seems to misbehave. */
+typedef struct {
+	oid	name[MAX_OID_LEN];
+	size_t	name_len;
+	int	complete;	/* found the end of this sub-tree */
+} snmp_bulk_tree_t;
+
+static long snmp_bulk_maxrep = DEFAULT_NETSNMP_MAXREP;	/* 0 = disabled */
+static int snmp_bulk_active = 0;
+/* cached values, sorted by their OIDs (var->name) for bsearch() */
+static netsnmp_variable_list **snmp_bulk_cache = NULL;
+static size_t snmp_bulk_count = 0, snmp_bulk_alloc = 0;
+/* walked sub-trees, only a few per template (one per table column) */
+static snmp_bulk_tree_t *snmp_bulk_trees = NULL;
+static size_t snmp_bulk_trees_count = 0, snmp_bulk_trees_alloc = 0;
+/* amount of SNMP requests, for debug reports */
+static unsigned long snmp_requests = 0;
+
+/* Binary form of the textual OIDs used in the mapping tables and of the
+ * instances of their templates, so net-snmp only parses each of them
+ * once instead of on every poll. Open-addressing hash by the OID text. */
+typedef struct {
+	char	*text;
+	oid	*name;
+	size_t	name_len;
+} su_oid_cache_t;
+
+static su_oid_cache_t *su_oid_cache = NULL;
+static size_t su_oid_cache_size = 0, su_oid_cache_count = 0;
+
+/* Binary OIDs of the selected mapping entries (snmp_info_t.oid_bin),
+ * parsed in upsdrv_initinfo(). Templates keep the positions of their
+ * "%i" components and the instances made so far (with their OID text),
+ * so that polling them costs no formatting, parsing nor look-up. */
+#define SU_OID_BIN_MAXARGS	2
+struct su_oid_bin_s {
+	oid	*name;
+	size_t	name_len;
+	/* templates: components to fill with the arguments */
+	size_t	arg_pos[SU_OID_BIN_MAXARGS];
+	size_t	arg_count;
+	struct su_oid_bin_s	**instances;
+	size_t	instances_count, instances_hint;
+	/* instances: arguments and the resulting OID text */
+	int	args[SU_OID_BIN_MAXARGS];
+	char	*text;
+	/* mapping entries: for su_oid_bin_free() */
+	snmp_info_t	*owner;
+	struct su_oid_bin_s	*next;
+};
+
+static su_oid_bin_t *su_oid_bins = NULL;
+
+/* Index of snmp_info[] entries by info_type for su_find_info(),
+ * dropped by su_select_mapping() when another table is selected
+ * and rebuilt on first use */
+static snmp_info_t **su_info_index = NULL;
+static size_t su_info_index_size = 0;
+
+/* Parsed sysOIDs of mib2nut[] entries, longest first, for match_sysoid() */
+typedef struct {
+	oid	name[MAX_OID_LEN];
+	size_t	name_len;
+	int	mib2nut_idx;
+} mib2nut_sysoid_t;
+
+static mib2nut_sysoid_t *mib2nut_sysoids = NULL;
+static size_t mib2nut_sysoids_count = 0;
+
 /* Forward functions declarations */
 static void disable_transfer_oids(void);
+static void nut_snmp_bulk_free(void);
+static void su_oid_cache_preload(void);
+static void su_oid_cache_free(void);
+static void su_oid_bin_free(void);
+static void su_select_mapping(snmp_info_t *info);
 bool_t get_and_process_data(int mode, snmp_info_t *su_info_p);
 int extract_template_number(snmp_info_flags_t template_type, const char* varname);
 snmp_info_flags_t get_template_type(const char* varname);
@@ -238,6 +318,8 @@ void upsdrv_initinfo(void)
 		upsdebugx(1, "%s: WARNING: snmp_info is empty", __func__);
 	}
 
+	su_oid_cache_preload();
+
 	/* add instant commands to the info database.
 	 * outlet (and groups) commands are processed later, during initial walk */
 	for (su_info_p = &snmp_info[0]; (su_info_p != NULL && su_info_p->info_type != NULL) ; su_info_p++)
@@ -402,6 +484,8 @@ void upsdrv_makevartable(void)
 		"Specifies the number of Net-SNMP retries to be used in the requests (default=5)");
 	addvar(VAR_VALUE, SU_VAR_TIMEOUT,
 		"Specifies the Net-SNMP timeout in seconds between retries (default=1)");
+	addvar(VAR_VALUE, SU_VAR_BULKMAXREP,
+		"Set max-repetitions of GETBULK requests for table walks, 0 to disable (default=20, not used with v1)");
 	addvar(VAR_FLAG, "notransferoids",
 		"Disable transfer OIDs (use on APCC Symmetras)");
 	addvar(VAR_FLAG, "symmetrathreephase",
@@ -839,6 +923,13 @@ void nut_snmp_init(const char *type, const char *hostname)
 	g_snmp_sess.timeout = snmp_timeout * ONE_SEC;
 	upsdebugx(2, "Setting SNMP timeout to %ld second(s)", snmp_timeout);
 
+	if (testvar(SU_VAR_BULKMAXREP)) {
+		snmp_bulk_maxrep = atol(getval(SU_VAR_BULKMAXREP));
+		if (snmp_bulk_maxrep < 0)
+			snmp_bulk_maxrep = 0;
+	}
+	upsdebugx(2, "Setting SNMP GETBULK max-repetitions to %ld", snmp_bulk_maxrep);
+
 	/* Retrieve user parameters */
 	version = testvar(SU_VAR_VERSION) ? getval(SU_VAR_VERSION) : "v1";
 
@@ -1073,6 +1164,15 @@ net-snmp/library/keytools.h:   int    generate_Ku(const oid * hashtype, u_int ha
 
 void nut_snmp_cleanup(void)
 {
+	nut_snmp_bulk_free();
+	su_oid_bin_free();
+	su_oid_cache_free();
+	su_select_mapping(NULL);
+
+	free(mib2nut_sysoids);
+	mib2nut_sysoids = NULL;
+	mib2nut_sysoids_count = 0;
+
 	/* close snmp session. */
 	if (g_snmp_sess_p) {
 		snmp_close(g_snmp_sess_p);
@@ -1098,30 +1198,292 @@ static void nut_snmp_free(struct snmp_pdu ** array_to_free)
 	}
 }
 
-/* Return a NULL terminated array of snmp_pdu * */
-static struct snmp_pdu **nut_snmp_walk(const char *OID, int max_iteration)
+/* FNV-1a hash of a string, optionally case-insensitive */
+static size_t su_strhash(const char *str, int nocase)
+{
+	uint32_t	hash = 2166136261U;
+
+	for (; *str; str++) {
+		hash ^= (unsigned char)(nocase ? tolower((unsigned char)*str) : *str);
+		hash *= 16777619U;
+	}
+
+	return (size_t)hash;
+}
+
+static su_oid_cache_t *su_oid_cache_slot(su_oid_cache_t *table, size_t size, const char *text)
+{
+	size_t	i = su_strhash(text, 0) & (size - 1);
+
+	while (table[i].text && strcmp(table[i].text, text))
+		i = (i + 1) & (size - 1);
+
+	return &table[i];
+}
+
+static void su_oid_cache_grow(void)
+{
+	su_oid_cache_t	*old = su_oid_cache;
+	size_t	old_size = su_oid_cache_size, i;
+
+	su_oid_cache_size = old_size ? old_size * 2 : 256;
+	su_oid_cache = xcalloc(su_oid_cache_size, sizeof(su_oid_cache_t));
+
+	for (i = 0; i < old_size; i++) {
+		if (old[i].text)
+			*su_oid_cache_slot(su_oid_cache, su_oid_cache_size, old[i].text) = old[i];
+	}
+
+	free(old);
+}
+
+static void su_oid_cache_free(void)
+{
+	size_t	i;
+
+	for (i = 0; i < su_oid_cache_size; i++) {
+		free(su_oid_cache[i].text);
+		free(su_oid_cache[i].name);
+	}
+
+	free(su_oid_cache);
+	su_oid_cache = NULL;
+	su_oid_cache_size = su_oid_cache_count = 0;
+}
+
+/* Same as snmp_parse_oid(), but only asks net-snmp once per OID text */
+static int su_parse_oid(const char *OID, oid *name, size_t *name_len)
+{
+	su_oid_cache_t	*entry;
+
+	if (su_oid_cache_size) {
+		entry = su_oid_cache_slot(su_oid_cache, su_oid_cache_size, OID);
+		if (entry->text) {
+			if (entry->name_len > *name_len)
+				return 0;
+			memcpy(name, entry->name, entry->name_len * sizeof(oid));
+			*name_len = entry->name_len;
+			return 1;
+		}
+	}
+
+	if (!snmp_parse_oid(OID, name, name_len) || *name_len < 1)
+		return 0;
+
+	/* Keep the load factor under 1/2 */
+	if (2 * (su_oid_cache_count + 1) > su_oid_cache_size)
+		su_oid_cache_grow();
+
+	entry = su_oid_cache_slot(su_oid_cache, su_oid_cache_size, OID);
+	entry->text = xstrdup(OID);
+	entry->name = xcalloc(*name_len, sizeof(oid));
+	memcpy(entry->name, name, *name_len * sizeof(oid));
+	entry->name_len = *name_len;
+	su_oid_cache_count++;
+
+	return 1;
+}
+
+/* Parse a template OID made of numbers and "%i" (or "%d") components;
+ * returns NULL for anything else (e.g. symbolic names) */
+static su_oid_bin_t *su_oid_bin_parse_template(const char *OID)
+{
+	oid	name[MAX_OID_LEN];
+	size_t	name_len = 0, arg_pos[SU_OID_BIN_MAXARGS], arg_count = 0;
+	const char	*p = OID;
+	su_oid_bin_t	*bin;
+
+	if (*p == '.')
+		p++;
+
+	while (*p) {
+		if (name_len == MAX_OID_LEN)
+			return NULL;
+
+		if (p[0] == '%' && (p[1] == 'i' || p[1] == 'd')) {
+			if (arg_count == SU_OID_BIN_MAXARGS)
+				return NULL;
+			arg_pos[arg_count++] = name_len;
+			name[name_len++] = 0;
+			p += 2;
+		} else if (isdigit((unsigned char)*p)) {
+			char	*end;
+
+			name[name_len++] = (oid)strtoul(p, &end, 10);
+			p = end;
+		} else {
+			return NULL;
+		}
+
+		if (*p == '.') {
+			if (*(++p) == '\0')
+				return NULL;
+		} else if (*p != '\0') {
+			return NULL;
+		}
+	}
+
+	if (arg_count == 0)
+		return NULL;
+
+	bin = xcalloc(1, sizeof(su_oid_bin_t));
+	bin->name = xcalloc(name_len, sizeof(oid));
+	memcpy(bin->name, name, name_len * sizeof(oid));
+	bin->name_len = name_len;
+	memcpy(bin->arg_pos, arg_pos, arg_count * sizeof(size_t));
+	bin->arg_count = arg_count;
+
+	return bin;
+}
+
+static void su_oid_bin_free(void)
+{
+	su_oid_bin_t	*bin;
+	size_t	i;
+
+	while ((bin = su_oid_bins) != NULL) {
+		su_oid_bins = bin->next;
+
+		for (i = 0; i < bin->instances_count; i++) {
+			free(bin->instances[i]->name);
+			free(bin->instances[i]->text);
+			free(bin->instances[i]);
+		}
+		free(bin->instances);
+
+		if (bin->owner)
+			bin->owner->oid_bin = NULL;
+		free(bin->name);
+		free(bin);
+	}
+}
+
+/* Parse the OIDs (and templates) of the selected mapping at once */
+static void su_oid_cache_preload(void)
+{
+	snmp_info_t	*su_info_p;
+	oid	name[MAX_OID_LEN];
+	size_t	name_len, templates = 0;
+
+	su_oid_bin_free();
+
+	for (su_info_p = &snmp_info[0]; su_info_p->info_type != NULL; su_info_p++) {
+		su_oid_bin_t	*bin = NULL;
+
+		if (su_info_p->OID == NULL)
+			continue;
+
+		if (strchr(su_info_p->OID, '%')) {
+			if ((bin = su_oid_bin_parse_template(su_info_p->OID)) == NULL) {
+				upsdebugx(2, "%s: can't pre-parse OID template %s for %s",
+					__func__, su_info_p->OID, su_info_p->info_type);
+				continue;
+			}
+			templates++;
+		} else {
+			name_len = MAX_OID_LEN;
+			if (!su_parse_oid(su_info_p->OID, name, &name_len)) {
+				upsdebugx(2, "%s: can't parse OID %s for %s", __func__,
+					su_info_p->OID, su_info_p->info_type);
+				continue;
+			}
+			bin = xcalloc(1, sizeof(su_oid_bin_t));
+			bin->name = xcalloc(name_len, sizeof(oid));
+			memcpy(bin->name, name, name_len * sizeof(oid));
+			bin->name_len = name_len;
+		}
+
+		bin->owner = su_info_p;
+		bin->next = su_oid_bins;
+		su_oid_bins = bin;
+		su_info_p->oid_bin = bin;
+	}
+
+	upsdebugx(2, "%s: %" PRIuSIZE " OIDs and %" PRIuSIZE " templates parsed",
+		__func__, su_oid_cache_count, templates);
+}
+
+/* The instance of the OID template of <su_info_p> for the given "%i"
+ * arguments: made (and its text formatted) on first use, then reused
+ * on each poll. Returns NULL if the template was not pre-parsed. */
+static su_oid_bin_t *su_oid_bin_instance(const snmp_info_t *su_info_p, int arg1, int arg2)
+{
+	su_oid_bin_t	*tmpl = su_info_p->oid_bin, *inst;
+	int	args[SU_OID_BIN_MAXARGS];
+	char	text[SU_INFOSIZE];
+	size_t	i, k;
+
+	if (tmpl == NULL || tmpl->arg_count == 0)
+		return NULL;
+
+	args[0] = arg1;
+	args[1] = arg2;
+	for (k = 0; k < tmpl->arg_count; k++) {
+		if (args[k] < 0)
+			return NULL;
+	}
+
+	/* Instances are mostly requested in the same order on each poll */
+	for (i = 0; i < tmpl->instances_count; i++) {
+		size_t	idx = (tmpl->instances_hint + i) % tmpl->instances_count;
+
+		inst = tmpl->instances[idx];
+		for (k = 0; k < tmpl->arg_count && inst->args[k] == args[k]; k++);
+		if (k == tmpl->arg_count) {
+			tmpl->instances_hint = idx + 1;
+			return inst;
+		}
+	}
+
+	inst = xcalloc(1, sizeof(su_oid_bin_t));
+	inst->name = xcalloc(tmpl->name_len, sizeof(oid));
+	memcpy(inst->name, tmpl->name, tmpl->name_len * sizeof(oid));
+	inst->name_len = tmpl->name_len;
+	for (k = 0; k < tmpl->arg_count; k++) {
+		inst->args[k] = args[k];
+		inst->name[tmpl->arg_pos[k]] = (oid)args[k];
+	}
+
+#ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic push
+#endif
+#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+#ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_SECURITY
+#pragma GCC diagnostic ignored "-Wformat-security"
+#endif
+	snprintf(text, sizeof(text), su_info_p->OID, arg1, arg2);
+#ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
+#pragma GCC diagnostic pop
+#endif
+	inst->text = xstrdup(text);
+
+	tmpl->instances = xrealloc(tmpl->instances,
+		(tmpl->instances_count + 1) * sizeof(su_oid_bin_t *));
+	tmpl->instances[tmpl->instances_count++] = inst;
+	tmpl->instances_hint = tmpl->instances_count;
+
+	upsdebugx(4, "%s: %s instantiated as %s", __func__, su_info_p->OID, inst->text);
+
+	return inst;
+}
+
+/* Same as nut_snmp_walk() for an already parsed OID (<name>) */
+static struct snmp_pdu **nut_snmp_walk_parsed(const char *OID, const oid *name, size_t name_len, int max_iteration)
 {
 	int status;
 	struct snmp_pdu *pdu, *response = NULL;
-	oid name[MAX_OID_LEN];
-	size_t name_len = MAX_OID_LEN;
-	oid * current_name;
+	const oid * current_name;
 	size_t current_name_len;
 	static unsigned int numerr = 0;
 	int nb_iteration = 0;
 	struct snmp_pdu ** ret_array = NULL;
 	int type = SNMP_MSG_GET;
+	struct timeval start;
 
-	upsdebugx(3, "%s(%s)", __func__, OID);
 	upsdebugx(4, "%s: max. iteration = %i", __func__, max_iteration);
 
-	/* create and send request. */
-	if (!snmp_parse_oid(OID, name, &name_len)) {
-		upsdebugx(2, "[%s] %s: %s: %s",
-			upsname?upsname:device_name, __func__, OID, snmp_api_errstring(snmp_errno));
-		return NULL;
-	}
-
 	current_name = name;
 	current_name_len = name_len;
 
@@ -1141,7 +1503,12 @@ static struct snmp_pdu **nut_snmp_walk(const char *OID, int max_iteration)
 
 		snmp_add_null_var(pdu, current_name, current_name_len);
 
+		gettimeofday(&start, NULL);
+		snmp_requests++;
 		status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
+		drvstats_xfer(DRVSTATS_XPORT_SNMP, &start,
+			(status == STAT_SUCCESS && response
+			 && response->errstat == SNMP_ERR_NOERROR));
 
 		if (!response) {
 			break;
@@ -1232,17 +1599,291 @@ static struct snmp_pdu **nut_snmp_walk(const char *OID, int max_iteration)
 	return ret_array;
 }
 
-struct snmp_pdu *nut_snmp_get(const char *OID)
+/* Return a NULL terminated array of snmp_pdu * */
+static struct snmp_pdu **nut_snmp_walk(const char *OID, int max_iteration)
 {
-	struct snmp_pdu ** pdu_array;
-	struct snmp_pdu * ret_pdu;
+	oid name[MAX_OID_LEN];
+	size_t name_len = MAX_OID_LEN;
 
-	if (OID == NULL)
+	upsdebugx(3, "%s(%s)", __func__, OID);
+
+	if (!su_parse_oid(OID, name, &name_len)) {
+		upsdebugx(2, "[%s] %s: %s: %s",
+			upsname?upsname:device_name, __func__, OID, snmp_api_errstring(snmp_errno));
 		return NULL;
+	}
 
-	upsdebugx(3, "%s(%s)", __func__, OID);
+	return nut_snmp_walk_parsed(OID, name, name_len, max_iteration);
+}
+
+static void nut_snmp_bulk_free(void)
+{
+	size_t	i;
+
+	for (i = 0; i < snmp_bulk_count; i++)
+		snmp_free_varbind(snmp_bulk_cache[i]);
+
+	free(snmp_bulk_cache);
+	snmp_bulk_cache = NULL;
+	snmp_bulk_count = snmp_bulk_alloc = 0;
+
+	free(snmp_bulk_trees);
+	snmp_bulk_trees = NULL;
+	snmp_bulk_trees_count = snmp_bulk_trees_alloc = 0;
+}
+
+/* Find the cached value of OID <name> (binary search) */
+static netsnmp_variable_list *nut_snmp_bulk_find(const oid *name, size_t name_len)
+{
+	size_t	lo = 0, hi = snmp_bulk_count;
+
+	while (lo < hi) {
+		size_t	mid = lo + (hi - lo) / 2;
+		netsnmp_variable_list	*var = snmp_bulk_cache[mid];
+		int	cmp = snmp_oid_compare(var->name, var->name_length, name, name_len);
+
+		if (cmp == 0)
+			return var;
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+/* Merge <count> values, sorted by OID as a walk returns them, into the
+ * cache (which takes them over); duplicates of cached values are freed */
+static void nut_snmp_bulk_merge(netsnmp_variable_list **vars, size_t count)
+{
+	netsnmp_variable_list	**merged;
+	size_t	i = 0, j = 0, n = 0;
+
+	if (count == 0)
+		return;
+
+	if (snmp_bulk_count + count > snmp_bulk_alloc) {
+		snmp_bulk_alloc = snmp_bulk_count + count;
+		if (snmp_bulk_alloc < 64)
+			snmp_bulk_alloc = 64;
+	}
+	merged = xcalloc(snmp_bulk_alloc, sizeof(netsnmp_variable_list *));
+
+	while (i < snmp_bulk_count || j < count) {
+		int	cmp;
+
+		if (i == snmp_bulk_count)
+			cmp = 1;
+		else if (j == count)
+			cmp = -1;
+		else
+			cmp = snmp_oid_compare(snmp_bulk_cache[i]->name, snmp_bulk_cache[i]->name_length,
+				vars[j]->name, vars[j]->name_length);
+
+		if (cmp < 0) {
+			merged[n++] = snmp_bulk_cache[i++];
+		} else if (cmp > 0) {
+			merged[n++] = vars[j++];
+		} else {
+			/* Seen by an overlapping walk already */
+			merged[n++] = snmp_bulk_cache[i++];
+			snmp_free_varbind(vars[j++]);
+		}
+	}
+
+	free(snmp_bulk_cache);
+	snmp_bulk_cache = merged;
+	snmp_bulk_count = n;
+}
+
+static snmp_bulk_tree_t *nut_snmp_bulk_add_tree(const oid *prefix, size_t prefix_len)
+{
+	snmp_bulk_tree_t	*tree;
+
+	if (snmp_bulk_trees_count == snmp_bulk_trees_alloc) {
+		snmp_bulk_trees_alloc = snmp_bulk_trees_alloc ? snmp_bulk_trees_alloc * 2 : 8;
+		snmp_bulk_trees = xrealloc(snmp_bulk_trees,
+			snmp_bulk_trees_alloc * sizeof(snmp_bulk_tree_t));
+	}
+
+	tree = &snmp_bulk_trees[snmp_bulk_trees_count++];
+	memset(tree, 0, sizeof(*tree));
+	memcpy(tree->name, prefix, prefix_len * sizeof(oid));
+	tree->name_len = prefix_len;
+
+	return tree;
+}
+
+/* Walk the sub-tree at <prefix> with GETBULK requests and cache the
+ * values. Returns 0 if the walk could not be done at all. */
+static int nut_snmp_bulk_walk(const oid *prefix, size_t prefix_len)
+{
+	oid	current[MAX_OID_LEN];
+	size_t	current_len = prefix_len, nb_items = 0;
+	size_t	tree_idx = snmp_bulk_trees_count;
+	netsnmp_variable_list	**vars;
+	struct timeval	start;
+	int	complete = 0;
+
+	memcpy(current, prefix, prefix_len * sizeof(oid));
+	nut_snmp_bulk_add_tree(prefix, prefix_len);
+	vars = xcalloc(SU_BULK_MAXITEMS, sizeof(netsnmp_variable_list *));
+
+	while (nb_items < SU_BULK_MAXITEMS) {
+		struct snmp_pdu	*pdu, *response = NULL;
+		netsnmp_variable_list	*vp;
+		int	status, done = 0;
+
+		pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
+		if (pdu == NULL) {
+			fatalx(EXIT_FAILURE, "Not enough memory");
+		}
+		pdu->non_repeaters = 0;
+		pdu->max_repetitions = snmp_bulk_maxrep;
+		snmp_add_null_var(pdu, current, current_len);
+
+		gettimeofday(&start, NULL);
+		snmp_requests++;
+		status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
+		drvstats_xfer(DRVSTATS_XPORT_SNMP, &start,
+			(status == STAT_SUCCESS && response
+			 && response->errstat == SNMP_ERR_NOERROR));
+
+		if (status != STAT_SUCCESS || !response
+		 || response->errstat != SNMP_ERR_NOERROR
+		 || !response->variables
+		) {
+			if (status == STAT_SUCCESS) {
+				/* The agent answered but did not like it */
+				upslogx(LOG_WARNING, "[%s] GETBULK request failed, "
+					"falling back to GETNEXT for table walks",
+					upsname?upsname:device_name);
+				snmp_bulk_maxrep = 0;
+			}
+			if (response)
+				snmp_free_pdu(response);
+			break;
+		}
+
+		for (vp = response->variables; vp && nb_items < SU_BULK_MAXITEMS; vp = vp->next_variable) {
+			netsnmp_variable_list	*next;
+
+			if (vp->type == SNMP_ENDOFMIBVIEW
+			 || vp->name_length < prefix_len
+			 || snmp_oid_compare(vp->name, prefix_len, prefix, prefix_len) != 0
+			) {
+				/* Out of our sub-tree: all seen */
+				complete = 1;
+				done = 1;
+				break;
+			}
+
+			if (snmp_oid_compare(vp->name, vp->name_length, current, current_len) <= 0) {
+				upslogx(LOG_WARNING, "[%s] GETBULK response is not "
+					"increasing, falling back to GETNEXT for table walks",
+					upsname?upsname:device_name);
+				snmp_bulk_maxrep = 0;
+				done = 1;
+				break;
+			}
+
+			memcpy(current, vp->name, vp->name_length * sizeof(oid));
+			current_len = vp->name_length;
+
+			if (vp->type == SNMP_NOSUCHOBJECT
+			 || vp->type == SNMP_NOSUCHINSTANCE
+			) {
+				continue;
+			}
+
+			/* Clone just this one variable into the cache */
+			next = vp->next_variable;
+			vp->next_variable = NULL;
+			vars[nb_items++] = snmp_clone_varbind(vp);
+			vp->next_variable = next;
+		}
+
+		snmp_free_pdu(response);
+
+		if (done)
+			break;
+	}
+
+	/* Values come in increasing OID order, as checked above */
+	nut_snmp_bulk_merge(vars, nb_items);
+	free(vars);
+	snmp_bulk_trees[tree_idx].complete = complete;
+
+	upsdebugx(4, "%s: cached %" PRIuSIZE " values (%s)", __func__, nb_items,
+		complete ? "complete" : "incomplete");
+
+	return (nb_items > 0 || complete);
+}
+
+/* Try to answer a GET of OID <name> from the GETBULK read-ahead cache,
+ * walking its parent if not done yet. Returns 1 if answered (with
+ * *ret_pdu NULL if the OID is known to not exist), or 0 if a GET is
+ * needed. */
+static int nut_snmp_bulk_get(const oid *name, size_t name_len, struct snmp_pdu **ret_pdu)
+{
+	*ret_pdu = NULL;
 
-	pdu_array = nut_snmp_walk(OID,1);
+	if (!snmp_bulk_active || snmp_bulk_maxrep < 1
+	 || g_snmp_sess_p == NULL || g_snmp_sess_p->version == SNMP_VERSION_1
+	 || name_len < 2
+	)
+		return 0;
+
+	while (1) {
+		netsnmp_variable_list	*var;
+		int	in_complete_tree = 0, parent_walked = 0;
+		size_t	i;
+
+		if ((var = nut_snmp_bulk_find(name, name_len)) != NULL) {
+			*ret_pdu = snmp_pdu_create(SNMP_MSG_RESPONSE);
+			if (*ret_pdu == NULL) {
+				fatalx(EXIT_FAILURE, "Not enough memory");
+			}
+			(*ret_pdu)->variables = snmp_clone_varbind(var);
+			upsdebugx(4, "%s: found in cache", __func__);
+			return 1;
+		}
+
+		for (i = 0; i < snmp_bulk_trees_count; i++) {
+			snmp_bulk_tree_t	*tree = &snmp_bulk_trees[i];
+
+			if (tree->name_len < name_len
+			 && !snmp_oid_compare(tree->name, tree->name_len, name, tree->name_len)
+			) {
+				if (tree->complete)
+					in_complete_tree = 1;
+				if (tree->name_len == name_len - 1)
+					parent_walked = 1;
+			}
+		}
+
+		if (in_complete_tree) {
+			upsdebugx(4, "%s: does not exist", __func__);
+			return 1;
+		}
+
+		/* Not known: walk the parent, unless tried already */
+		if (parent_walked || !nut_snmp_bulk_walk(name, name_len - 1))
+			return 0;
+	}
+}
+
+/* Same as nut_snmp_get() for an already parsed OID (<name>) */
+static struct snmp_pdu *nut_snmp_get_parsed(const char *OID, const oid *name, size_t name_len)
+{
+	struct snmp_pdu ** pdu_array;
+	struct snmp_pdu * ret_pdu;
+
+	if (snmp_bulk_active && nut_snmp_bulk_get(name, name_len, &ret_pdu))
+		return ret_pdu;
+
+	pdu_array = nut_snmp_walk_parsed(OID, name, name_len, 1);
 
 	if(pdu_array == NULL) {
 		return NULL;
@@ -1255,6 +1896,40 @@ struct snmp_pdu *nut_snmp_get(const char *OID)
 	return ret_pdu;
 }
 
+struct snmp_pdu *nut_snmp_get(const char *OID)
+{
+	oid name[MAX_OID_LEN];
+	size_t name_len = MAX_OID_LEN;
+
+	if (OID == NULL)
+		return NULL;
+
+	upsdebugx(3, "%s(%s)", __func__, OID);
+
+	/* Parsed once, for both the cache look-up and the request */
+	if (!su_parse_oid(OID, name, &name_len)) {
+		upsdebugx(2, "[%s] %s: %s: %s",
+			upsname?upsname:device_name, __func__, OID, snmp_api_errstring(snmp_errno));
+		return NULL;
+	}
+
+	return nut_snmp_get_parsed(OID, name, name_len);
+}
+
+/* Get the value of a mapping entry (or template instance), using
+ * its pre-parsed OID if any */
+static struct snmp_pdu *su_info_get(const snmp_info_t *su_info_p)
+{
+	const su_oid_bin_t	*bin = su_info_p->oid_bin;
+
+	if (bin == NULL || bin->arg_count > 0 || su_info_p->OID == NULL)
+		return nut_snmp_get(su_info_p->OID);
+
+	upsdebugx(3, "%s(%s)", __func__, su_info_p->OID);
+
+	return nut_snmp_get_parsed(su_info_p->OID, bin->name, bin->name_len);
+}
+
 static bool_t decode_str(struct snmp_pdu *pdu, char *buf, size_t buf_len, info_lkp_t *oid2info)
 {
 	size_t len = 0;
@@ -1343,14 +2018,11 @@ static bool_t decode_str(struct snmp_pdu *pdu, char *buf, size_t buf_len, info_l
 	return TRUE;
 }
 
-bool_t nut_snmp_get_str(const char *OID, char *buf, size_t buf_len, info_lkp_t *oid2info)
+/* Decode (and free) a response to a GET of OID as a string */
+static bool_t pdu_get_str(struct snmp_pdu *pdu, const char *OID, char *buf, size_t buf_len, info_lkp_t *oid2info)
 {
-	struct snmp_pdu *pdu;
 	bool_t ret;
 
-	upsdebugx(3, "Entering %s()", __func__);
-
-	pdu = nut_snmp_get(OID);
 	if (pdu == NULL)
 		return FALSE;
 
@@ -1366,6 +2038,18 @@ bool_t nut_snmp_get_str(const char *OID, char *buf, size_t buf_len, info_lkp_t *
 	return ret;
 }
 
+bool_t nut_snmp_get_str(const char *OID, char *buf, size_t buf_len, info_lkp_t *oid2info)
+{
+	upsdebugx(3, "Entering %s()", __func__);
+
+	return pdu_get_str(nut_snmp_get(OID), OID, buf, buf_len, oid2info);
+}
+
+static bool_t su_info_get_str(const snmp_info_t *su_info_p, char *buf, size_t buf_len, info_lkp_t *oid2info)
+{
+	return pdu_get_str(su_info_get(su_info_p), su_info_p->OID, buf, buf_len, oid2info);
+}
+
 
 static bool_t decode_oid(struct snmp_pdu *pdu, char *buf, size_t buf_len)
 {
@@ -1414,16 +2098,13 @@ bool_t nut_snmp_get_oid(const char *OID, char *buf, size_t buf_len)
 	return ret;
 }
 
-bool_t nut_snmp_get_int(const char *OID, long *pval)
+/* Decode (and free) a response to a GET of OID as a number */
+static bool_t pdu_get_int(struct snmp_pdu *pdu, const char *OID, long *pval)
 {
 	char tmp_buf[SU_LARGEBUF];
-	struct snmp_pdu *pdu;
 	long value;
 	char *buf;
 
-	upsdebugx(3, "Entering %s()", __func__);
-
-	pdu = nut_snmp_get(OID);
 	if (pdu == NULL)
 		return FALSE;
 
@@ -1466,10 +2147,22 @@ bool_t nut_snmp_get_int(const char *OID, long *pval)
 
 	snmp_free_pdu(pdu);
 
-	if (pval != NULL)
-		*pval = value;
+	if (pval != NULL)
+		*pval = value;
+
+	return TRUE;
+}
+
+bool_t nut_snmp_get_int(const char *OID, long *pval)
+{
+	upsdebugx(3, "Entering %s()", __func__);
+
+	return pdu_get_int(nut_snmp_get(OID), OID, pval);
+}
 
-	return TRUE;
+static bool_t su_info_get_int(const snmp_info_t *su_info_p, long *pval)
+{
+	return pdu_get_int(su_info_get(su_info_p), su_info_p->OID, pval);
 }
 
 bool_t nut_snmp_set(const char *OID, char type, const char *value)
@@ -1479,10 +2172,11 @@ bool_t nut_snmp_set(const char *OID, char type, const char *value)
 	struct snmp_pdu *pdu, *response = NULL;
 	oid name[MAX_OID_LEN];
 	size_t name_len = MAX_OID_LEN;
+	struct timeval start;
 
 	upsdebugx(1, "entering %s(%s, %c, %s)", __func__, OID, type, value);
 
-	if (!snmp_parse_oid(OID, name, &name_len)) {
+	if (!su_parse_oid(OID, name, &name_len)) {
 		upslogx(LOG_ERR, "[%s] %s: %s: %s",
 			upsname?upsname:device_name, __func__, OID, snmp_api_errstring(snmp_errno));
 		return FALSE;
@@ -1499,8 +2193,13 @@ bool_t nut_snmp_set(const char *OID, char type, const char *value)
 		return FALSE;
 	}
 
+	gettimeofday(&start, NULL);
 	status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
 
+	drvstats_xfer(DRVSTATS_XPORT_SNMP, &start,
+		(status == STAT_SUCCESS && response
+		 && response->errstat == SNMP_ERR_NOERROR));
+
 	if ((status == STAT_SUCCESS) && (response->errstat == SNMP_ERR_NOERROR))
 		ret = TRUE;
 	else
@@ -1824,10 +2523,53 @@ void su_alarm_set(snmp_info_t *su_info_p, long value)
 	/* TODO: else */
 }
 
+/* Select the snmp_info[] table in use (or none), dropping the info_type
+ * index of the previous one: it is rebuilt by su_find_info() when needed.
+ * All changes of snmp_info must go through here, as a new table may well
+ * be allocated where an old one was freed. */
+static void su_select_mapping(snmp_info_t *info)
+{
+	snmp_info = info;
+	free(su_info_index);
+	su_info_index = NULL;
+	su_info_index_size = 0;
+}
+
+/* (re)build the info_type index of the current snmp_info[] */
+static void su_info_index_build(void)
+{
+	snmp_info_t	*su_info_p;
+	size_t	count = 0, i;
+
+	for (su_info_p = &snmp_info[0]; su_info_p->info_type != NULL; su_info_p++)
+		count++;
+
+	free(su_info_index);
+	for (su_info_index_size = 16; su_info_index_size < 2 * count; )
+		su_info_index_size *= 2;
+	su_info_index = xcalloc(su_info_index_size, sizeof(snmp_info_t *));
+
+	for (su_info_p = &snmp_info[0]; su_info_p->info_type != NULL; su_info_p++) {
+		i = su_strhash(su_info_p->info_type, 1) & (su_info_index_size - 1);
+		while (su_info_index[i]
+		 && strcasecmp(su_info_index[i]->info_type, su_info_p->info_type)
+		) {
+			i = (i + 1) & (su_info_index_size - 1);
+		}
+
+		/* Keep the first entry of duplicates, as a linear search would */
+		if (su_info_index[i] == NULL)
+			su_info_index[i] = su_info_p;
+	}
+
+	upsdebugx(3, "%s: %" PRIuSIZE " entries indexed", __func__, count);
+}
+
 /* find info element definition in my info array. */
 snmp_info_t *su_find_info(const char *type)
 {
 	snmp_info_t *su_info_p;
+	size_t	i;
 
 	if (snmp_info == NULL) {
 		fatalx(EXIT_FAILURE, "%s: snmp_info is not initialized", __func__);
@@ -1837,41 +2579,48 @@ snmp_info_t *su_find_info(const char *type)
 		upsdebugx(1, "%s: WARNING: snmp_info is empty", __func__);
 	}
 
-	for (su_info_p = &snmp_info[0]; (su_info_p != NULL && su_info_p->info_type != NULL) ; su_info_p++)
+	if (su_info_index == NULL)
+		su_info_index_build();
+
+	i = su_strhash(type, 1) & (su_info_index_size - 1);
+	while ((su_info_p = su_info_index[i]) != NULL) {
 		if (!strcasecmp(su_info_p->info_type, type)) {
 			upsdebugx(3, "%s: \"%s\" found", __func__, type);
 			return su_info_p;
 		}
+		i = (i + 1) & (su_info_index_size - 1);
+	}
 
 	upsdebugx(3, "%s: unknown info type (%s)", __func__, type);
 	return NULL;
 }
 
-/* Counter match the sysOID using {device,ups}.model OID
- * Return TRUE if this OID can be retrieved, FALSE otherwise */
-static bool_t match_model_OID(void)
+/* Get the {device,ups}.model OID of a mapping table, instantiated for
+ * the daisychain master (0) / 1rst device if it is a template.
+ * Return TRUE if there is such an OID, FALSE otherwise */
+static bool_t get_model_OID(const snmp_info_t *info, char *buf, size_t buf_len)
 {
-	bool_t retCode = FALSE;
-	snmp_info_t *su_info_p, *cur_info_p;
-	char testOID_buf[LARGEBUF];
+	static const char	*model_types[] = { "device.model", "ups.model", NULL };
+	const snmp_info_t	*su_info_p = NULL;
+	int	i;
 
-	/* Try to get device.model first */
-	su_info_p = su_find_info("device.model");
-	/* Otherwise, try to get ups.model */
-	if (su_info_p == NULL)
-		su_info_p = su_find_info("ups.model");
+	/* Try to get device.model first, otherwise ups.model */
+	for (i = 0; model_types[i] != NULL && su_info_p == NULL; i++) {
+		for (su_info_p = info; su_info_p->info_type != NULL; su_info_p++) {
+			if (!strcasecmp(su_info_p->info_type, model_types[i]))
+				break;
+		}
+		if (su_info_p->info_type == NULL)
+			su_info_p = NULL;
+	}
 
-	if (su_info_p != NULL) {
-		/* Daisychain specific: we may have a template (including formatting
-		 * string) that needs to be adapted! */
-		if (strchr(su_info_p->OID, '%') != NULL)
-		{
-			upsdebugx(2, "Found template, need to be adapted");
-			cur_info_p = (snmp_info_t *)malloc(sizeof(snmp_info_t));
-			cur_info_p->info_type = (char *)xmalloc(SU_INFOSIZE);
-			cur_info_p->OID = (char *)xmalloc(SU_INFOSIZE);
-			snprintf((char*)cur_info_p->info_type, SU_INFOSIZE, "%s", su_info_p->info_type);
-			/* Use the daisychain master (0) / 1rst device index */
+	if (su_info_p == NULL || su_info_p->OID == NULL)
+		return FALSE;
+
+	/* Daisychain specific: we may have a template (including formatting
+	 * string) that needs to be adapted! */
+	if (strchr(su_info_p->OID, '%') != NULL) {
+		upsdebugx(2, "Found template, need to be adapted");
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
 #pragma GCC diagnostic push
 #endif
@@ -1881,56 +2630,104 @@ static bool_t match_model_OID(void)
 #ifdef HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_FORMAT_SECURITY
 #pragma GCC diagnostic ignored "-Wformat-security"
 #endif
-			snprintf((char*)cur_info_p->OID, SU_INFOSIZE, su_info_p->OID, 0);
+		snprintf(buf, buf_len, su_info_p->OID, 0);
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
 #pragma GCC diagnostic pop
 #endif
-		}
-		else {
-			upsdebugx(2, "Found entry, not a template %s", su_info_p->OID);
-			/* Otherwise, just point at what we found */
-			cur_info_p = su_info_p;
-		}
+	}
+	else {
+		snprintf(buf, buf_len, "%s", su_info_p->OID);
+	}
 
-		upsdebugx(2, "Testing %s using OID %s", cur_info_p->info_type, cur_info_p->OID);
-		retCode = nut_snmp_get_str(cur_info_p->OID, testOID_buf, LARGEBUF, NULL);
+	upsdebugx(2, "%s: using %s OID %s", __func__, su_info_p->info_type, buf);
+	return TRUE;
+}
 
-		/* Free our malloc, if it was dynamic */
-		if (strchr(su_info_p->OID, '%') != NULL) {
-			if (cur_info_p->info_type != NULL)
-				free((char*)cur_info_p->info_type);
-			if (cur_info_p->OID != NULL)
-				free((char*)cur_info_p->OID);
-			if (cur_info_p != NULL)
-				free((char*)cur_info_p);
+/* Counter match the sysOID using {device,ups}.model OID
+ * Return TRUE if this OID can be retrieved, FALSE otherwise */
+static bool_t match_model_OID(void)
+{
+	char testOID[SU_INFOSIZE];
+	char testOID_buf[LARGEBUF];
+
+	if (get_model_OID(snmp_info, testOID, sizeof(testOID)) != TRUE)
+		return FALSE;
+
+	return nut_snmp_get_str(testOID, testOID_buf, LARGEBUF, NULL);
+}
+
+static int mib2nut_sysoid_cmp(const void *a, const void *b)
+{
+	const mib2nut_sysoid_t	*x = a, *y = b;
+
+	/* Longest first, and in mib2nut[] order for the same length */
+	if (x->name_len != y->name_len)
+		return (x->name_len < y->name_len) ? 1 : -1;
+
+	return (x->mib2nut_idx > y->mib2nut_idx) - (x->mib2nut_idx < y->mib2nut_idx);
+}
+
+/* Parse the sysOIDs of all mib2nut[] entries once */
+static void mib2nut_sysoid_index_build(void)
+{
+	int	i;
+
+	if (mib2nut_sysoids != NULL)
+		return;
+
+	for (i = 0; mib2nut[i] != NULL; i++)
+		;
+	mib2nut_sysoids = xcalloc((size_t)i + 1, sizeof(mib2nut_sysoid_t));
+
+	for (i = 0; mib2nut[i] != NULL; i++) {
+		mib2nut_sysoid_t	*entry = &mib2nut_sysoids[mib2nut_sysoids_count];
+
+		if (mib2nut[i]->sysOID == NULL)
+			continue;
+
+		entry->name_len = MAX_OID_LEN;
+		if (!read_objid(mib2nut[i]->sysOID, entry->name, &entry->name_len)) {
+			upsdebugx(2, "%s: can't build OID %s: %s",
+				__func__, mib2nut[i]->sysOID, snmp_api_errstring(snmp_errno));
+			continue;
 		}
+
+		entry->mib2nut_idx = i;
+		mib2nut_sysoids_count++;
 	}
 
-	return retCode;
+	qsort(mib2nut_sysoids, mib2nut_sysoids_count, sizeof(mib2nut_sysoid_t),
+		mib2nut_sysoid_cmp);
+
+	upsdebugx(2, "%s: %" PRIuSIZE " sysOIDs indexed", __func__, mib2nut_sysoids_count);
 }
 
-/* Try to find the MIB using sysOID matching.
- * Return a pointer to a mib2nut definition if found, NULL otherwise */
-static mib2nut_info_t *match_sysoid(void)
+/* Retrieve sysOID value of this device */
+static bool_t get_device_sysoid(char *buf, size_t buf_len)
 {
-	char sysOID_buf[LARGEBUF];
-	oid device_sysOID[MAX_OID_LEN];
-	size_t device_sysOID_len = MAX_OID_LEN;
-	oid mib2nut_sysOID[MAX_OID_LEN];
-	size_t mib2nut_sysOID_len = MAX_OID_LEN;
-	int i;
-
-	/* Retrieve sysOID value of this device */
-	if (nut_snmp_get_oid(SYSOID_OID, sysOID_buf, sizeof(sysOID_buf)) != TRUE)
+	if (nut_snmp_get_oid(SYSOID_OID, buf, buf_len) != TRUE)
 	{
 		upsdebugx(2, "Can't get sysOID value (using nut_snmp_get_oid())");
 		/* Fallback for non-compliant device, that returns a string and not an OID */
-		if (nut_snmp_get_str(SYSOID_OID, sysOID_buf, sizeof(sysOID_buf), NULL) != TRUE) {
+		if (nut_snmp_get_str(SYSOID_OID, buf, buf_len, NULL) != TRUE) {
 			upsdebugx(2, "Can't get sysOID value (using nut_snmp_get_str())");
-			return NULL;
+			return FALSE;
 		}
 	}
 
+	return TRUE;
+}
+
+static mib2nut_info_t *match_sysoid(void)
+{
+	char sysOID_buf[LARGEBUF];
+	oid device_sysOID[MAX_OID_LEN];
+	size_t device_sysOID_len = MAX_OID_LEN, j;
+	int i;
+
+	if (get_device_sysoid(sysOID_buf, sizeof(sysOID_buf)) != TRUE)
+		return NULL;
+
 	upsdebugx(1, "%s: device sysOID value = %s", __func__, sysOID_buf);
 
 	/* Build OIDs for comparison */
@@ -1942,70 +2739,270 @@ static mib2nut_info_t *match_sysoid(void)
 		return NULL;
 	}
 
-	/* Now, iterate on mib2nut definitions */
-	for (i = 0; mib2nut[i] != NULL; i++)
+	/* Now, check the mib2nut definitions whose sysOID is the device
+	 * one, and then those whose sysOID is a prefix of it, longest first */
+	mib2nut_sysoid_index_build();
+	for (j = 0; j < mib2nut_sysoids_count; j++)
 	{
-		upsdebugx(1, "%s: checking MIB %s", __func__, mib2nut[i]->mib_name);
+		mib2nut_sysoid_t	*entry = &mib2nut_sysoids[j];
 
-		if (mib2nut[i]->sysOID == NULL)
+		if (entry->name_len > device_sysOID_len
+		 || snmp_oid_compare(device_sysOID, entry->name_len, entry->name, entry->name_len)
+		) {
 			continue;
+		}
 
-		/* Clear variables */
-		memset(mib2nut_sysOID, 0, sizeof(mib2nut_sysOID));
-		mib2nut_sysOID_len = MAX_OID_LEN;
+		i = entry->mib2nut_idx;
+		upsdebugx(1, "%s: sysOID %s %s MIB %s (%s)", __func__, sysOID_buf,
+			(entry->name_len == device_sysOID_len) ? "matches" : "is under",
+			mib2nut[i]->mib_name, mib2nut[i]->sysOID);
 
-		if (!read_objid(mib2nut[i]->sysOID, mib2nut_sysOID, &mib2nut_sysOID_len))
-		{
-			upsdebugx(2, "%s: can't build OID %s: %s",
-				__func__, sysOID_buf, snmp_api_errstring(snmp_errno));
+		/* Counter verify, using {ups,device}.model */
+		su_select_mapping(mib2nut[i]->snmp_info);
 
-			/* Try to continue anyway! */
+		if (snmp_info == NULL) {
+			upsdebugx(0, "%s: WARNING: snmp_info is not initialized "
+				"for mapping table entry #%d \"%s\"",
+				__func__, i, mib2nut[i]->mib_name
+				);
 			continue;
 		}
+		else if (snmp_info[0].info_type == NULL) {
+			upsdebugx(1, "%s: WARNING: snmp_info is empty "
+				"for mapping table entry #%d \"%s\"",
+				__func__, i, mib2nut[i]->mib_name);
+		}
 
-		/* Now compare these */
-		upsdebugx(1, "%s: comparing %s with %s", __func__, sysOID_buf, mib2nut[i]->sysOID);
-		if (!netsnmp_oid_equals(device_sysOID, device_sysOID_len, mib2nut_sysOID, mib2nut_sysOID_len))
+		if (match_model_OID() != TRUE)
 		{
-			upsdebugx(2, "%s: sysOID matches MIB '%s'!", __func__, mib2nut[i]->mib_name);
-			/* Counter verify, using {ups,device}.model */
-			snmp_info = mib2nut[i]->snmp_info;
+			upsdebugx(2, "%s: testOID provided and doesn't match MIB '%s'!", __func__, mib2nut[i]->mib_name);
+			su_select_mapping(NULL);
+			continue;
+		}
+		else
+			upsdebugx(2, "%s: testOID provided and matches MIB '%s'!", __func__, mib2nut[i]->mib_name);
 
-			if (snmp_info == NULL) {
-				upsdebugx(0, "%s: WARNING: snmp_info is not initialized "
-					"for mapping table entry #%d \"%s\"",
-					__func__, i, mib2nut[i]->mib_name
-					);
+		return mib2nut[i];
+	}
+
+	/* Yell all to call for user report */
+	upslogx(LOG_ERR, "No matching MIB found for sysOID '%s'!\n" \
+		"Please report it to NUT developers, with an 'upsc' output for your device.\n" \
+		"Going back to the classic MIB detection method.",
+		sysOID_buf);
+
+	return NULL;
+}
+
+/* Classic method for all candidates at once: get the model OIDs of
+ * all mappings with as few multi-variable GET requests as possible, and
+ * return the first mapping (in mib2nut[] order) the device answered for.
+ * *probed is set to FALSE if this can not be done (SNMPv1 agents fail the
+ * whole request if one variable is missing, some agents have a limit...),
+ * in which case the caller should probe the candidates one by one. */
+static mib2nut_info_t *match_model_OID_multi(bool_t *probed)
+{
+	int	cand[SU_PROBE_MAXVARS], i = 0, n, k;
+	char	testOID[SU_INFOSIZE];
+
+	*probed = FALSE;
+
+	if (g_snmp_sess_p == NULL || g_snmp_sess_p->version == SNMP_VERSION_1)
+		return NULL;
+
+	while (mib2nut[i] != NULL) {
+		struct snmp_pdu	*pdu, *response = NULL;
+		netsnmp_variable_list	*vp;
+		struct timeval	start;
+		int	status;
+
+		pdu = snmp_pdu_create(SNMP_MSG_GET);
+		if (pdu == NULL) {
+			fatalx(EXIT_FAILURE, "Not enough memory");
+		}
+
+		/* Collect the next chunk of candidates */
+		for (n = 0; mib2nut[i] != NULL && n < SU_PROBE_MAXVARS; i++) {
+			oid	name[MAX_OID_LEN];
+			size_t	name_len = MAX_OID_LEN;
+
+			if (mib2nut[i]->snmp_info == NULL
+			 || get_model_OID(mib2nut[i]->snmp_info, testOID, sizeof(testOID)) != TRUE
+			 || !su_parse_oid(testOID, name, &name_len)
+			) {
+				upsdebugx(2, "%s: no model OID to test for MIB '%s'",
+					__func__, mib2nut[i]->mib_name);
 				continue;
 			}
-			else if (snmp_info[0].info_type == NULL) {
-				upsdebugx(1, "%s: WARNING: snmp_info is empty "
-					"for mapping table entry #%d \"%s\"",
-					__func__, i, mib2nut[i]->mib_name);
-			}
 
-			if (match_model_OID() != TRUE)
-			{
-				upsdebugx(2, "%s: testOID provided and doesn't match MIB '%s'!", __func__, mib2nut[i]->mib_name);
-				snmp_info = NULL;
-				continue;
+			snmp_add_null_var(pdu, name, name_len);
+			cand[n++] = i;
+		}
+
+		if (n == 0) {
+			snmp_free_pdu(pdu);
+			break;
+		}
+
+		upsdebugx(2, "%s: probing %d MIBs in one request", __func__, n);
+		gettimeofday(&start, NULL);
+		snmp_requests++;
+		status = snmp_synch_response(g_snmp_sess_p, pdu, &response);
+		drvstats_xfer(DRVSTATS_XPORT_SNMP, &start,
+			(status == STAT_SUCCESS && response
+			 && response->errstat == SNMP_ERR_NOERROR));
+
+		if (status != STAT_SUCCESS || !response
+		 || response->errstat != SNMP_ERR_NOERROR
+		) {
+			upsdebugx(2, "%s: multi-variable GET failed, "
+				"falling back to one request per MIB", __func__);
+			if (response)
+				snmp_free_pdu(response);
+			return NULL;
+		}
+
+		for (vp = response->variables, k = 0; vp && k < n; vp = vp->next_variable, k++) {
+			switch (vp->type) {
+			case ASN_OCTET_STR:
+			case ASN_OPAQUE:
+			case ASN_INTEGER:
+			case ASN_COUNTER:
+			case ASN_GAUGE:
+			case ASN_TIMETICKS:
+			case ASN_OBJECT_ID:
+				upsdebugx(2, "%s: testOID provided and matches MIB '%s'!",
+					__func__, mib2nut[cand[k]]->mib_name);
+				snmp_free_pdu(response);
+				*probed = TRUE;
+				su_select_mapping(mib2nut[cand[k]]->snmp_info);
+				return mib2nut[cand[k]];
+			default:
+				upsdebugx(3, "%s: testOID provided and doesn't match MIB '%s'!",
+					__func__, mib2nut[cand[k]]->mib_name);
+				break;
 			}
-			else
-				upsdebugx(2, "%s: testOID provided and matches MIB '%s'!", __func__, mib2nut[i]->mib_name);
+		}
+
+		snmp_free_pdu(response);
+	}
+
+	*probed = TRUE;
+	return NULL;
+}
+
+/* The MIB detected for a device is remembered in the state path, so that
+ * the next driver start only needs to counter verify it instead of going
+ * through all the mappings. Remove that file to force a full detection.
+ * It also holds the sysOID the device reported: if that changes (e.g. the
+ * device or its firmware was replaced), the file is dropped as well. */
+static void mib2nut_cache_path(char *buf, size_t buf_len)
+{
+	snprintf(buf, buf_len, "%s/snmp-ups-%s.mib", dflt_statepath(),
+		upsname ? upsname : device_name);
+}
+
+/* Make sure a stale file is not tried again on the next start */
+static void mib2nut_cache_drop(const char *fn, const char *why)
+{
+	upsdebugx(1, "%s: %s, detecting the MIB again", __func__, why);
+	if (unlink(fn) != 0 && errno != ENOENT)
+		upsdebug_with_errno(1, "%s: can't remove %s", __func__, fn);
+}
+
+static mib2nut_info_t *mib2nut_cache_load(void)
+{
+	char	fn[LARGEBUF], line[LARGEBUF], cur_sysoid[LARGEBUF];
+	char	port[LARGEBUF], mib[SU_INFOSIZE], sysoid[SU_INFOSIZE],
+		dev_sysoid[LARGEBUF];
+	FILE	*fp;
+	int	i, found = 0;
+
+	mib2nut_cache_path(fn, sizeof(fn));
+	if ((fp = fopen(fn, "r")) == NULL) {
+		upsdebugx(2, "%s: no detected MIB remembered in %s", __func__, fn);
+		return NULL;
+	}
+
+	while (!found && fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#')
+			continue;
+		found = (sscanf(line, "%1023s %127s %127s %1023s",
+			port, mib, sysoid, dev_sysoid) == 4);
+	}
+	fclose(fp);
+
+	if (!found || strcmp(port, device_path)) {
+		mib2nut_cache_drop(fn, "remembered MIB is not about this device");
+		return NULL;
+	}
+
+	/* A different device now answers at this address? */
+	if (get_device_sysoid(cur_sysoid, sizeof(cur_sysoid)) != TRUE)
+		snprintf(cur_sysoid, sizeof(cur_sysoid), "-");
+	if (strcmp(cur_sysoid, dev_sysoid)) {
+		upsdebugx(1, "%s: device sysOID was %s, now %s",
+			__func__, dev_sysoid, cur_sysoid);
+		mib2nut_cache_drop(fn, "device sysOID changed");
+		return NULL;
+	}
+
+	for (i = 0; mib2nut[i] != NULL; i++) {
+		if (strcmp(mib2nut[i]->mib_name, mib)
+		 || strcmp(mib2nut[i]->sysOID ? mib2nut[i]->sysOID : "-", sysoid)
+		 || mib2nut[i]->snmp_info == NULL
+		) {
+			continue;
+		}
 
+		su_select_mapping(mib2nut[i]->snmp_info);
+		if (match_model_OID() == TRUE) {
+			upsdebugx(1, "%s: using remembered MIB '%s'", __func__, mib);
 			return mib2nut[i];
 		}
-	}
 
-	/* Yell all to call for user report */
-	upslogx(LOG_ERR, "No matching MIB found for sysOID '%s'!\n" \
-		"Please report it to NUT developers, with an 'upsc' output for your device.\n" \
-		"Going back to the classic MIB detection method.",
-		sysOID_buf);
+		su_select_mapping(NULL);
+		mib2nut_cache_drop(fn, "remembered MIB does not match anymore");
+		return NULL;
+	}
 
+	mib2nut_cache_drop(fn, "remembered MIB is not known by this driver");
 	return NULL;
 }
 
+static void mib2nut_cache_save(const mib2nut_info_t *m2n)
+{
+	char	fn[LARGEBUF], tmpfn[LARGEBUF + 32], dev_sysoid[LARGEBUF];
+	FILE	*fp;
+	int	ok;
+
+	if (get_device_sysoid(dev_sysoid, sizeof(dev_sysoid)) != TRUE)
+		snprintf(dev_sysoid, sizeof(dev_sysoid), "-");
+
+	mib2nut_cache_path(fn, sizeof(fn));
+	snprintf(tmpfn, sizeof(tmpfn), "%s.%" PRIiMAX, fn, (intmax_t)getpid());
+
+	if ((fp = fopen(tmpfn, "w")) == NULL) {
+		upsdebug_with_errno(2, "%s: can't write %s", __func__, tmpfn);
+		return;
+	}
+
+	ok = (fprintf(fp, "# MIB detected by snmp-ups, remove this file to detect again\n") > 0);
+	ok = (ok && fprintf(fp, "%s %s %s %s\n", device_path, m2n->mib_name,
+		m2n->sysOID ? m2n->sysOID : "-", dev_sysoid) > 0);
+	ok = (fclose(fp) == 0 && ok);
+
+	/* a driver starting meanwhile only ever sees a complete file */
+#ifdef WIN32
+	if (ok)
+		unlink(fn);
+#endif
+	if (!ok || rename(tmpfn, fn) != 0) {
+		upsdebug_with_errno(2, "%s: can't write %s", __func__, fn);
+		unlink(tmpfn);
+	}
+}
+
 /* Load the right snmp_info_t structure matching mib parameter */
 bool_t load_mib2nut(const char *mib)
 {
@@ -2014,6 +3011,7 @@ bool_t load_mib2nut(const char *mib)
 	/* Below we have many checks for "auto"; avoid redundant string walks: */
 	bool_t mibIsAuto = (0 == strcmp(mib, "auto"));
 	bool_t mibSeen = FALSE; /* Did we see the MIB name while walking mib2nut[]? */
+	bool_t probed = FALSE, cached = FALSE;
 
 	upsdebugx(1, "SNMP UPS driver: entering %s(%s) to detect "
 		"proper MIB for device [%s] (host %s)",
@@ -2024,8 +3022,14 @@ bool_t load_mib2nut(const char *mib)
 
 	/* First, try to match against sysOID, if no MIB was provided.
 	 * This should speed up init stage
-	 * (Note: sysOID points the device main MIB entry point) */
+	 * (Note: sysOID points the device main MIB entry point),
+	 * unless we already know it from a previous run */
 	if (mibIsAuto)
+	{
+		cached = ((m2n = mib2nut_cache_load()) != NULL);
+	}
+
+	if (mibIsAuto && m2n == NULL)
 	{
 		upsdebugx(2, "%s: trying the new match_sysoid() method with %s",
 			__func__, mib);
@@ -2045,8 +3049,14 @@ bool_t load_mib2nut(const char *mib)
 		}
 	}
 
-	/* Otherwise, revert to the classic method */
-	if (m2n == NULL)
+	/* Otherwise, revert to the classic method, probing all
+	 * candidates at once if possible */
+	if (m2n == NULL && mibIsAuto)
+	{
+		m2n = match_model_OID_multi(&probed);
+	}
+
+	if (m2n == NULL && !probed)
 	{
 		for (i = 0; mib2nut[i] != NULL; i++) {
 			/* Is there already a MIB name provided? */
@@ -2064,7 +3074,7 @@ bool_t load_mib2nut(const char *mib)
 				__func__, mib2nut[i]->mib_name);
 
 			/* Classic method: test an OID specific to this MIB */
-			snmp_info = mib2nut[i]->snmp_info;
+			su_select_mapping(mib2nut[i]->snmp_info);
 
 			if (snmp_info == NULL) {
 				upsdebugx(0, "%s: WARNING: snmp_info is not initialized "
@@ -2090,7 +3100,7 @@ bool_t load_mib2nut(const char *mib)
 			{
 				upsdebugx(3, "%s: testOID provided and doesn't match MIB '%s'!",
 					__func__, mib2nut[i]->mib_name);
-				snmp_info = NULL;
+				su_select_mapping(NULL);
 				continue;
 			}
 			else
@@ -2106,7 +3116,7 @@ bool_t load_mib2nut(const char *mib)
 	/* Store the result, if any */
 	if (m2n != NULL)
 	{
-		snmp_info = m2n->snmp_info;
+		su_select_mapping(m2n->snmp_info);
 		OID_pwr_status = m2n->oid_pwr_status;
 		mibname = m2n->mib_name;
 		mibvers = m2n->mib_version;
@@ -2114,6 +3124,8 @@ bool_t load_mib2nut(const char *mib)
 		upsdebugx(1, "%s: using %s MIB for device [%s] (host %s)",
 			__func__, mibname,
 			upsname ? upsname : device_name, device_path);
+		if (mibIsAuto && !cached)
+			mib2nut_cache_save(m2n);
 		return TRUE;
 	}
 
@@ -2328,6 +3340,7 @@ static snmp_info_t *instantiate_info(snmp_info_t *info_template, snmp_info_t *ne
 	new_instance->dfl = info_template->dfl;
 	new_instance->flags = info_template->flags;
 	new_instance->oid2info = info_template->oid2info;
+	new_instance->oid_bin = NULL;
 
 	upsdebugx(2, "instantiate_info: template instantiated");
 	return new_instance;
@@ -2545,9 +3558,17 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 	/* Needed *2 to fit a max size_t in snprintf() below,
 	 * even if that should never happen */
 	char tmp_buf[SU_INFOSIZE];
+	char *oid_buf = NULL;
+	int oid_args, oid_arg1, oid_arg2;
+	su_oid_bin_t *inst;
+	struct timeval start, stop;
+	unsigned long requests = snmp_requests;
 
 	upsdebugx(1, "%s template definition found (%s)...", type, su_info_p->info_type);
 
+	gettimeofday(&start, NULL);
+	snmp_bulk_active = 1;
+
 	if ((strncmp(type, "device", 6)) && (devices_count > 1) && (current_device_number > 0)) {
 		snprintf(template_count_var, sizeof(template_count_var), "device.%i.%s.count", current_device_number, type);
 	} else {
@@ -2573,6 +3594,7 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 	if (template_count > 0) {
 		/* general init of data using the template */
 		instantiate_info(su_info_p, &cur_info_p);
+		oid_buf = (char *)cur_info_p.OID;
 
 		base_snmp_index = base_snmp_template_index(su_info_p);
 
@@ -2704,14 +3726,19 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 			}
 
 			if (cur_info_p.OID != NULL) {
+				oid_args = 1;
+				oid_arg1 = cur_template_number;
+				oid_arg2 = 0;
+
 				/* Special processing for daisychain */
 				if (!strncmp(type, "device", 6)) {
 					if (current_device_number > 0) {
-						snprintf((char *)cur_info_p.OID, SU_INFOSIZE, su_info_p->OID, current_device_number + device_template_offset);
+						oid_arg1 = current_device_number + device_template_offset;
+					}
+					else {
+						/* FIXME: daisychain-whole, what to do? */
+						oid_args = 0;
 					}
-					/*else
-					 * FIXME: daisychain-whole, what to do?
-					 */
 				}
 				else {
 					/* Special processing for daisychain:
@@ -2720,22 +3747,30 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 					 * the formatting info for it are in 1rst or 2nd position */
 					if (daisychain_enabled == TRUE) {
 						if (su_info_p->flags & SU_TYPE_DAISY_1) {
-							snprintf((char *)cur_info_p.OID, SU_INFOSIZE,
-								su_info_p->OID, current_device_number + device_template_offset, cur_template_number);
+							oid_arg1 = current_device_number + device_template_offset;
+							oid_arg2 = cur_template_number;
 						}
 						else if (su_info_p->flags & SU_TYPE_DAISY_2) {
-							snprintf((char *)cur_info_p.OID, SU_INFOSIZE,
-								su_info_p->OID, cur_template_number + device_template_offset,
-								current_device_number - device_template_offset);
-						}
-						else {
-							/* Note: no device daisychain templating (SU_TYPE_DAISY_MASTER_ONLY)! */
-							snprintf((char *)cur_info_p.OID, SU_INFOSIZE, su_info_p->OID, cur_template_number);
+							oid_arg1 = cur_template_number + device_template_offset;
+							oid_arg2 = current_device_number - device_template_offset;
 						}
+						/* else: no device daisychain templating
+						 * (SU_TYPE_DAISY_MASTER_ONLY)! */
 					}
-					else {
-						snprintf((char *)cur_info_p.OID, SU_INFOSIZE, su_info_p->OID, cur_template_number);
-					}
+				}
+
+				/* Use the instance parsed once at init if there is one,
+				 * or format the OID text as before */
+				inst = oid_args ? su_oid_bin_instance(su_info_p, oid_arg1, oid_arg2) : NULL;
+				if (inst != NULL) {
+					cur_info_p.OID = inst->text;
+					cur_info_p.oid_bin = inst;
+				}
+				else {
+					cur_info_p.OID = oid_buf;
+					cur_info_p.oid_bin = NULL;
+					if (oid_args)
+						snprintf(oid_buf, SU_INFOSIZE, su_info_p->OID, oid_arg1, oid_arg2);
 				}
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_FORMAT_NONLITERAL
 #pragma GCC diagnostic pop
@@ -2758,8 +3793,8 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 			su_info_p->flags = cur_info_p.flags;
 		}
 		free((char*)cur_info_p.info_type);
-		if (cur_info_p.OID != NULL)
-			free((char*)cur_info_p.OID);
+		if (oid_buf != NULL)
+			free(oid_buf);
 		if ((cur_info_p.dfl != NULL) &&
 			(strstr(su_info_p->dfl, "%i") != NULL))
 			free((char*)cur_info_p.dfl);
@@ -2767,6 +3802,15 @@ static bool_t process_template(int mode, const char* type, snmp_info_t *su_info_
 	else {
 		upsdebugx(1, "No %s present, discarding template definition...", type);
 	}
+
+	snmp_bulk_active = 0;
+	nut_snmp_bulk_free();
+
+	gettimeofday(&stop, NULL);
+	upsdebugx(2, "%s: %s template (%s) walked in %.3f sec with %lu SNMP requests",
+		__func__, type, su_info_p->info_type,
+		difftimeval(stop, start), snmp_requests - requests);
+
 	return status;
 }
 
@@ -2941,7 +3985,10 @@ bool_t daisychain_init(void)
 		 * the number of devices present */
 		else
 		{
+			snmp_bulk_active = 1;
 			devices_count = guesstimate_template_count(su_info_p);
+			snmp_bulk_active = 0;
+			nut_snmp_bulk_free();
 			upsdebugx(1, "Guesstimation: there are %ld device(s) present", devices_count);
 		}
 
@@ -3412,13 +4459,27 @@ bool_t su_ups_get(snmp_info_t *su_info_p)
 	char *format_char = NULL;
 	int saved_current_device_number = -1;
 	snmp_info_t *tmp_info_p = NULL;
+	snmp_info_t tmp_info;
+	su_oid_bin_t *inst = NULL;
 
 	upsdebugx(2, "%s: %s %s", __func__, su_info_p->info_type, su_info_p->OID);
 
 	/* Check if this is a daisychain template */
 	if (su_info_p->OID != NULL
 	&&  (format_char = strchr(su_info_p->OID, '%')) != NULL
+	&&  (inst = su_oid_bin_instance(su_info_p,
+		current_device_number + device_template_offset, 0)) != NULL
 	) {
+		/* Pre-parsed template: its instance is kept, no need to
+		 * allocate and format a copy of the entry on each poll */
+		tmp_info = *su_info_p;
+		tmp_info.OID = inst->text;
+		tmp_info.oid_bin = inst;
+		upsdebugx(3, "%s: OID %s adapted into %s",
+			__func__, su_info_p->OID, tmp_info.OID);
+		su_info_p = &tmp_info;
+	}
+	else if (format_char != NULL) {
 		upsdebugx(3, "%s: calling instantiate_info() for "
 			"daisy-chain template", __func__);
 		tmp_info_p = instantiate_info(su_info_p, tmp_info_p);
@@ -3510,7 +4571,7 @@ bool_t su_ups_get(snmp_info_t *su_info_p)
 		upsdebugx(2, "%s: requesting nut_snmp_get_int() for "
 			"ups.status, with%s daisy template originally",
 			__func__, (format_char!=NULL ? "" : "out"));
-		status = nut_snmp_get_int(su_info_p->OID, &value);
+		status = su_info_get_int(su_info_p, &value);
 		if (status == TRUE)
 		{
 			su_status_set(su_info_p, value);
@@ -3533,7 +4594,7 @@ bool_t su_ups_get(snmp_info_t *su_info_p)
 		upsdebugx(2, "%s: requesting nut_snmp_get_int() for "
 			"some alarm, with%s daisy template originally",
 			__func__, (format_char!=NULL ? "" : "out"));
-		status = nut_snmp_get_int(su_info_p->OID, &value);
+		status = su_info_get_int(su_info_p, &value);
 		if (status == TRUE)
 		{
 			su_alarm_set(su_info_p, value);
@@ -3553,7 +4614,7 @@ bool_t su_ups_get(snmp_info_t *su_info_p)
 		upsdebugx(2, "%s: requesting nut_snmp_get_int() for "
 			"ups.alarms, with%s daisy template originally",
 			__func__, (format_char!=NULL ? "" : "out"));
-		status = nut_snmp_get_int(su_info_p->OID, &value);
+		status = su_info_get_int(su_info_p, &value);
 		if (status == TRUE) {
 			upsdebugx(2, "=> %ld alarms present", value);
 			if (value > 0) {
@@ -3623,7 +4684,7 @@ bool_t su_ups_get(snmp_info_t *su_info_p)
 		upsdebugx(2, "%s: requesting nut_snmp_get_int() for "
 			"ambient.temperature, with%s daisy template originally",
 			__func__, (format_char!=NULL ? "" : "out"));
-		status = nut_snmp_get_int(su_info_p->OID, &value);
+		status = su_info_get_int(su_info_p, &value);
 
 		if(status != TRUE) {
 			free_info(tmp_info_p);
@@ -3665,7 +4726,7 @@ bool_t su_ups_get(snmp_info_t *su_info_p)
 		upsdebugx(2, "%s: requesting nut_snmp_get_str(), "
 			"with%s daisy template originally",
 			__func__, (format_char!=NULL ? "" : "out"));
-		status = nut_snmp_get_str(su_info_p->OID, buf,
+		status = su_info_get_str(su_info_p, buf,
 			sizeof(buf), su_info_p->oid2info);
 		if (status == TRUE) {
 			const char *fmt_buf;
@@ -3688,7 +4749,7 @@ bool_t su_ups_get(snmp_info_t *su_info_p)
 		upsdebugx(2, "%s: requesting nut_snmp_get_int(), "
 			"with%s daisy template originally",
 			__func__, (format_char!=NULL ? "" : "out"));
-		status = nut_snmp_get_int(su_info_p->OID, &value);
+		status = su_info_get_int(su_info_p, &value);
 		if (status == TRUE) {
 			if ((su_info_p->flags&SU_FLAG_NEGINVALID && value<0)
 				|| (su_info_p->flags&SU_FLAG_ZEROINVALID && value==0)) {
@@ -135,6 +135,7 @@
 #define DEFAULT_NETSNMP_RETRIES   5
 #define DEFAULT_NETSNMP_TIMEOUT   1    /* in seconds */
 #define DEFAULT_SEMISTATICFREQ    10   /* in snmpwalk update cycles */
+#define DEFAULT_NETSNMP_MAXREP    20   /* GETBULK max-repetitions */
 
 /* use explicit booleans */
 #ifndef FALSE
@@ -232,6 +233,9 @@ typedef struct {
 typedef uint32_t snmp_info_flags_t; /* To extend when 32 bits become too congested */
 #define PRI_SU_FLAGS	PRIu32
 
+/* Binary form of an snmp_info_t OID (or template), private to snmp-ups.c */
+typedef struct su_oid_bin_s su_oid_bin_t;
+
 typedef struct {
 	char         *info_type;  /* INFO_ or CMD_ element */
 	int           info_flags; /* flags to set in addinfo: see ST_FLAG_*
@@ -254,17 +258,19 @@ typedef struct {
 	                           * when/if we get more than 32 flag values.
 	                           */
 	info_lkp_t   *oid2info;   /* lookup table between OID and NUT values */
+	su_oid_bin_t *oid_bin;    /* snmp-ups internal: OID parsed once for
+	                           * the selected mapping, keep NULL here */
 } snmp_info_t;
 
 /* Help align with DMF branch codebase until it is merged */
 #if defined WITH_DMF_FUNCTIONS && WITH_DMF_FUNCTIONS
 # if defined WITH_DMF_LUA && WITH_DMF_LUA
-#  define snmp_info_default(_1, _2, _3, _4, _5, _6, _7)	{_1, _2, _3, _4, _5, _6, _7, NULL, NULL, NULL}
+#  define snmp_info_default(_1, _2, _3, _4, _5, _6, _7)	{_1, _2, _3, _4, _5, _6, _7, NULL, NULL, NULL, NULL}
 # else
-#  define snmp_info_default(_1, _2, _3, _4, _5, _6, _7)	{_1, _2, _3, _4, _5, _6, _7, NULL, NULL}
+#  define snmp_info_default(_1, _2, _3, _4, _5, _6, _7)	{_1, _2, _3, _4, _5, _6, _7, NULL, NULL, NULL}
 # endif /* WITH_DMF_LUA  */
 #else
-#  define snmp_info_default(_1, _2, _3, _4, _5, _6, _7)	{_1, _2, _3, _4, _5, _6, _7}
+#  define snmp_info_default(_1, _2, _3, _4, _5, _6, _7)	{_1, _2, _3, _4, _5, _6, _7, NULL}
 #endif /* WITH_DMF_FUNCTIONS */
 #define snmp_info_sentinel	snmp_info_default(NULL, 0, 0, NULL, NULL, 0, NULL)
 
@@ -363,6 +369,7 @@ typedef struct {
 #define SU_VAR_VERSION		"snmp_version"
 #define SU_VAR_RETRIES		"snmp_retries"
 #define SU_VAR_TIMEOUT		"snmp_timeout"
+#define SU_VAR_BULKMAXREP	"snmp_bulk_maxrep"
 #define SU_VAR_SEMISTATICFREQ	"semistaticfreq"
 #define SU_VAR_MIBS			"mibs"
 #define SU_VAR_POLLFREQ		"pollfreq"
@@ -381,6 +388,9 @@ typedef struct {
 #define SU_BUFSIZE		32
 #define SU_LARGEBUF		256
 
+#define SU_BULK_MAXITEMS	1024	/* max. values cached per GETBULK table walk */
+#define SU_PROBE_MAXVARS	16	/* max. model OIDs probed per request during MIB detection */
+
 #define SU_STALE_RETRY	10	/* retry to retrieve stale element */
 				/* after this number of iterations. */
 				/* FIXME: this is for *all* elements */
@@ -928,6 +928,7 @@ void upsdrv_cleanup(void)
 static int mrir(modbus_t * arg_ctx, int addr, int nb, uint16_t * dest)
 {
 	int r, i;
+	struct timeval start;
 	
 	/* zero out the thing, because we might have reused it */
 	for (i=0; i<nb; i++) {
@@ -935,7 +936,9 @@ static int mrir(modbus_t * arg_ctx, int addr, int nb, uint16_t * dest)
 	}
 
 	/*r = modbus_read_input_registers(arg_ctx, addr, nb, dest);*/
+	gettimeofday(&start, NULL);
 	r = modbus_read_registers(arg_ctx, addr, nb, dest);
+	drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, r != -1);
 	if (r == -1) {
 		upslogx(LOG_ERR, "mrir: modbus_read_input_registers(addr:%d, count:%d): %s (%s)", addr, nb, modbus_strerror(errno), device_path);
 	}
@@ -945,7 +948,11 @@ static int mrir(modbus_t * arg_ctx, int addr, int nb, uint16_t * dest)
 static int mwrs(modbus_t *ctx, int addr, int nb, uint16_t *src)
 {
 	int r = -1;
+	struct timeval start;
+
+	gettimeofday(&start, NULL);
 	r = modbus_write_registers(ctx, addr, nb, src);
+	drvstats_xfer(DRVSTATS_XPORT_MODBUS, &start, r != -1);
 	
 	if (r == -1) {
 		upslogx(LOG_ERR, "mrir: modbus_write_registers(addr:%d, count:%d): %s (%s)", addr, nb, modbus_strerror(errno), device_path);
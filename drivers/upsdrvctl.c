@@ -73,6 +73,13 @@ static int	maxretry = 1;
 	/* timer - delay between each restart attempt of the driver(s) */
 static int	retrydelay = 5;
 
+	/* counter - start up to that many drivers at once (1 = one by one) */
+static int	maxparallel = 1;
+
+	/* flag - forkexec() should not wait for the driver being started,
+	 * start_all_drivers_parallel() keeps track of the child itself */
+static int	nowait_launch = 0;
+
 	/* Directory where driver executables live */
 static char	*driverpath = NULL;
 
@@ -118,6 +125,9 @@ void do_upsconf_args(char *arg_upsname, char *var, char *val)
 		if (!strcmp(var, "retrydelay"))
 			retrydelay = atoi(val);
 
+		if (!strcmp(var, "maxparallel"))
+			maxparallel = atoi(val);
+
 		if (!strcmp(var, "nowait")) {
 			char * s = getenv("NUT_IGNORE_NOWAIT");
 			if (s && !strcmp(s, "true")) {
@@ -664,6 +674,13 @@ static void forkexec(char *const argv[], const ups_t *ups)
 				return;
 			}
 
+			/* Bounded parallel startup: caller waits for the child */
+			if (nowait_launch) {
+				upsdebugx(2, "Launched driver PID %" PRIdMAX ", continuing...",
+					(intmax_t)pid);
+				return;
+			}
+
 			if (nut_foreground_passthrough > 0 && upscount > 1) {
 				/* Let upsdrvctl fork to run its numerous children
 				 * but without further forking on their side - so
@@ -1071,6 +1088,278 @@ static void send_one_driver(void (*command_func)(const ups_t *), const char *arg
 	fatalx(EXIT_FAILURE, "UPS %s not found in ups.conf", arg_upsname);
 }
 
+#ifndef WIN32
+typedef enum {
+	DRV_START_PENDING = 0,
+	DRV_START_RUNNING,
+	DRV_START_DONE,
+	DRV_START_FAILED,
+	DRV_START_TIMEOUT
+} drv_start_state_t;
+
+typedef struct {
+	ups_t	*ups;
+	drv_start_state_t	state;
+	int	tries_left;
+	time_t	not_before;	/* do not (re)try earlier than this */
+	time_t	deadline;	/* maxstartdelay expiry, or 0 if none */
+} drv_start_t;
+
+/* Report how the launched driver process has exited; return 1 if
+ * it was a success (driver initialized and went to background) */
+static int drv_start_verdict(const ups_t *ups, int wstat)
+{
+	if (WIFEXITED(wstat) == 0) {
+		if (WIFSIGNALED(wstat)) {
+			upslogx(LOG_WARNING, "Driver [%s] died after signal %d",
+				ups->upsname, WTERMSIG(wstat));
+		} else {
+			upslogx(LOG_WARNING, "Driver [%s] exited abnormally",
+				ups->upsname);
+		}
+		return 0;
+	}
+
+	if (WEXITSTATUS(wstat) != 0) {
+		upslogx(LOG_WARNING, "Driver [%s] failed to start (exit status=%d)",
+			ups->upsname, WEXITSTATUS(wstat));
+		return 0;
+	}
+
+	return 1;
+}
+
+/* Reschedule a failed or timed-out attempt if allowed by maxretry */
+static int drv_start_retry(drv_start_t *ds, time_t now)
+{
+	if (ds->tries_left <= 0)
+		return 0;
+
+	upsdebugx(2, "Driver [%s]: %i remaining attempts",
+		ds->ups->upsname, ds->tries_left);
+	ds->state = DRV_START_PENDING;
+	ds->not_before = now + (retrydelay > 0 ? retrydelay : 0);
+	return 1;
+}
+
+/* Start all drivers with up to "maxparallel" of them initializing at
+ * once. A driver is considered ready when the process we launched has
+ * exited successfully, i.e. the driver has connected to its device,
+ * created its socket for upsd and went to background. Failures and
+ * timeouts are retried as for sequential start-up, and summarized at
+ * the end. The sdorder is not relevant here (only for shutdown).
+ */
+static void start_all_drivers_parallel(void)
+{
+	drv_start_t	*tbl;
+	ups_t	*ups;
+	size_t	i, n = 0;
+	int	running = 0, left = 0, started = 0;
+	time_t	now, began;
+	struct sigaction	sa;
+	char	failed[LARGEBUF], stuck[LARGEBUF];
+
+	for (ups = upstable; ups; ups = ups->next)
+		n++;
+
+	tbl = (drv_start_t *)xcalloc(n, sizeof(drv_start_t));
+	for (i = 0, ups = upstable; ups; ups = ups->next, i++) {
+		tbl[i].ups = ups;
+		tbl[i].tries_left = maxretry;
+		if (maxretry > 0) {
+			tbl[i].state = DRV_START_PENDING;
+			left++;
+		} else {
+			tbl[i].state = DRV_START_DONE;
+		}
+	}
+
+	upsdebugx(1, "Starting %" PRIuSIZE " drivers, up to %d at once",
+		n, maxparallel);
+
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sa.sa_handler = waitpid_timeout;
+	sigaction(SIGALRM, &sa, NULL);
+
+	time(&began);
+	while (left > 0) {
+		time_t	wake = 0;
+		pid_t	pid;
+		int	wstat = 0;
+
+		time(&now);
+
+		/* Launch whatever is due, as long as we have free slots */
+		for (i = 0; i < n && running < maxparallel; i++) {
+			drv_start_t	*ds = &tbl[i];
+			int	delay;
+
+			if (ds->state != DRV_START_PENDING || ds->not_before > now)
+				continue;
+
+			ds->tries_left--;
+			ds->ups->pid = -1;
+
+			nowait_launch = 1;
+			start_driver(ds->ups);
+			nowait_launch = 0;
+
+			if (ds->ups->pid == -1) {
+				/* testmode, nothing was forked */
+				ds->state = DRV_START_DONE;
+				left--;
+				started++;
+				continue;
+			}
+
+			delay = (ds->ups->maxstartdelay != -1)
+				? ds->ups->maxstartdelay : maxstartdelay;
+			ds->deadline = (delay >= 0) ? now + delay : 0;
+			ds->state = DRV_START_RUNNING;
+			running++;
+		}
+
+		if (left < 1)
+			break;
+
+		/* When should we look around next, if no child exits before? */
+		for (i = 0; i < n; i++) {
+			drv_start_t	*ds = &tbl[i];
+
+			if (ds->state == DRV_START_RUNNING && ds->deadline
+			 && (!wake || ds->deadline < wake))
+				wake = ds->deadline;
+
+			if (ds->state == DRV_START_PENDING && running < maxparallel
+			 && (!wake || ds->not_before < wake))
+				wake = ds->not_before;
+		}
+
+		if (!running) {
+			/* Only retries waiting for their retrydelay */
+			if (wake > now)
+				sleep((unsigned int)(wake - now));
+			continue;
+		}
+
+		if (wake)
+			alarm((unsigned int)(wake > now ? wake - now : 1));
+		pid = waitpid(-1, &wstat, 0);
+		alarm(0);
+
+		time(&now);
+
+		if (pid > 0) {
+			drv_start_t	*ds = NULL;
+
+			for (i = 0; i < n; i++) {
+				if (tbl[i].ups->pid == pid) {
+					ds = &tbl[i];
+					break;
+				}
+			}
+
+			if (!ds) {
+				/* An earlier attempt which had timed out */
+				upsdebugx(1, "Reaped an earlier driver launch PID %" PRIdMAX,
+					(intmax_t)pid);
+			} else
+			if (ds->state == DRV_START_RUNNING) {
+				running--;
+				if (drv_start_verdict(ds->ups, wstat)) {
+					upsdebugx(1, "Driver [%s] started", ds->ups->upsname);
+					ds->state = DRV_START_DONE;
+					left--;
+					started++;
+				} else
+				if (!drv_start_retry(ds, now)) {
+					ds->state = DRV_START_FAILED;
+					left--;
+					exec_error++;
+				}
+			} else {
+				/* Timed out before but finished eventually,
+				 * so the final revision in main() does not
+				 * have to bother about this one any more */
+				int	ok = drv_start_verdict(ds->ups, wstat);
+
+				ds->ups->exceeded_timeout = 0;
+				if (ds->state == DRV_START_PENDING) {
+					/* was waiting to retry, no need now */
+					if (ok) {
+						ds->state = DRV_START_DONE;
+						left--;
+						started++;
+					}
+				} else
+				if (ds->state == DRV_START_TIMEOUT) {
+					if (ok) {
+						ds->state = DRV_START_DONE;
+						started++;
+					} else {
+						ds->state = DRV_START_FAILED;
+						exec_error++;
+					}
+				}
+			}
+		} else
+		if (pid == -1 && errno != EINTR) {
+			/* Should not happen: lost track of our children */
+			upslog_with_errno(LOG_ERR, "%s: waitpid", __func__);
+			for (i = 0; i < n; i++) {
+				if (tbl[i].state == DRV_START_RUNNING) {
+					tbl[i].state = DRV_START_FAILED;
+					running--;
+					left--;
+					exec_error++;
+				}
+			}
+			continue;
+		}
+
+		/* Who is taking too long? */
+		for (i = 0; i < n; i++) {
+			drv_start_t	*ds = &tbl[i];
+
+			if (ds->state != DRV_START_RUNNING
+			 || !ds->deadline || ds->deadline > now)
+				continue;
+
+			upslogx(LOG_WARNING, "Startup timer elapsed for driver [%s], continuing...",
+				ds->ups->upsname);
+			ds->ups->exceeded_timeout = 1;
+			running--;
+
+			if (!drv_start_retry(ds, now)) {
+				ds->state = DRV_START_TIMEOUT;
+				left--;
+				exec_timeout++;
+			}
+		}
+	}
+
+	failed[0] = '\0';
+	stuck[0] = '\0';
+	for (i = 0; i < n; i++) {
+		if (tbl[i].state == DRV_START_FAILED)
+			snprintfcat(failed, sizeof(failed), " %s", tbl[i].ups->upsname);
+		if (tbl[i].state == DRV_START_TIMEOUT)
+			snprintfcat(stuck, sizeof(stuck), " %s", tbl[i].ups->upsname);
+	}
+
+	time(&now);
+	upslogx(LOG_INFO, "Started %d of %" PRIuSIZE " drivers in %" PRIdMAX " sec",
+		started, n, (intmax_t)(now - began));
+	if (*failed)
+		upslogx(LOG_WARNING, "Drivers failed to start:%s", failed);
+	if (*stuck)
+		upslogx(LOG_WARNING, "Drivers still starting after maxstartdelay:%s", stuck);
+
+	free(tbl);
+}
+#endif	/* !WIN32 */
+
 /* walk UPS table and send command to all UPSes according to sdorder */
 static void send_all_drivers(void (*command_func)(const ups_t *))
 {
@@ -1106,6 +1395,22 @@ static void send_all_drivers(void (*command_func)(const ups_t *))
 			);
 		}
 
+#ifndef WIN32
+		/* Bounded parallel startup, if configured and we would wait */
+		if (command_func == &start_driver
+		&&  ups->next
+		&&  maxparallel > 1
+		&&  waitfordrivers
+		&&  nut_foreground_passthrough <= 0
+		&&  !(nut_foreground_passthrough != 0
+		      && nut_debug_level > 0
+		      && nut_debug_level_passthrough > 0)
+		) {
+			start_all_drivers_parallel();
+			return;
+		}
+#endif	/* !WIN32 */
+
 		while (ups) {
 			command_func(ups);
 
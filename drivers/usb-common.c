@@ -376,6 +376,50 @@ void USBFreeRegexMatcher(USBDeviceMatcher_t *matcher)
 	free(matcher);
 }
 
+/* Evaluate the criteria of a chain of matchers which are known without
+ * opening the device: the numeric IDs and the bus, device and port names
+ * for regex matchers, and the numeric IDs for exact matchers. Criteria on
+ * descriptor strings, and other kinds of matchers, are left for matching
+ * the opened device. Return 0 if the device can be skipped, 1 if it may
+ * match, or -1 (with errno set) / -2 on errors like matchers do.
+ */
+int USBMatchBeforeOpen(USBDeviceMatcher_t *matcher, USBDevice_t *hd)
+{
+	USBDeviceMatcher_t	*m;
+	int	r = 1;
+
+	for (m = matcher; m && r == 1; m = m->next) {
+		if (m->match_function == &match_function_exact) {
+			USBDevice_t	*data = (USBDevice_t *)m->privdata;
+
+			r = (hd->VendorID == data->VendorID
+				&& hd->ProductID == data->ProductID);
+		} else if (m->match_function == &match_function_regex) {
+			regex_matcher_data_t	*data = (regex_matcher_data_t *)m->privdata;
+
+			if ((r = match_regex_hex(data->regex[0], hd->VendorID)) != 1
+			 || (r = match_regex_hex(data->regex[1], hd->ProductID)) != 1
+			 || (r = match_regex(data->regex[5], hd->Bus)) != 1
+			 || (r = match_regex(data->regex[6], hd->Device)) != 1
+			) {
+				break;
+			}
+#if (defined WITH_USB_BUSPORT) && (WITH_USB_BUSPORT)
+			r = match_regex(data->regex[7], hd->BusPort);
+#endif
+		}
+	}
+
+	if (r != 1) {
+		upsdebugx(3, "%s: ruled out device %04x:%04x on bus %s, device %s",
+			__func__, hd->VendorID, hd->ProductID,
+			hd->Bus ? hd->Bus : "unknown",
+			hd->Device ? hd->Device : "unknown");
+	}
+
+	return r;
+}
+
 void warn_if_bad_usb_port_filename(const char *fn) {
 	/* USB drivers ignore the 'port' setting - log a notice
 	 * if it is not "auto". Note: per se, ignoring the port
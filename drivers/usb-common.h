@@ -533,6 +533,11 @@ int USBNewRegexMatcher(USBDeviceMatcher_t **matcher, char **regex, int cflags);
 void USBFreeExactMatcher(USBDeviceMatcher_t *matcher);
 void USBFreeRegexMatcher(USBDeviceMatcher_t *matcher);
 
+/* Apply those criteria of a matcher chain which do not need the device
+ * to be opened (IDs, bus, device, port) of exact and regex matchers.
+ * Return 0 if the device does not match, 1 if it may match. */
+int USBMatchBeforeOpen(USBDeviceMatcher_t *matcher, USBDevice_t *hd);
+
 /* dummy USB function and macro, inspired from the Linux kernel
  * this allows USB information extraction */
 #define USB_DEVICE(vendorID, productID)	vendorID, productID
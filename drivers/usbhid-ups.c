@@ -29,7 +29,7 @@
  */
 
 #define DRIVER_NAME	"Generic HID driver"
-#define DRIVER_VERSION	"0.54"
+#define DRIVER_VERSION	"0.57"
 
 #define HU_VAR_WAITBEFORERECONNECT "waitbeforereconnect"
 
@@ -39,6 +39,7 @@
 #include "usbhid-ups.h"
 #include "hidparser.h"
 #include "hidtypes.h"
+#include "hidcache.h"
 #include "common.h"
 #ifdef WIN32
 #include "wincompat.h"
@@ -139,6 +140,9 @@ bool_t use_interrupt_pipe = TRUE;
 bool_t use_interrupt_pipe = FALSE;
 #endif
 static size_t interrupt_pipe_EIO_count = 0; /* How many times we had I/O errors since last reconnect? */
+#if !((defined SHUT_MODE) && SHUT_MODE)
+static int async_interrupt = 0; /* Read the interrupt pipe in the background? */
+#endif	/* !SHUT_MODE => USB */
 static time_t lastpoll; /* Timestamp the last polling */
 hid_dev_handle_t udev = HID_DEV_HANDLE_CLOSED;
 
@@ -206,6 +210,10 @@ static void ups_alarm_set(void);
 static void ups_status_set(void);
 static bool_t hid_ups_walk(walkmode_t mode);
 static int reconnect_ups(void);
+static void hidcache_store(void);
+#if !((defined SHUT_MODE) && SHUT_MODE)
+static void interrupt_async_start(void);
+#endif	/* !SHUT_MODE => USB */
 static int ups_infoval_set(hid_info_t *item, double value);
 static int callback(hid_dev_handle_t argudev, HIDDevice_t *arghd,
 					usb_ctrl_charbuf rdbuf, usb_ctrl_charbufsize rdlen);
@@ -1018,6 +1026,9 @@ void upsdrv_makevartable(void)
 	addvar(VAR_FLAG, "disable_fix_report_desc",
 		"Set to disable fix-ups for broken USB encoding, etc. which we apply by default on certain vendors/products");
 
+	addvar(VAR_FLAG, "hidcache",
+		"Remember the report descriptor and mapping of the device in the state path");
+
 #if !((defined SHUT_MODE) && SHUT_MODE)
 	addvar(VAR_VALUE, "subdriver", "Explicit USB HID subdriver selection");
 
@@ -1032,6 +1043,8 @@ void upsdrv_makevartable(void)
 		"Don't use polling, only use interrupt pipe");
 	addvar(VAR_VALUE, "interruptsize",
 		"Number of bytes to read from interrupt pipe");
+	addvar(VAR_FLAG, "asyncinterrupt",
+		"Read interrupt pipe in the background, to handle reports as they come");
 	addvar(VAR_VALUE, HU_VAR_WAITBEFORERECONNECT,
 		"Seconds to wait before trying to reconnect");
 
@@ -1047,7 +1060,8 @@ void upsdrv_updateinfo(void)
 {
 	hid_info_t	*item;
 	HIDData_t	*event[MAX_EVENT_NUM], *found_data;
-	int		i, evtCount;
+	double		evtValue[MAX_EVENT_NUM];
+	int		i, evtCount, reports = 0;
 	double		value;
 	time_t		now;
 
@@ -1057,6 +1071,9 @@ void upsdrv_updateinfo(void)
 
 	/* check for device availability to set datastale! */
 	if (hd == NULL) {
+		/* not woken up by the lost device anymore */
+		extrafd = ERROR_FD;
+
 		/* don't flood reconnection attempts */
 		if (now < (lastpoll + poll_interval)) {
 			return;
@@ -1082,12 +1099,17 @@ void upsdrv_updateinfo(void)
 			hd = NULL;
 			return;
 		}
+
+#if !((defined SHUT_MODE) && SHUT_MODE)
+		interrupt_async_start();
+#endif	/* !SHUT_MODE => USB */
 	}
 #ifdef DEBUG
 	interval();
 #endif
 
 	/* Get HID notifications on Interrupt pipe first */
+next_report:
 	if (use_interrupt_pipe == TRUE) {
 		evtCount = HIDGetEvents(udev, event, MAX_EVENT_NUM);
 		switch (evtCount)
@@ -1125,11 +1147,16 @@ void upsdrv_updateinfo(void)
 		upsdebugx(1, "Not using interrupt pipe...");
 	}
 
+	/* Decode all events from the interrupt report at once */
+	if (evtCount > 0 && HIDGetEventValues(udev, event, evtCount, evtValue) != evtCount) {
+		upsdebugx(1, "Can't decode HID objects from interrupt report");
+		evtCount = 0;
+	}
+
 	/* Process pending events (HID notifications on Interrupt pipe) */
 	for (i = 0; i < evtCount; i++) {
 
-		if (HIDGetDataValue(udev, event[i], &value, poll_interval) != 1)
-			continue;
+		value = evtValue[i];
 
 		if (nut_debug_level >= 2) {
 			upsdebugx(2,
@@ -1157,6 +1184,12 @@ void upsdrv_updateinfo(void)
 
 		ups_infoval_set(item, value);
 	}
+
+	/* With asynchronous interrupt transfers, more reports may be queued
+	 * already: take them in too (bounded, should the device flood us) */
+	if (VALID_FD(extrafd) && evtCount > 0 && ++reports < MAX_EVENT_NUM) {
+		goto next_report;
+	}
 #ifdef DEBUG
 	upsdebugx(1, "took %.3f seconds handling interrupt reports...\n",
 		interval());
@@ -1220,6 +1253,13 @@ void upsdrv_initinfo(void)
 
 	time(&lastpoll);
 
+#if !((defined SHUT_MODE) && SHUT_MODE)
+	if (testvar("asyncinterrupt")) {
+		async_interrupt = 1;
+	}
+	interrupt_async_start();
+#endif	/* !SHUT_MODE => USB */
+
 	/* install handlers */
 	upsh.setvar = setvar;
 	upsh.instcmd = instcmd;
@@ -1382,6 +1422,8 @@ void upsdrv_initups(void)
 		fatalx(EXIT_FAILURE, "Can't initialize data from HID UPS");
 	}
 
+	hidcache_store();
+
 	if (dstate_getinfo("battery.charge.low")) {
 		/* Retrieve user defined battery settings */
 		val = getval(HU_VAR_LOWBATT);
@@ -1427,9 +1469,12 @@ void upsdrv_cleanup(void)
 {
 	upsdebugx(1, "upsdrv_cleanup...");
 
+	/* keep refusals which were cleared since initialization */
+	hidcache_store();
 	comm_driver->close_dev(udev);
 	Free_ReportDesc(pDesc);
 	free_report_buffer(reportbuf);
+	hidcache_free();
 #if !((defined SHUT_MODE) && SHUT_MODE)
 	USBFreeExactMatcher(exact_matcher);
 	USBFreeRegexMatcher(regex_matcher);
@@ -1491,6 +1536,39 @@ static void process_boolean_info(const char *nutvalue)
 	upsdebugx(5, "Warning: %s not in list of known values", nutvalue);
 }
 
+/**********************************************************************
+ * Report descriptor and mapping cache
+ *********************************************************************/
+
+/* The parsed (and fixed up) report descriptor of the device, and the
+ * outcome of the NUT-to-HID mapping of the subdriver, are remembered in
+ * a usbhid-ups-<upsname>.hid file in the state path. When the device
+ * presents the same report descriptor on the next start, its parsing,
+ * the look-ups of the HID paths and the reading of the items which
+ * the device refused before are skipped; the items which worked are still
+ * read by the initial data walk, which validates what was remembered.
+ * This is only done with the "hidcache" flag. Remove that file to go
+ * through everything again. */
+
+/* Where the "hidcache" flag remembers them, or NULL without it */
+static const char *hidcache_path(char *buf, size_t buf_len)
+{
+	if (!testvar("hidcache")) {
+		return NULL;
+	}
+
+	snprintf(buf, buf_len, "%s/usbhid-ups-%s.hid", dflt_statepath(),
+		upsname ? upsname : device_name);
+	return buf;
+}
+
+static void hidcache_store(void)
+{
+	char	fn[LARGEBUF];
+
+	hidcache_save(hidcache_path(fn, sizeof(fn)), hd, pDesc);
+}
+
 static int callback(
 	hid_dev_handle_t argudev,
 	HIDDevice_t *arghd,
@@ -1499,6 +1577,7 @@ static int callback(
 {
 	int i;
 	const char *mfr = NULL, *model = NULL, *serial = NULL;
+	char fn[LARGEBUF];
 #if !((defined SHUT_MODE) && SHUT_MODE)
 	int ret;
 #endif	/* !SHUT_MODE => USB */
@@ -1527,23 +1606,6 @@ static int callback(
 	hd = arghd;
 	udev = argudev;
 
-	/* Parse Report Descriptor */
-	Free_ReportDesc(pDesc);
-	pDesc = Parse_ReportDesc(rdbuf, rdlen);
-	if (!pDesc) {
-		upsdebug_with_errno(1, "Failed to parse report descriptor!");
-		return 0;
-	}
-
-	/* prepare report buffer */
-	free_report_buffer(reportbuf);
-	reportbuf = new_report_buffer(pDesc);
-	if (!reportbuf) {
-		upsdebug_with_errno(1, "Failed to allocate report buffer!");
-		Free_ReportDesc(pDesc);
-		return 0;
-	}
-
 	/* select the subdriver for this device */
 	subdriver = match_function_subdriver_name(0);
 	if (!subdriver) {
@@ -1563,9 +1625,32 @@ static int callback(
 
 	upslogx(2, "Using subdriver: %s", subdriver->name);
 
-	if (subdriver->fix_report_desc(arghd, pDesc)) {
-		upsdebugx(2, "Report Descriptor Fixed");
+	/* Parse Report Descriptor, unless it is remembered from last time */
+	Free_ReportDesc(pDesc);
+	hidcache_init(subdriver->hid2nut, subdriver->name, disable_fix_report_desc);
+	pDesc = hidcache_load(hidcache_path(fn, sizeof(fn)), arghd, rdbuf, rdlen);
+	if (!pDesc) {
+		pDesc = Parse_ReportDesc(rdbuf, rdlen);
+		if (!pDesc) {
+			upsdebug_with_errno(1, "Failed to parse report descriptor!");
+			return 0;
+		}
+
+		if (subdriver->fix_report_desc(arghd, pDesc)) {
+			upsdebugx(2, "Report Descriptor Fixed");
+		}
+	}
+
+	/* prepare report buffer */
+	free_report_buffer(reportbuf);
+	reportbuf = new_report_buffer(pDesc);
+	if (!reportbuf) {
+		upsdebug_with_errno(1, "Failed to allocate report buffer!");
+		Free_ReportDesc(pDesc);
+		pDesc = NULL;
+		return 0;
 	}
+
 	HIDDumpTree(udev, arghd, subdriver->utab);
 
 #if !((defined SHUT_MODE) && SHUT_MODE)
@@ -1675,7 +1760,9 @@ static bool_t hid_ups_walk(walkmode_t mode)
 				break;
 
 			/* Create the NUT-to-HID mapping */
-			item->hiddata = HIDGetItemData(item->hidpath, subdriver->utab);
+			item->hiddata = hidcache_item_data(
+				(size_t)(item - subdriver->hid2nut),
+				item->hidpath, subdriver->utab);
 			if (item->hiddata == NULL)
 				continue;
 
@@ -1766,7 +1853,11 @@ static bool_t hid_ups_walk(walkmode_t mode)
 		}
 #endif	/* !SHUT_MODE => USB */
 
-		retcode = HIDGetDataValue(udev, item->hiddata, &value, poll_interval);
+		/* Also skips, at initialization, what the device
+		 * refused at a previous start */
+		retcode = hidcache_get_value(udev,
+			(size_t)(item - subdriver->hid2nut), item->hiddata,
+			&value, poll_interval, (mode == HU_WALKMODE_INIT));
 
 		switch (retcode)
 		{
@@ -1801,6 +1892,7 @@ static bool_t hid_ups_walk(walkmode_t mode)
 			break;	/* Found! */
 
 		case 0:
+		case LIBUSB_ERROR_PIPE:      /* Stall: the device refused this item */
 			continue;
 
 		case LIBUSB_ERROR_TIMEOUT:   /* Connection timed out */
@@ -1812,7 +1904,6 @@ static bool_t hid_ups_walk(walkmode_t mode)
 		case -EPROTO:		/* Protocol error */
 # endif
 #endif
-		case LIBUSB_ERROR_PIPE:      /* Broken pipe */
 		default:
 			/* Don't know what happened, try again later... */
 		   upsdebugx(1, "HIDGetDataValue unknown retcode '%i'", retcode);
@@ -1911,6 +2002,33 @@ static int reconnect_ups(void)
 	return 0;
 }
 
+#if !((defined SHUT_MODE) && SHUT_MODE)
+/* Have the interrupt pipe read in the background if asked to, and the
+ * main loop woken up (through extrafd) as soon as a report comes in */
+static void interrupt_async_start(void)
+{
+	int	fd;
+	size_t	size = (interrupt_size > 0 && interrupt_size < SMALLBUF)
+		? interrupt_size : SMALLBUF;
+
+	extrafd = ERROR_FD;
+
+	if (!async_interrupt || use_interrupt_pipe != TRUE) {
+		return;
+	}
+
+	fd = (comm_driver->start_interrupt_async == NULL) ? -1
+		: comm_driver->start_interrupt_async(udev, (usb_ctrl_charbufsize)size);
+	if (fd < 0) {
+		upslogx(LOG_WARNING, "Asynchronous interrupt pipe reading is not "
+			"available, reading it once per update instead");
+		return;
+	}
+
+	extrafd = fd;
+}
+#endif	/* !SHUT_MODE => USB */
+
 /* Convert the local status information to NUT format and set NUT
    alarms. */
 static void ups_alarm_set(void)
@@ -545,6 +545,18 @@ size_t strnlen(const char *s, size_t maxlen);
 /* TODO: Extend for TYPE_FD and WIN32 eventually? */
 void set_close_on_exec(int fd);
 
+#ifndef WIN32
+/* Start a helper command (e.g. NOTIFYCMD or CMDSCRIPT) without waiting
+ * for it. Unless cmd has characters meaningful to the shell, it is split
+ * on spaces and run directly, with the args (NULL-terminated, may be NULL)
+ * as separate arguments after its own. Otherwise /bin/sh -c runs shellcmd
+ * (cmd with the args, quoted as the caller needs), or cmd if it is NULL.
+ * If input is not NULL, it is written to the standard input of the helper
+ * (SIGPIPE should be ignored, in case the helper does not read it).
+ * Returns the PID of the helper, or -1 with errno set. */
+pid_t nut_spawn_command(const char *cmd, char *const args[], const char *shellcmd, const char *input);
+#endif
+
 #ifdef __cplusplus
 /* *INDENT-OFF* */
 }
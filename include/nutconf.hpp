@@ -1663,6 +1663,7 @@ public:
 	inline bool getNoWait()            const { return getFlag("nowait"); }
 
 	inline long long int getDebugMin()      const { return getInt("debug_min"); }
+	inline long long int getMaxParallel()   const { return getInt("maxparallel"); }
 	inline long long int getMaxRetry()      const { return getInt("maxretry"); }
 	inline long long int getMaxStartDelay() const { return getInt("maxstartdelay"); }
 	inline long long int getPollInterval()  const { return getInt("pollinterval", 5); }  // TODO: check the default
@@ -1677,6 +1678,7 @@ public:
 	inline void setNoWait(bool val = true)              { setFlag("nowait",    val); }
 
 	inline void setDebugMin(long long int num)          { setInt("debug_min",     num); }
+	inline void setMaxParallel(long long int num)       { setInt("maxparallel",   num); }
 	inline void setMaxRetry(long long int num)          { setInt("maxretry",      num); }
 	inline void setMaxStartDelay(long long int delay)   { setInt("maxstartdelay", delay); }
 	inline void setPollInterval(long long int interval) { setInt("pollinterval",  interval); }
@@ -1766,6 +1768,7 @@ public:
 	inline std::string getModelName(const std::string & ups)           const { return getStr(ups, "modelname"); }
 	inline std::string getNotification(const std::string & ups)        const { return getStr(ups, "notification"); }
 	inline std::string getPassword(const std::string & ups)            const { return getStr(ups, "password"); }
+	inline std::string getPollIntervalWatch(const std::string & ups)   const { return getStr(ups, "pollinterval_watch"); }
 	inline std::string getPort(const std::string & ups)                const { return getStr(ups, "port"); }
 	inline std::string getPrefix(const std::string & ups)              const { return getStr(ups, "prefix"); }
 	inline std::string getPrivPassword(const std::string & ups)        const { return getStr(ups, "privPassword"); }
@@ -1909,6 +1912,8 @@ public:
 	inline long long int getOutputPhaseAngle(const std::string & ups)          const { return getInt(ups, "output_phase_angle"); }
 	inline long long int getPinsShutdownMode(const std::string & ups)          const { return getInt(ups, "pins_shutdown_mode"); }
 	inline long long int getPollFreq(const std::string & ups)                  const { return getInt(ups, "pollfreq"); }            // CHECKME
+	inline long long int getPollIntervalAlert(const std::string & ups)         const { return getInt(ups, "pollinterval_alert"); }
+	inline long long int getPollIntervalStable(const std::string & ups)        const { return getInt(ups, "pollinterval_stable"); }
 	inline long long int getPowerUp(const std::string & ups)                   const { return getInt(ups, "powerup"); }             // CHECKME
 	inline long long int getPrgShut(const std::string & ups)                   const { return getInt(ups, "prgshut"); }             // CHECKME
 	inline long long int getRebootDelay(const std::string & ups)               const { return getInt(ups, "rebootdelay"); }         // CHECKME
@@ -1919,6 +1924,7 @@ public:
 	inline long long int getShutdownDuration(const std::string & ups)          const { return getInt(ups, "shutdown_duration"); }
 	inline long long int getShutdownTimer(const std::string & ups)             const { return getInt(ups, "shutdown_timer"); }
 	inline long long int getSlaveAddress(const std::string & ups)              const { return getInt(ups, "slave_address"); }
+	inline long long int getSnmpBulkMaxRep(const std::string & ups)            const { return getInt(ups, "snmp_bulk_maxrep"); }
 	inline long long int getSnmpRetries(const std::string & ups)               const { return getInt(ups, "snmp_retries"); }
 	inline long long int getSnmpTimeout(const std::string & ups)               const { return getInt(ups, "snmp_timeout"); }
 	inline long long int getStartDelay(const std::string & ups)                const { return getInt(ups, "startdelay"); }          // CHECKME
@@ -1964,6 +1970,7 @@ public:
 	inline bool getNoWarnNoImp(const std::string & ups)    const { return getFlag(ups, "nowarn_noimp"); }
 	inline bool getOldMAC(const std::string & ups)         const { return getFlag(ups, "oldmac"); }
 	inline bool getPollOnly(const std::string & ups)       const { return getFlag(ups, "pollonly"); }
+	inline bool getPublishStats(const std::string & ups)   const { return getFlag(ups, "publish_stats"); }
 	inline bool getSilent(const std::string & ups)         const { return getFlag(ups, "silent"); }
 	inline bool getStatusOnly(const std::string & ups)     const { return getFlag(ups, "status_only"); }
 	inline bool getSubscribe(const std::string & ups)      const { return getFlag(ups, "subscribe"); }
@@ -2011,6 +2018,7 @@ public:
 	inline void setModelName(const std::string & ups, const std::string & modelname)          { setStr(ups, "modelname",           modelname); }
 	inline void setNotification(const std::string & ups, const std::string & notification)    { setStr(ups, "notification",        notification); }
 	inline void setPassword(const std::string & ups, const std::string & password)            { setStr(ups, "password",            password); }
+	inline void setPollIntervalWatch(const std::string & ups, const std::string & watch)       { setStr(ups, "pollinterval_watch",  watch); }
 	inline void setPort(const std::string & ups, const std::string & port)                    { setStr(ups, "port",                port); }
 	inline void setPrefix(const std::string & ups, const std::string & prefix)                { setStr(ups, "prefix",              prefix); }
 	inline void setPrivPassword(const std::string & ups, const std::string & priv_passwd)     { setStr(ups, "privPassword",        priv_passwd); }
@@ -2122,6 +2130,8 @@ public:
 	inline void setOutputPhaseAngle(const std::string & ups, long long int val)               { setInt(ups, "output_phase_angle",  val); }
 	inline void setPinsShutdownMode(const std::string & ups, long long int val)               { setInt(ups, "pins_shutdown_mode",  val); }
 	inline void setPollFreq(const std::string & ups, long long int pollfreq)                  { setInt(ups, "pollfreq",            pollfreq); }     // CHECKME
+	inline void setPollIntervalAlert(const std::string & ups, long long int interval)         { setInt(ups, "pollinterval_alert",  interval); }
+	inline void setPollIntervalStable(const std::string & ups, long long int interval)        { setInt(ups, "pollinterval_stable", interval); }
 	inline void setPowerUp(const std::string & ups, long long int powerup)                    { setInt(ups, "powerup",             powerup); }      // CHECKME
 	inline void setPrgShut(const std::string & ups, long long int prgshut)                    { setInt(ups, "prgshut",             prgshut); }      // CHECKME
 	inline void setRebootDelay(const std::string & ups, long long int delay)                  { setInt(ups, "rebootdelay",         delay); }        // CHECKME
@@ -2132,6 +2142,7 @@ public:
 	inline void setShutdownDuration(const std::string & ups, long long int val)               { setInt(ups, "shutdown_duration",   val); }
 	inline void setShutdownTimer(const std::string & ups, long long int val)                  { setInt(ups, "shutdown_timer",      val); }
 	inline void setSlaveAddress(const std::string & ups, long long int val)                   { setInt(ups, "slave_address",       val); }
+	inline void setSnmpBulkMaxRep(const std::string & ups, long long int val)                 { setInt(ups, "snmp_bulk_maxrep",    val); }
 	inline void setSnmpRetries(const std::string & ups, long long int val)                    { setInt(ups, "snmp_retries",        val); }
 	inline void setSnmpTimeout(const std::string & ups, long long int val)                    { setInt(ups, "snmp_timeout",        val); }
 	inline void setStartDelay(const std::string & ups, long long int delay)                   { setInt(ups, "startdelay",          delay); }        // CHECKME
@@ -2209,6 +2220,7 @@ public:
 	inline void setNoWarnNoImp(const std::string & ups, bool set = true)    { setFlag(ups, "nowarn_noimp",   set); }
 	inline void setOldMAC(const std::string & ups, bool set = true)         { setFlag(ups, "oldmac",         set); }
 	inline void setPollOnly(const std::string & ups, bool set = true)       { setFlag(ups, "pollonly",       set); }
+	inline void setPublishStats(const std::string & ups, bool set = true)   { setFlag(ups, "publish_stats",  set); }
 	inline void setSilent(const std::string & ups, bool set = true)         { setFlag(ups, "silent",         set); }
 	inline void setStatusOnly(const std::string & ups, bool set = true)     { setFlag(ups, "status_only",    set); }	// aka OPTI_MINPOLL
 	inline void setSubscribe(const std::string & ups, bool set = true)      { setFlag(ups, "subscribe",      set); }
@@ -76,6 +76,8 @@ if test -z "${nut_have_neon_seen}"; then
 	if test "${nut_have_neon}" = "yes"; then
 		dnl Check for connect timeout support in library (optional)
 		AC_CHECK_FUNCS(ne_set_connect_timeout ne_sock_connect_timeout)
+		dnl Check for response header access (optional, neon 0.26+)
+		AC_CHECK_FUNCS(ne_get_response_header)
 		LIBNEON_CFLAGS="${CFLAGS}"
 		LIBNEON_LIBS="${LIBS}"
 
@@ -35,6 +35,7 @@ let ups_global   = "chroot"
                  | "driverpath"
                  | "maxstartdelay"
                  | "maxretry"
+                 | "maxparallel"
                  | "nowait"
                  | "retrydelay"
                  | "pollinterval"
@@ -52,6 +53,10 @@ let ups_fields   = "driver"
                  | "desc"
                  | "nolock"
                  | "ignorelb"
+                 | "publish_stats"
+                 | "pollinterval_alert"
+                 | "pollinterval_stable"
+                 | "pollinterval_watch"
                  | "maxstartdelay"
                  | "synchronous"
                  | "user"
@@ -24,6 +24,7 @@
 #include "upsd.h"
 #include "sstate.h"
 #include "state.h"
+#include "desc.h"
 #include "neterr.h"
 
 #include "netlist.h"
@@ -127,6 +128,102 @@ static void list_var(nut_ctype_t *client, const char *upsname)
 	sendback(client, "END LIST VAR %s\n", upsname);
 }
 
+/* all the metadata of a variable, in the order: VALUE, TYPE, DESC, ENUM, RANGE */
+static int varinfo_dump(const st_tree_t *node, nut_ctype_t *client, const char *ups,
+	int fsd)
+{
+	char	buf[SMALLBUF];
+	const	char	*desc;
+	const	enum_t	*etmp;
+	const	range_t	*rtmp;
+
+	if (!node)
+		return 1;	/* not an error */
+
+	if (node->left) {
+		if (!varinfo_dump(node->left, client, ups, fsd))
+			return 0;		/* write failed in child */
+	}
+
+	/* status is always a special case */
+	if ((fsd == 1) && (!strcasecmp(node->var, "ups.status"))) {
+		if (!sendback(client, "VARINFO %s %s VALUE \"FSD %s\"\n",
+			ups, node->var, node->val))
+			return 0;
+
+	} else {
+		if (!sendback(client, "VARINFO %s %s VALUE \"%s\"\n",
+			ups, node->var, node->val))
+			return 0;
+	}
+
+	/* same words as the answer to GET TYPE */
+	snprintf(buf, sizeof(buf), "VARINFO %s %s TYPE", ups, node->var);
+
+	if (node->flags & ST_FLAG_RW)
+		snprintfcat(buf, sizeof(buf), " RW");
+
+	if (node->enum_list)
+		snprintfcat(buf, sizeof(buf), " ENUM");
+
+	if (node->range_list)
+		snprintfcat(buf, sizeof(buf), " RANGE");
+
+	if (node->flags & ST_FLAG_STRING)
+		snprintfcat(buf, sizeof(buf), " STRING:%ld", node->aux);
+	else
+		snprintfcat(buf, sizeof(buf), " NUMBER");
+
+	if (!sendback(client, "%s\n", buf))
+		return 0;
+
+	desc = desc_get_var(node->var);
+
+	if (!sendback(client, "VARINFO %s %s DESC \"%s\"\n", ups, node->var,
+		desc ? desc : "Description unavailable"))
+		return 0;
+
+	for (etmp = node->enum_list; etmp != NULL; etmp = etmp->next) {
+		if (!sendback(client, "VARINFO %s %s ENUM \"%s\"\n",
+			ups, node->var, etmp->val))
+			return 0;
+	}
+
+	for (rtmp = node->range_list; rtmp != NULL; rtmp = rtmp->next) {
+		if (!sendback(client, "VARINFO %s %s RANGE \"%i\" \"%i\"\n",
+			ups, node->var, rtmp->min, rtmp->max))
+			return 0;
+	}
+
+	if (node->right)
+		return varinfo_dump(node->right, client, ups, fsd);
+
+	return 1;
+}
+
+static void list_varinfo(nut_ctype_t *client, const char *upsname)
+{
+	const   upstype_t *ups;
+
+	ups = get_ups_ptr(upsname);
+
+	if (!ups) {
+		send_err(client, NUT_ERR_UNKNOWN_UPS);
+		return;
+	}
+
+	if (!ups_available(ups, client))
+		return;
+
+	if (!sendback(client, "BEGIN LIST VARINFO %s\n", upsname))
+		return;
+
+	if (!varinfo_dump(ups->inforoot, client, upsname, ups->fsd))
+		return;
+
+	sendback(client, "END LIST VARINFO %s\n", upsname);
+}
+
 static void list_cmd(nut_ctype_t *client, const char *upsname)
 {
 	const   upstype_t *ups;
@@ -315,6 +412,12 @@ void net_list(nut_ctype_t *client, size_t numarg, const char **arg)
 		return;
 	}
 
+	/* LIST VARINFO UPS */
+	if (!strcasecmp(arg[0], "VARINFO")) {
+		list_varinfo(client, arg[1]);
+		return;
+	}
+
 	/* LIST CMD UPS */
 	if (!strcasecmp(arg[0], "CMD")) {
 		list_cmd(client, arg[1]);
@@ -37,7 +37,7 @@
 #include "usb-common.h"
 #include "common.h"
 
-void GetValue(const unsigned char *Buf, HIDData_t *pData, long *pValue);
+#include "hidparser.h"
 
 static void Usage(char *name) {
 	printf("%s [<buf> <offset> <size> <min> <max> <expect>]\n", name);
@@ -64,6 +64,255 @@ static void PrintBufAndData(uint8_t *buf, size_t bufSize, HIDData_t *pData) {
 		pData->Offset, pData->Size, pData->LogMin, pData->LogMin, pData->LogMax, pData->LogMax);
 }
 
+/* The decoding as it was done before HIDDecoder_t precomputation,
+ * bit by bit, to check the current GetValue() against it */
+static unsigned int OldHibit(unsigned long x)
+{
+	unsigned int	res = 0;
+
+	while (x > 0xff) {
+		x >>= 8;
+		res += 8;
+	}
+
+	while (x) {
+		x >>= 1;
+		res += 1;
+	}
+
+	return res;
+}
+
+static long OldGetValue(const unsigned char *Buf, const HIDData_t *pData)
+{
+	int	Weight, Bit;
+	unsigned long	mask, signbit, magMax, magMin;
+	long	value = 0;
+
+	Bit = pData->Offset + 8;	/* First byte of report is report ID */
+
+	for (Weight = 0; Weight < pData->Size; Weight++, Bit++) {
+		int	State = Buf[Bit >> 3] & (1 << (Bit & 7));
+
+		if (State) {
+			value += (1L << Weight);
+		}
+	}
+
+	magMax = pData->LogMax >= 0 ? (unsigned long)(pData->LogMax) : (unsigned long)(-(pData->LogMax + 1));
+	magMin = pData->LogMin >= 0 ? (unsigned long)(pData->LogMin) : (unsigned long)(-(pData->LogMin + 1));
+	signbit = 1L << OldHibit(magMax > magMin ? magMax : magMin);
+	mask = (signbit - 1) | ((pData->LogMin < 0) ? signbit : 0);
+
+	value = (long)((unsigned long)(value) & mask);
+
+	if (pData->LogMin < 0 && ((unsigned long)(value) & signbit) != 0) {
+		value |= ~mask;
+	}
+
+	if (value < pData->LogMin) {
+		value = pData->LogMin;
+	} else if (value > pData->LogMax) {
+		value = pData->LogMax;
+	}
+
+	return value;
+}
+
+/* The logical to physical conversion as it was done in libhid.c
+ * before HIDDecoder_t precomputation, with the unit exponent */
+static double OldExponent(double a, int8_t b)
+{
+	if (b > 0)
+		return (a * OldExponent(a, --b));
+
+	if (b < 0)
+		return ((1/a) * OldExponent(a, ++b));
+
+	return 1;
+}
+
+static double OldGetPhysicalValue(const HIDData_t *pData, long logical)
+{
+	double	physical, Factor;
+	int8_t	unit_expo = pData->UnitExp;
+
+	/* Voltage and VA/Watts units are the ones with a base exponent */
+	if (pData->Unit == 0x00F0D121 || pData->Unit == 0x0000D121) {
+		unit_expo -= 7;
+	}
+
+	if (!pData->have_PhyMax || !pData->have_PhyMin
+	 || (pData->PhyMax == 0 && pData->PhyMin == 0)
+	 || (pData->PhyMax <= pData->PhyMin) || (pData->LogMax <= pData->LogMin)
+	) {
+		physical = (double)logical;
+	} else {
+		Factor = (double)(pData->PhyMax - pData->PhyMin) / (pData->LogMax - pData->LogMin);
+		physical = (double)((logical - pData->LogMin) * Factor) + pData->PhyMin;
+
+		if (physical > pData->PhyMax) {
+			physical = pData->PhyMax;
+		} else if (physical < pData->PhyMin) {
+			physical = pData->PhyMin;
+		}
+	}
+
+	return physical * OldExponent(10, unit_expo);
+}
+
+/* Decode items of all offsets and sizes (up to a long) with signed and
+ * unsigned logical ranges from pseudo-random reports, both ways */
+static int CompareWithOldGetValue(void)
+{
+	unsigned char	reportBuf[16];
+	HIDData_t	data;
+	unsigned int	seed = 1023, tests = 0, failed = 0;
+	int	Offset, Size, range, round;
+	size_t	i;
+	long	value, expected, smax;
+
+	for (Size = 1; Size <= 32 && (size_t)Size < sizeof(long) * 8; Size++) {
+		smax = (long)((1UL << (Size - 1)) - 1);
+
+		for (Offset = 0; Offset < 32; Offset++) {
+			for (range = 0; range < 6; range++) {
+				memset((void *)&data, 0, sizeof(data));
+				data.Offset = (uint8_t)Offset;
+				data.Size = (uint8_t)Size;
+
+				switch (range) {
+				case 0:	/* unsigned, full size */
+					data.LogMin = 0;
+					data.LogMax = 2 * smax + 1;
+					break;
+				case 1:	/* signed, full size */
+					data.LogMin = -smax - 1;
+					data.LogMax = smax;
+					break;
+				case 2:	/* unsigned, smaller than the size */
+					data.LogMin = 0;
+					data.LogMax = smax / 3;
+					break;
+				case 3:	/* signed, smaller than the size */
+					data.LogMin = -(smax / 3) - 1;
+					data.LogMax = smax / 5;
+					break;
+				case 4:	/* signed, only -1 below zero */
+					data.LogMin = -1;
+					data.LogMax = smax;
+					break;
+				default:	/* unsigned, not starting at zero */
+					data.LogMin = smax / 7;
+					data.LogMax = smax;
+					break;
+				}
+
+				for (round = 0; round < 8; round++) {
+					for (i = 0; i < sizeof(reportBuf); i++) {
+						seed = seed * 1103515245U + 12345U;
+						reportBuf[i] = (unsigned char)(seed >> 16);
+					}
+
+					GetValue(reportBuf, &data, &value);
+					expected = OldGetValue(reportBuf, &data);
+					tests++;
+
+					if (value != expected) {
+						printf("Decoder test ");
+						PrintBufAndData(reportBuf, sizeof(reportBuf), &data);
+						printf(" value %ld FAIL expected %ld\n", value, expected);
+						failed++;
+					}
+				}
+			}
+		}
+	}
+
+	printf("Decoder tests: %u of %u values differ from the former computation - %s\n",
+		failed, tests, failed ? "FAIL" : "PASS");
+
+	return (failed != 0);
+}
+
+/* Convert logical values to physical ones, with and without a linear
+ * conversion, clamping and unit exponents, both ways */
+static int CompareWithOldPhysicalValue(void)
+{
+	static struct {
+		long Unit;		/* HID unit */
+		int8_t UnitExp;		/* Unit exponent of the item */
+		long LogMin, LogMax;	/* logical minimum and maximum values */
+		int8_t have_Phy;	/* physical minimum and maximum defined? */
+		long PhyMin, PhyMax;	/* physical minimum and maximum values */
+		long logical;		/* logical value */
+		double expectedValue;	/* the expected physical value */
+	} testData[] = {
+		/* logical is physical, no unit */
+		{ 0, 0, 0, 255, 0, 0, 0, 100, 100 },
+		{ 0, 0, -128, 127, 0, 0, 0, -42, -42 },
+		/* both physical extents are 0: logical is physical */
+		{ 0, 0, 0, 255, 1, 0, 0, 200, 200 },
+		/* physical extents are inverted: logical as is */
+		{ 0, 0, 0, 255, 1, 10, 5, 200, 200 },
+		/* linear conversion, and its clamping */
+		{ 0, 0, 0, 255, 1, 0, 1000, 51, 200 },
+		{ 0, 0, -100, 100, 1, 0, 50, 0, 25 },
+		{ 0, 0, 0, 100, 1, 10, 20, 150, 20 },
+		{ 0, 0, 10, 100, 1, 10, 20, 0, 10 },
+		/* Voltage: the unit exponent of 7 is the base */
+		{ 0x00F0D121, 7, 0, 65535, 0, 0, 0, 230, 230 },
+		{ 0x00F0D121, 5, 0, 65535, 0, 0, 0, 23012, 230.12 },
+		{ 0x00F0D121, 6, 0, 255, 1, 0, 2550, 23, 23 },
+		/* Watts */
+		{ 0x0000D121, 8, 0, 65535, 0, 0, 0, 12, 120 },
+		/* Ampere, second, Hertz: no base exponent */
+		{ 0x00100001, -2, 0, 65535, 0, 0, 0, 1234, 12.34 },
+		{ 0x00001001, 1, 0, 65535, 0, 0, 0, 30, 300 },
+		{ 0x0000F001, -1, 0, 65535, 0, 0, 0, 500, 50 },
+		/* signed current through a linear conversion */
+		{ 0x00100001, -1, -32768, 32767, 1, -32768, 32767, -1000, -100 }
+	};
+	HIDData_t	data;
+	size_t	i;
+	int	exitStatus = 0;
+	double	value, expected;
+
+	for (i = 0; i < SIZEOF_ARRAY(testData); i++) {
+		memset((void *)&data, 0, sizeof(data));
+		data.Unit = testData[i].Unit;
+		data.UnitExp = testData[i].UnitExp;
+		data.LogMin = testData[i].LogMin;
+		data.LogMax = testData[i].LogMax;
+		data.have_PhyMin = data.have_PhyMax = testData[i].have_Phy;
+		data.PhyMin = testData[i].PhyMin;
+		data.PhyMax = testData[i].PhyMax;
+
+		value = GetPhysicalValue(&data, testData[i].logical);
+		expected = OldGetPhysicalValue(&data, testData[i].logical);
+
+		printf("Physical test #%" PRIiSIZE " unit 0x%08lx exp %d logical %ld [%ld..%ld] physical [%ld..%ld]%s",
+			i + 1, data.Unit, data.UnitExp, testData[i].logical,
+			data.LogMin, data.LogMax, data.PhyMin, data.PhyMax,
+			data.have_PhyMin ? "" : " (undefined)");
+
+		/* the same computation gives the same result, exactly;
+		 * the expected values are only as exact as decimals go */
+		if (value == expected
+		 && value - testData[i].expectedValue < 1e-9
+		 && testData[i].expectedValue - value < 1e-9
+		) {
+			printf(" value %g PASS\n", value);
+		} else {
+			printf(" value %g FAIL expected %g (former computation %g)\n",
+				value, testData[i].expectedValue, expected);
+			exitStatus = 1;
+		}
+	}
+
+	return exitStatus;
+}
+
 static int RunBuiltInTests(char *argv[]) {
 	int exitStatus = 0;
 	size_t i;
@@ -133,6 +382,14 @@ static int RunBuiltInTests(char *argv[]) {
 		}
 	}
 
+	if (CompareWithOldGetValue() != 0) {
+		exitStatus = 1;
+	}
+
+	if (CompareWithOldPhysicalValue() != 0) {
+		exitStatus = 1;
+	}
+
 	/* Emulate rdlen calculations in libusb{0,1}.c or
 	 * langid calculations in nutdrv_qx.c; in these
 	 * cases we take two bytes (cast from usb_ctrl_char
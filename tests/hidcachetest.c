@@ -0,0 +1,199 @@
+/* hidcachetest.c - check that usbhid-ups remembers the items a device
+ * refused (drivers/hidcache.c), and does not read them again at the next
+ * start, with libhid.c reading a fake device
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "hidcache.h"
+#include "hidparser.h"
+
+/* Usually provided by usbhid-ups.c and libusb{0,1}.c */
+HIDDesc_t	*pDesc = NULL;
+reportbuf_t	*reportbuf = NULL;
+communication_subdriver_t	usb_subdriver;
+
+/* UPS.PowerSummary.{Voltage,Current,Frequency} as features in
+ * reports 1, 2 and 3 */
+static unsigned char	rdesc[] = {
+	0x05, 0x84, 0x09, 0x04, 0xa1, 0x01, 0x09, 0x24, 0xa1, 0x02,
+	0x75, 0x08, 0x95, 0x01, 0x15, 0x00, 0x26, 0xff, 0x00,
+	0x85, 0x01, 0x09, 0x30, 0xb1, 0x02,
+	0x85, 0x02, 0x09, 0x31, 0xb1, 0x02,
+	0x85, 0x03, 0x09, 0x32, 0xb1, 0x02,
+	0xc0, 0xc0
+};
+
+static usage_lkp_t	test_usage_lkp[] = {
+	{ "UPS",		0x00840004 },
+	{ "PowerSummary",	0x00840024 },
+	{ "Voltage",		0x00840030 },
+	{ "Current",		0x00840031 },
+	{ "Frequency",		0x00840032 },
+	{ NULL, 0 }
+};
+
+static usage_tables_t	test_utab[] = { test_usage_lkp, NULL };
+
+static hid_info_t	test_hid2nut[] = {
+	{ "input.voltage", 0, 0, "UPS.PowerSummary.Voltage", NULL, "%.0f", 0, NULL },
+	{ "input.current", 0, 0, "UPS.PowerSummary.Current", NULL, "%.0f", 0, NULL },
+	{ "input.frequency", 0, 0, "UPS.PowerSummary.Frequency", NULL, "%.0f", 0, NULL },
+	{ NULL, 0, 0, NULL, NULL, NULL, 0, NULL }
+};
+
+#define NITEMS	3
+
+/* The fake device stalls on what is refused, times out on what is
+ * busy, and counts the requests for each report */
+static int	refused[NITEMS + 1], busy[NITEMS + 1], requests[NITEMS + 1];
+
+static int fake_get_report(usb_dev_handle *sdev, usb_ctrl_repindex ReportId,
+	usb_ctrl_charbuf raw_buf, usb_ctrl_charbufsize ReportSize)
+{
+	NUT_UNUSED_VARIABLE(sdev);
+
+	if (ReportId < 1 || ReportId > NITEMS || ReportSize < 2) {
+		return LIBUSB_ERROR_INVALID_PARAM;
+	}
+
+	requests[ReportId]++;
+	if (refused[ReportId]) {
+		return LIBUSB_ERROR_PIPE;
+	}
+	if (busy[ReportId]) {
+		return LIBUSB_ERROR_TIMEOUT;
+	}
+
+	raw_buf[0] = (unsigned char)ReportId;
+	raw_buf[1] = (unsigned char)(100 + ReportId);
+	return 2;
+}
+
+static HIDDevice_t	dev;
+static char	fn[SMALLBUF];
+
+/* (Re)start of the driver: remembered report descriptor, or parsed one */
+static int start(int expect_remembered)
+{
+	Free_ReportDesc(pDesc);
+	free_report_buffer(reportbuf);
+
+	hidcache_init(test_hid2nut, "test", 0);
+	pDesc = hidcache_load(fn, &dev, rdesc, sizeof(rdesc));
+	if ((pDesc != NULL) != expect_remembered) {
+		printf("=== report descriptor %s, expected %s (FAIL)\n",
+			pDesc ? "remembered" : "parsed",
+			expect_remembered ? "remembered" : "parsed");
+		return 1;
+	}
+
+	if (!pDesc) {
+		pDesc = Parse_ReportDesc(rdesc, sizeof(rdesc));
+	}
+	reportbuf = new_report_buffer(pDesc);
+
+	return (pDesc == NULL || reportbuf == NULL);
+}
+
+/* Read all items like hid_ups_walk() does, check which reports were
+ * requested and what was returned for them */
+static int walk(const char *what, int init, const int expected_requests[NITEMS], const int expected_ret[NITEMS])
+{
+	size_t	i;
+	int	res = 0, ret;
+	double	value;
+
+	memset(requests, 0, sizeof(requests));
+	printf("=== %s:", what);
+
+	for (i = 0; i < NITEMS; i++) {
+		HIDData_t	*pData = hidcache_item_data(i, test_hid2nut[i].hidpath, test_utab);
+
+		if (!pData) {
+			printf(" %s not mapped (FAIL)\n", test_hid2nut[i].hidpath);
+			return 1;
+		}
+
+		ret = hidcache_get_value(NULL, i, pData, &value, 0, init);
+		printf(" [%s %d/%d]", test_hid2nut[i].info_type, requests[i + 1], ret);
+		if (requests[i + 1] != expected_requests[i] || ret != expected_ret[i]) {
+			printf(" (expected %d/%d)", expected_requests[i], expected_ret[i]);
+			res++;
+		}
+	}
+	printf(" (%s)\n", res ? "FAIL" : "OK");
+
+	hidcache_save(fn, &dev, pDesc);
+
+	return res;
+}
+
+int main(void)
+{
+	static const int	all_read[NITEMS] = { 1, 1, 1 };
+	static const int	first_start[NITEMS] = { 1, LIBUSB_ERROR_PIPE, LIBUSB_ERROR_TIMEOUT };
+	static const int	poll_refused[NITEMS] = { 1, LIBUSB_ERROR_PIPE, 1 };
+	static const int	skip_refused[NITEMS] = { 1, 0, 1 };
+	static const int	next_start[NITEMS] = { 1, 0, 1 };
+	static const int	answers_now[NITEMS] = { 1, 1, 1 };
+	int	res = 0;
+
+	usb_subdriver.get_report = fake_get_report;
+	dev.VendorID = 0x0463;
+	dev.ProductID = 0xffff;
+	snprintf(fn, sizeof(fn), "hidcachetest-%" PRIiMAX ".hid", (intmax_t)getpid());
+
+	/* The device stalls on Current, Frequency is only late once */
+	refused[2] = 1;
+	busy[3] = 1;
+	res += start(0);
+	res += walk("first start", 1, all_read, first_start);
+
+	/* Polls still read everything */
+	busy[3] = 0;
+	res += walk("poll", 0, all_read, poll_refused);
+
+	/* At the next start, Current is not asked for at all, while
+	 * a mere timeout was no refusal */
+	res += start(1);
+	res += walk("second start", 1, skip_refused, next_start);
+
+	/* When the device answers for it in a poll, that is remembered too */
+	refused[2] = 0;
+	res += walk("poll after an update", 0, all_read, answers_now);
+	res += start(1);
+	res += walk("third start", 1, all_read, answers_now);
+
+	hidcache_free();
+	Free_ReportDesc(pDesc);
+	free_report_buffer(reportbuf);
+	unlink(fn);
+
+	printf("=== %s\n", res ? "FAILED" : "PASSED");
+
+	return (res != 0);
+}
@@ -0,0 +1,382 @@
+/* mbregmaptest.c - check how the Modbus register map (drivers/modbus-regmap.c)
+ * merges the declared registers into read requests, and serves their values
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "common.h"
+#include "modbus-regmap.h"
+
+/* Usually provided by the driver core (main.c) */
+char	*device_path = "mbregmaptest";
+
+/* A fake device, instead of libmodbus: registers hold a value derived
+ * from their address, one address range is not mapped (so reading it
+ * fails with an illegal address exception), and all requests are logged */
+#define UNMAPPED_FIRST	0x100
+#define UNMAPPED_LAST	0x103
+
+#define MAX_REQUESTS	16
+
+static struct {
+	int	func, addr, count;
+} requests[MAX_REQUESTS];
+static int nrequests = 0;
+
+static uint16_t reg_value(int addr)
+{
+	return (uint16_t)(addr ^ 0x5A5A);
+}
+
+static int fake_read(int func, int addr, int nb, uint16_t *regs, uint8_t *bits)
+{
+	int	i;
+
+	if (nrequests < MAX_REQUESTS) {
+		requests[nrequests].func = func;
+		requests[nrequests].addr = addr;
+		requests[nrequests].count = nb;
+	}
+	nrequests++;
+
+	if (addr <= UNMAPPED_LAST && addr + nb - 1 >= UNMAPPED_FIRST) {
+		errno = EMBXILADD;
+		return -1;
+	}
+
+	for (i = 0; i < nb; i++) {
+		if (regs)
+			regs[i] = reg_value(addr + i);
+		else
+			bits[i] = (uint8_t)((addr + i) % 3 == 0);
+	}
+
+	return nb;
+}
+
+int modbus_read_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
+{
+	NUT_UNUSED_VARIABLE(ctx);
+	return fake_read(0x01, addr, nb, NULL, dest);
+}
+
+int modbus_read_input_bits(modbus_t *ctx, int addr, int nb, uint8_t *dest)
+{
+	NUT_UNUSED_VARIABLE(ctx);
+	return fake_read(0x02, addr, nb, NULL, dest);
+}
+
+int modbus_read_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest)
+{
+	NUT_UNUSED_VARIABLE(ctx);
+	return fake_read(0x03, addr, nb, dest, NULL);
+}
+
+int modbus_read_input_registers(modbus_t *ctx, int addr, int nb, uint16_t *dest)
+{
+	NUT_UNUSED_VARIABLE(ctx);
+	return fake_read(0x04, addr, nb, dest, NULL);
+}
+
+int modbus_get_socket(modbus_t *ctx)
+{
+	NUT_UNUSED_VARIABLE(ctx);
+	return -1;
+}
+
+int modbus_connect(modbus_t *ctx)
+{
+	NUT_UNUSED_VARIABLE(ctx);
+	errno = ECONNREFUSED;
+	return -1;
+}
+
+void modbus_close(modbus_t *ctx)
+{
+	NUT_UNUSED_VARIABLE(ctx);
+}
+
+const char *modbus_strerror(int errnum)
+{
+	return (errnum == EMBXILADD) ? "Illegal data address" : strerror(errnum);
+}
+
+/* Check that the last refresh sent exactly the expected requests */
+static int check_requests(const char *what, int expected_count, const int expected[][3])
+{
+	int	i, res = 0;
+
+	printf("=== %s: %d request(s)", what, nrequests);
+	if (nrequests != expected_count || nrequests > MAX_REQUESTS) {
+		printf(", expected %d (FAIL)\n", expected_count);
+		return 1;
+	}
+
+	for (i = 0; i < nrequests; i++) {
+		printf(" [0x%02x %d+%d]", requests[i].func,
+			requests[i].addr, requests[i].count);
+		if (requests[i].func != expected[i][0]
+		 || requests[i].addr != expected[i][1]
+		 || requests[i].count != expected[i][2]
+		) {
+			printf(" (expected [0x%02x %d+%d])", expected[i][0],
+				expected[i][1], expected[i][2]);
+			res++;
+		}
+	}
+	printf(" (%s)\n", res ? "FAIL" : "OK");
+
+	return res;
+}
+
+/* Check the value served for a declared register */
+static int check_value(const mbregmap_t *map, mbregmap_type_t type, int addr, int expect_ok, uint16_t expected)
+{
+	uint16_t	val = 0;
+	int	ok = (mbregmap_get(map, type, addr, &val) == 0);
+
+	if (ok != expect_ok || (ok && val != expected)) {
+		printf("=== value of %d: %s %u, expected %s %u (FAIL)\n", addr,
+			ok ? "read" : "not read", val,
+			expect_ok ? "read" : "not read", expected);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Check the values served for a declared range */
+static int check_range(const mbregmap_t *map, mbregmap_type_t type, int addr, int count)
+{
+	uint16_t	vals[2 * MODBUS_MAX_READ_REGISTERS];
+	int	i;
+
+	if (count > 2 * MODBUS_MAX_READ_REGISTERS
+	 || mbregmap_get_range(map, type, addr, count, vals) != 0
+	) {
+		printf("=== range %d+%d: not read (FAIL)\n", addr, count);
+		return 1;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (vals[i] != reg_value(addr + i)) {
+			printf("=== range %d+%d: value of %d is %u, expected %u (FAIL)\n",
+				addr, count, addr + i, vals[i], reg_value(addr + i));
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int refresh(mbregmap_t *map, int expected_failures)
+{
+	int	failed;
+
+	nrequests = 0;
+	failed = mbregmap_refresh(map, NULL);
+	if (failed != expected_failures) {
+		printf("=== refresh: %d failed request(s), expected %d (FAIL)\n",
+			failed, expected_failures);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int test_merge(void)
+{
+	mbregmap_t	*map = mbregmap_new(MBREGMAP_DEFAULT_MAX_GAP);
+	static const int	expected[][3] = {
+		{ 0x04, 5, 1 },
+		{ 0x03, 10, 4 },
+		{ 0x03, 30, 2 }
+	};
+	int	res = 0;
+
+	/* out of order, overlapping and duplicate declarations */
+	mbregmap_add(map, MBREGMAP_HOLDING, 30, 2);
+	mbregmap_add(map, MBREGMAP_HOLDING, 12, 2);
+	mbregmap_add(map, MBREGMAP_HOLDING, 10, 1);
+	mbregmap_add(map, MBREGMAP_HOLDING, 12, 1);
+	/* same address, other type: never merged with the above */
+	mbregmap_add(map, MBREGMAP_INPUT_R, 5, 1);
+
+	res += refresh(map, 0);
+	/* 10-13 with a gap of 1, then 30-31 is 16 registers away */
+	res += check_requests("merge with the default gap", 3, expected);
+	res += check_value(map, MBREGMAP_HOLDING, 10, 1, reg_value(10));
+	res += check_value(map, MBREGMAP_HOLDING, 13, 1, reg_value(13));
+	res += check_value(map, MBREGMAP_HOLDING, 31, 1, reg_value(31));
+	res += check_value(map, MBREGMAP_INPUT_R, 5, 1, reg_value(5));
+	/* not declared at all */
+	res += check_value(map, MBREGMAP_HOLDING, 40, 0, 0);
+	res += check_value(map, MBREGMAP_COIL, 10, 0, 0);
+
+	mbregmap_free(map);
+	return res;
+}
+
+static int test_gap_limits(void)
+{
+	mbregmap_t	*map = mbregmap_new(0);
+	static const int	expected_nogap[][3] = {
+		{ 0x03, 10, 2 },
+		{ 0x03, 13, 1 }
+	};
+	static const int	expected_maxcount[][3] = {
+		{ 0x03, 0, 125 },
+		{ 0x03, 200, 1 }
+	};
+	static const int	expected_bits[][3] = {
+		{ 0x01, 0, 101 },
+		{ 0x01, 300, 1 }
+	};
+	int	res = 0;
+
+	/* no gap allowed: only adjacent registers are merged */
+	mbregmap_add(map, MBREGMAP_HOLDING, 10, 1);
+	mbregmap_add(map, MBREGMAP_HOLDING, 11, 1);
+	mbregmap_add(map, MBREGMAP_HOLDING, 13, 1);
+	res += refresh(map, 0);
+	res += check_requests("merge without gap", 2, expected_nogap);
+	mbregmap_free(map);
+
+	/* any gap allowed, but requests stay within the protocol limit */
+	map = mbregmap_new(1000);
+	mbregmap_add(map, MBREGMAP_HOLDING, 0, 1);
+	mbregmap_add(map, MBREGMAP_HOLDING, 124, 1);
+	mbregmap_add(map, MBREGMAP_HOLDING, 200, 1);
+	res += refresh(map, 0);
+	res += check_requests("merge up to 125 registers", 2, expected_maxcount);
+	res += check_value(map, MBREGMAP_HOLDING, 124, 1, reg_value(124));
+	res += check_value(map, MBREGMAP_HOLDING, 200, 1, reg_value(200));
+	mbregmap_free(map);
+
+	/* bits: the allowed gap is 16 times larger */
+	map = mbregmap_new(8);
+	mbregmap_add(map, MBREGMAP_COIL, 0, 1);
+	mbregmap_add(map, MBREGMAP_COIL, 100, 1);
+	mbregmap_add(map, MBREGMAP_COIL, 300, 1);
+	res += refresh(map, 0);
+	res += check_requests("merge bits", 2, expected_bits);
+	res += check_value(map, MBREGMAP_COIL, 0, 1, 1);
+	res += check_value(map, MBREGMAP_COIL, 100, 1, 0);
+	res += check_value(map, MBREGMAP_COIL, 300, 1, 1);
+	mbregmap_free(map);
+
+	return res;
+}
+
+static int test_wide_ranges(void)
+{
+	mbregmap_t	*map = mbregmap_new(1000);
+	static const int	expected[][3] = {
+		{ 0x03, 0, 125 },
+		{ 0x03, 125, 5 },
+		{ 0x03, 300, 125 },
+		{ 0x03, 425, 5 }
+	};
+	uint16_t	vals[4];
+	int	res = 0;
+
+	/* a range crossing the end of the first request... */
+	mbregmap_add(map, MBREGMAP_HOLDING, 0, 1);
+	mbregmap_add(map, MBREGMAP_HOLDING, 120, 10);
+	/* ...and one too wide for any request */
+	mbregmap_add(map, MBREGMAP_HOLDING, 300, 130);
+
+	res += refresh(map, 0);
+	res += check_requests("ranges wider than a request", 4, expected);
+	res += check_range(map, MBREGMAP_HOLDING, 120, 10);
+	res += check_range(map, MBREGMAP_HOLDING, 300, 130);
+	res += check_range(map, MBREGMAP_HOLDING, 123, 4);
+
+	/* the registers between the blocks were not read */
+	if (mbregmap_get_range(map, MBREGMAP_HOLDING, 128, 4, vals) == 0) {
+		printf("=== range 128+4 read across a gap (FAIL)\n");
+		res++;
+	}
+
+	mbregmap_free(map);
+	return res;
+}
+
+static int test_unmapped(void)
+{
+	mbregmap_t	*map = mbregmap_new(MBREGMAP_DEFAULT_MAX_GAP);
+	static const int	expected_first[][3] = {
+		{ 0x03, UNMAPPED_FIRST - 2, 8 },
+		{ 0x03, UNMAPPED_FIRST - 2, 2 },
+		{ 0x03, UNMAPPED_LAST + 1, 2 }
+	};
+	static const int	expected_next[][3] = {
+		{ 0x03, UNMAPPED_FIRST - 2, 2 },
+		{ 0x03, UNMAPPED_LAST + 1, 2 }
+	};
+	static const int	expected_failed[][3] = {
+		{ 0x04, UNMAPPED_FIRST, 1 }
+	};
+	int	res = 0;
+
+	/* the gap between the two ranges is not mapped by the device */
+	mbregmap_add(map, MBREGMAP_HOLDING, UNMAPPED_FIRST - 2, 2);
+	mbregmap_add(map, MBREGMAP_HOLDING, UNMAPPED_LAST + 1, 2);
+
+	/* the merged request is refused, then the ranges are read separately... */
+	res += refresh(map, 0);
+	res += check_requests("unmapped gap, first refresh", 3, expected_first);
+	res += check_value(map, MBREGMAP_HOLDING, UNMAPPED_FIRST - 1, 1, reg_value(UNMAPPED_FIRST - 1));
+	res += check_value(map, MBREGMAP_HOLDING, UNMAPPED_LAST + 2, 1, reg_value(UNMAPPED_LAST + 2));
+
+	/* ...and from then on only separately */
+	res += refresh(map, 0);
+	res += check_requests("unmapped gap, next refresh", 2, expected_next);
+	mbregmap_free(map);
+
+	/* a declared register which can not be read is reported as such */
+	map = mbregmap_new(MBREGMAP_DEFAULT_MAX_GAP);
+	mbregmap_add(map, MBREGMAP_INPUT_R, UNMAPPED_FIRST, 1);
+	res += refresh(map, 1);
+	res += check_requests("unmapped register", 1, expected_failed);
+	res += check_value(map, MBREGMAP_INPUT_R, UNMAPPED_FIRST, 0, 0);
+	mbregmap_free(map);
+
+	return res;
+}
+
+int main(void)
+{
+	int	res = 0;
+
+	res += test_merge();
+	res += test_gap_limits();
+	res += test_wide_ranges();
+	res += test_unmapped();
+
+	printf("=== %s\n", res ? "FAILED" : "PASSED");
+
+	return (res != 0);
+}
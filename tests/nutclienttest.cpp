@@ -77,6 +77,8 @@ class NutClientTest : public CppUnit::TestFixture
 		CPPUNIT_TEST( test_copy_assignment_var );
 
 		CPPUNIT_TEST( test_nutclientstub_dev );
+
+		CPPUNIT_TEST( test_parse_varinfo );
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -97,6 +99,8 @@ public:
 	void test_copy_assignment_var();
 
 	void test_nutclientstub_dev();
+
+	void test_parse_varinfo();
 };
 
 // Registers the fixture into the 'registry'
@@ -543,6 +547,88 @@ void NutClientTest::test_nutclientstub_dev() {
 		!noException);
 }
 
+void NutClientTest::test_parse_varinfo() {
+	/* As sent by upsd for "LIST VARINFO su700", see docs/net-protocol.txt */
+	static const char *answer[] = {
+		"VARINFO su700 input.transfer.low VALUE \"103\"",
+		"VARINFO su700 input.transfer.low TYPE RW ENUM NUMBER",
+		"VARINFO su700 input.transfer.low DESC \"Low voltage transfer point\"",
+		"VARINFO su700 input.transfer.low ENUM \"103\"",
+		"VARINFO su700 input.transfer.low ENUM \"100\"",
+		"VARINFO su700 ups.delay.start VALUE \"30\"",
+		"VARINFO su700 ups.delay.start TYPE RW RANGE NUMBER",
+		"VARINFO su700 ups.delay.start DESC \"Interval to wait before (re)starting the load (seconds)\"",
+		"VARINFO su700 ups.delay.start RANGE \"0\" \"60\"",
+		"VARINFO su700 ups.delay.start RANGE \"120\" \"300\"",
+		"VARINFO su700 ups.id VALUE \"My \\\"lab\\\" UPS\"",
+		"VARINFO su700 ups.id TYPE RW STRING:32",
+		"VARINFO su700 ups.id DESC \"\"",
+		/* Truncated, and unknown to this client: both skipped */
+		"VARINFO su700 ups.id DESC",
+		"VARINFO su700 ups.id LATER \"keyword\"",
+		/* Only a value, as for variables without metadata */
+		"VARINFO su700 ups.status VALUE \"OL\"",
+		nullptr
+	};
+	const std::string prefix = "VARINFO su700";
+	std::vector<std::vector<std::string> > lines;
+
+	for (size_t i = 0; answer[i] != nullptr; i++) {
+		lines.push_back(TcpClient::explode(answer[i], prefix.size()));
+	}
+
+	std::map<std::string,VariableInfo> infos = TcpClient::parseVariableInfos(lines);
+
+	CPPUNIT_ASSERT_EQUAL_MESSAGE(
+		"Not all LIST VARINFO variables were parsed",
+		static_cast<size_t>(4), infos.size());
+
+	const VariableInfo& low = infos["input.transfer.low"];
+	CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1), low.values.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("103"), low.values[0]);
+	CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), low.type.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("RW"), low.type[0]);
+	CPPUNIT_ASSERT_EQUAL(std::string("ENUM"), low.type[1]);
+	CPPUNIT_ASSERT_EQUAL(std::string("NUMBER"), low.type[2]);
+	CPPUNIT_ASSERT_EQUAL(std::string("Low voltage transfer point"), low.description);
+	CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), low.enums.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("103"), low.enums[0]);
+	CPPUNIT_ASSERT_EQUAL(std::string("100"), low.enums[1]);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Enumerated variable has ranges",
+		low.ranges.empty());
+
+	const VariableInfo& start = infos["ups.delay.start"];
+	CPPUNIT_ASSERT_EQUAL(std::string("30"), start.values[0]);
+	CPPUNIT_ASSERT_EQUAL(std::string("RANGE"), start.type[1]);
+	CPPUNIT_ASSERT_EQUAL(
+		std::string("Interval to wait before (re)starting the load (seconds)"),
+		start.description);
+	CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), start.ranges.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("0"), start.ranges[0].first);
+	CPPUNIT_ASSERT_EQUAL(std::string("60"), start.ranges[0].second);
+	CPPUNIT_ASSERT_EQUAL(std::string("120"), start.ranges[1].first);
+	CPPUNIT_ASSERT_EQUAL(std::string("300"), start.ranges[1].second);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Variable with ranges has enumerated values",
+		start.enums.empty());
+
+	const VariableInfo& id = infos["ups.id"];
+	CPPUNIT_ASSERT_EQUAL(std::string("My \"lab\" UPS"), id.values[0]);
+	CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), id.type.size());
+	CPPUNIT_ASSERT_EQUAL(std::string("STRING:32"), id.type[1]);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Empty description was not kept empty",
+		id.description.empty());
+
+	const VariableInfo& status = infos["ups.status"];
+	CPPUNIT_ASSERT_EQUAL(std::string("OL"), status.values[0]);
+	CPPUNIT_ASSERT_MESSAGE(
+		"Variable without metadata got some",
+		status.type.empty() && status.description.empty()
+		&& status.enums.empty() && status.ranges.empty());
+}
+
 } // namespace nut {}
 
 #ifdef __clang__
@@ -0,0 +1,152 @@
+/* nutscannertest.c - check that devices reported by libnutscan scans as
+ * they are discovered are told apart (or recognized as the same) by
+ * nutscan_add_unique_device(), so nut-scanner displays none of them twice
+ * and drops none.
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "nut-scan.h"
+
+/* As nut-scanner does: display only the devices not reported before,
+ * as told by nutscan_add_unique_device() which keeps copies of them */
+static nutscan_device_t *dev_reported = NULL;
+static int displayed = 0;
+
+static void report_device(nutscan_device_t * device, void * userdata)
+{
+	NUT_UNUSED_VARIABLE(userdata);
+
+	if (nutscan_add_unique_device(&dev_reported, device) == 0) {
+		printf("  skipped %s device reported earlier\n",
+			nutscan_device_type_strings[device->type]);
+		return;
+	}
+
+	nutscan_display_parsable(device);
+	displayed++;
+}
+
+static nutscan_device_t *new_usb_device(const char *serial, const char *device)
+{
+	nutscan_device_t	*dev = nutscan_new_device();
+
+	dev->type = TYPE_USB;
+	dev->driver = strdup("usbhid-ups");
+	dev->port = strdup("auto");
+	nutscan_add_option_to_device(dev, "vendorid", "0463");
+	nutscan_add_option_to_device(dev, "productid", "FFFF");
+	if (serial)
+		nutscan_add_option_to_device(dev, "serial", (char *)serial);
+	nutscan_add_commented_option_to_device(dev, "bus", "001", "");
+	nutscan_add_commented_option_to_device(dev, "device", (char *)device, "");
+
+	return dev;
+}
+
+static nutscan_device_t *new_nut_device(nutscan_device_type_t type, const char *port)
+{
+	nutscan_device_t	*dev = nutscan_new_device();
+
+	dev->type = type;
+	dev->driver = strdup("nutclient");
+	dev->port = strdup(port);
+
+	return dev;
+}
+
+static int check_displayed(const char *what, int expected)
+{
+	printf("=== %s: displayed %d device(s), expected %d (%s)\n",
+		what, displayed, expected,
+		displayed == expected ? "OK" : "FAIL");
+
+	return (displayed != expected);
+}
+
+int main(void)
+{
+	nutscan_device_t	*usb = NULL, *oldnut = NULL, *avahi = NULL, *dev, *noport;
+	int	res = 0;
+
+	nutscan_set_device_callback(report_device, NULL);
+
+	/* Two UPSes of the same model, only the serial numbers differ */
+	usb = nutscan_add_discovered_device(usb, new_usb_device("SN0001", "002"));
+	usb = nutscan_add_discovered_device(usb, new_usb_device("SN0002", "003"));
+	res += check_displayed("USB devices with different serial numbers", 2);
+
+	/* Two UPSes which do not report a serial number */
+	usb = nutscan_add_discovered_device(usb, new_usb_device(NULL, "004"));
+	usb = nutscan_add_discovered_device(usb, new_usb_device(NULL, "005"));
+	res += check_displayed("USB devices on different device numbers", 4);
+
+	/* The same data server seen by two scanning methods */
+	oldnut = nutscan_add_discovered_device(oldnut,
+		new_nut_device(TYPE_NUT, "ups1@192.0.2.1"));
+	avahi = nutscan_add_discovered_device(avahi,
+		new_nut_device(TYPE_AVAHI, "ups1@192.0.2.1"));
+	avahi = nutscan_add_discovered_device(avahi,
+		new_nut_device(TYPE_AVAHI, "ups2@192.0.2.1"));
+	res += check_displayed("NUT devices also found by Avahi", 6);
+
+	if (nutscan_same_device(nutscan_rewind_device(usb), NULL)) {
+		printf("=== comparison with NULL device: FAIL\n");
+		res++;
+	}
+
+	/* The copies kept are complete: the originals are found among them */
+	for (dev = nutscan_rewind_device(usb); dev != NULL; dev = dev->next) {
+		if (nutscan_add_unique_device(&dev_reported, dev) != 0) {
+			printf("=== USB device %s not kept: FAIL\n", dev->port);
+			res++;
+		}
+	}
+
+	/* Without a driver and port, devices can not be told apart */
+	noport = nutscan_new_device();
+	if (nutscan_add_unique_device(&dev_reported, noport) != 1
+	||  nutscan_add_unique_device(&dev_reported, noport) != 1
+	) {
+		printf("=== device without a port not added: FAIL\n");
+		res++;
+	}
+	nutscan_free_device(noport);
+
+	if (nutscan_add_unique_device(&dev_reported, NULL) != -1
+	||  nutscan_add_unique_device(NULL, nutscan_rewind_device(usb)) != -1
+	) {
+		printf("=== NULL device or list accepted: FAIL\n");
+		res++;
+	}
+
+	nutscan_set_device_callback(NULL, NULL);
+	nutscan_free_device(usb);
+	nutscan_free_device(oldnut);
+	nutscan_free_device(avahi);
+	nutscan_free_device(dev_reported);
+
+	return res;
+}
@@ -0,0 +1,208 @@
+/* upsschedtimertest.c - check that the pending timers of the upssched
+ * daemon (clients/upssched-timers.c) fire in order, earliest first and
+ * in the order they were started when due at the same time, and that
+ * cancelling timers, by name, keeps them so.
+ *
+ * Copyright (C)
+ *	2026	NUT Community
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "nut_stdint.h"
+#include "upssched.h"
+
+#define NTIMERS	500
+
+static unsigned int	seed = 2000;
+
+static unsigned int next_random(unsigned int range)
+{
+	seed = seed * 1103515245U + 12345U;
+	return (seed >> 16) % range;
+}
+
+/* Fire (remove) all the timers left, checking that they come earliest
+ * first, then by start order, and that none of the cancelled is left */
+static int check_firing(const char *what, size_t expected, const int *cancelled)
+{
+	ttype_t	*tmp;
+	time_t	etime = 0;
+	unsigned long	seq = 0;
+	size_t	fired = 0;
+	int	res = 0, i;
+
+	while ((tmp = timer_first()) != NULL) {
+		if (fired > 0 && (tmp->etime < etime || (tmp->etime == etime && tmp->seq <= seq))) {
+			printf("=== %s: timer %s (due %ld, started #%lu) fired after one due %ld, started #%lu (FAIL)\n",
+				what, tmp->name, (long)tmp->etime, tmp->seq, (long)etime, seq);
+			res++;
+		}
+
+		if (cancelled && sscanf(tmp->name, "t%d", &i) == 1 && cancelled[i]) {
+			printf("=== %s: cancelled timer %s fired (FAIL)\n", what, tmp->name);
+			res++;
+		}
+
+		etime = tmp->etime;
+		seq = tmp->seq;
+		fired++;
+
+		timer_remove(tmp);
+	}
+
+	if (fired != expected) {
+		printf("=== %s: %" PRIuSIZE " timers fired, expected %" PRIuSIZE " (FAIL)\n",
+			what, fired, expected);
+		res++;
+	}
+
+	if (timer_count() != 0) {
+		printf("=== %s: %" PRIuSIZE " timers left (FAIL)\n", what, timer_count());
+		res++;
+	}
+
+	printf("=== %s: %" PRIuSIZE " timers (%s)\n", what, fired, res ? "FAIL" : "OK");
+
+	return res;
+}
+
+static int test_order(void)
+{
+	char	name[SMALLBUF];
+	int	i;
+
+	/* few different times, so that many timers are due at once */
+	for (i = 0; i < NTIMERS; i++) {
+		snprintf(name, sizeof(name), "t%d", i);
+		timer_add(name, (time_t)(1000 + next_random(50)));
+	}
+
+	return check_firing("firing order", NTIMERS, NULL);
+}
+
+static int test_cancel(void)
+{
+	char	name[SMALLBUF];
+	int	cancelled[NTIMERS];
+	size_t	left = NTIMERS;
+	int	i, res = 0;
+	ttype_t	*tmp;
+
+	for (i = 0; i < NTIMERS; i++) {
+		snprintf(name, sizeof(name), "t%d", i);
+		timer_add(name, (time_t)(1000 + next_random(200)));
+		cancelled[i] = 0;
+	}
+
+	/* cancel timers from anywhere in the heap, some of them twice */
+	for (i = 0; i < NTIMERS; i++) {
+		int	n = (int)next_random(NTIMERS);
+
+		snprintf(name, sizeof(name), "t%d", n);
+		tmp = timer_find(name);
+
+		if (cancelled[n]) {
+			if (tmp != NULL) {
+				printf("=== cancel: timer %s found after it was cancelled (FAIL)\n", name);
+				res++;
+			}
+			continue;
+		}
+
+		if (tmp == NULL || strcmp(tmp->name, name)) {
+			printf("=== cancel: timer %s not found (FAIL)\n", name);
+			res++;
+			continue;
+		}
+
+		timer_remove(tmp);
+		cancelled[n] = 1;
+		left--;
+	}
+
+	if (timer_count() != left) {
+		printf("=== cancel: %" PRIuSIZE " timers pending, expected %" PRIuSIZE " (FAIL)\n",
+			timer_count(), left);
+		res++;
+	}
+
+	res += check_firing("firing order after cancelling", left, cancelled);
+
+	return res;
+}
+
+static int test_same_name(void)
+{
+	ttype_t	*tmp;
+	int	res = 0;
+
+	/* CANCEL-TIMER cancels the oldest timer of that name */
+	timer_add("same", 30);
+	timer_add("other", 5);
+	timer_add("same", 10);
+	timer_add("same", 20);
+
+	if ((tmp = timer_first()) == NULL || strcmp(tmp->name, "other")) {
+		printf("=== same name: first timer is not the one due first (FAIL)\n");
+		res++;
+	}
+
+	if ((tmp = timer_find("same")) == NULL || tmp->etime != 30) {
+		printf("=== same name: not the oldest timer found (FAIL)\n");
+		res++;
+	} else {
+		timer_remove(tmp);
+	}
+
+	if ((tmp = timer_find("same")) == NULL || tmp->etime != 10) {
+		printf("=== same name: not the next oldest timer found (FAIL)\n");
+		res++;
+	}
+
+	if (timer_find("none") != NULL) {
+		printf("=== same name: unknown timer found (FAIL)\n");
+		res++;
+	}
+
+	printf("=== same name (%s)\n", res ? "FAIL" : "OK");
+
+	return res + check_firing("firing order with the same name", 3, NULL);
+}
+
+int main(void)
+{
+	int	res = 0;
+
+	if (timer_first() != NULL || timer_count() != 0) {
+		printf("=== no timers at start (FAIL)\n");
+		res++;
+	}
+
+	res += test_order();
+	res += test_cancel();
+	res += test_same_name();
+
+	printf("=== %s\n", res ? "FAILED" : "PASSED");
+
+	return (res != 0);
+}
@@ -134,6 +134,14 @@ static const struct option longopts[] = {
 
 static nutscan_device_t *dev[TYPE_END];
 
+/* Devices are displayed as soon as any scan reports them, see report_device() */
+static void (*display_func)(nutscan_device_t * device);
+
+/* Stripped-down copies of the devices displayed so far, to skip those
+ * found again by another scan type, and for the sanity checks which
+ * need to see them all (done when all scans are complete) */
+static nutscan_device_t *dev_reported = NULL;
+
 static useconds_t timeout = DEFAULT_NETWORK_TIMEOUT * 1000 * 1000; /* in usec */
 static char * port = NULL;
 static char * serial_ports = NULL;
@@ -142,6 +150,29 @@ static int cli_link_detail_level = -1;
 /* Track requested IP ranges (from CLI or auto-discovery) */
 static nutscan_ip_range_list_t ip_ranges_list;
 
+/* Called by libnutscan for each device as it is discovered;
+ * calls are serialized by the library */
+static void report_device(nutscan_device_t * device, void * userdata)
+{
+	NUT_UNUSED_VARIABLE(userdata);
+
+	/* Keeps a copy of the new ones, in dev_reported */
+	if (nutscan_add_unique_device(&dev_reported, device) == 0) {
+		upsdebugx(1, "Skipping %s device reported earlier: "
+			"driver=\"%s\" port=\"%s\"",
+			nutscan_device_type_strings[device->type],
+			device->driver, device->port);
+		return;
+	}
+
+	if (display_func == nutscan_display_ups_conf_with_sanity_check) {
+		nutscan_display_ups_conf(device);
+	} else {
+		display_func(device);
+	}
+	fflush(stdout);
+}
+
 #ifdef HAVE_PTHREAD
 static pthread_t thread[TYPE_END];
 
@@ -1154,7 +1185,6 @@ int main(int argc, char *argv[])
 	int allow_ipmi = 0;
 	int allow_eaton_serial = 0; /* MUST be requested explicitly! */
 	int quiet = 0; /* The debugging level for certain upsdebugx() progress messages; 0 = print always, quiet==1 is to require at least one -D */
-	void (*display_func)(nutscan_device_t * device);
 	int ret_code = EXIT_SUCCESS;
 #ifdef HAVE_PTHREAD
 # ifdef HAVE_SEMAPHORE
@@ -1221,6 +1251,7 @@ int main(int argc, char *argv[])
 
 	/* Default, see -Q/-N/-P below */
 	display_func = nutscan_display_ups_conf_with_sanity_check;
+	nutscan_set_device_callback(report_device, NULL);
 
 	/* Parse command line options -- Second loop: everything else */
 	/* Restore error messages... */
@@ -1836,45 +1867,35 @@ display_help:
 	}
 #endif /* HAVE_PTHREAD */
 
-	upsdebugx(1, "SCANS DONE: display results");
+	/* Devices were displayed by report_device() as they were found */
+	if (display_func == nutscan_display_ups_conf_with_sanity_check) {
+		upsdebugx(1, "SCANS DONE: display sanity checks");
+		nutscan_display_sanity_check(dev_reported);
+	}
+	nutscan_set_device_callback(NULL, NULL);
+	nutscan_free_device(dev_reported);
 
-	upsdebugx(1, "SCANS DONE: display results: USB");
-	display_func(dev[TYPE_USB]);
 	upsdebugx(1, "SCANS DONE: free resources: USB");
 	nutscan_free_device(dev[TYPE_USB]);
 
-	upsdebugx(1, "SCANS DONE: display results: SNMP");
-	display_func(dev[TYPE_SNMP]);
 	upsdebugx(1, "SCANS DONE: free resources: SNMP");
 	nutscan_free_device(dev[TYPE_SNMP]);
 
-	upsdebugx(1, "SCANS DONE: display results: XML/HTTP");
-	display_func(dev[TYPE_XML]);
 	upsdebugx(1, "SCANS DONE: free resources: XML/HTTP");
 	nutscan_free_device(dev[TYPE_XML]);
 
-	upsdebugx(1, "SCANS DONE: display results: NUT bus (old)");
-	display_func(dev[TYPE_NUT]);
 	upsdebugx(1, "SCANS DONE: free resources: NUT bus (old)");
 	nutscan_free_device(dev[TYPE_NUT]);
 
-	upsdebugx(1, "SCANS DONE: display results: NUT simulation devices");
-	display_func(dev[TYPE_NUT_SIMULATION]);
 	upsdebugx(1, "SCANS DONE: free resources: NUT simulation devices");
 	nutscan_free_device(dev[TYPE_NUT_SIMULATION]);
 
-	upsdebugx(1, "SCANS DONE: display results: NUT bus (avahi)");
-	display_func(dev[TYPE_AVAHI]);
 	upsdebugx(1, "SCANS DONE: free resources: NUT bus (avahi)");
 	nutscan_free_device(dev[TYPE_AVAHI]);
 
-	upsdebugx(1, "SCANS DONE: display results: IPMI");
-	display_func(dev[TYPE_IPMI]);
 	upsdebugx(1, "SCANS DONE: free resources: IPMI");
 	nutscan_free_device(dev[TYPE_IPMI]);
 
-	upsdebugx(1, "SCANS DONE: display results: SERIAL");
-	display_func(dev[TYPE_EATON_SERIAL]);
 	upsdebugx(1, "SCANS DONE: free resources: SERIAL");
 	nutscan_free_device(dev[TYPE_EATON_SERIAL]);
 
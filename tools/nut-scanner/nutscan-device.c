@@ -31,6 +31,10 @@
 #include <string.h>
 #include <assert.h>
 
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif
+
 const char * nutscan_device_type_strings[TYPE_END] = {
 	"NONE", /* 0 */
 	"USB",
@@ -56,6 +60,15 @@ const char * nutscan_device_type_lstrings[TYPE_END] = {
 	"serial",
 };
 
+/* Consumer's hook for devices as they are discovered, see
+ * nutscan_set_device_callback(); calls are serialized since
+ * several scanners may be running in parallel threads */
+static nutscan_device_callback_t device_callback = NULL;
+static void * device_callback_data = NULL;
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t device_callback_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 nutscan_device_t * nutscan_new_device(void)
 {
 	nutscan_device_t * device;
@@ -229,6 +242,129 @@ nutscan_device_t * nutscan_add_device_to_device(nutscan_device_t * first, nutsca
 	return dev2;
 }
 
+void nutscan_set_device_callback(nutscan_device_callback_t callback, void * userdata)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&device_callback_mutex);
+#endif
+	device_callback = callback;
+	device_callback_data = userdata;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&device_callback_mutex);
+#endif
+}
+
+nutscan_device_t * nutscan_add_discovered_device(nutscan_device_t * first, nutscan_device_t * device)
+{
+	if (device == NULL) {
+		return first;
+	}
+
+	/* Report it while it is still a list of its own, so the
+	 * display methods which walk the list only show this one */
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&device_callback_mutex);
+#endif
+	if (device_callback != NULL && device->prev == NULL && device->next == NULL) {
+		upsdebugx(5, "%s: reporting %s device: driver=%s port=%s",
+			__func__, nutscan_device_type_strings[device->type],
+			NUT_STRARG(device->driver), NUT_STRARG(device->port));
+		device_callback(device, device_callback_data);
+	}
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&device_callback_mutex);
+#endif
+
+	return nutscan_add_device_to_device(first, device);
+}
+
+static int same_string(const char * a, const char * b)
+{
+	if (a == NULL || b == NULL)
+		return (a == b);
+
+	return !strcmp(a, b);
+}
+
+static size_t count_options(const nutscan_options_t * opt)
+{
+	size_t	count = 0;
+
+	for (; opt != NULL; opt = opt->next)
+		count++;
+
+	return count;
+}
+
+int nutscan_same_device(const nutscan_device_t * first, const nutscan_device_t * second)
+{
+	const nutscan_options_t	*opt1, *opt2;
+
+	if (first == NULL || second == NULL)
+		return 0;
+
+	if (!same_string(first->driver, second->driver)
+	||  !same_string(first->port, second->port)
+	||  count_options(first->opt) != count_options(second->opt)
+	) {
+		return 0;
+	}
+
+	for (opt1 = first->opt; opt1 != NULL; opt1 = opt1->next) {
+		for (opt2 = second->opt; opt2 != NULL; opt2 = opt2->next) {
+			if (same_string(opt1->option, opt2->option)
+			&&  same_string(opt1->value, opt2->value)
+			) {
+				break;
+			}
+		}
+
+		if (opt2 == NULL)
+			return 0;
+	}
+
+	return 1;
+}
+
+int nutscan_add_unique_device(nutscan_device_t ** list, const nutscan_device_t * device)
+{
+	nutscan_device_t	*current_dev, *copy;
+	nutscan_options_t	*opt;
+
+	if (list == NULL || device == NULL)
+		return -1;
+
+	/* Compare the options too: e.g. all USB devices have port=auto */
+	if (device->driver != NULL && device->port != NULL) {
+		for (current_dev = nutscan_rewind_device(*list);
+		     current_dev != NULL;
+		     current_dev = current_dev->next
+		) {
+			if (nutscan_same_device(current_dev, device))
+				return 0;
+		}
+	}
+
+	if ((copy = nutscan_new_device()) == NULL)
+		return -1;
+
+	copy->type = device->type;
+	if ((device->driver && (copy->driver = strdup(device->driver)) == NULL)
+	||  (device->port && (copy->port = strdup(device->port)) == NULL)
+	) {
+		nutscan_free_device(copy);
+		return -1;
+	}
+
+	for (opt = device->opt; opt != NULL; opt = opt->next) {
+		nutscan_add_commented_option_to_device(copy,
+			opt->option, opt->value, opt->comment_tag);
+	}
+
+	*list = nutscan_add_device_to_device(*list, copy);
+	return 1;
+}
+
 nutscan_device_t * nutscan_rewind_device(nutscan_device_t * device)
 {
 	if (NULL == device)
@@ -86,6 +86,67 @@ void nutscan_add_commented_option_to_device(nutscan_device_t * device, char * op
 void nutscan_add_option_to_device(nutscan_device_t * device, char * option, char * value);
 nutscan_device_t * nutscan_add_device_to_device(nutscan_device_t * first, nutscan_device_t * second);
 
+/**
+ *  \brief  Callback for devices as soon as they are discovered
+ *
+ *  The device is owned by the list which the scanning method returns
+ *  eventually; it must not be modified nor freed by the callback.
+ *
+ *  \param  device    Newly discovered device (not linked to others yet)
+ *  \param  userdata  As passed to nutscan_set_device_callback()
+ */
+typedef void (*nutscan_device_callback_t)(nutscan_device_t * device, void * userdata);
+
+/**
+ *  \brief  Set (or with NULL, clear) the callback which all scanning
+ *          methods call for each device they discover
+ *
+ *  Calls are serialized, even when several scans run in parallel.
+ */
+void nutscan_set_device_callback(nutscan_device_callback_t callback, void * userdata);
+
+/**
+ *  \brief  Report a newly discovered device to the callback (if any)
+ *          and add it to a list, as nutscan_add_device_to_device() does
+ *
+ *  \param  first   Device list (may be NULL)
+ *  \param  device  New device
+ *
+ *  \return End of the resulting list
+ */
+nutscan_device_t * nutscan_add_discovered_device(nutscan_device_t * first, nutscan_device_t * device);
+
+/**
+ *  \brief  Check whether two scan results describe the same device
+ *
+ *  Devices are the same if they have the same driver, port and set of
+ *  options (with the same values, in any order, commented or not), so
+ *  e.g. several USB devices with \c port=auto and the same driver are
+ *  told apart by their vendorid, productid, serial, bus, device etc.
+ *
+ *  \param  first   A device
+ *  \param  second  Another device
+ *
+ *  \return 1 if same, 0 if not
+ */
+int nutscan_same_device(const nutscan_device_t * first, const nutscan_device_t * second);
+
+/**
+ *  \brief  Add a copy of a device to a list, unless the same device (as
+ *          checked by nutscan_same_device()) is in that list already
+ *
+ *  E.g. to keep track of the devices reported by the callback of
+ *  nutscan_set_device_callback(), and skip those found again by another
+ *  scanning method. Devices without a driver or port are always added.
+ *
+ *  \param  list    Pointer to the device list (the list may be NULL)
+ *  \param  device  Device to copy
+ *
+ *  \return 1 if added, 0 if the same device was in the list already,
+ *          -1 if it could not be copied
+ */
+int nutscan_add_unique_device(nutscan_device_t ** list, const nutscan_device_t * device);
+
 /**
  *  \brief  Rewind device list
  *
@@ -205,12 +205,13 @@ void nutscan_display_sanity_check_serial(nutscan_device_t * device)
 	 * Also note that not all devices may have/report
 	 * a serial at all (option will be missing).
 	 */
-	/* FIXME: Currently this is normally called as part
-	 * of nutscan_display_ups_conf_with_sanity_check()
-	 * and nut-scanner goes over each type separately.
-	 * So with current approach it will not see "issues"
-	 * with multiple data paths (e.g. USB and SNMP) to
-	 * same device.
+	/* NOTE: When called as part of
+	 * nutscan_display_ups_conf_with_sanity_check()
+	 * it only sees the list of one scan type, so it
+	 * will not see "issues" with multiple data paths
+	 * (e.g. USB and SNMP) to same device. The nut-scanner
+	 * program displays devices as they are discovered and
+	 * calls this once for all of them, in display order.
 	 */
 	nutscan_device_t * current_dev = device;
 	nutscan_options_t * opt;
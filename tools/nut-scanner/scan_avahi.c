@@ -303,7 +303,7 @@ static void update_device(const char * host_name, const char *ip, uint16_t port,
 				}
 			}
 			if (dev->port) {
-				dev_ret = nutscan_add_device_to_device(dev_ret, dev);
+				dev_ret = nutscan_add_discovered_device(dev_ret, dev);
 			}
 			else {
 				nutscan_free_device(dev);
@@ -348,7 +348,7 @@ static void update_device(const char * host_name, const char *ip, uint16_t port,
 				dev->port = strdup(host_name);
 			}
 			if (dev->port) {
-				dev_ret = nutscan_add_device_to_device(dev_ret, dev);
+				dev_ret = nutscan_add_discovered_device(dev_ret, dev);
 			}
 			else {
 				nutscan_free_device(dev);
@@ -94,6 +94,7 @@ char  *device_path;
 TYPE_FD   upsfd;
 int   exit_flag = 0;
 int   do_lock_port;
+int   do_serial_adaptive = 0;
 
 /* Functions extracted from drivers/bcmxcp.c, to avoid pulling too many things
  * lightweight function to calculate the 8-bit
@@ -183,7 +184,7 @@ static nutscan_device_t * nutscan_scan_eaton_serial_shut(const char* port_name)
 #ifdef HAVE_PTHREAD
 				pthread_mutex_lock(&dev_mutex);
 #endif
-				dev_ret = nutscan_add_device_to_device(dev_ret, dev);
+				dev_ret = nutscan_add_discovered_device(dev_ret, dev);
 #ifdef HAVE_PTHREAD
 				pthread_mutex_unlock(&dev_mutex);
 #endif
@@ -221,14 +222,6 @@ static nutscan_device_t * nutscan_scan_eaton_serial_xcp(const char* port_name)
 	memset(sbuf, 0, 128);
 
 	if (VALID_FD_SER(devfd)) {
-#ifdef HAVE_PTHREAD
-		pthread_mutex_lock(&dev_mutex);
-#endif
-		upsfd = devfd;
-#ifdef HAVE_PTHREAD
-		pthread_mutex_unlock(&dev_mutex);
-#endif
-
 		for (i = 0; (pw_baud_rates[i].rate != 0) && (dev == NULL); i++)
 		{
 			memset(answer, 0, 256);
@@ -241,7 +234,17 @@ static nutscan_device_t * nutscan_scan_eaton_serial_xcp(const char* port_name)
 				break;
 
 			usleep(90000);
-			send_write_command(BCMXCP_AUTHCMD, 4);
+			/* Send the authorisation command to this port: unlike
+			 * drivers/bcmxcp_ser.c->send_write_command() which uses
+			 * the global upsfd, this is safe with several ports
+			 * being probed in parallel threads */
+			sbuf[0] = PW_COMMAND_START_BYTE;
+			sbuf[1] = (unsigned char)sizeof(BCMXCP_AUTHCMD);
+			memcpy(sbuf + 2, BCMXCP_AUTHCMD, sizeof(BCMXCP_AUTHCMD));
+			sbuf[2 + sizeof(BCMXCP_AUTHCMD)] = calc_checksum(sbuf);
+			ret = ser_send_buf(devfd, sbuf, 3 + sizeof(BCMXCP_AUTHCMD));
+			if (ret <= 0)
+				break;
 			usleep(500000);
 
 			/* Discovery with Baud Hunting (XCP protocol spec. §4.1.2)
@@ -273,7 +276,7 @@ static nutscan_device_t * nutscan_scan_eaton_serial_xcp(const char* port_name)
 #ifdef HAVE_PTHREAD
 				pthread_mutex_lock(&dev_mutex);
 #endif
-				dev_ret = nutscan_add_device_to_device(dev_ret, dev);
+				dev_ret = nutscan_add_discovered_device(dev_ret, dev);
 #ifdef HAVE_PTHREAD
 				pthread_mutex_unlock(&dev_mutex);
 #endif
@@ -361,7 +364,7 @@ static nutscan_device_t * nutscan_scan_eaton_serial_q1(const char* port_name)
 #ifdef HAVE_PTHREAD
 										pthread_mutex_lock(&dev_mutex);
 #endif
-										dev_ret = nutscan_add_device_to_device(dev_ret, dev);
+										dev_ret = nutscan_add_discovered_device(dev_ret, dev);
 #ifdef HAVE_PTHREAD
 										pthread_mutex_unlock(&dev_mutex);
 #endif
@@ -380,22 +383,52 @@ static nutscan_device_t * nutscan_scan_eaton_serial_q1(const char* port_name)
 	return dev;
 }
 
+/* Protocols to try on each port, stopping at the first one which answers:
+ * SHUT is the current Eaton serial protocol, Q1 is quick to rule out
+ * (about 3 seconds), while XCP is legacy and hunts through all baud rates
+ * (about 8 seconds when nothing answers), so it comes last */
+static const struct {
+	const char	*name;
+	nutscan_device_t * (*probe)(const char* port_name);
+} eaton_serial_probes[] = {
+	{ "SHUT",	nutscan_scan_eaton_serial_shut },
+	{ "Q1",	nutscan_scan_eaton_serial_q1 },
+	{ "XCP",	nutscan_scan_eaton_serial_xcp },
+	/* Else try UTalk? */
+	{ NULL,	NULL }
+};
+
 static void * nutscan_scan_eaton_serial_device(void * port_arg)
 {
 	nutscan_device_t * dev = NULL;
 	char* port_name = (char*) port_arg;
+	struct timeval start, now;
+	size_t i;
+
+	gettimeofday(&start, NULL);
 
-	/* Try SHUT first */
-	if ((dev = nutscan_scan_eaton_serial_shut(port_name)) == NULL) {
-		usleep(100000);
-		/* Else, try XCP */
-		if ((dev = nutscan_scan_eaton_serial_xcp(port_name)) == NULL) {
-			/* Else, try Q1 */
+	for (i = 0; eaton_serial_probes[i].probe != NULL; i++) {
+		if (i > 0) {
 			usleep(100000);
-			dev = nutscan_scan_eaton_serial_q1(port_name);
 		}
-		/* Else try UTalk? */
+
+		upsdebugx(2, "%s: %s: trying %s", __func__,
+			port_name, eaton_serial_probes[i].name);
+		if ((dev = eaton_serial_probes[i].probe(port_name)) != NULL) {
+			break;
+		}
 	}
+
+	gettimeofday(&now, NULL);
+	if (dev) {
+		upsdebugx(1, "%s: %s: found %s device (driver %s) in %.3f sec",
+			__func__, port_name, eaton_serial_probes[i].name,
+			dev->driver, difftimeval(now, start));
+	} else {
+		upsdebugx(1, "%s: %s: no device found in %.3f sec",
+			__func__, port_name, difftimeval(now, start));
+	}
+
 	return dev;
 }
 
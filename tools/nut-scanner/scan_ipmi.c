@@ -584,7 +584,7 @@ nutscan_device_t * nutscan_scan_ipmi_device(const char * IPaddr, nutscan_ipmi_t
 			/* FIXME: also dump device.serial?
 			 * using drivers/libfreeipmi_get_board_info() */
 
-			current_nut_dev = nutscan_add_device_to_device(
+			current_nut_dev = nutscan_add_discovered_device(
 							current_nut_dev,
 							nut_dev);
 
@@ -32,6 +32,12 @@
 #include "nut_stdint.h"
 #include <ltdl.h>
 
+#ifndef WIN32
+# include <sys/socket.h>
+# include <netdb.h>
+# include <poll.h>
+#endif
+
 #define SCAN_NUT_DRIVERNAME "dummy-ups"
 
 /* dynamic link library stuff */
@@ -50,7 +56,7 @@ static int (*nut_upscli_disconnect)(UPSCONN_t *ups);
 /* This variable collects device(s) from a sequential or parallel scan,
  * is returned to caller, and cleared to allow subsequent independent scans */
 static nutscan_device_t * dev_ret = NULL;
-#ifdef HAVE_PTHREAD
+#if (defined HAVE_PTHREAD) && (defined WIN32)
 static pthread_mutex_t dev_mutex;
 #endif
 
@@ -138,7 +144,68 @@ err:
 	return 0;
 }
 
-/* FIXME: SSL support */
+/* Report one device served by a NUT data server; the caller must
+ * hold dev_mutex if several scanning threads may be running */
+static void scan_nut_add_device(const char *upsname, const char *hostname, uint16_t port)
+{
+	nutscan_device_t * dev = NULL;
+	size_t buf_size;
+
+	/* FIXME: check for duplication by getting driver.port and device.serial
+	 * for comparison with other busses results */
+	/* FIXME:
+	 * - also print the description if != "Unavailable"?
+	 * - for upsmon.conf or ups.conf (using dummy-ups)? */
+	dev = nutscan_new_device();
+	dev->type = TYPE_NUT;
+	/* NOTE: There is no driver by such name, in practice it could
+	 * be a dummy-ups relay, a clone driver, or part of upsmon config */
+	dev->driver = strdup(SCAN_NUT_DRIVERNAME);
+	/* +1+1 is for '@' character and terminating 0,
+	 * and the other +1+1 is for possible '[' and ']'
+	 * around the host name:
+	 */
+	buf_size = strlen(upsname) + strlen(hostname) + 1 + 1 + 1 + 1;
+	if (port != PORT) {
+		/* colon and up to 5 digits */
+		buf_size += 6;
+	}
+
+	dev->port = malloc(buf_size);
+
+	if (dev->port) {
+		/* Check if IPv6 and needs brackets */
+		const char	*hostname_colon = strchr(hostname, ':');
+
+		if (hostname_colon && *hostname_colon == '\0')
+			hostname_colon = NULL;
+		if (*hostname == '[')
+			hostname_colon = NULL;
+
+		if (port != PORT) {
+			if (hostname_colon) {
+				snprintf(dev->port, buf_size, "%s@[%s]:%" PRIu16,
+					upsname, hostname, port);
+			} else {
+				snprintf(dev->port, buf_size, "%s@%s:%" PRIu16,
+					upsname, hostname, port);
+			}
+		} else {
+			/* Standard port, not suffixed */
+			if (hostname_colon) {
+				snprintf(dev->port, buf_size, "%s@[%s]",
+					upsname, hostname);
+			} else {
+				snprintf(dev->port, buf_size, "%s@%s",
+					upsname, hostname);
+			}
+		}
+		dev_ret = nutscan_add_discovered_device(dev_ret, dev);
+	}
+}
+
+/* List the devices of one server through libupsclient, which also sets
+ * up SSL when the server offers it */
 static void * list_nut_devices(void * arg)
 {
 	struct scan_nut_arg * nut_arg = (struct scan_nut_arg*)arg;
@@ -150,8 +217,6 @@ static void * list_nut_devices(void * arg)
 	char **answer;
 	char *hostname = NULL;
 	UPSCONN_t *ups = malloc(sizeof(*ups));
-	nutscan_device_t * dev = NULL;
-	size_t buf_size;
 
 	tv.tv_sec = nut_arg->timeout / (1000*1000);
 	tv.tv_usec = nut_arg->timeout % (1000*1000);
@@ -192,64 +257,13 @@ static void * list_nut_devices(void * arg)
 			free(ups);
 			return NULL;
 		}
-		/* FIXME: check for duplication by getting driver.port and device.serial
-		 * for comparison with other busses results */
-		/* FIXME:
-		 * - also print answer[2] if != "Unavailable"?
-		 * - for upsmon.conf or ups.conf (using dummy-ups)? */
-		dev = nutscan_new_device();
-		dev->type = TYPE_NUT;
-		/* NOTE: There is no driver by such name, in practice it could
-		 * be a dummy-ups relay, a clone driver, or part of upsmon config */
-		dev->driver = strdup(SCAN_NUT_DRIVERNAME);
-		/* +1+1 is for '@' character and terminating 0,
-		 * and the other +1+1 is for possible '[' and ']'
-		 * around the host name:
-		 */
-		buf_size = strlen(answer[1]) + strlen(hostname) + 1 + 1 + 1 + 1;
-		if (port != PORT) {
-			/* colon and up to 5 digits */
-			buf_size += 6;
-		}
-
-		dev->port = malloc(buf_size);
-
-		if (dev->port) {
-			/* Check if IPv6 and needs brackets */
-			char	*hostname_colon = strchr(hostname, ':');
-
-			if (hostname_colon && *hostname_colon == '\0')
-				hostname_colon = NULL;
-			if (*hostname == '[')
-				hostname_colon = NULL;
-
-			if (port != PORT) {
-				if (hostname_colon) {
-					snprintf(dev->port, buf_size, "%s@[%s]:%" PRIu16,
-						answer[1], hostname, port);
-				} else {
-					snprintf(dev->port, buf_size, "%s@%s:%" PRIu16,
-						answer[1], hostname, port);
-				}
-			} else {
-				/* Standard port, not suffixed */
-				if (hostname_colon) {
-					snprintf(dev->port, buf_size, "%s@[%s]",
-						answer[1], hostname);
-				} else {
-					snprintf(dev->port, buf_size, "%s@%s",
-						answer[1], hostname);
-				}
-			}
-#ifdef HAVE_PTHREAD
-			pthread_mutex_lock(&dev_mutex);
+#if (defined HAVE_PTHREAD) && (defined WIN32)
+		pthread_mutex_lock(&dev_mutex);
 #endif
-			dev_ret = nutscan_add_device_to_device(dev_ret, dev);
-#ifdef HAVE_PTHREAD
-			pthread_mutex_unlock(&dev_mutex);
+		scan_nut_add_device(answer[1], hostname, port);
+#if (defined HAVE_PTHREAD) && (defined WIN32)
+		pthread_mutex_unlock(&dev_mutex);
 #endif
-		}
-
 	}
 
 	(*nut_upscli_disconnect)(ups);
@@ -259,35 +273,16 @@ static void * list_nut_devices(void * arg)
 	return NULL;
 }
 
-nutscan_device_t * nutscan_scan_nut(const char* start_ip, const char* stop_ip, const char* port, useconds_t usec_timeout)
-{
-	nutscan_device_t	*ndret;
-	nutscan_ip_range_list_t irl;
-
-	nutscan_init_ip_ranges(&irl);
-	nutscan_add_ip_range(&irl, (char *)start_ip, (char *)stop_ip);
-
-	ndret = nutscan_scan_ip_range_nut(&irl, port, usec_timeout);
-
-	/* Avoid nuking caller's strings here */
-	irl.ip_ranges->start_ip = NULL;
-	irl.ip_ranges->end_ip = NULL;
-	nutscan_free_ip_ranges(&irl);
-
-	return ndret;
-}
+#ifdef WIN32
 
-nutscan_device_t * nutscan_scan_ip_range_nut(nutscan_ip_range_list_t * irl, const char* port, useconds_t usec_timeout)
+/* Thread-per-address engine, used where poll() on sockets is not available */
+static nutscan_device_t * scan_ip_range_nut_threads(nutscan_ip_range_list_t * irl, const char* port, useconds_t usec_timeout)
 {
 	bool_t pass = TRUE; /* Track that we may spawn a scanning thread */
 	nutscan_ip_range_list_iter_t ip;
 	char * ip_str = NULL;
 	char * ip_dest = NULL;
 	char buf[SMALLBUF];
-#ifndef WIN32
-	struct sigaction oldact;
-	int change_action_handler = 0;
-#endif
 	struct scan_nut_arg *nut_arg;
 
 #ifdef HAVE_PTHREAD
@@ -304,11 +299,9 @@ nutscan_device_t * nutscan_scan_ip_range_nut(nutscan_ip_range_list_t * irl, cons
 # endif
 #endif /* HAVE_PTHREAD */
 
-#ifdef WIN32
 	WSADATA WSAdata;
 	WSAStartup(2,&WSAdata);
 	atexit((void(*)(void))WSACleanup);
-#endif
 
 #ifdef HAVE_PTHREAD
 	pthread_mutex_init(&dev_mutex, NULL);
@@ -348,44 +341,6 @@ nutscan_device_t * nutscan_scan_ip_range_nut(nutscan_ip_range_list_t * irl, cons
 
 #endif /* HAVE_PTHREAD */
 
-	if (!nutscan_avail_nut) {
-		return NULL;
-	}
-
-	if (irl == NULL || irl->ip_ranges == NULL) {
-		return NULL;
-	}
-
-	if (!irl->ip_ranges->start_ip) {
-		upsdebugx(1, "%s: no starting IP address specified", __func__);
-	} else if (irl->ip_ranges_count == 1
-		&& (irl->ip_ranges->start_ip == irl->ip_ranges->end_ip
-		    || !strcmp(irl->ip_ranges->start_ip, irl->ip_ranges->end_ip)
-	)) {
-		upsdebugx(1, "%s: Scanning \"Old NUT\" bus for single IP address: %s",
-			__func__, irl->ip_ranges->start_ip);
-	} else {
-		upsdebugx(1, "%s: Scanning \"Old NUT\" bus for IP address range(s): %s",
-			__func__, nutscan_stringify_ip_ranges(irl));
-	}
-
-#ifndef WIN32
-	/* Ignore SIGPIPE if the caller hasn't set a handler for it yet */
-	if (sigaction(SIGPIPE, NULL, &oldact) == 0) {
-#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_STRICT_PROTOTYPES)
-# pragma GCC diagnostic push
-# pragma GCC diagnostic ignored "-Wstrict-prototypes"
-#endif
-		if (oldact.sa_handler == SIG_DFL) {
-			change_action_handler = 1;
-			signal(SIGPIPE, SIG_IGN);
-		}
-#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_STRICT_PROTOTYPES)
-# pragma GCC diagnostic pop
-#endif
-	}
-#endif
-
 	ip_str = nutscan_ip_ranges_iter_init(&ip, irl);
 
 	while (ip_str != NULL) {
@@ -645,7 +600,438 @@ nutscan_device_t * nutscan_scan_ip_range_nut(nutscan_ip_range_list_t * irl, cons
 # endif /* HAVE_SEMAPHORE */
 #endif /* HAVE_PTHREAD */
 
-#ifndef WIN32
+	return nutscan_rewind_device(dev_ret);
+}
+
+#else	/* !WIN32 */
+
+/* Event-driven engine: a single thread keeps a window of non-blocking
+ * probes in flight and multiplexes them with poll(), so scanning large
+ * ranges costs one socket per outstanding probe rather than one thread.
+ * Each probe connects, asks for STARTTLS like UPSCLI_CONN_TRYSSL does,
+ * then sends "LIST UPS" and collects the answer, with a deadline (the
+ * scan timeout) for each of these steps. Servers which accept STARTTLS
+ * are listed afterwards through libupsclient, which sets up SSL. */
+
+#define SCAN_NUT_STARTTLS	"STARTTLS\n"
+#define SCAN_NUT_QUERY	"LIST UPS\n"
+
+typedef enum {
+	SCAN_NUT_PROBE_FREE = 0,
+	SCAN_NUT_PROBE_CONNECTING,
+	SCAN_NUT_PROBE_STARTTLS,
+	SCAN_NUT_PROBE_READING
+} scan_nut_probe_state_t;
+
+/* scan_nut_probe_read() results */
+#define SCAN_NUT_PROBE_MORE	0
+#define SCAN_NUT_PROBE_DONE	1
+#define SCAN_NUT_PROBE_TLS	2
+
+typedef struct {
+	scan_nut_probe_state_t	state;
+	int	fd;
+	char	*hostname;		/* numeric address, without brackets */
+	useconds_t	timeout;
+	struct timeval	deadline;
+	char	buf[LARGEBUF];		/* partial line carried between reads */
+	size_t	buflen;
+} scan_nut_probe_t;
+
+static void scan_nut_set_deadline(struct timeval *deadline, useconds_t usec)
+{
+	gettimeofday(deadline, NULL);
+	deadline->tv_sec += (time_t)(usec / (1000*1000));
+	deadline->tv_usec += (suseconds_t)(usec % (1000*1000));
+	if (deadline->tv_usec >= 1000*1000) {
+		deadline->tv_sec++;
+		deadline->tv_usec -= 1000*1000;
+	}
+}
+
+static void scan_nut_probe_close(scan_nut_probe_t *probe)
+{
+	if (probe->fd >= 0) {
+		close(probe->fd);
+	}
+
+	free(probe->hostname);
+	probe->hostname = NULL;
+	probe->fd = -1;
+	probe->buflen = 0;
+	probe->state = SCAN_NUT_PROBE_FREE;
+}
+
+/* Returns 0 when the query went out whole, -1 otherwise */
+static int scan_nut_probe_send(scan_nut_probe_t *probe, const char *query,
+	scan_nut_probe_state_t state)
+{
+	ssize_t	ret;
+
+	ret = send(probe->fd, query, strlen(query), 0);
+
+	if (ret != (ssize_t)strlen(query)) {
+		upsdebug_with_errno(3, "%s: %s: failed to send query",
+			__func__, probe->hostname);
+		return -1;
+	}
+
+	probe->state = state;
+	scan_nut_set_deadline(&probe->deadline, probe->timeout);
+
+	return 0;
+}
+
+/* Returns 0 when the probe is in flight, -1 when there is nothing to wait for */
+static int scan_nut_probe_start(scan_nut_probe_t *probe, const char *ip_str,
+	const char *portstr, useconds_t usec_timeout)
+{
+	struct addrinfo	hints, *res = NULL;
+	int	fd, ret;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+
+	if ((ret = getaddrinfo(ip_str, portstr, &hints, &res)) != 0) {
+		upsdebugx(3, "%s: %s: %s", __func__, ip_str, gai_strerror(ret));
+		return -1;
+	}
+
+	fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (fd < 0) {
+		upsdebug_with_errno(3, "%s: %s: socket", __func__, ip_str);
+		freeaddrinfo(res);
+		return -1;
+	}
+
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+		upsdebug_with_errno(3, "%s: %s: fcntl", __func__, ip_str);
+		close(fd);
+		freeaddrinfo(res);
+		return -1;
+	}
+
+	ret = connect(fd, res->ai_addr, res->ai_addrlen);
+	freeaddrinfo(res);
+
+	if (ret < 0 && errno != EINPROGRESS) {
+		upsdebug_with_errno(3, "%s: %s: connect", __func__, ip_str);
+		close(fd);
+		return -1;
+	}
+
+	probe->fd = fd;
+	probe->hostname = xstrdup(ip_str);
+	probe->timeout = usec_timeout;
+	probe->buflen = 0;
+
+	if (ret == 0) {
+		/* Connected at once, typically to a local address */
+		if (scan_nut_probe_send(probe, SCAN_NUT_STARTTLS, SCAN_NUT_PROBE_STARTTLS) < 0) {
+			scan_nut_probe_close(probe);
+			return -1;
+		}
+		return 0;
+	}
+
+	probe->state = SCAN_NUT_PROBE_CONNECTING;
+	scan_nut_set_deadline(&probe->deadline, usec_timeout);
+
+	return 0;
+}
+
+/* Consume what the server sent so far: returns SCAN_NUT_PROBE_MORE if
+ * more is expected, SCAN_NUT_PROBE_DONE when the listing is complete,
+ * SCAN_NUT_PROBE_TLS if the server accepted STARTTLS, and -1 on errors
+ * or unexpected data */
+static int scan_nut_probe_read(scan_nut_probe_t *probe, uint16_t port)
+{
+	ssize_t	ret;
+	char	*line, *eol, *upsname;
+
+	ret = recv(probe->fd, probe->buf + probe->buflen,
+		sizeof(probe->buf) - probe->buflen - 1, 0);
+
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return 0;
+		}
+		upsdebug_with_errno(3, "%s: %s: recv", __func__, probe->hostname);
+		return -1;
+	}
+
+	if (ret == 0) {
+		upsdebugx(3, "%s: %s: server closed the connection",
+			__func__, probe->hostname);
+		return -1;
+	}
+
+	probe->buflen += (size_t)ret;
+	probe->buf[probe->buflen] = '\0';
+
+	line = probe->buf;
+	while ((eol = strchr(line, '\n')) != NULL) {
+		*eol = '\0';
+		if (eol > line && eol[-1] == '\r') {
+			eol[-1] = '\0';
+		}
+
+		upsdebugx(5, "%s: %s: [%s]", __func__, probe->hostname, line);
+
+		if (probe->state == SCAN_NUT_PROBE_STARTTLS) {
+			if (!strncmp(line, "OK STARTTLS", 11)) {
+				return SCAN_NUT_PROBE_TLS;
+			}
+
+			/* Like upscli_sslinit(): anything else means no SSL */
+			if (scan_nut_probe_send(probe, SCAN_NUT_QUERY, SCAN_NUT_PROBE_READING) < 0) {
+				return -1;
+			}
+
+			line = eol + 1;
+			continue;
+		}
+
+		if (!strcmp(line, "END LIST UPS")) {
+			return SCAN_NUT_PROBE_DONE;
+		}
+
+		if (!strncmp(line, "UPS ", 4)) {
+			/* UPS <upsname> <description> */
+			upsname = line + 4;
+			if (strchr(upsname, ' ') == NULL) {
+				return -1;
+			}
+			*strchr(upsname, ' ') = '\0';
+			scan_nut_add_device(upsname, probe->hostname, port);
+		} else if (strcmp(line, "BEGIN LIST UPS")) {
+			/* An ERR answer, or not a NUT data server at all */
+			return -1;
+		}
+
+		line = eol + 1;
+	}
+
+	probe->buflen = strlen(line);
+	if (probe->buflen >= sizeof(probe->buf) - 1) {
+		upsdebugx(3, "%s: %s: answer line too long",
+			__func__, probe->hostname);
+		return -1;
+	}
+	memmove(probe->buf, line, probe->buflen + 1);
+
+	return SCAN_NUT_PROBE_MORE;
+}
+
+static nutscan_device_t * scan_ip_range_nut_events(nutscan_ip_range_list_t * irl, const char* port, useconds_t usec_timeout)
+{
+	nutscan_ip_range_list_iter_t ip;
+	char * ip_str = NULL;
+	char portstr[SMALLBUF];
+	uint16_t portnum = PORT;
+	struct sigaction oldact;
+	int change_action_handler = 0;
+	scan_nut_probe_t	*probes;
+	struct pollfd	*fds;
+	size_t	*fdprobe;
+	size_t	window, inflight = 0, slot = 0, nfds, i;
+	struct timeval	now;
+	double	remaining, wait;
+	int	ret, ret2, timeout_ms;
+	char	portbuf[SMALLBUF];
+	char	**tls_hosts = NULL;
+	size_t	tls_count = 0;
+
+	if (port) {
+		unsigned short	ushort_port;
+
+		if (!str_to_ushort(port, &ushort_port, 10) || ushort_port == 0) {
+			upsdebugx(0, "%s: invalid port number: %s", __func__, port);
+			return NULL;
+		}
+		portnum = (uint16_t)ushort_port;
+	}
+	snprintf(portstr, sizeof(portstr), "%" PRIu16, portnum);
+
+	/* One socket per probe in flight, so the same limits apply
+	 * as to the amount of scanning threads elsewhere */
+#if (defined HAVE_PTHREAD) && ((defined HAVE_PTHREAD_TRYJOIN) || (defined HAVE_SEMAPHORE))
+	window = max_threads;
+	if (max_threads_oldnut > 0 && max_threads_oldnut < window) {
+		window = max_threads_oldnut;
+	}
+#else
+	window = DEFAULT_THREAD;
+#endif
+	if (window < 1) {
+		window = 1;
+	}
+
+	upsdebugx(2, "%s: up to %" PRIuSIZE " probes in flight", __func__, window);
+
+	probes = xcalloc(window, sizeof(*probes));
+	fds = xcalloc(window, sizeof(*fds));
+	fdprobe = xcalloc(window, sizeof(*fdprobe));
+	for (i = 0; i < window; i++) {
+		probes[i].fd = -1;
+	}
+
+	/* Ignore SIGPIPE if the caller hasn't set a handler for it yet */
+	if (sigaction(SIGPIPE, NULL, &oldact) == 0) {
+#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_STRICT_PROTOTYPES)
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wstrict-prototypes"
+#endif
+		if (oldact.sa_handler == SIG_DFL) {
+			change_action_handler = 1;
+			signal(SIGPIPE, SIG_IGN);
+		}
+#if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_STRICT_PROTOTYPES)
+# pragma GCC diagnostic pop
+#endif
+	}
+
+	ip_str = nutscan_ip_ranges_iter_init(&ip, irl);
+
+	while (ip_str != NULL || inflight > 0) {
+		/* Top up the window with new targets */
+		while (ip_str != NULL && inflight < window) {
+			while (probes[slot].state != SCAN_NUT_PROBE_FREE) {
+				slot = (slot + 1) % window;
+			}
+
+			upsdebugx(4, "%s: probing %s", __func__, ip_str);
+			if (scan_nut_probe_start(&probes[slot], ip_str, portstr, usec_timeout) == 0) {
+				inflight++;
+			}
+
+			free(ip_str);
+			ip_str = nutscan_ip_ranges_iter_inc(&ip);
+		}
+
+		/* Expire late probes, wait on the others until the nearest deadline */
+		gettimeofday(&now, NULL);
+		nfds = 0;
+		wait = -1;
+		for (i = 0; i < window; i++) {
+			if (probes[i].state == SCAN_NUT_PROBE_FREE) {
+				continue;
+			}
+
+			remaining = difftimeval(probes[i].deadline, now);
+			if (remaining <= 0) {
+				upsdebugx(3, "%s: %s: timed out while %s", __func__,
+					probes[i].hostname,
+					probes[i].state == SCAN_NUT_PROBE_CONNECTING
+						? "connecting" : "waiting for an answer");
+				scan_nut_probe_close(&probes[i]);
+				inflight--;
+				continue;
+			}
+
+			if (wait < 0 || remaining < wait) {
+				wait = remaining;
+			}
+
+			fds[nfds].fd = probes[i].fd;
+			fds[nfds].events = (probes[i].state == SCAN_NUT_PROBE_CONNECTING)
+				? POLLOUT : POLLIN;
+			fds[nfds].revents = 0;
+			fdprobe[nfds] = i;
+			nfds++;
+		}
+
+		if (nfds == 0) {
+			continue;
+		}
+
+		/* Round up, so we do not spin just short of a deadline */
+		timeout_ms = (wait > (double)(INT_MAX / 1000)) ? INT_MAX : (int)(wait * 1000) + 1;
+
+		ret = poll(fds, (nfds_t)nfds, timeout_ms);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			upsdebug_with_errno(1, "%s: poll", __func__);
+			break;
+		}
+
+		for (i = 0; i < nfds && ret > 0; i++) {
+			scan_nut_probe_t	*probe = &probes[fdprobe[i]];
+
+			if (fds[i].revents == 0) {
+				continue;
+			}
+			ret--;
+
+			if (probe->state == SCAN_NUT_PROBE_CONNECTING) {
+				int	err = 0;
+				socklen_t	errlen = sizeof(err);
+
+				if (getsockopt(probe->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) < 0
+				||  err != 0
+				) {
+					upsdebugx(3, "%s: %s: connect: %s", __func__,
+						probe->hostname, strerror(err ? err : errno));
+					scan_nut_probe_close(probe);
+					inflight--;
+					continue;
+				}
+
+				if (scan_nut_probe_send(probe, SCAN_NUT_STARTTLS, SCAN_NUT_PROBE_STARTTLS) < 0) {
+					scan_nut_probe_close(probe);
+					inflight--;
+				}
+				continue;
+			}
+
+			ret2 = scan_nut_probe_read(probe, portnum);
+			if (ret2 == SCAN_NUT_PROBE_MORE) {
+				continue;
+			}
+
+			if (ret2 == SCAN_NUT_PROBE_TLS) {
+				/* Keep it for later, with the address as
+				 * upscli_splitaddr() takes it */
+				snprintf(portbuf, sizeof(portbuf),
+					strchr(probe->hostname, ':') ? "[%s]:%s" : "%s:%s",
+					probe->hostname, portstr);
+				tls_hosts = xrealloc(tls_hosts, (tls_count + 1) * sizeof(*tls_hosts));
+				tls_hosts[tls_count++] = xstrdup(portbuf);
+			}
+
+			scan_nut_probe_close(probe);
+			inflight--;
+		}
+	}
+
+	/* Servers which accepted STARTTLS: one at a time, with the same
+	 * timeout, as there are usually few of them */
+	for (i = 0; i < tls_count; i++) {
+		struct scan_nut_arg	*nut_arg = xcalloc(1, sizeof(*nut_arg));
+
+		upsdebugx(3, "%s: %s: listing devices over SSL", __func__, tls_hosts[i]);
+		nut_arg->hostname = tls_hosts[i];
+		nut_arg->timeout = usec_timeout;
+		/* frees nut_arg and the host name */
+		list_nut_devices(nut_arg);
+	}
+	free(tls_hosts);
+
+	for (i = 0; i < window; i++) {
+		if (probes[i].state != SCAN_NUT_PROBE_FREE) {
+			scan_nut_probe_close(&probes[i]);
+		}
+	}
+	free(ip_str);
+	free(probes);
+	free(fds);
+	free(fdprobe);
+
 	if (change_action_handler) {
 #if (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_PUSH_POP) && (defined HAVE_PRAGMA_GCC_DIAGNOSTIC_IGNORED_STRICT_PROTOTYPES)
 # pragma GCC diagnostic push
@@ -656,7 +1042,55 @@ nutscan_device_t * nutscan_scan_ip_range_nut(nutscan_ip_range_list_t * irl, cons
 # pragma GCC diagnostic pop
 #endif
 	}
-#endif
 
 	return nutscan_rewind_device(dev_ret);
 }
+#endif	/* !WIN32 */
+
+nutscan_device_t * nutscan_scan_nut(const char* start_ip, const char* stop_ip, const char* port, useconds_t usec_timeout)
+{
+	nutscan_device_t	*ndret;
+	nutscan_ip_range_list_t irl;
+
+	nutscan_init_ip_ranges(&irl);
+	nutscan_add_ip_range(&irl, (char *)start_ip, (char *)stop_ip);
+
+	ndret = nutscan_scan_ip_range_nut(&irl, port, usec_timeout);
+
+	/* Avoid nuking caller's strings here */
+	irl.ip_ranges->start_ip = NULL;
+	irl.ip_ranges->end_ip = NULL;
+	nutscan_free_ip_ranges(&irl);
+
+	return ndret;
+}
+
+nutscan_device_t * nutscan_scan_ip_range_nut(nutscan_ip_range_list_t * irl, const char* port, useconds_t usec_timeout)
+{
+	if (!nutscan_avail_nut) {
+		return NULL;
+	}
+
+	if (irl == NULL || irl->ip_ranges == NULL) {
+		return NULL;
+	}
+
+	if (!irl->ip_ranges->start_ip) {
+		upsdebugx(1, "%s: no starting IP address specified", __func__);
+	} else if (irl->ip_ranges_count == 1
+		&& (irl->ip_ranges->start_ip == irl->ip_ranges->end_ip
+		    || !strcmp(irl->ip_ranges->start_ip, irl->ip_ranges->end_ip)
+	)) {
+		upsdebugx(1, "%s: Scanning \"Old NUT\" bus for single IP address: %s",
+			__func__, irl->ip_ranges->start_ip);
+	} else {
+		upsdebugx(1, "%s: Scanning \"Old NUT\" bus for IP address range(s): %s",
+			__func__, nutscan_stringify_ip_ranges(irl));
+	}
+
+#ifdef WIN32
+	return scan_ip_range_nut_threads(irl, port, usec_timeout);
+#else
+	return scan_ip_range_nut_events(irl, port, usec_timeout);
+#endif
+}
@@ -76,7 +76,7 @@ nutscan_device_t * nutscan_scan_nut_simulation(void)
 #ifdef HAVE_PTHREAD
 			pthread_mutex_lock(&dev_mutex);
 #endif
-			dev_ret = nutscan_add_device_to_device(dev_ret, dev);
+			dev_ret = nutscan_add_discovered_device(dev_ret, dev);
 #ifdef HAVE_PTHREAD
 			pthread_mutex_unlock(&dev_mutex);
 #endif
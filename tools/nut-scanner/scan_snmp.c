@@ -33,6 +33,7 @@
 
 #ifndef WIN32
 # include <sys/socket.h>
+# include <sys/select.h>
 #else
 # undef _WIN32_WINNT
 #endif
@@ -100,7 +101,7 @@
 /* This variable collects device(s) from a sequential or parallel scan,
  * is returned to caller, and cleared to allow subsequent independent scans */
 static nutscan_device_t * dev_ret = NULL;
-#ifdef HAVE_PTHREAD
+#if (defined HAVE_PTHREAD) && (defined WIN32)
 static pthread_mutex_t dev_mutex;
 #endif
 static useconds_t g_usec_timeout ;
@@ -130,6 +131,13 @@ static netsnmp_variable_list * (*nut_snmp_add_null_var)(netsnmp_pdu *pdu,
 			const oid *objid, size_t objidlen);
 static int (*nut_snmp_sess_synch_response) (void *sessp, netsnmp_pdu *pdu,
 			netsnmp_pdu **response);
+static int (*nut_snmp_sess_async_send) (void *sessp, netsnmp_pdu *pdu,
+			snmp_callback callback, void *cb_data);
+static int (*nut_snmp_sess_select_info) (void *sessp, int *numfds,
+			fd_set *fdset, struct timeval *timeout, int *block);
+static int (*nut_snmp_sess_read) (void *sessp, fd_set *fdset);
+static void (*nut_snmp_sess_timeout) (void *sessp);
+static netsnmp_transport * (*nut_snmp_sess_transport) (void *sessp);
 static int (*nut_snmp_oid_compare) (const oid *in_name1, size_t len1,
 			const oid *in_name2, size_t len2);
 static void (*nut_snmp_free_pdu) (netsnmp_pdu *pdu);
@@ -211,6 +219,16 @@ int nutscan_load_snmp_library(const char *libname_path)
 				snmp_add_null_var;
 	*(void **) (&nut_snmp_sess_synch_response) =
 			snmp_sess_synch_response;
+	*(void **) (&nut_snmp_sess_async_send) =
+			snmp_sess_async_send;
+	*(void **) (&nut_snmp_sess_select_info) =
+			snmp_sess_select_info;
+	*(void **) (&nut_snmp_sess_read) =
+				snmp_sess_read;
+	*(void **) (&nut_snmp_sess_timeout) =
+				snmp_sess_timeout;
+	*(void **) (&nut_snmp_sess_transport) =
+				snmp_sess_transport;
 	*(void **) (&nut_snmp_oid_compare) =
 				snmp_oid_compare;
 	*(void **) (&nut_snmp_free_pdu) = snmp_free_pdu;
@@ -346,6 +364,36 @@ int nutscan_load_snmp_library(const char *libname_path)
 		goto err;
 	}
 
+	*(void **) (&nut_snmp_sess_async_send) = lt_dlsym(dl_handle,
+						"snmp_sess_async_send");
+	if ((dl_error = lt_dlerror()) != NULL) {
+		goto err;
+	}
+
+	*(void **) (&nut_snmp_sess_select_info) = lt_dlsym(dl_handle,
+						"snmp_sess_select_info");
+	if ((dl_error = lt_dlerror()) != NULL) {
+		goto err;
+	}
+
+	*(void **) (&nut_snmp_sess_read) = lt_dlsym(dl_handle,
+							"snmp_sess_read");
+	if ((dl_error = lt_dlerror()) != NULL) {
+		goto err;
+	}
+
+	*(void **) (&nut_snmp_sess_timeout) = lt_dlsym(dl_handle,
+							"snmp_sess_timeout");
+	if ((dl_error = lt_dlerror()) != NULL) {
+		goto err;
+	}
+
+	*(void **) (&nut_snmp_sess_transport) = lt_dlsym(dl_handle,
+							"snmp_sess_transport");
+	if ((dl_error = lt_dlerror()) != NULL) {
+		goto err;
+	}
+
 	*(void **) (&nut_snmp_oid_compare) = lt_dlsym(dl_handle,
 							"snmp_oid_compare");
 	if ((dl_error = lt_dlerror()) != NULL) {
@@ -537,16 +585,30 @@ static void scan_snmp_add_device(nutscan_snmp_t * sec, struct snmp_pdu *response
 		}
 	}
 
-#ifdef HAVE_PTHREAD
+#if (defined HAVE_PTHREAD) && (defined WIN32)
 	pthread_mutex_lock(&dev_mutex);
 #endif
-	dev_ret = nutscan_add_device_to_device(dev_ret, dev);
-#ifdef HAVE_PTHREAD
+	dev_ret = nutscan_add_discovered_device(dev_ret, dev);
+#if (defined HAVE_PTHREAD) && (defined WIN32)
 	pthread_mutex_unlock(&dev_mutex);
 #endif
 
 }
 
+/* Whether a response carries a value for the requested OID */
+static int scan_snmp_valid_answer(struct snmp_pdu *response, oid *name, size_t name_len)
+{
+	return (response->errstat == SNMP_ERR_NOERROR
+	 && response->variables != NULL
+	 && response->variables->name != NULL
+	 && (*nut_snmp_oid_compare)(response->variables->name,
+	        response->variables->name_length,
+	        name, name_len) == 0
+	 && response->variables->val.string != NULL
+	);
+}
+
+#ifdef WIN32
 static struct snmp_pdu * scan_snmp_get_oid(char* oid_str, void* handle)
 {
 	size_t name_len;
@@ -577,15 +639,7 @@ static struct snmp_pdu * scan_snmp_get_oid(char* oid_str, void* handle)
 		return NULL;
 	}
 
-	if (status != STAT_SUCCESS
-	 || response->errstat != SNMP_ERR_NOERROR
-	 || response->variables == NULL
-	 || response->variables->name == NULL
-	 || ((*nut_snmp_oid_compare)(response->variables->name,
-	        response->variables->name_length,
-	        name, name_len) != 0)
-	 || response->variables->val.string == NULL
-	) {
+	if (status != STAT_SUCCESS || !scan_snmp_valid_answer(response, name, name_len)) {
 		(*nut_snmp_free_pdu)(response);
 		index++;
 		return NULL;
@@ -635,6 +689,8 @@ static void try_all_oid(void * arg, const char * mib_found)
 	}
 }
 
+#endif	/* WIN32 */
+
 static int init_session(struct snmp_session * snmp_sess, nutscan_snmp_t * sec)
 {
 	(*nut_snmp_sess_init)(snmp_sess);
@@ -894,6 +950,7 @@ static int init_session(struct snmp_session * snmp_sess, nutscan_snmp_t * sec)
 	return 1;
 }
 
+#ifdef WIN32
 static void * try_SysOID(void * arg)
 {
 	struct snmp_session snmp_sess;
@@ -1025,27 +1082,8 @@ try_SysOID_free:
 	return NULL;
 }
 
-nutscan_device_t * nutscan_scan_snmp(const char * start_ip, const char * stop_ip,
-                                     useconds_t usec_timeout, nutscan_snmp_t * sec)
-{
-	nutscan_device_t	*ndret;
-	nutscan_ip_range_list_t irl;
-
-	nutscan_init_ip_ranges(&irl);
-	nutscan_add_ip_range(&irl, (char *)start_ip, (char *)stop_ip);
-
-	ndret = nutscan_scan_ip_range_snmp(&irl, usec_timeout, sec);
-
-	/* Avoid nuking caller's strings here */
-	irl.ip_ranges->start_ip = NULL;
-	irl.ip_ranges->end_ip = NULL;
-	nutscan_free_ip_ranges(&irl);
-
-	return ndret;
-}
-
-nutscan_device_t * nutscan_scan_ip_range_snmp(nutscan_ip_range_list_t * irl,
-                                     useconds_t usec_timeout, nutscan_snmp_t * sec)
+/* Thread-per-address engine, used where select() on sockets is not available */
+static nutscan_device_t * scan_ip_range_snmp_threads(nutscan_ip_range_list_t * irl, nutscan_snmp_t * sec)
 {
 	bool_t pass = TRUE; /* Track that we may spawn a scanning thread */
 	nutscan_device_t * result;
@@ -1067,11 +1105,9 @@ nutscan_device_t * nutscan_scan_ip_range_snmp(nutscan_ip_range_list_t * irl,
 # endif
 #endif /* HAVE_PTHREAD */
 
-#ifdef WIN32
 	WSADATA WSAdata;
 	WSAStartup(2,&WSAdata);
 	atexit((void(*)(void))WSACleanup);
-#endif
 
 #ifdef HAVE_PTHREAD
 	pthread_mutex_init(&dev_mutex, NULL);
@@ -1111,38 +1147,6 @@ nutscan_device_t * nutscan_scan_ip_range_snmp(nutscan_ip_range_list_t * irl,
 
 #endif /* HAVE_PTHREAD */
 
-	if (!nutscan_avail_snmp) {
-		return NULL;
-	}
-
-	if (irl == NULL || irl->ip_ranges == NULL) {
-		return NULL;
-	}
-
-	if (!irl->ip_ranges->start_ip) {
-		upsdebugx(1, "%s: no starting IP address specified", __func__);
-	} else if (irl->ip_ranges_count == 1
-		&& (irl->ip_ranges->start_ip == irl->ip_ranges->end_ip
-		    || !strcmp(irl->ip_ranges->start_ip, irl->ip_ranges->end_ip)
-	)) {
-		upsdebugx(1, "%s: Scanning SNMP for single IP address: %s",
-			__func__, irl->ip_ranges->start_ip);
-	} else {
-		upsdebugx(1, "%s: Scanning SNMP for IP address range(s): %s",
-			__func__, nutscan_stringify_ip_ranges(irl));
-	}
-
-	g_usec_timeout = usec_timeout;
-
-	/* Force numeric OIDs resolution (ie, do not resolve to textual names)
-	 * This is mostly for the convenience of debug output */
-	if (nut_snmp_out_toggle_options("n") != NULL) {
-		upsdebugx(1, "Failed to enable numeric OIDs resolution");
-	}
-
-	/* Initialize the SNMP library */
-	(*nut_init_snmp)("nut-scanner");
-
 	ip_str = nutscan_ip_ranges_iter_init(&ip, irl);
 
 	while (ip_str != NULL) {
@@ -1390,6 +1394,478 @@ nutscan_device_t * nutscan_scan_ip_range_snmp(nutscan_ip_range_list_t * irl,
 	return result;
 }
 
+#else	/* !WIN32 */
+
+/* Event-driven engine: a single thread keeps a window of targets in
+ * flight, each with its own net-snmp session, and multiplexes them with
+ * select() on the sockets reported by snmp_sess_select_info(). The walk
+ * which try_SysOID() and try_all_oid() do with blocking requests is a
+ * state machine here: each step sends one request with
+ * snmp_sess_async_send(), scan_snmp_probe_callback() handles its answer
+ * from snmp_sess_read(), and each request gets the scan timeout as its
+ * deadline. */
+
+typedef enum {
+	SCAN_SNMP_PROBE_FREE = 0,
+	SCAN_SNMP_PROBE_SYSOID,	/* asking for the sysObjectID */
+	SCAN_SNMP_PROBE_MATCH,	/* checking the MIBs known for that sysObjectID */
+	SCAN_SNMP_PROBE_ALL,	/* trying the OIDs of all known MIBs */
+	SCAN_SNMP_PROBE_DONE
+} scan_snmp_probe_state_t;
+
+typedef struct {
+	scan_snmp_probe_state_t	state;
+	nutscan_snmp_t	sec;		/* peer name and session handle */
+	int	reqid;			/* request in flight, or 0 */
+	struct timeval	deadline;
+	oid	name[MAX_OID_LEN];	/* OID asked for */
+	size_t	name_len;
+	oid	sysoid[MAX_OID_LEN];	/* sysObjectID of the device */
+	size_t	sysoid_len;
+	size_t	index;			/* position in snmp_device_table[] */
+	int	found;			/* a MIB was found for the sysObjectID */
+} scan_snmp_probe_t;
+
+static void scan_snmp_set_deadline(struct timeval *deadline, useconds_t usec)
+{
+	gettimeofday(deadline, NULL);
+	deadline->tv_sec += (time_t)(usec / (1000*1000));
+	deadline->tv_usec += (suseconds_t)(usec % (1000*1000));
+	if (deadline->tv_usec >= 1000*1000) {
+		deadline->tv_sec++;
+		deadline->tv_usec -= 1000*1000;
+	}
+}
+
+static void scan_snmp_probe_close(scan_snmp_probe_t *probe)
+{
+	/* Set first: closing may run the callback for the pending request */
+	probe->state = SCAN_SNMP_PROBE_FREE;
+	probe->reqid = 0;
+
+	if (probe->sec.handle != NULL) {
+		(*nut_snmp_sess_close)(probe->sec.handle);
+		probe->sec.handle = NULL;
+	}
+
+	free(probe->sec.peername);
+	probe->sec.peername = NULL;
+}
+
+/* Handle the answer to the request in flight, or NULL if there was none */
+static void scan_snmp_probe_answer(scan_snmp_probe_t *probe, struct snmp_pdu *response)
+{
+	switch (probe->state) {
+		case SCAN_SNMP_PROBE_SYSOID:
+			if (response == NULL) {
+				upsdebugx(3, "%s: %s: no answer", __func__, probe->sec.peername);
+				probe->state = SCAN_SNMP_PROBE_DONE;
+				break;
+			}
+
+			/* SNMP device found: sysObjectID is supposed to
+			 * give the required MIB */
+			probe->sysoid_len = 0;
+			if (response->variables != NULL
+			&&  response->variables->val.objid != NULL
+			) {
+				probe->sysoid_len = response->variables->val_len / sizeof(oid);
+				if (probe->sysoid_len > MAX_OID_LEN) {
+					probe->sysoid_len = MAX_OID_LEN;
+				}
+				memcpy(probe->sysoid, response->variables->val.objid,
+					probe->sysoid_len * sizeof(oid));
+			}
+			probe->state = SCAN_SNMP_PROBE_MATCH;
+			probe->index = 0;
+			break;
+
+		case SCAN_SNMP_PROBE_MATCH:
+		case SCAN_SNMP_PROBE_ALL:
+			if (response != NULL
+			&&  scan_snmp_valid_answer(response, probe->name, probe->name_len)
+			) {
+				scan_snmp_add_device(&probe->sec, response,
+					snmp_device_table[probe->index].mib);
+				probe->found = 1;
+			}
+			probe->index++;
+			break;
+
+		case SCAN_SNMP_PROBE_FREE:
+		case SCAN_SNMP_PROBE_DONE:
+		default:
+			break;
+	}
+}
+
+/* Called from snmp_sess_read() with an answer, or from snmp_sess_timeout()
+ * and snmp_sess_close() when there will be none */
+static int scan_snmp_probe_callback(int operation, netsnmp_session *session,
+	int reqid, netsnmp_pdu *pdu, void *magic)
+{
+	scan_snmp_probe_t	*probe = (scan_snmp_probe_t *)magic;
+
+	NUT_UNUSED_VARIABLE(session);
+
+	if (probe->state == SCAN_SNMP_PROBE_FREE || reqid != probe->reqid) {
+		/* Late answer to a request we gave up on */
+		return 1;
+	}
+
+	probe->reqid = 0;
+	scan_snmp_probe_answer(probe,
+		(operation == NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE) ? pdu : NULL);
+
+	return 1;
+}
+
+/* Returns 0 when the request is in flight, -1 otherwise */
+static int scan_snmp_probe_send(scan_snmp_probe_t *probe, const char *oid_str)
+{
+	struct snmp_pdu	*pdu;
+
+	probe->name_len = MAX_OID_LEN;
+	if (!(*nut_snmp_parse_oid)(oid_str, probe->name, &probe->name_len)) {
+		upsdebugx(3, "%s: %s: cannot parse OID %s",
+			__func__, probe->sec.peername, oid_str);
+		return -1;
+	}
+
+	pdu = (*nut_snmp_pdu_create)(SNMP_MSG_GET);
+	if (pdu == NULL) {
+		return -1;
+	}
+	(*nut_snmp_add_null_var)(pdu, probe->name, probe->name_len);
+
+	probe->reqid = (*nut_snmp_sess_async_send)(probe->sec.handle, pdu,
+		scan_snmp_probe_callback, probe);
+	if (probe->reqid == 0) {
+		/* The PDU is only taken over when it was sent */
+		upsdebugx(3, "%s: %s: failed to send the request for %s",
+			__func__, probe->sec.peername, oid_str);
+		(*nut_snmp_free_pdu)(pdu);
+		return -1;
+	}
+
+	scan_snmp_set_deadline(&probe->deadline, g_usec_timeout);
+
+	return 0;
+}
+
+/* Send the next request of the walk: returns 0 when one is in flight,
+ * -1 when the probe is done */
+static int scan_snmp_probe_next(scan_snmp_probe_t *probe)
+{
+	snmp_device_id_t	*entry;
+	oid	name[MAX_OID_LEN];
+	size_t	name_len;
+
+	while (probe->state == SCAN_SNMP_PROBE_MATCH) {
+		entry = &snmp_device_table[probe->index];
+
+		if (entry->mib == NULL || probe->sysoid_len == 0) {
+			/* try a list of known OID, if no device was found otherwise */
+			probe->state = probe->found ? SCAN_SNMP_PROBE_DONE : SCAN_SNMP_PROBE_ALL;
+			probe->index = 0;
+			break;
+		}
+
+		name_len = MAX_OID_LEN;
+		if (entry->sysoid == NULL
+		||  !(*nut_snmp_parse_oid)(entry->sysoid, name, &name_len)
+		||  (*nut_snmp_oid_compare)(probe->sysoid, probe->sysoid_len,
+			name, name_len) != 0
+		) {
+			probe->index++;
+			continue;
+		}
+
+		/* add mib if no complementary oid is present */
+		/* FIXME: No desc defined when add device */
+		if (entry->oid == NULL || entry->oid[0] == '\0') {
+			scan_snmp_add_device(&probe->sec, NULL, entry->mib);
+			probe->found = 1;
+			probe->index++;
+			continue;
+		}
+
+		/* else test complementary oid before adding mib */
+		if (scan_snmp_probe_send(probe, entry->oid) == 0) {
+			return 0;
+		}
+		probe->index++;
+	}
+
+	while (probe->state == SCAN_SNMP_PROBE_ALL) {
+		entry = &snmp_device_table[probe->index];
+
+		if (entry->mib == NULL) {
+			probe->state = SCAN_SNMP_PROBE_DONE;
+			break;
+		}
+
+		if (entry->oid != NULL && entry->oid[0] != '\0'
+		&&  scan_snmp_probe_send(probe, entry->oid) == 0
+		) {
+			return 0;
+		}
+		probe->index++;
+	}
+
+	return -1;
+}
+
+/* Takes ip_str over; returns 0 when the probe is in flight, -1 when
+ * there is nothing to wait for */
+static int scan_snmp_probe_start(scan_snmp_probe_t *probe, nutscan_snmp_t *sec,
+	char *ip_str)
+{
+	struct snmp_session	snmp_sess;
+	netsnmp_transport	*transport;
+
+	memcpy(&probe->sec, sec, sizeof(probe->sec));
+	probe->sec.peername = ip_str;
+	probe->sec.handle = NULL;
+	probe->reqid = 0;
+	probe->sysoid_len = 0;
+	probe->index = 0;
+	probe->found = 0;
+	/* So that scan_snmp_probe_close() frees what is set up below */
+	probe->state = SCAN_SNMP_PROBE_SYSOID;
+
+	if (!init_session(&snmp_sess, &probe->sec)) {
+		free(snmp_sess.securityName);
+		scan_snmp_probe_close(probe);
+		return -1;
+	}
+
+	snmp_sess.retries = 0;
+	/* netsnmp timeout is accounted in uS, but typed as long
+	 * and not useconds_t (which is at most long per POSIX)
+	 */
+	snmp_sess.timeout = (long)g_usec_timeout;
+
+	probe->sec.handle = (*nut_snmp_sess_open)(&snmp_sess);
+	/* snmp_sess_open() made its own copy */
+	free(snmp_sess.securityName);
+	if (probe->sec.handle == NULL) {
+		upsdebugx(2, "Failed to open SNMP session for %s", ip_str);
+		scan_snmp_probe_close(probe);
+		return -1;
+	}
+
+	transport = (*nut_snmp_sess_transport)(probe->sec.handle);
+	if (transport == NULL || transport->sock < 0 || transport->sock >= FD_SETSIZE) {
+		upsdebugx(1, "%s: %s: too many open files to watch its socket, skipped",
+			__func__, ip_str);
+		scan_snmp_probe_close(probe);
+		return -1;
+	}
+
+	if (scan_snmp_probe_send(probe, SysOID) < 0) {
+		scan_snmp_probe_close(probe);
+		return -1;
+	}
+
+	return 0;
+}
+
+static nutscan_device_t * scan_ip_range_snmp_events(nutscan_ip_range_list_t * irl, nutscan_snmp_t * sec)
+{
+	nutscan_device_t	*result;
+	nutscan_ip_range_list_iter_t ip;
+	char * ip_str = NULL;
+	scan_snmp_probe_t	*probes, *probe;
+	size_t	window, inflight = 0, slot = 0, i;
+	struct timeval	now, tv;
+	fd_set	fdset;
+	double	remaining, wait;
+	int	numfds, block, ret;
+
+	/* One session (and socket) per target in flight, so the same limits
+	 * apply as to the amount of scanning threads elsewhere */
+#if (defined HAVE_PTHREAD) && ((defined HAVE_PTHREAD_TRYJOIN) || (defined HAVE_SEMAPHORE))
+	window = max_threads;
+	if (max_threads_netsnmp > 0 && max_threads_netsnmp < window) {
+		window = max_threads_netsnmp;
+	}
+#else
+	window = DEFAULT_THREAD;
+#endif
+	/* ... and select() can only watch sockets below FD_SETSIZE */
+	if (window > (size_t)(FD_SETSIZE / 2)) {
+		window = (size_t)(FD_SETSIZE / 2);
+	}
+	if (window < 1) {
+		window = 1;
+	}
+
+	upsdebugx(2, "%s: up to %" PRIuSIZE " targets in flight", __func__, window);
+
+	probes = xcalloc(window, sizeof(*probes));
+
+	ip_str = nutscan_ip_ranges_iter_init(&ip, irl);
+
+	while (ip_str != NULL || inflight > 0) {
+		/* Top up the window with new targets */
+		while (ip_str != NULL && inflight < window) {
+			while (probes[slot].state != SCAN_SNMP_PROBE_FREE) {
+				slot = (slot + 1) % window;
+			}
+
+			upsdebugx(4, "%s: probing %s", __func__, ip_str);
+			if (scan_snmp_probe_start(&probes[slot], sec, ip_str) == 0) {
+				inflight++;
+			}
+
+			ip_str = nutscan_ip_ranges_iter_inc(&ip);
+		}
+
+		/* Expire late requests, go on with the walk of the targets
+		 * which got their answer, and wait on the others until the
+		 * nearest deadline */
+		gettimeofday(&now, NULL);
+		FD_ZERO(&fdset);
+		numfds = 0;
+		wait = -1;
+		for (i = 0; i < window; i++) {
+			probe = &probes[i];
+			if (probe->state == SCAN_SNMP_PROBE_FREE) {
+				continue;
+			}
+
+			if (probe->reqid != 0 && difftimeval(probe->deadline, now) <= 0) {
+				upsdebugx(3, "%s: %s: timed out", __func__, probe->sec.peername);
+				probe->reqid = 0;
+				scan_snmp_probe_answer(probe, NULL);
+			}
+
+			if (probe->reqid == 0 && scan_snmp_probe_next(probe) < 0) {
+				scan_snmp_probe_close(probe);
+				inflight--;
+				continue;
+			}
+
+			remaining = difftimeval(probe->deadline, now);
+			if (remaining < 0) {
+				remaining = 0;
+			}
+			if (wait < 0 || remaining < wait) {
+				wait = remaining;
+			}
+
+			block = 1;
+			(*nut_snmp_sess_select_info)(probe->sec.handle,
+				&numfds, &fdset, &tv, &block);
+		}
+
+		if (wait < 0) {
+			continue;
+		}
+
+		/* Round up, so we do not spin just short of a deadline */
+		wait += 0.001;
+		tv.tv_sec = (time_t)wait;
+		tv.tv_usec = (suseconds_t)((wait - (double)tv.tv_sec) * 1000000);
+
+		ret = select(numfds, &fdset, NULL, NULL, &tv);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			upsdebug_with_errno(1, "%s: select", __func__);
+			break;
+		}
+
+		for (i = 0; i < window; i++) {
+			probe = &probes[i];
+			if (probe->state == SCAN_SNMP_PROBE_FREE) {
+				continue;
+			}
+
+			if (ret > 0) {
+				(*nut_snmp_sess_read)(probe->sec.handle, &fdset);
+			}
+			(*nut_snmp_sess_timeout)(probe->sec.handle);
+		}
+	}
+
+	for (i = 0; i < window; i++) {
+		if (probes[i].state != SCAN_SNMP_PROBE_FREE) {
+			scan_snmp_probe_close(&probes[i]);
+		}
+	}
+	free(ip_str);
+	free(probes);
+
+	result = nutscan_rewind_device(dev_ret);
+	dev_ret = NULL;
+	return result;
+}
+#endif	/* !WIN32 */
+
+nutscan_device_t * nutscan_scan_snmp(const char * start_ip, const char * stop_ip,
+                                     useconds_t usec_timeout, nutscan_snmp_t * sec)
+{
+	nutscan_device_t	*ndret;
+	nutscan_ip_range_list_t irl;
+
+	nutscan_init_ip_ranges(&irl);
+	nutscan_add_ip_range(&irl, (char *)start_ip, (char *)stop_ip);
+
+	ndret = nutscan_scan_ip_range_snmp(&irl, usec_timeout, sec);
+
+	/* Avoid nuking caller's strings here */
+	irl.ip_ranges->start_ip = NULL;
+	irl.ip_ranges->end_ip = NULL;
+	nutscan_free_ip_ranges(&irl);
+
+	return ndret;
+}
+
+nutscan_device_t * nutscan_scan_ip_range_snmp(nutscan_ip_range_list_t * irl,
+                                     useconds_t usec_timeout, nutscan_snmp_t * sec)
+{
+	if (!nutscan_avail_snmp) {
+		return NULL;
+	}
+
+	if (irl == NULL || irl->ip_ranges == NULL) {
+		return NULL;
+	}
+
+	if (!irl->ip_ranges->start_ip) {
+		upsdebugx(1, "%s: no starting IP address specified", __func__);
+	} else if (irl->ip_ranges_count == 1
+		&& (irl->ip_ranges->start_ip == irl->ip_ranges->end_ip
+		    || !strcmp(irl->ip_ranges->start_ip, irl->ip_ranges->end_ip)
+	)) {
+		upsdebugx(1, "%s: Scanning SNMP for single IP address: %s",
+			__func__, irl->ip_ranges->start_ip);
+	} else {
+		upsdebugx(1, "%s: Scanning SNMP for IP address range(s): %s",
+			__func__, nutscan_stringify_ip_ranges(irl));
+	}
+
+	g_usec_timeout = usec_timeout;
+
+	/* Force numeric OIDs resolution (ie, do not resolve to textual names)
+	 * This is mostly for the convenience of debug output */
+	if (nut_snmp_out_toggle_options("n") != NULL) {
+		upsdebugx(1, "Failed to enable numeric OIDs resolution");
+	}
+
+	/* Initialize the SNMP library */
+	(*nut_init_snmp)("nut-scanner");
+
+#ifdef WIN32
+	return scan_ip_range_snmp_threads(irl, sec);
+#else
+	return scan_ip_range_snmp_events(irl, sec);
+#endif
+}
+
 #else /* not WITH_SNMP */
 
 /* stub function */
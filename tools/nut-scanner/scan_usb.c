@@ -626,7 +626,7 @@ nutscan_device_t * nutscan_scan_usb(nutscan_usb_t * scanopts)
 						"NOTMATCHED-YET");
 				}
 
-				current_nut_dev = nutscan_add_device_to_device(
+				current_nut_dev = nutscan_add_discovered_device(
 					current_nut_dev,
 					nut_dev);
 
@@ -39,6 +39,8 @@
 # include <arpa/inet.h>
 # include <netinet/in.h>
 # include <sys/select.h>
+# include <fcntl.h>
+# include <poll.h>
 # define SOCK_OPT_CAST
 #else
 # define SOCK_OPT_CAST (char*)
@@ -57,6 +59,9 @@
 #include <ne_xml.h>
 #include <ltdl.h>
 
+/* Requests sent to each address (or broadcast) before giving up */
+#define MAX_RETRIES 3
+
 /* dynamic link library stuff */
 static lt_dlhandle dl_handle = NULL;
 static const char *dl_error = NULL;
@@ -182,6 +187,57 @@ static int startelm_cb(void *userdata, int parent, const char *nspace, const cha
 	return result;
 }
 
+/* Make a device of a reply to <SCAN_REQUEST/> from ip, or return NULL if
+ * netxml-ups does not support it; the caller must hold dev_mutex if
+ * several scanning threads may be running */
+static nutscan_device_t * nutscan_xml_http_device(const char *buf, size_t len, const char *ip, uint16_t port_udp)
+{
+	nutscan_device_t	*nut_dev;
+	ne_xml_parser	*parser;
+	int	parserFailed;
+	char	url[SMALLBUF];
+
+	nut_dev = nutscan_new_device();
+	if (nut_dev == NULL) {
+		fprintf(stderr, "Memory allocation error\n");
+		return NULL;
+	}
+
+	upsdebugx(5,
+		"Some host at IP %s replied to NetXML UDP request on port %d, "
+		"inspecting the response...",
+		ip, port_udp);
+	nut_dev->type = TYPE_XML;
+	/* Try to read device type */
+	parser = (*nut_ne_xml_create)();
+	(*nut_ne_xml_push_handler)(parser, startelm_cb,
+				NULL, NULL, nut_dev);
+	(*nut_ne_xml_parse)(parser, buf, len);
+	parserFailed = (*nut_ne_xml_failed)(parser); /* 0 = ok, nonzero = fail */
+	(*nut_ne_xml_destroy)(parser);
+
+	if (parserFailed != 0) {
+		fprintf(stderr,
+			"Device at IP %s replied with NetXML but was not deemed compatible "
+			"with 'netxml-ups' driver (unsupported protocol version, etc.)\n",
+			ip);
+		nutscan_free_device(nut_dev);
+		return NULL;
+	}
+
+	nut_dev->driver = strdup("netxml-ups");
+	snprintf(url, sizeof(url), "http://%s", ip);
+	/* FIXME: Should the IPv6 address here be bracketed?
+	 *  Does our driver support the notation? */
+	nut_dev->port = strdup(url);
+	upsdebugx(3,
+		"nutscan_xml_http_device(): "
+		"Adding configuration for driver='%s' port='%s'",
+		nut_dev->driver, nut_dev->port);
+
+	return nut_dev;
+}
+
 static void * nutscan_scan_xml_http_generic(void * arg)
 {
 	nutscan_xml_t * sec = (nutscan_xml_t *)arg;
@@ -231,7 +287,6 @@ static void * nutscan_scan_xml_http_generic(void * arg)
 
 /* FIXME : Per http://stackoverflow.com/questions/683624/udp-broadcast-on-all-interfaces
  * A single sendto() generates a single packet, so one must iterate all known interfaces... */
-#define MAX_RETRIES 3
 	for (i = 0; i != MAX_RETRIES ; i++) {
 		/* Initialize socket */
 		sockAddress_udp.sin_family = AF_INET;
@@ -279,9 +334,6 @@ static void * nutscan_scan_xml_http_generic(void * arg)
 			while ((ret = select(peerSocket + 1, &fds, NULL, NULL,
 						&timeout))
 			) {
-				ne_xml_parser	*parser;
-				int	parserFailed;
-
 				retNum ++;
 				upsdebugx(5, "nutscan_scan_xml_http_generic() : request to %s, "
 					"loop #%d/%d, response #%d",
@@ -323,62 +375,25 @@ static void * nutscan_scan_xml_http_generic(void * arg)
 					continue;
 				}
 
-				nut_dev = nutscan_new_device();
-				if (nut_dev == NULL) {
-					fprintf(stderr, "Memory allocation error\n");
-					goto end_abort;
-				}
-
 #ifdef HAVE_PTHREAD
 				pthread_mutex_lock(&dev_mutex);
 #endif
-				upsdebugx(5,
-					"Some host at IP %s replied to NetXML UDP request on port %d, "
-					"inspecting the response...",
-					string, port_udp);
-				nut_dev->type = TYPE_XML;
-				/* Try to read device type */
-				parser = (*nut_ne_xml_create)();
-				(*nut_ne_xml_push_handler)(parser, startelm_cb,
-							NULL, NULL, nut_dev);
 				/* recv_size is a ssize_t, so in range of size_t */
-				(*nut_ne_xml_parse)(parser, buf, (size_t)recv_size);
-				parserFailed = (*nut_ne_xml_failed)(parser); /* 0 = ok, nonzero = fail */
-				(*nut_ne_xml_destroy)(parser);
-
-				if (parserFailed == 0) {
-					nut_dev->driver = strdup("netxml-ups");
-					sprintf(buf, "http://%s", string);
-					/* FIXME: Should the IPv6 address here be bracketed?
-					 *  Does our driver support the notation? */
-					nut_dev->port = strdup(buf);
-					upsdebugx(3,
-						"nutscan_scan_xml_http_generic(): "
-						"Adding configuration for driver='%s' port='%s'",
-						nut_dev->driver, nut_dev->port);
-					dev_ret = nutscan_add_device_to_device(
+				nut_dev = nutscan_xml_http_device(buf, (size_t)recv_size,
+					string, port_udp);
+				if (nut_dev != NULL) {
+					dev_ret = nutscan_add_discovered_device(
 						dev_ret, nut_dev);
-#ifdef HAVE_PTHREAD
-					pthread_mutex_unlock(&dev_mutex);
-#endif
 				}
-				else
-				{
-					fprintf(stderr,
-						"Device at IP %s replied with NetXML but was not deemed compatible "
-						"with 'netxml-ups' driver (unsupported protocol version, etc.)\n",
-						string);
-					nutscan_free_device(nut_dev);
-					nut_dev = NULL;
 #ifdef HAVE_PTHREAD
-					pthread_mutex_unlock(&dev_mutex);
+				pthread_mutex_unlock(&dev_mutex);
 #endif
-					if (ip == NULL) {
-						/* skip this device; note that for a
-						 * broadcast scan there may be more
-						 * in the loop's queue */
-						continue;
-					}
+
+				if (nut_dev == NULL && ip == NULL) {
+					/* skip this device; note that for a
+					 * broadcast scan there may be more
+					 * in the loop's queue */
+					continue;
 				}
 
 				if (ip != NULL) {
@@ -400,12 +415,7 @@ static void * nutscan_scan_xml_http_generic(void * arg)
 	upsdebugx(2,
 		"nutscan_scan_xml_http_generic(): no replies collected for %s, done",
 		(ip ? ip : "<broadcast>"));
-	goto end;
 
-end_abort:
-	upsdebugx(1,
-		"Had to abort nutscan_scan_xml_http_generic() for %s, see fatal details above",
-		(ip ? ip : "<broadcast>"));
 end:
 	if (ip != NULL) /* do not free "ip", it comes from caller */
 		close(peerSocket);
@@ -437,58 +447,34 @@ nutscan_device_t * nutscan_scan_xml_http_range(const char * start_ip, const char
 	return ndret;
 }
 
-nutscan_device_t * nutscan_scan_ip_range_xml_http(nutscan_ip_range_list_t * irl, useconds_t usec_timeout, nutscan_xml_t * sec)
+#ifdef WIN32
+/* Thread-per-address engine, used where poll() on sockets is not available */
+static nutscan_device_t * scan_ip_range_xml_http_threads(nutscan_ip_range_list_t * irl, useconds_t usec_timeout, nutscan_xml_t * sec)
 {
 	bool_t pass = TRUE; /* Track that we may spawn a scanning thread */
 	nutscan_xml_t * tmp_sec = NULL;
 	nutscan_device_t * result = NULL;
-
-	if (!nutscan_avail_xml_http) {
-		return NULL;
-	}
-
-	/* We assume the list is maintained by our methods, so should not have
-	 * null addresses. But just in case - check for it a little tiny once.
-	 */
-	if (irl == NULL || irl->ip_ranges == NULL
-	 || irl->ip_ranges->start_ip == NULL || irl->ip_ranges->end_ip == NULL
-	) {
-		upsdebugx(1, "%s: Scanning XML/HTTP bus using broadcast.", __func__);
-		/* Fall through to after the if/else clause */
-	} else {
-		/* Iterate the one or a range of IPs to scan */
-		nutscan_ip_range_list_iter_t ip;
-		char * ip_str = NULL;
+	nutscan_ip_range_list_iter_t ip;
+	char * ip_str = NULL;
 #ifdef HAVE_PTHREAD
 # ifdef HAVE_SEMAPHORE
-		sem_t * semaphore = nutscan_semaphore();
-		sem_t   semaphore_scantype_inst;
-		sem_t * semaphore_scantype = &semaphore_scantype_inst;
+	sem_t * semaphore = nutscan_semaphore();
+	sem_t   semaphore_scantype_inst;
+	sem_t * semaphore_scantype = &semaphore_scantype_inst;
 # endif /* HAVE_SEMAPHORE */
-		pthread_t thread;
-		nutscan_thread_t * thread_array = NULL;
-		size_t thread_count = 0, i;
+	pthread_t thread;
+	nutscan_thread_t * thread_array = NULL;
+	size_t thread_count = 0, i;
 # if (defined HAVE_PTHREAD_TRYJOIN) || (defined HAVE_SEMAPHORE)
-		size_t  max_threads_scantype = max_threads_netxml;
+	size_t  max_threads_scantype = max_threads_netxml;
 # endif
 #endif
 
-		if (irl->ip_ranges_count == 1
-		&& (irl->ip_ranges->start_ip == irl->ip_ranges->end_ip
-		    || !strcmp(irl->ip_ranges->start_ip, irl->ip_ranges->end_ip)
-		)) {
-			upsdebugx(1, "%s: Scanning XML/HTTP bus for single IP address: %s",
-				__func__, irl->ip_ranges->start_ip);
-		} else {
-			upsdebugx(1, "%s: Scanning XML/HTTP bus for IP address range(s): %s",
-				__func__, nutscan_stringify_ip_ranges(irl));
-		}
-
 #ifdef HAVE_PTHREAD
-		pthread_mutex_init(&dev_mutex, NULL);
+	pthread_mutex_init(&dev_mutex, NULL);
 
 # ifdef HAVE_SEMAPHORE
-		if (max_threads_scantype > 0) {
+	if (max_threads_scantype > 0) {
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE
 #pragma GCC diagnostic push
 #endif
@@ -499,280 +485,549 @@ nutscan_device_t * nutscan_scan_ip_range_xml_http(nutscan_ip_range_list_t * irl,
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunreachable-code"
 #endif
-			/* Different platforms, different sizes, none fits all... */
-			if (SIZE_MAX > UINT_MAX && max_threads_scantype > UINT_MAX) {
+		/* Different platforms, different sizes, none fits all... */
+		if (SIZE_MAX > UINT_MAX && max_threads_scantype > UINT_MAX) {
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
 #ifdef HAVE_PRAGMAS_FOR_GCC_DIAGNOSTIC_IGNORED_UNREACHABLE_CODE
 #pragma GCC diagnostic pop
 #endif
-				upsdebugx(1,
-					"WARNING: %s: Limiting max_threads_scantype to range acceptable for sem_init()",
-					__func__);
-				max_threads_scantype = UINT_MAX - 1;
-			}
+			upsdebugx(1,
+				"WARNING: %s: Limiting max_threads_scantype to range acceptable for sem_init()",
+				__func__);
+			max_threads_scantype = UINT_MAX - 1;
+		}
 
-			upsdebugx(4, "%s: sem_init() for %" PRIuSIZE " threads", __func__, max_threads_scantype);
-			if (sem_init(semaphore_scantype, 0, (unsigned int)max_threads_scantype)) {
-				upsdebug_with_errno(4, "%s: sem_init() failed", __func__);
-			}
+		upsdebugx(4, "%s: sem_init() for %" PRIuSIZE " threads", __func__, max_threads_scantype);
+		if (sem_init(semaphore_scantype, 0, (unsigned int)max_threads_scantype)) {
+			upsdebug_with_errno(4, "%s: sem_init() failed", __func__);
 		}
+	}
 # endif /* HAVE_SEMAPHORE */
 
 #endif /* HAVE_PTHREAD */
 
-		ip_str = nutscan_ip_ranges_iter_init(&ip, irl);
+	ip_str = nutscan_ip_ranges_iter_init(&ip, irl);
 
-		while (ip_str != NULL) {
+	while (ip_str != NULL) {
 #ifdef HAVE_PTHREAD
-			/* NOTE: With many enough targets to scan, this can crash
-			 * by spawning too many children; add a limit and loop to
-			 * "reap" some already done with their work. And probably
-			 * account them in thread_array[] as something to not wait
-			 * for below in pthread_join()...
-			 */
+		/* NOTE: With many enough targets to scan, this can crash
+		 * by spawning too many children; add a limit and loop to
+		 * "reap" some already done with their work. And probably
+		 * account them in thread_array[] as something to not wait
+		 * for below in pthread_join()...
+		 */
 
 # ifdef HAVE_SEMAPHORE
-			/* Just wait for someone to free a semaphored slot,
-			 * if none are available, and then/otherwise grab one
+		/* Just wait for someone to free a semaphored slot,
+		 * if none are available, and then/otherwise grab one
+		 */
+		if (thread_array == NULL) {
+			/* Starting point, or after a wait to complete
+			 * all earlier runners */
+			if (max_threads_scantype > 0)
+				sem_wait(semaphore_scantype);
+			sem_wait(semaphore);
+			pass = TRUE;
+		} else {
+			/* If successful (the lock was acquired),
+			 * sem_wait() and sem_trywait() will return 0.
+			 * Otherwise, -1 is returned and errno is set,
+			 * and the state of the semaphore is unchanged.
 			 */
-			if (thread_array == NULL) {
-				/* Starting point, or after a wait to complete
-				 * all earlier runners */
-				if (max_threads_scantype > 0)
-					sem_wait(semaphore_scantype);
-				sem_wait(semaphore);
-				pass = TRUE;
-			} else {
-				/* If successful (the lock was acquired),
-				 * sem_wait() and sem_trywait() will return 0.
-				 * Otherwise, -1 is returned and errno is set,
-				 * and the state of the semaphore is unchanged.
-				 */
-				int	stwST = sem_trywait(semaphore_scantype), stwS = sem_trywait(semaphore);
-				pass = ((max_threads_scantype == 0 || stwST == 0) && stwS == 0);
-				upsdebugx(4, "%s: max_threads_scantype=%" PRIuSIZE
-					" curr_threads=%" PRIuSIZE
-					" thread_count=%" PRIuSIZE
-					" stwST=%d stwS=%d pass=%d",
-					__func__, max_threads_scantype,
-					curr_threads, thread_count,
-					stwST, stwS, pass
-				);
-			}
+			int	stwST = sem_trywait(semaphore_scantype), stwS = sem_trywait(semaphore);
+			pass = ((max_threads_scantype == 0 || stwST == 0) && stwS == 0);
+			upsdebugx(4, "%s: max_threads_scantype=%" PRIuSIZE
+				" curr_threads=%" PRIuSIZE
+				" thread_count=%" PRIuSIZE
+				" stwST=%d stwS=%d pass=%d",
+				__func__, max_threads_scantype,
+				curr_threads, thread_count,
+				stwST, stwS, pass
+			);
+		}
 # else
 #  ifdef HAVE_PTHREAD_TRYJOIN
-			/* A somewhat naive and brute-force solution for
-			 * systems without a semaphore.h. This may suffer
-			 * some off-by-one errors, using a few more threads
-			 * than intended (if we race a bit at the wrong time,
-			 * probably up to one per enabled scanner routine).
-			 */
+		/* A somewhat naive and brute-force solution for
+		 * systems without a semaphore.h. This may suffer
+		 * some off-by-one errors, using a few more threads
+		 * than intended (if we race a bit at the wrong time,
+		 * probably up to one per enabled scanner routine).
+		 */
+
+		/* TOTHINK: Should there be a threadcount_mutex when
+		 * we just read the value in if() and while() below?
+		 * At worst we would overflow the limit a bit due to
+		 * other protocol scanners...
+		 */
+		if (curr_threads >= max_threads
+		|| (curr_threads >= max_threads_scantype && max_threads_scantype > 0)
+		) {
+			upsdebugx(2, "%s: already running %" PRIuSIZE " scanning threads "
+				"(launched overall: %" PRIuSIZE "), "
+				"waiting until some would finish",
+				__func__, curr_threads, thread_count);
 
-			/* TOTHINK: Should there be a threadcount_mutex when
-			 * we just read the value in if() and while() below?
-			 * At worst we would overflow the limit a bit due to
-			 * other protocol scanners...
-			 */
-			if (curr_threads >= max_threads
-			|| (curr_threads >= max_threads_scantype && max_threads_scantype > 0)
+			while (curr_threads >= max_threads
+			   || (curr_threads >= max_threads_scantype && max_threads_scantype > 0)
 			) {
-				upsdebugx(2, "%s: already running %" PRIuSIZE " scanning threads "
-					"(launched overall: %" PRIuSIZE "), "
-					"waiting until some would finish",
-					__func__, curr_threads, thread_count);
+				for (i = 0; i < thread_count ; i++) {
+					int ret;
 
-				while (curr_threads >= max_threads
-				   || (curr_threads >= max_threads_scantype && max_threads_scantype > 0)
-				) {
-					for (i = 0; i < thread_count ; i++) {
-						int ret;
-
-						if (!thread_array[i].active) continue;
-
-						pthread_mutex_lock(&threadcount_mutex);
-						upsdebugx(3, "%s: Trying to join thread #%i...", __func__, i);
-						ret = pthread_tryjoin_np(thread_array[i].thread, NULL);
-						switch (ret) {
-							case ESRCH:     /* No thread with the ID thread could be found - already "joined"? */
-								upsdebugx(5, "%s: Was thread #%" PRIuSIZE " joined earlier?", __func__, i);
-								break;
-							case 0:         /* thread exited */
-								if (curr_threads > 0) {
-									curr_threads --;
-									upsdebugx(4, "%s: Joined a finished thread #%" PRIuSIZE, __func__, i);
-								} else {
-									/* threadcount_mutex fault? */
-									upsdebugx(0, "WARNING: %s: Accounting of thread count "
-										"says we are already at 0", __func__);
-								}
-								thread_array[i].active = FALSE;
-								break;
-							case EBUSY:     /* actively running */
-								upsdebugx(6, "%s: thread #%" PRIuSIZE " still busy (%i)",
-									__func__, i, ret);
-								break;
-							case EDEADLK:   /* Errors with thread interactions... bail out? */
-							case EINVAL:    /* Errors with thread interactions... bail out? */
-							default:        /* new pthreads abilities? */
-								upsdebugx(5, "%s: thread #%" PRIuSIZE " reported code %i",
-									__func__, i, ret);
-								break;
-						}
-						pthread_mutex_unlock(&threadcount_mutex);
-					}
+					if (!thread_array[i].active) continue;
 
-					if (curr_threads >= max_threads
-					|| (curr_threads >= max_threads_scantype && max_threads_scantype > 0)
-					) {
-							usleep (10000); /* microSec's, so 0.01s here */
+					pthread_mutex_lock(&threadcount_mutex);
+					upsdebugx(3, "%s: Trying to join thread #%i...", __func__, i);
+					ret = pthread_tryjoin_np(thread_array[i].thread, NULL);
+					switch (ret) {
+						case ESRCH:     /* No thread with the ID thread could be found - already "joined"? */
+							upsdebugx(5, "%s: Was thread #%" PRIuSIZE " joined earlier?", __func__, i);
+							break;
+						case 0:         /* thread exited */
+							if (curr_threads > 0) {
+								curr_threads --;
+								upsdebugx(4, "%s: Joined a finished thread #%" PRIuSIZE, __func__, i);
+							} else {
+								/* threadcount_mutex fault? */
+								upsdebugx(0, "WARNING: %s: Accounting of thread count "
+									"says we are already at 0", __func__);
+							}
+							thread_array[i].active = FALSE;
+							break;
+						case EBUSY:     /* actively running */
+							upsdebugx(6, "%s: thread #%" PRIuSIZE " still busy (%i)",
+								__func__, i, ret);
+							break;
+						case EDEADLK:   /* Errors with thread interactions... bail out? */
+						case EINVAL:    /* Errors with thread interactions... bail out? */
+						default:        /* new pthreads abilities? */
+							upsdebugx(5, "%s: thread #%" PRIuSIZE " reported code %i",
+								__func__, i, ret);
+							break;
 					}
+					pthread_mutex_unlock(&threadcount_mutex);
+				}
+
+				if (curr_threads >= max_threads
+				|| (curr_threads >= max_threads_scantype && max_threads_scantype > 0)
+				) {
+						usleep (10000); /* microSec's, so 0.01s here */
 				}
-				upsdebugx(2, "%s: proceeding with scan", __func__);
 			}
+			upsdebugx(2, "%s: proceeding with scan", __func__);
+		}
 
-			/* NOTE: No change to default "pass" in this ifdef:
-			 * if we got to this line, we have a slot to use */
+		/* NOTE: No change to default "pass" in this ifdef:
+		 * if we got to this line, we have a slot to use */
 #  endif /* HAVE_PTHREAD_TRYJOIN */
 # endif  /* HAVE_SEMAPHORE */
 #endif   /* HAVE_PTHREAD */
 
-			if (pass) {
-				tmp_sec = malloc(sizeof(nutscan_xml_t));
-				if (tmp_sec == NULL) {
-					fprintf(stderr,
-						"Memory allocation error\n");
-					return NULL;
-				}
-				memcpy(tmp_sec, sec, sizeof(nutscan_xml_t));
-				tmp_sec->peername = ip_str;
-				if (tmp_sec->usec_timeout <= 0) {
-					tmp_sec->usec_timeout = usec_timeout;
-				}
+		if (pass) {
+			tmp_sec = malloc(sizeof(nutscan_xml_t));
+			if (tmp_sec == NULL) {
+				fprintf(stderr,
+					"Memory allocation error\n");
+				return NULL;
+			}
+			memcpy(tmp_sec, sec, sizeof(nutscan_xml_t));
+			tmp_sec->peername = ip_str;
+			if (tmp_sec->usec_timeout <= 0) {
+				tmp_sec->usec_timeout = usec_timeout;
+			}
 
 #ifdef HAVE_PTHREAD
-				if (pthread_create(&thread, NULL, nutscan_scan_xml_http_generic, (void *)tmp_sec) == 0) {
-					nutscan_thread_t	*new_thread_array;
+			if (pthread_create(&thread, NULL, nutscan_scan_xml_http_generic, (void *)tmp_sec) == 0) {
+				nutscan_thread_t	*new_thread_array;
 # ifdef HAVE_PTHREAD_TRYJOIN
-					pthread_mutex_lock(&threadcount_mutex);
-					curr_threads++;
+				pthread_mutex_lock(&threadcount_mutex);
+				curr_threads++;
 # endif /* HAVE_PTHREAD_TRYJOIN */
 
-					thread_count++;
-					new_thread_array = realloc(thread_array,
-						thread_count * sizeof(nutscan_thread_t));
-					if (new_thread_array == NULL) {
-						upsdebugx(1, "%s: Failed to realloc thread array", __func__);
-						break;
-					}
-					else {
-						thread_array = new_thread_array;
-					}
-					thread_array[thread_count - 1].thread = thread;
-					thread_array[thread_count - 1].active = TRUE;
+				thread_count++;
+				new_thread_array = realloc(thread_array,
+					thread_count * sizeof(nutscan_thread_t));
+				if (new_thread_array == NULL) {
+					upsdebugx(1, "%s: Failed to realloc thread array", __func__);
+					break;
+				}
+				else {
+					thread_array = new_thread_array;
+				}
+				thread_array[thread_count - 1].thread = thread;
+				thread_array[thread_count - 1].active = TRUE;
 
 # ifdef HAVE_PTHREAD_TRYJOIN
-					pthread_mutex_unlock(&threadcount_mutex);
+				pthread_mutex_unlock(&threadcount_mutex);
 # endif /* HAVE_PTHREAD_TRYJOIN */
-				}
+			}
 #else /* not HAVE_PTHREAD */
-				nutscan_scan_xml_http_generic((void *)tmp_sec);
+			nutscan_scan_xml_http_generic((void *)tmp_sec);
 #endif /* if HAVE_PTHREAD */
 
-				/* Prepare the next iteration */
+			/* Prepare the next iteration */
 /*				free(ip_str); */ /* One of these free()s seems to cause a double-free instead */
-				ip_str = nutscan_ip_ranges_iter_inc(&ip);
+			ip_str = nutscan_ip_ranges_iter_inc(&ip);
 /*				free(tmp_sec); */
-			} else { /* if not pass -- all slots busy */
+		} else { /* if not pass -- all slots busy */
 #ifdef HAVE_PTHREAD
 # ifdef HAVE_SEMAPHORE
-				/* Wait for all current scans to complete */
-				if (thread_array != NULL) {
-					upsdebugx (2, "%s: Running too many scanning threads (%"
-						PRIuSIZE "), "
-						"waiting until older ones would finish",
-						__func__, thread_count);
-					for (i = 0; i < thread_count ; i++) {
-						int ret;
-						if (!thread_array[i].active) {
-							/* Probably should not get here,
-							 * but handle it just in case */
-							upsdebugx(0, "WARNING: %s: Midway clean-up: did not expect thread %" PRIuSIZE " to be not active",
-								__func__, i);
-							sem_post(semaphore);
-							if (max_threads_scantype > 0)
-								sem_post(semaphore_scantype);
-							continue;
-						}
-						thread_array[i].active = FALSE;
-						ret = pthread_join(thread_array[i].thread, NULL);
-						if (ret != 0) {
-							upsdebugx(0, "WARNING: %s: Midway clean-up: pthread_join() returned code %i",
-								__func__, ret);
-						}
+			/* Wait for all current scans to complete */
+			if (thread_array != NULL) {
+				upsdebugx (2, "%s: Running too many scanning threads (%"
+					PRIuSIZE "), "
+					"waiting until older ones would finish",
+					__func__, thread_count);
+				for (i = 0; i < thread_count ; i++) {
+					int ret;
+					if (!thread_array[i].active) {
+						/* Probably should not get here,
+						 * but handle it just in case */
+						upsdebugx(0, "WARNING: %s: Midway clean-up: did not expect thread %" PRIuSIZE " to be not active",
+							__func__, i);
 						sem_post(semaphore);
 						if (max_threads_scantype > 0)
 							sem_post(semaphore_scantype);
+						continue;
+					}
+					thread_array[i].active = FALSE;
+					ret = pthread_join(thread_array[i].thread, NULL);
+					if (ret != 0) {
+						upsdebugx(0, "WARNING: %s: Midway clean-up: pthread_join() returned code %i",
+							__func__, ret);
 					}
-					thread_count = 0;
-					free(thread_array);
-					thread_array = NULL;
+					sem_post(semaphore);
+					if (max_threads_scantype > 0)
+						sem_post(semaphore_scantype);
 				}
+				thread_count = 0;
+				free(thread_array);
+				thread_array = NULL;
+			}
 # else
 #  ifdef HAVE_PTHREAD_TRYJOIN
-				/* TODO: Move the wait-loop for TRYJOIN here? */
+			/* TODO: Move the wait-loop for TRYJOIN here? */
 #  endif /* HAVE_PTHREAD_TRYJOIN */
 # endif  /* HAVE_SEMAPHORE */
 #endif   /* HAVE_PTHREAD */
-			} /* if: could we "pass" or not? */
-		} /* while */
+		} /* if: could we "pass" or not? */
+	} /* while */
 
 #ifdef HAVE_PTHREAD
-		if (thread_array != NULL) {
-			upsdebugx(2, "%s: all planned scans launched, waiting for threads to complete", __func__);
-			for (i = 0; i < thread_count; i++) {
-				int ret;
+	if (thread_array != NULL) {
+		upsdebugx(2, "%s: all planned scans launched, waiting for threads to complete", __func__);
+		for (i = 0; i < thread_count; i++) {
+			int ret;
 
-				if (!thread_array[i].active) continue;
+			if (!thread_array[i].active) continue;
 
-				ret = pthread_join(thread_array[i].thread, NULL);
-				if (ret != 0) {
-					upsdebugx(0, "WARNING: %s: Clean-up: pthread_join() returned code %i",
-						__func__, ret);
-				}
-				thread_array[i].active = FALSE;
+			ret = pthread_join(thread_array[i].thread, NULL);
+			if (ret != 0) {
+				upsdebugx(0, "WARNING: %s: Clean-up: pthread_join() returned code %i",
+					__func__, ret);
+			}
+			thread_array[i].active = FALSE;
 # ifdef HAVE_SEMAPHORE
-				sem_post(semaphore);
-				if (max_threads_scantype > 0)
-					sem_post(semaphore_scantype);
+			sem_post(semaphore);
+			if (max_threads_scantype > 0)
+				sem_post(semaphore_scantype);
 # else
 #  ifdef HAVE_PTHREAD_TRYJOIN
-				pthread_mutex_lock(&threadcount_mutex);
-				if (curr_threads > 0) {
-					curr_threads --;
-					upsdebugx(5, "%s: Clean-up: Joined a finished thread #%" PRIuSIZE,
-						__func__, i);
-				} else {
-					upsdebugx(0, "WARNING: %s: Clean-up: Accounting of thread count "
-						"says we are already at 0", __func__);
-				}
-				pthread_mutex_unlock(&threadcount_mutex);
+			pthread_mutex_lock(&threadcount_mutex);
+			if (curr_threads > 0) {
+				curr_threads --;
+				upsdebugx(5, "%s: Clean-up: Joined a finished thread #%" PRIuSIZE,
+					__func__, i);
+			} else {
+				upsdebugx(0, "WARNING: %s: Clean-up: Accounting of thread count "
+					"says we are already at 0", __func__);
+			}
+			pthread_mutex_unlock(&threadcount_mutex);
 #  endif /* HAVE_PTHREAD_TRYJOIN */
 # endif /* HAVE_SEMAPHORE */
-			}
-			free(thread_array);
-			upsdebugx(2, "%s: all threads freed", __func__);
 		}
-		pthread_mutex_destroy(&dev_mutex);
+		free(thread_array);
+		upsdebugx(2, "%s: all threads freed", __func__);
+	}
+	pthread_mutex_destroy(&dev_mutex);
 
 # ifdef HAVE_SEMAPHORE
-		if (max_threads_scantype > 0)
-			sem_destroy(semaphore_scantype);
+	if (max_threads_scantype > 0)
+		sem_destroy(semaphore_scantype);
 # endif /* HAVE_SEMAPHORE */
 #endif /* HAVE_PTHREAD */
 
-		result = nutscan_rewind_device(dev_ret);
+	result = nutscan_rewind_device(dev_ret);
+	dev_ret = NULL;
+	return result;
+}
+
+#else	/* !WIN32 */
+
+/* Event-driven engine: a single thread keeps a window of addresses in
+ * flight on one UDP socket and multiplexes them with poll(), matching the
+ * replies to the addresses they come from. Like the thread-per-address
+ * engine, each address is asked up to MAX_RETRIES times, waiting for the
+ * scan timeout after each request, until it replies. */
+
+typedef struct {
+	char	*ip;		/* NULL when the slot is free */
+	struct in_addr	addr;
+	int	attempts;
+	struct timeval	deadline;
+} scan_xml_target_t;
+
+static nutscan_device_t * scan_ip_range_xml_http_events(nutscan_ip_range_list_t * irl, useconds_t usec_timeout, nutscan_xml_t * sec)
+{
+	const char	*scanMsg = "<SCAN_REQUEST/>";
+	uint16_t	port_udp = 4679;
+	nutscan_ip_range_list_iter_t	ip;
+	char	*ip_str = NULL;
+	scan_xml_target_t	*targets;
+	size_t	window, inflight = 0, slot = 0, i;
+	struct sockaddr_in	sockAddress_udp;
+	socklen_t	sockAddressLength;
+	struct pollfd	pfd;
+	struct timeval	now;
+	double	remaining, wait;
+	char	buf[SMALLBUF + 8];
+	ssize_t	recv_size;
+	int	peerSocket, ret, timeout_ms;
+	nutscan_device_t	*nut_dev;
+
+	if (sec != NULL) {
+		if (sec->port_udp > 0 && sec->port_udp <= 65534)
+			port_udp = sec->port_udp;
+		if (sec->usec_timeout > 0)
+			usec_timeout = sec->usec_timeout;
+	}
+
+	if (usec_timeout <= 0)
+		usec_timeout = 5000000; /* Driver default : 5sec */
+
+	/* The same limits apply as to the amount of scanning threads */
+#if (defined HAVE_PTHREAD) && ((defined HAVE_PTHREAD_TRYJOIN) || (defined HAVE_SEMAPHORE))
+	window = max_threads;
+	if (max_threads_netxml > 0 && max_threads_netxml < window) {
+		window = max_threads_netxml;
+	}
+#else
+	window = DEFAULT_THREAD;
+#endif
+	if (window < 1) {
+		window = 1;
+	}
+
+	if ((peerSocket = socket(AF_INET, SOCK_DGRAM, 0)) == -1) {
+		fprintf(stderr, "Error creating socket\n");
+		return NULL;
+	}
+
+	if (fcntl(peerSocket, F_SETFL, fcntl(peerSocket, F_GETFL) | O_NONBLOCK) < 0) {
+		upsdebug_with_errno(1, "%s: fcntl", __func__);
+		close(peerSocket);
+		return NULL;
+	}
+
+	upsdebugx(2, "%s: up to %" PRIuSIZE " addresses in flight, "
+		"%d attempt(s) with a timeout of %" PRIdMAX " usec",
+		__func__, window, MAX_RETRIES, (uintmax_t)usec_timeout);
+
+	targets = xcalloc(window, sizeof(*targets));
+
+	ip_str = nutscan_ip_ranges_iter_init(&ip, irl);
+
+	while (ip_str != NULL || inflight > 0) {
+		/* Top up the window with new addresses, asked at once */
+		while (ip_str != NULL && inflight < window) {
+			while (targets[slot].ip != NULL) {
+				slot = (slot + 1) % window;
+			}
+
+			if (inet_pton(AF_INET, ip_str, &targets[slot].addr) != 1) {
+				upsdebugx(3, "%s: %s: not an IPv4 address, skipped",
+					__func__, ip_str);
+				free(ip_str);
+			} else {
+				targets[slot].ip = ip_str;
+				targets[slot].attempts = 0;
+				timerclear(&targets[slot].deadline);
+				inflight++;
+			}
+
+			ip_str = nutscan_ip_ranges_iter_inc(&ip);
+		}
+
+		/* (Re)send the requests which are due, give up on the
+		 * addresses which had all their chances */
+		gettimeofday(&now, NULL);
+		wait = -1;
+		for (i = 0; i < window; i++) {
+			if (targets[i].ip == NULL) {
+				continue;
+			}
+
+			remaining = difftimeval(targets[i].deadline, now);
+			if (remaining <= 0) {
+				if (targets[i].attempts == MAX_RETRIES) {
+					upsdebugx(2, "%s: no replies collected for %s",
+						__func__, targets[i].ip);
+					free(targets[i].ip);
+					targets[i].ip = NULL;
+					inflight--;
+					continue;
+				}
+
+				targets[i].attempts++;
+				upsdebugx(4, "%s: scanning IP '%s' with a unicast, attempt %d of %d",
+					__func__, targets[i].ip, targets[i].attempts, MAX_RETRIES);
+
+				memset(&sockAddress_udp, 0, sizeof(sockAddress_udp));
+				sockAddress_udp.sin_family = AF_INET;
+				sockAddress_udp.sin_addr = targets[i].addr;
+				sockAddress_udp.sin_port = htons(port_udp);
+
+				if (sendto(peerSocket, scanMsg, strlen(scanMsg), 0,
+					(struct sockaddr *)&sockAddress_udp,
+					sizeof(sockAddress_udp)) <= 0
+				) {
+					fprintf(stderr,
+						"Error sending Eaton <SCAN_REQUEST/> to %s, #%d/%d\n",
+						targets[i].ip, targets[i].attempts, MAX_RETRIES);
+				}
+
+				/* Wait for the timeout even if sending failed,
+				 * as the thread-per-address engine does */
+				targets[i].deadline = now;
+				targets[i].deadline.tv_sec += (time_t)(usec_timeout / 1000000);
+				targets[i].deadline.tv_usec += (suseconds_t)(usec_timeout % 1000000);
+				if (targets[i].deadline.tv_usec >= 1000000) {
+					targets[i].deadline.tv_sec++;
+					targets[i].deadline.tv_usec -= 1000000;
+				}
+				remaining = difftimeval(targets[i].deadline, now);
+			}
+
+			if (wait < 0 || remaining < wait) {
+				wait = remaining;
+			}
+		}
+
+		if (inflight == 0) {
+			continue;
+		}
+
+		/* Round up, so we do not spin just short of a deadline */
+		timeout_ms = (wait > (double)(INT_MAX / 1000)) ? INT_MAX : (int)(wait * 1000) + 1;
+
+		pfd.fd = peerSocket;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		ret = poll(&pfd, 1, timeout_ms);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			upsdebug_with_errno(1, "%s: poll", __func__);
+			break;
+		}
+
+		if (ret == 0) {
+			continue;
+		}
+
+		/* Take all the replies which arrived */
+		for (;;) {
+			sockAddressLength = sizeof(sockAddress_udp);
+			recv_size = recvfrom(peerSocket, buf, sizeof(buf), 0,
+				(struct sockaddr *)&sockAddress_udp,
+				&sockAddressLength);
+
+			if (recv_size < 0) {
+				if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+					upsdebug_with_errno(3, "%s: recvfrom", __func__);
+				}
+				break;
+			}
+
+			for (i = 0; i < window; i++) {
+				if (targets[i].ip != NULL
+				 && targets[i].addr.s_addr == sockAddress_udp.sin_addr.s_addr
+				) {
+					break;
+				}
+			}
+
+			if (i == window) {
+				/* A late reply to an address we are done with,
+				 * or not asked at all */
+				upsdebugx(4, "%s: ignoring a reply from %s", __func__,
+					inet_ntoa(sockAddress_udp.sin_addr));
+				continue;
+			}
+
+			/* recv_size is a ssize_t, so in range of size_t */
+			nut_dev = nutscan_xml_http_device(buf, (size_t)recv_size,
+				targets[i].ip, port_udp);
+			if (nut_dev != NULL) {
+				dev_ret = nutscan_add_discovered_device(dev_ret, nut_dev);
+			}
+
+			upsdebugx(2, "%s: we collected one reply to unicast for %s, done",
+				__func__, targets[i].ip);
+			free(targets[i].ip);
+			targets[i].ip = NULL;
+			inflight--;
+		}
+	}
+
+	for (i = 0; i < window; i++) {
+		free(targets[i].ip);
+	}
+	free(targets);
+	free(ip_str);
+	close(peerSocket);
+
+	return nutscan_rewind_device(dev_ret);
+}
+#endif	/* !WIN32 */
+
+nutscan_device_t * nutscan_scan_ip_range_xml_http(nutscan_ip_range_list_t * irl, useconds_t usec_timeout, nutscan_xml_t * sec)
+{
+	nutscan_xml_t * tmp_sec = NULL;
+	nutscan_device_t * result = NULL;
+
+	if (!nutscan_avail_xml_http) {
+		return NULL;
+	}
+
+	/* We assume the list is maintained by our methods, so should not have
+	 * null addresses. But just in case - check for it a little tiny once.
+	 */
+	if (irl == NULL || irl->ip_ranges == NULL
+	 || irl->ip_ranges->start_ip == NULL || irl->ip_ranges->end_ip == NULL
+	) {
+		upsdebugx(1, "%s: Scanning XML/HTTP bus using broadcast.", __func__);
+		/* Fall through to after the if/else clause */
+	} else {
+		if (irl->ip_ranges_count == 1
+		&& (irl->ip_ranges->start_ip == irl->ip_ranges->end_ip
+		    || !strcmp(irl->ip_ranges->start_ip, irl->ip_ranges->end_ip)
+		)) {
+			upsdebugx(1, "%s: Scanning XML/HTTP bus for single IP address: %s",
+				__func__, irl->ip_ranges->start_ip);
+		} else {
+			upsdebugx(1, "%s: Scanning XML/HTTP bus for IP address range(s): %s",
+				__func__, nutscan_stringify_ip_ranges(irl));
+		}
+
+#ifdef WIN32
+		result = scan_ip_range_xml_http_threads(irl, usec_timeout, sec);
+#else
+		result = scan_ip_range_xml_http_events(irl, usec_timeout, sec);
+#endif
 		dev_ret = NULL;
 		return result;
 	}	/* end of: scan range of 1+ IP address(es), maybe in parallel */